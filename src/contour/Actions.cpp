@@ -62,6 +62,7 @@ optional<Action> fromString(string const& _name)
         mapAction<actions::PasteClipboard>("PasteClipboard"),
         mapAction<actions::PasteSelection>("PasteSelection"),
         mapAction<actions::Quit>("Quit"),
+        mapAction<actions::SaveTrace>("SaveTrace"),
         mapAction<actions::ScreenshotVT>("ScreenshotVT"),
         mapAction<actions::ScrollDown>("ScrollDown"),
         mapAction<actions::ScrollOneDown>("ScrollOneDown"),
@@ -80,6 +81,11 @@ optional<Action> fromString(string const& _name)
         mapAction<actions::ReloadConfig>("ReloadConfig"),
         mapAction<actions::ResetConfig>("ResetConfig"),
         mapAction<actions::CopyPreviousMarkRange>("CopyPreviousMarkRange"),
+        mapAction<actions::CopyLastCommandOutput>("CopyLastCommandOutput"),
+        mapAction<actions::SearchSelection>("SearchSelection"),
+        mapAction<actions::SearchNext>("SearchNext"),
+        mapAction<actions::SearchPrevious>("SearchPrevious"),
+        mapAction<actions::ClearSearch>("ClearSearch"),
     };
 
     auto const name = toLower(_name);
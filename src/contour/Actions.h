@@ -50,6 +50,12 @@ struct ResetFontSize{};
 struct ReloadConfig{ std::optional<std::string> profileName; };
 struct ResetConfig{};
 struct CopyPreviousMarkRange{};
+struct CopyLastCommandOutput{};
+struct SaveTrace{};
+struct SearchSelection{};
+struct SearchNext{};
+struct SearchPrevious{};
+struct ClearSearch{};
 // CloseTab
 // OpenTab
 // FocusNextTab
@@ -86,7 +92,13 @@ using Action = std::variant<
     OpenConfiguration,
     OpenFileManager,
     Quit,
-    CopyPreviousMarkRange
+    CopyPreviousMarkRange,
+    CopyLastCommandOutput,
+    SaveTrace,
+    SearchSelection,
+    SearchNext,
+    SearchPrevious,
+    ClearSearch
 >;
 
 std::optional<Action> fromString(std::string const& _name);
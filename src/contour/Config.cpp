@@ -636,6 +636,15 @@ terminal::ColorProfile loadColorScheme(YAML::Node const& _node)
             colors.selectionBackground.reset();
     }
 
+    if (auto def = _node["search_match"]; def && def.IsMap())
+    {
+        if (auto fg = def["foreground"]; fg && fg.IsScalar() && !fg.as<string>().empty())
+            colors.searchMatchForeground = fg.as<string>();
+
+        if (auto bg = def["background"]; bg && bg.IsScalar() && !bg.as<string>().empty())
+            colors.searchMatchBackground = bg.as<string>();
+    }
+
     if (auto cursor = _node["cursor"]; cursor && cursor.IsScalar() && !cursor.as<string>().empty())
         colors.cursor = cursor.as<string>();
 
@@ -1023,6 +1032,15 @@ TerminalProfile loadTerminalProfile(YAML::Node const& _node,
                 profile.hyperlinkDecoration.hover = *pdeco;
     }
 
+    if (auto pacing = _node["frame_pacing"]; pacing)
+    {
+        softLoadValue(pacing, "adaptive", profile.framePacing.adaptive);
+        softLoadValue(pacing, "max_fps_under_pressure", profile.framePacing.maxFramesPerSecondUnderPressure);
+        softLoadValue(pacing, "pressure_throughput", profile.framePacing.pressureThroughput);
+        if (auto window = pacing["input_latency_window"]; window)
+            profile.framePacing.inputLatencyWindow = chrono::milliseconds(window.as<int>());
+    }
+
     if (auto cursor = _node["cursor"]; cursor)
     {
         if (auto shape = cursor["shape"]; shape)
@@ -1060,6 +1078,24 @@ void loadConfigFromFile(Config& _config, FileSystem::path const& _fileName)
         softLoadValue(images, "max_height", _config.maxImageSize.height);
     }
 
+    if (auto ptyBuffer = doc["pty_buffer"]; ptyBuffer)
+    {
+        softLoadValue(ptyBuffer, "high_watermark", _config.ptyBufferLimits.highWatermark);
+        softLoadValue(ptyBuffer, "low_watermark", _config.ptyBufferLimits.lowWatermark);
+        softLoadValue(ptyBuffer, "slice_size", _config.ptyBufferLimits.sliceSize);
+    }
+
+    if (auto metricsExport = doc["metrics_export"]; metricsExport)
+    {
+        if (auto path = metricsExport["path"]; path && !path.as<string>().empty())
+            _config.metricsExportPath = FileSystem::path(path.as<string>());
+        if (auto interval = metricsExport["interval"]; interval)
+            _config.metricsExportInterval = chrono::milliseconds(max(interval.as<int>(), 100));
+    }
+
+    if (auto traceFile = doc["trace_file"]; traceFile && !traceFile.as<string>().empty())
+        _config.traceFilePath = FileSystem::path(traceFile.as<string>());
+
     if (auto scrollbar = doc["scrollbar"]; scrollbar)
     {
         if (auto value = scrollbar["position"]; value)
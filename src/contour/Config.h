@@ -20,10 +20,13 @@
 #include <terminal_renderer/TextRenderer.h>         // FontDescriptions
 #include <terminal_renderer/DecorationRenderer.h>   // Decorator
 
+#include <terminal_view/FramePacer.h>             // FramePacingPolicy
+
 #include <terminal/Color.h>
 #include <terminal/Process.h>
 #include <terminal/Sequencer.h>                 // CursorDisplay
 #include <terminal/Size.h>
+#include <terminal/Terminal.h>              // PtyBufferLimits
 
 #include <text_shaper/font.h>
 
@@ -86,6 +89,8 @@ struct TerminalProfile {
         terminal::renderer::Decorator normal = terminal::renderer::Decorator::DottedUnderline;
         terminal::renderer::Decorator hover = terminal::renderer::Decorator::Underline;
     } hyperlinkDecoration;
+
+    terminal::view::FramePacingPolicy framePacing;
 };
 
 using terminal::renderer::opengl::ShaderConfig;
@@ -127,6 +132,18 @@ struct Config {
 
     ScrollBarPosition scrollbarPosition = ScrollBarPosition::Right;
     bool hideScrollbarInAltScreen = true;
+
+    terminal::PtyBufferLimits ptyBufferLimits{};
+
+    /// File to periodically export the performance metrics into, if set.
+    std::optional<FileSystem::path> metricsExportPath;
+    std::chrono::milliseconds metricsExportInterval{1000};
+
+    /// File to write the timeline trace into, upon action SaveTrace or signal SIGUSR1.
+    FileSystem::path traceFilePath = FileSystem::temp_directory_path() / "contour-trace.json";
+
+    /// File to record the session's PTY output into, if set (see command line option --record).
+    std::optional<FileSystem::path> sessionRecordingPath;
 };
 
 std::optional<std::string> readConfigFile(std::string const& _filename);
@@ -15,7 +15,6 @@
 #include <contour/Actions.h>
 
 #include <terminal/Color.h>
-#include <terminal/Metrics.h>
 #include <terminal/pty/Pty.h>
 
 #if defined(_MSC_VER)
@@ -25,11 +24,14 @@
 #endif
 
 #include <crispy/debuglog.h>
+#include <crispy/metrics.h>
+#include <crispy/trace.h>
 
 #include <terminal_renderer/opengl/OpenGLRenderer.h>
 
 #include <QtCore/QDebug>
 #include <QtCore/QMetaObject>
+#include <QtCore/QMimeData>
 #include <QtCore/QFileInfo>
 #include <QtCore/QProcess>
 #include <QtCore/QTimer>
@@ -49,6 +51,7 @@
 
 #include <cstring>
 #include <fstream>
+#include <limits>
 #include <stdexcept>
 #include <string_view>
 
@@ -64,8 +67,10 @@ using std::get;
 using std::holds_alternative;
 using std::ios;
 using std::lock_guard;
+using std::make_shared;
 using std::make_unique;
 using std::max;
+using std::min;
 using std::move;
 using std::nullopt;
 using std::ofstream;
@@ -74,23 +79,12 @@ using std::pair;
 using std::ref;
 using std::runtime_error;
 using std::scoped_lock;
+using std::shared_ptr;
 using std::string;
 using std::string_view;
 
 using namespace std::string_view_literals;
 
-#if defined(CONTOUR_PERF_STATS)
-#define STATS_INC(name)   ++(stats_. name)
-#define STATS_ZERO(name)  (stats_. name = 0)
-#define STATS_GET(name)   (stats_. name).load()
-#define STATS_SET(name)   (stats_. name) =
-#else
-#define STATS_INC(name)   do {} while (0)
-#define STATS_ZERO(name)  do {} while (0)
-#define STATS_GET(name)   0
-#define STATS_SET(name)   /*!*/
-#endif
-
 #if defined(_MSC_VER)
 #define __PRETTY_FUNCTION__ __FUNCDNAME__
 #endif
@@ -381,6 +375,53 @@ namespace // {{{
        ~FunctionCallEvent() { fun(); }
     };
 
+    /// Clipboard data that converts the (possibly huge) selected text only once it is being requested.
+    class SelectionMimeData : public QMimeData {
+      public:
+        /// Maximum number of bytes of text that can be handed out.
+        static constexpr size_t MaxSize = std::numeric_limits<int>::max() / 2 - 64;
+
+        explicit SelectionMimeData(shared_ptr<terminal::ChunkedText> _text) : text_{move(_text)} {}
+
+        QStringList formats() const override
+        {
+            return {QStringLiteral("text/plain;charset=utf-8"), QStringLiteral("text/plain")};
+        }
+
+        bool hasFormat(QString const& _mimeType) const override { return formats().contains(_mimeType); }
+
+      protected:
+        QVariant retrieveData(QString const& _mimeType, QVariant::Type _type) const override
+        {
+            if (!hasFormat(_mimeType))
+                return QMimeData::retrieveData(_mimeType, _type);
+
+            // Qt's containers (including their allocation header) are limited to INT_MAX bytes,
+            // and the converted QString takes up to two bytes per UTF-8 byte.
+            if (text_->size() > MaxSize)
+            {
+                debuglog(WidgetTag).write("Selected text of {} bytes is too large for the clipboard.", text_->size());
+                return QVariant{};
+            }
+
+            QByteArray data;
+            data.reserve(static_cast<int>(text_->size()));
+            for (auto const& chunk : text_->chunks())
+                data.append(chunk.data(), static_cast<int>(chunk.size()));
+
+            if (_type == QVariant::String)
+                return QString::fromUtf8(data);
+
+            return data;
+        }
+
+      private:
+        shared_ptr<terminal::ChunkedText> text_;
+    };
+
+    /// Event type used to wake up the GUI thread for processing pending updates.
+    QEvent::Type const WakeEventType = static_cast<QEvent::Type>(QEvent::registerEventType());
+
     template <typename F>
     void postToObject(QObject* obj, F fun)
     {
@@ -407,7 +448,9 @@ TerminalWidget::TerminalWidget(config::Config _config,
     fonts_{ profile().fonts },
     terminalView_{},
     configFileChangeWatcher_{},
-    updateTimer_(this)
+    updateTimer_(this),
+    frameTimer_(this),
+    framePacer_{ profile_.framePacing }
 {
     debuglog(WidgetTag).write("ctor: terminalSize={}, fontSize={}, contentScale={}, geometry={}:{}..{}:{}",
                               config_.profile(config_.defaultProfileName)->terminalSize,
@@ -447,6 +490,10 @@ TerminalWidget::TerminalWidget(config::Config _config,
     updateTimer_.setSingleShot(true);
     connect(&updateTimer_, &QTimer::timeout, this, QOverload<>::of(&TerminalWidget::blinkingCursorUpdate));
 
+    frameTimer_.setSingleShot(true);
+    frameTimer_.setTimerType(Qt::PreciseTimer);
+    connect(&frameTimer_, &QTimer::timeout, this, QOverload<>::of(&TerminalWidget::update));
+
     connect(this, SIGNAL(frameSwapped()), this, SLOT(onFrameSwapped()));
 
     //TODO: connect(this, SIGNAL(screenChanged(QScreen*)), this, SLOT(onScreenChanged(QScreen*)));
@@ -456,7 +503,6 @@ TerminalWidget::~TerminalWidget()
 {
     debuglog(WidgetTag).write("TerminalWidget.dtor!");
     makeCurrent(); // XXX must be called.
-    statsSummary();
 }
 
 
@@ -465,16 +511,6 @@ int TerminalWidget::pointsToPixels(text::font_size _size) const noexcept
     return int(ceil(_size.pt / 72.0 * 96.0 * contentScale()));
 }
 
-void TerminalWidget::statsSummary()
-{
-#if defined(CONTOUR_VT_METRICS)
-    std::cout << "Some small summary in VT sequences usage metrics\n";
-    std::cout << "================================================\n\n";
-    for (auto const& [name, freq] : terminalMetrics_.ordered())
-        std::cout << fmt::format("{:>10}: {}\n", freq, name);
-#endif
-}
-
 void TerminalWidget::createScrollBar()
 {
     scrollBar_ = new QScrollBar(this);
@@ -534,14 +570,7 @@ void TerminalWidget::blinkingCursorUpdate()
 
 void TerminalWidget::onFrameSwapped()
 {
-#if defined(CONTOUR_PERF_STATS)
-    qDebug() << QString::fromStdString(fmt::format(
-        "Consecutive renders: {}, updates since last render: {}; {}",
-        STATS_GET(consecutiveRenderCount),
-        STATS_GET(updatesSinceRendering),
-        terminalView_->renderer().metrics().to_string()
-    ));
-#endif
+    terminalView_->terminal().framePresented(steady_clock::now());
 
     for (;;)
     {
@@ -562,8 +591,7 @@ void TerminalWidget::onFrameSwapped()
 
                 //QCoreApplication::postEvent(this, new QEvent(QEvent::UpdateRequest));
                 //requestUpdate();
-                // TODO(don't do pressure-optimizations right now) renderingPressure_ = true;
-                update();
+                scheduleFrame();
                 return;
             case State::CleanPainting:
                 if (!state_.compare_exchange_strong(state, State::CleanIdle))
@@ -571,7 +599,6 @@ void TerminalWidget::onFrameSwapped()
                 [[fallthrough]];
             case State::CleanIdle:
                 renderingPressure_ = false;
-                STATS_ZERO(consecutiveRenderCount);
                 if (profile().cursorDisplay == terminal::CursorDisplay::Blink
                         && terminalView_->terminal().cursorVisibility())
                     updateTimer_.start(terminalView_->terminal().nextRender(steady_clock::now()));
@@ -686,6 +713,20 @@ void TerminalWidget::initializeGL()
     screen.setMaxImageColorRegisters(config_.maxImageColorRegisters);
     screen.setSixelCursorConformance(config_.sixelCursorConformance);
 
+    terminalView_->terminal().setPtyBufferLimits(config_.ptyBufferLimits);
+
+    if (config_.sessionRecordingPath.has_value())
+    {
+        try
+        {
+            terminalView_->terminal().startRecording(config_.sessionRecordingPath->string());
+        }
+        catch (exception const& e)
+        {
+            cerr << "Failed to start session recording. " << e.what() << endl;
+        }
+    }
+
     if (profile_.maximized)
         window()->showMaximized();
 
@@ -733,17 +774,12 @@ void TerminalWidget::resizeGL(int _width, int _height)
 
 void TerminalWidget::paintGL()
 {
-// #if defined(CONTOUR_PERF_STATS)
-//     qDebug() << QString::fromStdString(fmt::format(
-//         "paintGL: consecutive renders: {}, updates since last render: {}; {}",
-//         STATS_GET(consecutiveRenderCount),
-//         STATS_GET(updatesSinceRendering),
-//         terminalView_->renderer().metrics().to_string()
-//     ));
-// #endif
-
     try {
-        STATS_INC(consecutiveRenderCount);
+        // Applied before the state is marked as painting, as it may scroll the viewport.
+        updateScrollBarIfDirty();
+
+        CRISPY_METRICS_TIME_SCOPE("gui.paint");
+        CRISPY_TRACE_SPAN("gui.paint");
         state_.store(State::CleanPainting);
         now_ = steady_clock::now();
 
@@ -770,7 +806,11 @@ void TerminalWidget::paintGL()
         glClear(GL_COLOR_BUFFER_BIT);
 
         //terminal::view::render(terminalView_, now_);
-        STATS_SET(updatesSinceRendering) terminalView_->render(now_, renderingPressure_);
+        terminalView_->render(now_, renderingPressure_);
+
+        framePacer_.onFrameRendered(now_,
+                                    steady_clock::now() - now_,
+                                    terminalView_->terminal().ptyBufferStats().sliceBytes);
     }
     catch (exception const& e)
     {
@@ -834,6 +874,7 @@ bool TerminalWidget::reloadConfigValues(config::Config _newConfig, string const&
     terminalView_->terminal().screen().setMaxImageSize(_newConfig.maxImageSize);
     terminalView_->terminal().screen().setMaxImageColorRegisters(config_.maxImageColorRegisters);
     terminalView_->terminal().screen().setSixelCursorConformance(config_.sixelCursorConformance);
+    terminalView_->terminal().setPtyBufferLimits(_newConfig.ptyBufferLimits);
 
     config_ = std::move(_newConfig);
     if (config::TerminalProfile *profile = config_.profile(_profileName); profile != nullptr)
@@ -903,6 +944,8 @@ void TerminalWidget::keyPressEvent(QKeyEvent* _keyEvent)
 {
     auto const keySeq = toKeySequence(_keyEvent);
 
+    framePacer_.onInput(steady_clock::now());
+
     debuglog(KeyboardTag).write(
         "text:{}, seq:{}, seqEmpty?:{}, key:0x{:X}, mod:0x{:X}, keySeq[0]:{}",
          _keyEvent->text().toStdString(),
@@ -1020,7 +1063,7 @@ void TerminalWidget::mouseMoveEvent(QMouseEvent* _event)
         auto const currentMousePosition = terminalView_->terminal().currentMousePosition();
         if (terminalView_->terminal().screen().contains(currentMousePosition))
         {
-            if (terminalView_->terminal().screen().at(currentMousePosition).hyperlink())
+            if (terminalView_->terminal().hyperlinkAt(currentMousePosition))
                 setCursor(Qt::CursorShape::PointingHandCursor);
             else
                 setDefaultCursor();
@@ -1155,6 +1198,13 @@ bool TerminalWidget::event(QEvent* _event)
     try
     {
         // qDebug() << "TerminalWidget.event():" << _event;
+        if (_event->type() == WakeEventType)
+        {
+            CRISPY_METRICS_COUNT("gui.wake_events", 1);
+            processPendingUpdates();
+            return true;
+        }
+
         if (_event->type() == QEvent::Close)
         {
             terminalView_->process().terminate(terminal::Process::TerminationHint::Hangup);
@@ -1313,10 +1363,42 @@ bool TerminalWidget::executeAction(Action const& _action)
             copyToClipboard(extractLastMarkRange());
             return Result::Silently;
         },
+        [this](actions::CopyLastCommandOutput) -> Result {
+            copyToClipboard(extractLastCommandOutput());
+            return Result::Silently;
+        },
+        [this](actions::SaveTrace) -> Result {
+            try
+            {
+                crispy::trace::registry::get().write_chrome_trace(config_.traceFilePath.string());
+                debuglog(WidgetTag).write("Trace written to {}.", config_.traceFilePath.string());
+            }
+            catch (exception const& e)
+            {
+                cerr << "Failed to save trace. " << e.what() << endl;
+            }
+            return Result::Silently;
+        },
+        [this](actions::SearchSelection) -> Result {
+            searchSelection();
+            return Result::Dirty;
+        },
+        [this, postScroll](actions::SearchNext) -> Result {
+            auto const _l = scoped_lock{terminalView_->terminal()};
+            auto const* search = terminalView_->terminal().scrollbackSearch();
+            return postScroll(search && terminalView_->terminal().viewport().scrollToNextSearchMatch(*search));
+        },
+        [this, postScroll](actions::SearchPrevious) -> Result {
+            auto const _l = scoped_lock{terminalView_->terminal()};
+            auto const* search = terminalView_->terminal().scrollbackSearch();
+            return postScroll(search && terminalView_->terminal().viewport().scrollToPreviousSearchMatch(*search));
+        },
+        [this](actions::ClearSearch) -> Result {
+            terminalView_->terminal().clearSearch();
+            return Result::Dirty;
+        },
         [this](actions::CopySelection) -> Result {
-            string const text = extractSelectionText();
-            if (QClipboard* clipboard = QGuiApplication::clipboard(); clipboard != nullptr)
-                clipboard->setText(QString::fromUtf8(text.c_str(), static_cast<int>(text.size())));
+            copySelectionToClipboard(QClipboard::Clipboard);
             return Result::Silently;
         },
         [this](actions::PasteSelection) -> Result {
@@ -1362,7 +1444,7 @@ bool TerminalWidget::executeAction(Action const& _action)
         },
         [this](actions::Quit) -> Result {
             //TODO: later warn here when more then one terminal view is open
-            terminalView_->terminal().device().close();
+            terminalView_->terminal().closeDevice();
             exit(EXIT_SUCCESS);
             return Result::Silently;
         },
@@ -1403,7 +1485,7 @@ bool TerminalWidget::executeAction(Action const& _action)
             auto const currentMousePosition = terminalView_->terminal().currentMousePosition();
             if (terminalView_->terminal().screen().contains(currentMousePosition))
             {
-                if (auto hyperlink = terminalView_->terminal().screen().at(currentMousePosition).hyperlink(); hyperlink != nullptr)
+                if (auto const hyperlink = terminalView_->terminal().hyperlinkAt(currentMousePosition); hyperlink != nullptr)
                 {
                     followHyperlink(*hyperlink);
                     return Result::Silently;
@@ -1512,45 +1594,59 @@ void TerminalWidget::activateProfile(string const& _name, config::TerminalProfil
 
     updateScrollBarPosition();
 
+    framePacer_.setPolicy(newProfile.framePacing);
+
     profile_ = std::move(newProfile);
     profileName_ = _name;
 }
 
-string TerminalWidget::extractSelectionText()
+void TerminalWidget::copySelectionToClipboard(QClipboard::Mode _mode)
 {
-    using namespace terminal;
-    int lastColumn = 0;
-    string text;
-    string currentLine;
+    // Starting a new extraction cancels (and waits for) the previous one for the same clipboard.
+    auto& extractor = selectionExtractors_.at(static_cast<size_t>(_mode));
+    extractor.reset();
 
-    auto const trimRight = [](string& value)
-    {
-        while (!value.empty() && std::isspace(value.back()))
-            value.pop_back();
+    auto const progress = [](terminal::SelectionTextExtractor::Progress _progress) {
+        debuglog(WidgetTag).write("Extracting selection: {}/{} lines.", _progress.lines, _progress.totalLines);
     };
 
-    terminalView_->terminal().renderSelection([&](Coordinate const& _pos, Cell const& _cell) {
-        auto const _lock = scoped_lock{ terminalView_->terminal() };
-        auto const isNewLine = _pos.column <= lastColumn;
-        auto const isLineWrapped = terminalView_->terminal().lineWrapped(_pos.row);
-        bool const touchesRightPage = _pos.row > 0
-            && terminalView_->terminal().isSelectedAbsolute({_pos.row - 1, gridMetrics().pageSize.width});
-        if (isNewLine && (!isLineWrapped || !touchesRightPage))
-        {
-            // TODO: handle logical line in word-selection (don't include LF in wrapped lines)
-            trimRight(currentLine);
-            text += currentLine;
-            text += '\n';
-            currentLine.clear();
+    extractor = make_unique<terminal::SelectionTextExtractor>(
+        terminalView_->terminal(),
+        progress,
+        [this, _mode](optional<terminal::ChunkedText> _text) {
+            if (!_text.has_value())
+            {
+                debuglog(WidgetTag).write("Selected lines became unavailable while copying them.");
+                return;
+            }
+
+            post([this, _mode, text = make_shared<terminal::ChunkedText>(move(*_text))]() {
+                if (QClipboard* clipboard = QGuiApplication::clipboard(); clipboard != nullptr)
+                    clipboard->setMimeData(new SelectionMimeData(text), _mode);
+            });
         }
-        currentLine += _cell.toUtf8();
-        lastColumn = _pos.column;
-    });
+    );
+}
+
+void TerminalWidget::searchSelection()
+{
+    auto query = terminal::SearchQuery{};
+    {
+        auto const _l = scoped_lock{terminalView_->terminal()};
+        auto const& terminal = terminalView_->terminal();
+        if (!terminal.isSelectionAvailable())
+            return;
 
-    trimRight(currentLine);
-    text += currentLine;
+        // Only the first selected (logical) line is searched for.
+        auto text = terminal::SelectionText{*terminal.selector(), terminal.screen().grid()};
+        while (!text.done() && text.text().empty() && text.read(1))
+            ;
+        query.pattern = text.text().str();
+        query.pattern.erase(min(query.pattern.find('\n'), query.pattern.size()));
+    }
 
-    return text;
+    if (!query.pattern.empty())
+        terminalView_->terminal().search(move(query));
 }
 
 string TerminalWidget::extractLastMarkRange()
@@ -1586,6 +1682,27 @@ string TerminalWidget::extractLastMarkRange()
     return text;
 }
 
+string TerminalWidget::extractLastCommandOutput()
+{
+    auto const _l = std::lock_guard{terminalView_->terminal()};
+
+    auto const& screen = terminalView_->terminal().screen();
+    auto const output = screen.findLastCommandOutput();
+    if (!output.has_value())
+        return {};
+
+    string text;
+    for (auto line = output->first; line <= output->second; ++line)
+    {
+        text += screen.grid().renderTextLineAbsolute(line);
+        while (!text.empty() && text.back() == ' ')
+            text.pop_back();
+        text += '\n';
+    }
+
+    return text;
+}
+
 void TerminalWidget::spawnNewTerminal(std::string const& _profileName)
 {
     // TODO: config option to either spawn new terminal via new process (default) or just as second window.
@@ -1636,14 +1753,94 @@ void TerminalWidget::post(std::function<void()> _fn)
     postToObject(this, std::move(_fn));
 }
 
+void TerminalWidget::schedule(unsigned _flags)
+{
+    // Only the first flags raised since the last processing need to wake up the GUI thread,
+    // all others are picked up by that very same wake event.
+    if (pendingUpdates_.fetch_or(_flags) == 0)
+        QCoreApplication::postEvent(this, new QEvent(WakeEventType));
+}
+
+void TerminalWidget::processPendingUpdates()
+{
+    auto const flags = pendingUpdates_.exchange(0);
+
+    if (flags & PendingUpdate::BufferSwitch)
+    {
+        setDefaultCursor();
+        updateScrollBarPosition();
+    }
+
+    if (flags & (PendingUpdate::ScrollBar | PendingUpdate::BufferSwitch))
+        scrollBarDirty_ = true;
+
+    if (flags & PendingUpdate::WindowTitle)
+    {
+        auto const terminalTitle = [this]() {
+            auto _l = scoped_lock{pendingWindowTitleLock_};
+            return pendingWindowTitle_;
+        }();
+        auto const title = terminalTitle.empty()
+            ? "contour"s
+            : fmt::format("{} - contour", terminalTitle);
+        if (window()->windowHandle())
+            window()->windowHandle()->setTitle(QString::fromUtf8(title.c_str()));
+    }
+
+    if (flags & PendingUpdate::Bell)
+    {
+        debuglog(WidgetTag).write("TODO: Beep!");
+        QApplication::beep();
+        // QApplication::beep() requires Qt Widgets dependency. doesn't suound good.
+        // so maybe just a visual bell then? That would require additional OpenGL/shader work then though.
+    }
+
+    if (flags & PendingUpdate::Repaint)
+        scheduleFrame();
+    else if (state_.load() == State::CleanIdle)
+        updateScrollBarIfDirty(); // no frame is going to be rendered that would pick it up.
+}
+
+void TerminalWidget::scheduleFrame()
+{
+    auto const now = steady_clock::now();
+    auto const delay = framePacer_.nextFrameDelay(now, terminalView_->terminal().keyPressPending(now));
+    renderingPressure_ = framePacer_.pressure();
+
+    if (delay == delay.zero())
+    {
+        frameTimer_.stop();
+        update();
+    }
+    else if (!frameTimer_.isActive())
+        frameTimer_.start(static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(delay).count()) + 1);
+}
+
+void TerminalWidget::updateScrollBarIfDirty()
+{
+    if (!scrollBarDirty_)
+        return;
+
+    scrollBarDirty_ = false;
+
+    auto& terminal = terminalView_->terminal();
+    if (terminal.screen().isPrimaryScreen())
+    {
+        scrollBar_->setMaximum(terminal.screen().historyLineCount());
+        if (profile().autoScrollOnUpdate && terminal.viewport().scrolled())
+            terminal.viewport().scrollToBottom();
+    }
+    else
+        scrollBar_->setMaximum(0);
+
+    updateScrollBarValue();
+}
+
 // {{{ TerminalView::Events overrides
 
 void TerminalWidget::bell()
 {
-    debuglog(WidgetTag).write("TODO: Beep!");
-    QApplication::beep();
-    // QApplication::beep() requires Qt Widgets dependency. doesn't suound good.
-    // so maybe just a visual bell then? That would require additional OpenGL/shader work then though.
+    schedule(PendingUpdate::Bell);
 }
 
 void TerminalWidget::notify(std::string_view const& _title, std::string_view const& _content)
@@ -1661,13 +1858,11 @@ void TerminalWidget::reply(std::string_view const& _reply)
 
 void TerminalWidget::setWindowTitle(std::string_view const& _title)
 {
-    post([this, terminalTitle = string(_title)]() {
-        auto const title = terminalTitle.empty()
-            ? "contour"s
-            : fmt::format("{} - contour", terminalTitle);
-        if (window()->windowHandle())
-            window()->windowHandle()->setTitle(QString::fromUtf8(title.c_str()));
-    });
+    {
+        auto _l = scoped_lock{pendingWindowTitleLock_};
+        pendingWindowTitle_ = string(_title);
+    }
+    schedule(PendingUpdate::WindowTitle);
 }
 
 void TerminalWidget::setTerminalProfile(std::string const& _configProfileName)
@@ -1679,53 +1874,25 @@ void TerminalWidget::setTerminalProfile(std::string const& _configProfileName)
 
 void TerminalWidget::onSelectionComplete()
 {
-    if (QClipboard* clipboard = QGuiApplication::clipboard(); clipboard != nullptr)
-    {
-        string const text = extractSelectionText();
-        clipboard->setText(QString::fromUtf8(text.c_str(), static_cast<int>(text.size())), QClipboard::Selection);
-    }
+    if (QClipboard* clipboard = QGuiApplication::clipboard(); clipboard != nullptr && clipboard->supportsSelection())
+        copySelectionToClipboard(QClipboard::Selection);
 }
 
 void TerminalWidget::bufferChanged(terminal::ScreenType)
 {
-    post([this] ()
-    {
-        setDefaultCursor();
-
-        if (terminalView_->terminal().screen().isPrimaryScreen())
-            scrollBar_->setMaximum(terminalView_->terminal().screen().historyLineCount());
-        else
-            scrollBar_->setMaximum(0);
-
-        updateScrollBarPosition();
-        updateScrollBarValue();
-    });
-
-    if (setScreenDirty())
-        update();
+    schedule(PendingUpdate::BufferSwitch | (setScreenDirty() ? PendingUpdate::Repaint : 0u));
 }
 
 void TerminalWidget::screenUpdated()
 {
-#if defined(CONTOUR_VT_METRICS)
-    // TODO
-    // for (auto const& command : _commands)
-    //     terminalMetrics_(command);
-#endif
-
+    // Called for every processed chunk of PTY output, so nothing but raising flags must happen here.
+    auto flags = 0u;
     if (terminalView_->terminal().screen().isPrimaryScreen())
-    {
-        post([this]()
-        {
-            scrollBar_->setMaximum(terminalView_->terminal().screen().historyLineCount());
-            if (profile().autoScrollOnUpdate && terminalView_->terminal().viewport().scrolled())
-                terminalView_->terminal().viewport().scrollToBottom();
-            updateScrollBarValue();
-        });
-    }
-
+        flags |= PendingUpdate::ScrollBar;
     if (setScreenDirty())
-        update(); //QCoreApplication::postEvent(this, new QEvent(QEvent::UpdateRequest));
+        flags |= PendingUpdate::Repaint;
+    if (flags)
+        schedule(flags);
 }
 
 void TerminalWidget::updateScrollBarValue()
@@ -1971,6 +2138,18 @@ void TerminalWidget::dumpState()
 {
     // TODO: log this to debuglog(...)?
     terminalView_->terminal().screen().dumpState("Dump screen state.");
+    cerr << fmt::format("PTY buffer: {}\n", terminalView_->terminal().ptyBufferStats());
+    cerr << fmt::format("Synchronized output: {}\n", terminalView_->terminal().synchronizedOutputStats());
+    cerr << fmt::format("Renderer: {}\n", terminalView_->renderer().metrics().to_string());
+    cerr << fmt::format("Frame pacing: {}\n", framePacer_.stats());
+    cerr << fmt::format("Input latency: {}\n", terminalView_->terminal().inputLatencyStats());
+    if (auto const recorderStats = terminalView_->terminal().recorderStats(); recorderStats.has_value())
+        cerr << fmt::format("Session recording: {}\n", *recorderStats);
+    if (crispy::metrics::enabled())
+    {
+        cerr << "Metrics:\n";
+        crispy::metrics::registry::get().write(cerr);
+    }
     //XXX terminalView_->renderer().dumpState(std::cout);
 }
 // }}}
@@ -17,11 +17,13 @@
 #include <contour/Config.h>
 #include <contour/FileChangeWatcher.h>
 #include <terminal/Color.h>
-#include <terminal/Metrics.h>
+#include <terminal/SelectionText.h>
+#include <terminal_view/FramePacer.h>
 #include <terminal_view/TerminalView.h>
 
 #include <QtCore/QPoint>
 #include <QtCore/QTimer>
+#include <QtGui/QClipboard>
 #include <QtGui/QOpenGLExtraFunctions>
 #include <QtGui/QVector4D>
 #include <QtWidgets/QOpenGLWidget>
@@ -29,6 +31,7 @@
 #include <QtWidgets/QSystemTrayIcon>
 #include <QtWidgets/QScrollBar>
 
+#include <array>
 #include <atomic>
 #include <fstream>
 #include <memory>
@@ -112,8 +115,10 @@ class TerminalWidget :
     void toggleFullscreen();
 
     bool setFontSize(text::font_size _fontSize);
-    std::string extractSelectionText();
+    void copySelectionToClipboard(QClipboard::Mode _mode);
+    void searchSelection();
     std::string extractLastMarkRange();
+    std::string extractLastCommandOutput();
     void spawnNewTerminal(std::string const& _profileName);
 
     void onScreenBufferChanged(terminal::ScreenType _type);
@@ -183,6 +188,39 @@ class TerminalWidget :
     /// either DirtyIdle if no painting is currently in progress, DirtyPainting otherwise.
     std::atomic<State> state_ = State::CleanIdle;
 
+    /// Deferred GUI thread work, as raised by the terminal's threads.
+    ///
+    /// Flags are accumulated in pendingUpdates_ and processed in a single pass on the GUI thread,
+    /// no matter how often they have been raised in between.
+    enum PendingUpdate : unsigned {
+        /// Screen contents changed and a new frame is to be rendered.
+        Repaint = 1 << 0,
+        /// History line count changed, scrollbar to be updated at next frame.
+        ScrollBar = 1 << 1,
+        /// Switched between primary and alternate screen.
+        BufferSwitch = 1 << 2,
+        /// Window title changed, see pendingWindowTitle_.
+        WindowTitle = 1 << 3,
+        /// Application rang the bell.
+        Bell = 1 << 4,
+    };
+
+    /// Raises the given PendingUpdate flags.
+    ///
+    /// This function may be called from any thread. At most one wake event is queued
+    /// into the GUI thread's event loop at any time.
+    void schedule(unsigned _flags);
+
+    /// Processes all PendingUpdate flags raised so far. Must be called on the GUI thread only.
+    void processPendingUpdates();
+
+    /// Applies the deferred scrollbar updates right before rendering a frame.
+    void updateScrollBarIfDirty();
+
+    /// Requests the next frame to be rendered, either right away or, when being throttled
+    /// by the frame pacer, as soon as the frame rate cap permits.
+    void scheduleFrame();
+
     /// Flags the screen as dirty.
     ///
     /// @returns boolean indicating whether the screen was clean before and made dirty (true), false otherwise.
@@ -208,7 +246,6 @@ class TerminalWidget :
         }
     }
 
-    void statsSummary();
     void doResize(terminal::Size _size);
     void setSize(terminal::Size _size);
 
@@ -228,17 +265,19 @@ class TerminalWidget :
     std::unique_ptr<terminal::view::TerminalView> terminalView_;
     std::optional<FileChangeWatcher> configFileChangeWatcher_;
     QTimer updateTimer_;                            // update() timer used to animate the blinking cursor.
+    QTimer frameTimer_;                             // update() timer used to render throttled frames.
+    terminal::view::FramePacer framePacer_;
     std::mutex screenUpdateLock_;
+    std::atomic<unsigned> pendingUpdates_ = 0;     // bitmask of PendingUpdate flags.
+    std::mutex pendingWindowTitleLock_;
+    std::string pendingWindowTitle_;                // most recently requested window title.
+    bool scrollBarDirty_ = false;                   // only accessed by the GUI thread.
     bool renderingPressure_ = false;
     bool maximizedState_ = false;
-    struct Stats {
-        std::atomic<uint64_t> updatesSinceRendering = 0;
-        std::atomic<uint64_t> consecutiveRenderCount = 0;
-    };
-    Stats stats_;
-#if defined(CONTOUR_VT_METRICS)
-    terminal::Metrics terminalMetrics_{};
-#endif
+
+    // Pending selection text extractions, one per clipboard mode, such that copying to one
+    // clipboard does not cancel copying to another. Only accessed by the GUI thread.
+    std::array<std::unique_ptr<terminal::SelectionTextExtractor>, QClipboard::LastMode + 1> selectionExtractors_;
 
     struct {
         std::optional<bool> changeFont;
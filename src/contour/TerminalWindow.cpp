@@ -17,7 +17,6 @@
 #include <contour/BackgroundBlur.h>
 
 #include <qnamespace.h>
-#include <terminal/Metrics.h>
 #include <terminal/pty/Pty.h>
 
 #if defined(_MSC_VER)
@@ -16,7 +16,6 @@
 #include <contour/Actions.h>
 #include <contour/Config.h>
 #include <contour/FileChangeWatcher.h>
-#include <terminal/Metrics.h>
 #include <terminal_view/TerminalView.h>
 
 #include <QtCore/QPoint>
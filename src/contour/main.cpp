@@ -18,6 +18,8 @@
 #include <terminal/Parser.h>
 #include <crispy/debuglog.h>
 #include <crispy/indexed.h>
+#include <crispy/metrics.h>
+#include <crispy/trace.h>
 #include <crispy/utils.h>
 
 #include <QtCore/QCommandLineParser>
@@ -29,9 +31,60 @@
 #include <iomanip>
 #include <algorithm>
 #include <numeric>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <csignal>
+#include <pthread.h>
+#endif
 
 using namespace std;
 
+#if !defined(_WIN32)
+namespace {
+    sigset_t traceSignalSet()
+    {
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGUSR1);
+        return set;
+    }
+
+    /// Blocks SIGUSR1 in the calling thread and all threads created by it afterwards,
+    /// so that it is only received by the trace signal thread.
+    /// (Processes started by the terminal get an empty signal mask, see terminal::Process.)
+    void blockTraceSignal()
+    {
+        auto const set = traceSignalSet();
+        pthread_sigmask(SIG_BLOCK, &set, nullptr);
+    }
+
+    /// Writes the timeline trace whenever SIGUSR1 is received. Writing happens on a dedicated
+    /// thread, as it is not async-signal-safe.
+    void startTraceSignalThread(FileSystem::path _path)
+    {
+        thread{[path = move(_path)]() {
+            auto const set = traceSignalSet();
+            for (;;)
+            {
+                int signo = 0;
+                if (sigwait(&set, &signo) != 0)
+                    continue;
+                try
+                {
+                    crispy::trace::registry::get().write_chrome_trace(path.string());
+                    cerr << "Trace written to " << path.string() << '\n';
+                }
+                catch (exception const& e)
+                {
+                    cerr << "Failed to save trace. " << e.what() << '\n';
+                }
+            }
+        }}.detach();
+    }
+}
+#endif
+
 namespace contour {
     struct CLI : public QCommandLineParser {
         CLI() {
@@ -42,6 +95,7 @@ namespace contour {
             addOption(profileOption);
             addOption(workingDirectoryOption);
             addOption(liveConfigOption);
+            addOption(recordOption);
             addOption(parserTable);
             addOption(enableDebugLogging);
             addOption(listDebugTags);
@@ -83,6 +137,12 @@ namespace contour {
             QCoreApplication::translate("main", "Enables live config reloading.")
         };
 
+        QCommandLineOption const recordOption{
+            QStringList() << "record",
+            QCoreApplication::translate("main", "Records the session's output into the given file, to be replayed with terminal_replay."),
+            QCoreApplication::translate("main", "PATH")
+        };
+
         QString profileName() const { return value(profileOption); }
         std::string debuglogFilter() const { return value(enableDebugLogging).toStdString(); }
 
@@ -105,6 +165,12 @@ int main(int argc, char* argv[])
         ++configFailures;
     };
 
+#if !defined(_WIN32)
+    if (crispy::trace::enabled())
+        blockTraceSignal();
+#endif
+    CRISPY_TRACE_THREAD_NAME("gui");
+
     try
     {
         // auto const HTS = "\033H";
@@ -158,26 +224,28 @@ int main(int argc, char* argv[])
 
         if (cli.isSet(cli.listDebugTags))
         {
-            auto tags = crispy::debugtag::store();
+            auto tags = vector<crispy::debugtag::tag_info const*>{};
+            for (auto const& tag: crispy::debugtag::store())
+                tags.push_back(&tag);
             sort(
                 begin(tags),
                 end(tags),
-                [](crispy::debugtag::tag_info const& a, crispy::debugtag::tag_info const& b) {
-                   return a.name < b.name;
+                [](crispy::debugtag::tag_info const* a, crispy::debugtag::tag_info const* b) {
+                   return a->name < b->name;
                 }
             );
             auto const maxNameLength = std::accumulate(
                 begin(tags),
                 end(tags),
                 size_t{0},
-                [&](auto _acc, auto const& _tag) { return max(_acc, _tag.name.size()); }
+                [&](auto _acc, auto const* _tag) { return max(_acc, _tag->name.size()); }
             );
             auto const column1Length = maxNameLength + 2u;
-            for (auto const& tag: tags)
+            for (auto const* tag: tags)
             {
                 std::cout
-                    << left << setw(int(column1Length)) << tag.name
-                    << "; " << tag.description << '\n';
+                    << left << setw(int(column1Length)) << tag->name
+                    << "; " << tag->description << '\n';
             }
             return EXIT_SUCCESS;
         }
@@ -238,6 +306,9 @@ int main(int argc, char* argv[])
             config.profile(profileName)->shell.workingDirectory =
                 FileSystem::path(cli.workingDirectory().toUtf8().toStdString());
 
+        if (!cli.value(cli.recordOption).isEmpty())
+            config.sessionRecordingPath = FileSystem::path(cli.value(cli.recordOption).toUtf8().toStdString());
+
         if (configFailures)
             return EXIT_FAILURE;
 
@@ -253,6 +324,15 @@ int main(int argc, char* argv[])
                 shell.arguments.push_back(positionalArgs.at(i).toStdString());
         }
 
+        auto metricsExporter = std::optional<crispy::metrics::exporter>{};
+        if (config.metricsExportPath.has_value())
+            metricsExporter.emplace(config.metricsExportPath->string(), config.metricsExportInterval);
+
+#if !defined(_WIN32)
+        if (crispy::trace::enabled())
+            startTraceSignalThread(config.traceFilePath);
+#endif
+
         contour::Controller controller(argv[0], config, liveConfig, profileName);
         controller.start();
 
@@ -16,9 +16,15 @@
 #include <crispy/indexed.h>
 #include <crispy/algorithm.h>
 
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <utility>
 #include <functional>
 #include <fmt/format.h>
@@ -47,20 +53,20 @@ namespace crispy {
 namespace detail {
     class dummy_source_location {
       public:
-        dummy_source_location(std::string_view _filename, int _line, std::string_view _functionName) :
+        dummy_source_location(char const* _filename, int _line, char const* _functionName) noexcept :
             fileName_{ _filename },
             line_{ _line },
             functionName_{ _functionName }
         {}
 
-        char const* file_name() const noexcept { return fileName_.c_str(); }
+        char const* file_name() const noexcept { return fileName_; }
         int line() const noexcept { return line_; }
-        char const* function_name() const noexcept { return functionName_.c_str(); }
+        char const* function_name() const noexcept { return functionName_; }
 
       private:
-        std::string fileName_;
+        char const* fileName_;
         int line_;
-        std::string functionName_;
+        char const* functionName_;
     };
 }
 
@@ -71,33 +77,34 @@ namespace detail {
 namespace debugtag
 {
     struct tag_info {
+        tag_info(std::string _name, std::string _description) :
+            name{ std::move(_name) },
+            description{ std::move(_description) }
+        {}
+
         std::string name;
-        bool enabled;
+        std::atomic<bool> enabled{false};
         std::string description;
     };
-    struct tag_id { size_t value; };
 
-    inline std::vector<tag_info>& store()
+    /// Handle to a debug tag, pointing straight to its enabled state.
+    struct tag_id {
+        size_t value;
+        std::atomic<bool> const* enabled;
+    };
+
+    /// All known tags. Tags are never removed, so references to them stay valid.
+    inline std::deque<tag_info>& store()
     {
-        static std::vector<tag_info> tagStore;
+        static std::deque<tag_info> tagStore;
         return tagStore;
     }
 
-    // inline tag_id get(std::string_view _name)
-    // {
-    //     for (auto const && [i, t] : crispy::indexed(store()))
-    //         if (_name == t.name)
-    //             return tag_id{ i };
-    //
-    //     store().emplace_back(std::pair{_name, false});
-    //     return tag_id{ store().size() - 1 };
-    // }
-
     inline tag_id make(std::string_view _name, std::string_view _description)
     {
         assert(crispy::none_of(store(), [&](tag_info const& x) { return x.name == _name; }));
-        store().emplace_back(tag_info{std::string(_name), false, std::string(_description)});
-        return tag_id{ store().size() - 1 };
+        auto& tag = store().emplace_back(std::string(_name), std::string(_description));
+        return tag_id{ store().size() - 1, &tag.enabled };
     }
 
     inline void enable(tag_id _tag)
@@ -110,38 +117,47 @@ namespace debugtag
         store().at(_tag.value).enabled = false;
     }
 
+    /// Tests whether or not the given tag is enabled, i.e. whether log messages of it are to be
+    /// formatted at all. This is a single relaxed load, so it is cheap enough to guard hot paths.
     inline bool enabled(tag_id _tag) noexcept
     {
-        return _tag.value < store().size() && store().at(_tag.value).enabled;
+        return _tag.enabled->load(std::memory_order_relaxed);
     }
 }
 
+class logging_sink;
+
 class log_message {
   public:
-    using Flush = std::function<void(log_message const&)>;
+    using Flush = void(*)(log_message&);
 
-    log_message(Flush _flush, source_location _sloc, debugtag::tag_id _tag) :
-        flush_{ std::move(_flush) },
+    log_message(Flush _flush, source_location _sloc, debugtag::tag_id _tag) noexcept :
+        flush_{ _flush },
         location_{ std::move(_sloc) },
-        tag_{ _tag }
+        tag_{ _tag },
+        enabled_{ debugtag::enabled(_tag) }
     {}
 
     ~log_message()
     {
-        flush_(*this);
+        if (enabled_ && flush_)
+            flush_(*this);
     }
 
+    log_message(log_message const&) = delete;
+    log_message& operator=(log_message const&) = delete;
+
     template <typename... Args>
     void write(std::string_view _message)
     {
-        if (debugtag::enabled(tag_))
+        if (enabled_)
             text_.append(_message);
     }
 
     template <typename... Args>
     void write(std::string_view _format, Args&&... _args)
     {
-        if (debugtag::enabled(tag_))
+        if (enabled_)
             text_.append(fmt::format(_format, std::forward<Args>(_args)...));
     }
 
@@ -150,17 +166,38 @@ class log_message {
     std::string const& text() const noexcept { return text_; }
 
   private:
+    friend class logging_sink;
+
+    // Constructs a message that has already been written, to be handed to the sink's writer thread.
+    log_message(source_location _sloc, debugtag::tag_id _tag, std::string _text) :
+        flush_{ nullptr },
+        location_{ std::move(_sloc) },
+        tag_{ _tag },
+        enabled_{ true },
+        text_{ std::move(_text) }
+    {}
+
     Flush flush_;
     source_location const location_;
     debugtag::tag_id const tag_;
+    bool const enabled_;
     std::string text_;
 };
 
+/// Sink for log messages.
+///
+/// Messages are only formatted on the calling thread (as their arguments may refer to the caller's
+/// state). Transforming and writing them happens on a background thread, that is started on the first
+/// message, so that logging does not block the caller on I/O. Messages are handed over via a lock-free
+/// queue; if the writer falls too far behind, further messages are dropped and accounted for.
 class logging_sink {
   public:
     using Transform = std::function<std::string(log_message const&)>;
     using Writer = std::function<void(std::string_view const&)>;
 
+    /// Maximum number of messages waiting to be written before further messages are dropped.
+    static constexpr size_t max_pending = 65536;
+
     logging_sink(bool _enabled, Writer _writer, Transform _transform) :
         enabled_{ _enabled },
         transform_{ std::move(_transform) },
@@ -180,19 +217,83 @@ class logging_sink {
         )
     {}
 
-    void set_transform(Transform _transform) { transform_ = std::move(_transform); }
-    void set_writer(Writer _writer) { writer_ = std::move(_writer); }
+    ~logging_sink()
+    {
+        {
+            auto _l = std::lock_guard{lock_};
+            terminating_ = true;
+        }
+        pending_.notify_one();
+        if (thread_.joinable())
+            thread_.join();
+    }
+
+    logging_sink(logging_sink const&) = delete;
+    logging_sink& operator=(logging_sink const&) = delete;
+
+    void set_transform(Transform _transform)
+    {
+        auto _l = std::lock_guard{writer_lock_};
+        transform_ = std::move(_transform);
+    }
+
+    void set_writer(Writer _writer)
+    {
+        auto _l = std::lock_guard{writer_lock_};
+        writer_ = std::move(_writer);
+    }
 
-    bool enabled() const noexcept { return enabled_; }
-    void enable(bool _enabled) { enabled_ = _enabled; }
-    void toggle() noexcept { enabled_ = !enabled_; }
+    bool enabled() const noexcept { return enabled_.load(std::memory_order_relaxed); }
+    void enable(bool _enabled) noexcept { enabled_.store(_enabled, std::memory_order_relaxed); }
+    void toggle() noexcept { enable(!enabled()); }
 
-    void write(log_message const& _message)
+    /// Enqueues the message for being written by the writer thread.
+    void write(log_message& _message)
     {
-        if (enabled())
-            writer_(transform_(_message));
+        if (!enabled())
+            return;
+
+        if (size_.fetch_add(1, std::memory_order_relaxed) >= max_pending)
+        {
+            size_.fetch_sub(1, std::memory_order_relaxed);
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        auto* entry = new pending_message{
+            log_message(_message.location(), _message.tag(), std::move(_message.text_)),
+            nullptr
+        };
+        auto* next = head_.load(std::memory_order_relaxed);
+        do
+            entry->next = next;
+        while (!head_.compare_exchange_weak(next, entry, std::memory_order_release, std::memory_order_relaxed));
+
+        // Only the first message of a batch needs to wake up the writer. Taking the lock for that
+        // makes sure the wake-up cannot get lost while the writer is about to go to sleep.
+        if (next == nullptr)
+        {
+            {
+                auto _l = std::lock_guard{lock_};
+                if (!thread_.joinable() && !terminating_)
+                    thread_ = std::thread{ [this]() { writerThread(); } };
+            }
+            pending_.notify_one();
+        }
     }
 
+    /// Blocks until all messages enqueued so far have been written.
+    void flush()
+    {
+        auto _l = std::unique_lock{lock_};
+        written_.wait(_l, [this]() {
+            return head_.load(std::memory_order_acquire) == nullptr && !writing_;
+        });
+    }
+
+    /// @returns the number of messages dropped due to the writer falling behind.
+    uint64_t dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
     /// Retrieves reference to standard debug-logging sink.
     static inline logging_sink& for_debug()
     {
@@ -211,9 +312,66 @@ class logging_sink {
     }
 
   private:
-    bool enabled_;
+    struct pending_message {
+        log_message message;
+        pending_message* next;
+    };
+
+    void writerThread()
+    {
+        auto _l = std::unique_lock{lock_};
+        for (;;)
+        {
+            pending_.wait(_l, [this]() { return head_.load(std::memory_order_acquire) || terminating_; });
+
+            auto* batch = head_.exchange(nullptr, std::memory_order_acquire);
+            if (!batch && terminating_)
+                break;
+
+            writing_ = true;
+            _l.unlock();
+            write_batch(batch);
+            _l.lock();
+            writing_ = false;
+            written_.notify_all();
+        }
+    }
+
+    void write_batch(pending_message* _batch)
+    {
+        // Messages have been pushed onto a stack, so restore their original order first.
+        pending_message* ordered = nullptr;
+        while (_batch)
+            ordered = std::exchange(_batch, std::exchange(_batch->next, ordered));
+
+        auto _l = std::lock_guard{writer_lock_};
+        if (auto const dropped = dropped_.exchange(0, std::memory_order_relaxed); dropped != 0)
+            writer_(fmt::format("[{} log messages dropped]\n", dropped));
+
+        while (ordered)
+        {
+            writer_(transform_(ordered->message));
+            delete std::exchange(ordered, ordered->next);
+            size_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<bool> enabled_;
+
+    std::mutex writer_lock_;
     Transform transform_;
     Writer writer_;
+
+    std::atomic<pending_message*> head_{nullptr};
+    std::atomic<size_t> size_{0};
+    std::atomic<uint64_t> dropped_{0};
+
+    std::mutex lock_;
+    std::condition_variable pending_;
+    std::condition_variable written_;
+    bool writing_ = false;
+    bool terminating_ = false;
+    std::thread thread_;
 };
 
 }
@@ -223,13 +381,13 @@ class logging_sink {
     // TODO: Change that as soon as we get C++20's std::source_location on all major platforms supported.
     inline ::crispy::log_message debuglog(::crispy::debugtag::tag_id _tag, crispy::source_location _sloc = crispy::source_location::current())
     {
-        return crispy::log_message([](::crispy::log_message const& m) { ::crispy::logging_sink::for_debug().write(m); }, _sloc, _tag);
+        return crispy::log_message([](::crispy::log_message& m) { ::crispy::logging_sink::for_debug().write(m); }, _sloc, _tag);
     }
 #elif defined(__GNUC__) || defined(__clang__)
-    #define debuglog(_tag) (::crispy::log_message([](::crispy::log_message const& m) { ::crispy::logging_sink::for_debug().write(m); }, ::crispy::detail::dummy_source_location(__FILE__, __LINE__, __FUNCTION__), (_tag)))
+    #define debuglog(_tag) (::crispy::log_message([](::crispy::log_message& m) { ::crispy::logging_sink::for_debug().write(m); }, ::crispy::detail::dummy_source_location(__FILE__, __LINE__, __FUNCTION__), (_tag)))
 #elif defined(__func__)
-    #define debuglog(_tag) (::crispy::log_message([](::crispy::log_message const& m) { ::crispy::logging_sink::for_debug().write(m); }, ::crispy::detail::dummy_source_location(__FILE__, __LINE__, __func__), (_tag)))
+    #define debuglog(_tag) (::crispy::log_message([](::crispy::log_message& m) { ::crispy::logging_sink::for_debug().write(m); }, ::crispy::detail::dummy_source_location(__FILE__, __LINE__, __func__), (_tag)))
 #elif defined(__FUNCTION__)
-    #define debuglog(_tag) (::crispy::log_message([](::crispy::log_message const& m) { ::crispy::logging_sink::for_debug().write(m); }, ::crispy::detail::dummy_source_location(__FILE__, __LINE__, __FUNCTION__), (_tag)))
+    #define debuglog(_tag) (::crispy::log_message([](::crispy::log_message& m) { ::crispy::logging_sink::for_debug().write(m); }, ::crispy::detail::dummy_source_location(__FILE__, __LINE__, __FUNCTION__), (_tag)))
 #endif
 
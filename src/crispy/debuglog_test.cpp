@@ -0,0 +1,96 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/debuglog.h>
+
+#include <catch2/catch.hpp>
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    auto const TestTag = crispy::debugtag::make("crispy.test", "Logs from crispy's unit tests.");
+
+    mutex linesLock;
+    vector<string> lines;
+
+    crispy::logging_sink& testSink()
+    {
+        static auto sink = crispy::logging_sink(
+            true,
+            [](string_view const& _text) { auto _l = lock_guard{linesLock}; lines.emplace_back(_text); },
+            [](crispy::log_message const& _message) { return _message.text(); }
+        );
+        return sink;
+    }
+
+    crispy::log_message testlog()
+    {
+#if defined(CRISPY_SOURCE_LOCATION)
+        auto const location = crispy::source_location::current();
+#else
+        auto const location = crispy::source_location(__FILE__, __LINE__, __FUNCTION__);
+#endif
+        return crispy::log_message([](crispy::log_message& _m) { testSink().write(_m); }, location, TestTag);
+    }
+}
+
+TEST_CASE("debuglog.disabled_tag")
+{
+    lines.clear();
+    crispy::debugtag::disable(TestTag);
+    CHECK_FALSE(crispy::debugtag::enabled(TestTag));
+
+    testlog().write("invisible {}", 42);
+    testSink().flush();
+    CHECK(lines.empty());
+}
+
+TEST_CASE("debuglog.async_writer")
+{
+    lines.clear();
+    crispy::debugtag::enable(TestTag);
+    CHECK(crispy::debugtag::enabled(TestTag));
+
+    constexpr int ThreadCount = 4;
+    constexpr int MessageCount = 1000;
+
+    auto threads = vector<thread>{};
+    for (int t = 0; t < ThreadCount; ++t)
+        threads.emplace_back([t]() {
+            for (int i = 0; i < MessageCount; ++i)
+                testlog().write("{} {}", t, i);
+        });
+    for (auto& t : threads)
+        t.join();
+
+    testSink().flush();
+    crispy::debugtag::disable(TestTag);
+
+    REQUIRE(lines.size() == ThreadCount * MessageCount);
+    CHECK(testSink().dropped() == 0);
+
+    // Messages of each thread are written in the order they were logged.
+    auto next = vector<int>(ThreadCount, 0);
+    for (auto const& line : lines)
+    {
+        auto const t = stoi(line.substr(0, line.find(' ')));
+        auto const i = stoi(line.substr(line.find(' ') + 1));
+        CHECK(i == next.at(t));
+        next[t] = i + 1;
+    }
+}
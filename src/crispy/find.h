@@ -0,0 +1,78 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+    #include <emmintrin.h>
+    #define CRISPY_FIND_SSE2 1
+#endif
+
+namespace crispy {
+
+/// Finds the first occurrence of @p _needle in @p _haystack, starting at @p _pos.
+///
+/// With SSE2 available, 16 candidate positions are tested at once by comparing the needle's
+/// first and last byte against the haystack, and only positions matching both are verified
+/// with memcmp. This is what makes it faster than std::string_view::find() on long texts.
+///
+/// @returns the position of the match or std::string_view::npos if there is none.
+inline size_t find_substring(std::string_view _haystack, std::string_view _needle, size_t _pos = 0) noexcept
+{
+    auto constexpr npos = std::string_view::npos;
+
+    if (_pos > _haystack.size() || _needle.size() > _haystack.size() - _pos)
+        return npos;
+
+    if (_needle.empty())
+        return _pos;
+
+    auto const* const haystack = _haystack.data();
+    auto const* const needle = _needle.data();
+    auto const n = _needle.size();
+    auto const last = _haystack.size() - n; // last valid match position
+    auto i = _pos;
+
+#if defined(CRISPY_FIND_SSE2)
+    auto const first = _mm_set1_epi8(needle[0]);
+    auto const lastByte = _mm_set1_epi8(needle[n - 1]);
+
+    for (; i + 16 <= last + 1; i += 16)
+    {
+        auto const blockFirst = _mm_loadu_si128(reinterpret_cast<__m128i const*>(haystack + i));
+        auto const blockLast = _mm_loadu_si128(reinterpret_cast<__m128i const*>(haystack + i + n - 1));
+        auto const eq = _mm_and_si128(_mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(lastByte, blockLast));
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(eq));
+
+        while (mask != 0)
+        {
+            auto const bit = static_cast<size_t>(__builtin_ctz(mask));
+            if (std::memcmp(haystack + i + bit + 1, needle + 1, n - 1) == 0)
+                return i + bit;
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; i <= last; ++i)
+        if (haystack[i] == needle[0] && std::memcmp(haystack + i, needle, n) == 0)
+            return i;
+
+    return npos;
+}
+
+} // namespace crispy
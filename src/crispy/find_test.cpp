@@ -0,0 +1,56 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/find.h>
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <string_view>
+
+using namespace std;
+using crispy::find_substring;
+
+TEST_CASE("find_substring.short")
+{
+    CHECK(find_substring("", "") == 0);
+    CHECK(find_substring("abc", "") == 0);
+    CHECK(find_substring("", "a") == string_view::npos);
+    CHECK(find_substring("abc", "abcd") == string_view::npos);
+    CHECK(find_substring("abc", "c") == 2);
+    CHECK(find_substring("abcabc", "bc", 2) == 4);
+    CHECK(find_substring("abc", "a", 4) == string_view::npos);
+}
+
+TEST_CASE("find_substring.matches_string_view_find")
+{
+    // long enough to run through the vectorized path, with matches at all positions relative to a block
+    auto haystack = string{};
+    for (int i = 0; i < 200; ++i)
+        haystack += static_cast<char>('a' + (i * 7) % 5);
+    haystack += "needle";
+    for (int i = 0; i < 37; ++i)
+        haystack += static_cast<char>('a' + i % 3);
+
+    for (auto const needle : {"needle"sv, "n"sv, "ab"sv, "aca"sv, "cabca"sv, "ed"sv, "le"sv, "abc"sv, "zz"sv})
+        for (size_t pos = 0; pos < haystack.size(); pos += 13)
+            CHECK(find_substring(haystack, needle, pos) == string_view(haystack).find(needle, pos));
+}
+
+TEST_CASE("find_substring.match_at_end")
+{
+    auto const haystack = string(100, 'x') + "yz";
+    CHECK(find_substring(haystack, "yz") == 100);
+    CHECK(find_substring(haystack, "xyz") == 99);
+    CHECK(find_substring(haystack, "z") == 101);
+}
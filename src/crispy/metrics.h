@@ -0,0 +1,298 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <fmt/format.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Hot path instrumentation, to be used via the CRISPY_METRICS_* macros below only,
+// so that it compiles to nothing unless CRISPY_METRICS is defined.
+//
+//   CRISPY_METRICS_COUNT(name, n)         adds n to the counter with the given name.
+//   CRISPY_METRICS_RECORD(name, duration) records a duration in the histogram with the given name.
+//   CRISPY_METRICS_TIME_SCOPE(name)       records the duration of the enclosing scope.
+//   CRISPY_METRICS_ONLY(statement)        executes statement only if metrics are enabled.
+//
+// Names must be string constants, as they are resolved only once per call site.
+
+#define CRISPY_METRICS_CONCAT_(a, b) a##b
+#define CRISPY_METRICS_CONCAT(a, b) CRISPY_METRICS_CONCAT_(a, b)
+
+#if defined(CRISPY_METRICS)
+    #define CRISPY_METRICS_COUNT(name, n)                                                                   \
+        do {                                                                                                \
+            static auto& crispy_metrics_counter_ = ::crispy::metrics::registry::get().counter_for(name);   \
+            crispy_metrics_counter_.add(n);                                                                 \
+        } while (0)
+
+    #define CRISPY_METRICS_RECORD(name, duration)                                                           \
+        do {                                                                                                \
+            static auto& crispy_metrics_histogram_ = ::crispy::metrics::registry::get().histogram_for(name); \
+            crispy_metrics_histogram_.record(duration);                                                     \
+        } while (0)
+
+    #define CRISPY_METRICS_TIME_SCOPE(name)                                                                 \
+        static auto& CRISPY_METRICS_CONCAT(crispy_metrics_histogram_, __LINE__) =                           \
+            ::crispy::metrics::registry::get().histogram_for(name);                                         \
+        auto const CRISPY_METRICS_CONCAT(crispy_metrics_timer_, __LINE__) =                                 \
+            ::crispy::metrics::scoped_timer{CRISPY_METRICS_CONCAT(crispy_metrics_histogram_, __LINE__)}
+
+    #define CRISPY_METRICS_ONLY(statement) statement
+#else
+    #define CRISPY_METRICS_COUNT(name, n) do {} while (0)
+    #define CRISPY_METRICS_RECORD(name, duration) do {} while (0)
+    #define CRISPY_METRICS_TIME_SCOPE(name) do {} while (0)
+    #define CRISPY_METRICS_ONLY(statement) /*!*/
+#endif
+
+namespace crispy::metrics {
+
+/// Tests whether or not hot path instrumentation has been compiled in.
+constexpr bool enabled() noexcept
+{
+#if defined(CRISPY_METRICS)
+    return true;
+#else
+    return false;
+#endif
+}
+
+/// Monotonically increasing event counter, cheap enough to be updated from any hot path.
+class counter {
+  public:
+    void add(uint64_t _n = 1) noexcept { value_.fetch_add(_n, std::memory_order_relaxed); }
+    uint64_t value() const noexcept { return value_.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<uint64_t> value_{0};
+};
+
+/// Latency histogram with fixed power-of-two buckets.
+///
+/// Bucket i counts durations in [2^i, 2^(i+1)) nanoseconds, with the last bucket being open ended.
+/// Recording is lock-free and wait-free (apart from maintaining the maximum).
+class histogram {
+  public:
+    static constexpr size_t bucket_count = 40; // the last bucket starts at ~9 minutes
+
+    void record(std::chrono::nanoseconds _value) noexcept
+    {
+        auto const ns = _value.count() > 0 ? static_cast<uint64_t>(_value.count()) : uint64_t{0};
+        buckets_[bucket_index(ns)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(ns, std::memory_order_relaxed);
+
+        auto max = max_.load(std::memory_order_relaxed);
+        while (ns > max && !max_.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+            ;
+    }
+
+    uint64_t count() const noexcept { return count_.load(std::memory_order_relaxed); }
+    uint64_t bucket(size_t _index) const noexcept { return buckets_[_index].load(std::memory_order_relaxed); }
+    std::chrono::nanoseconds sum() const noexcept { return std::chrono::nanoseconds(sum_.load(std::memory_order_relaxed)); }
+    std::chrono::nanoseconds max() const noexcept { return std::chrono::nanoseconds(max_.load(std::memory_order_relaxed)); }
+
+    std::chrono::nanoseconds mean() const noexcept
+    {
+        auto const n = count();
+        return n ? sum() / static_cast<int64_t>(n) : std::chrono::nanoseconds::zero();
+    }
+
+    /// @returns an upper bound of the @p _p-th percentile (0..1), with the precision of a bucket.
+    std::chrono::nanoseconds percentile(double _p) const noexcept
+    {
+        auto const n = count();
+        if (!n)
+            return std::chrono::nanoseconds::zero();
+
+        auto const rank = static_cast<uint64_t>(_p * static_cast<double>(n - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < bucket_count; ++i)
+        {
+            seen += bucket(i);
+            if (seen >= rank)
+                return std::min(std::chrono::nanoseconds((uint64_t{2} << i) - 1), max());
+        }
+        return max();
+    }
+
+    static size_t bucket_index(uint64_t _ns) noexcept
+    {
+        if (_ns == 0)
+            return 0;
+#if defined(_MSC_VER)
+        unsigned long msb = 0;
+        _BitScanReverse64(&msb, _ns);
+        auto const log2 = static_cast<size_t>(msb);
+#else
+        auto const log2 = static_cast<size_t>(63 - __builtin_clzll(_ns));
+#endif
+        return std::min(log2, bucket_count - 1);
+    }
+
+  private:
+    std::array<std::atomic<uint64_t>, bucket_count> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+/// Records the lifetime of this object into a histogram.
+class scoped_timer {
+  public:
+    explicit scoped_timer(histogram& _histogram) noexcept :
+        histogram_{ _histogram },
+        start_{ std::chrono::steady_clock::now() }
+    {}
+
+    ~scoped_timer() { histogram_.record(std::chrono::steady_clock::now() - start_); }
+
+    scoped_timer(scoped_timer const&) = delete;
+    scoped_timer& operator=(scoped_timer const&) = delete;
+
+  private:
+    histogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+/// Process-wide registry of named counters and histograms.
+///
+/// Metrics are created on first lookup and live until the process exits, so that references
+/// to them can be cached at the call site. Lookup takes a lock, updating a metric does not.
+class registry {
+  public:
+    static registry& get()
+    {
+        static registry instance;
+        return instance;
+    }
+
+    counter& counter_for(std::string_view _name) { return lookup(counters_, _name); }
+    histogram& histogram_for(std::string_view _name) { return lookup(histograms_, _name); }
+
+    void for_each_counter(std::function<void(std::string const&, counter const&)> const& _visit) const
+    {
+        auto _l = std::lock_guard{lock_};
+        for (auto const& [name, value] : counters_)
+            _visit(name, *value);
+    }
+
+    void for_each_histogram(std::function<void(std::string const&, histogram const&)> const& _visit) const
+    {
+        auto _l = std::lock_guard{lock_};
+        for (auto const& [name, value] : histograms_)
+            _visit(name, *value);
+    }
+
+    /// Writes all metrics that have been updated at least once in a human readable form, one per line.
+    void write(std::ostream& _os) const
+    {
+        for_each_counter([&](auto const& _name, counter const& _counter) {
+            if (_counter.value())
+                _os << fmt::format("{} {}\n", _name, _counter.value());
+        });
+
+        for_each_histogram([&](auto const& _name, histogram const& _histogram) {
+            if (!_histogram.count())
+                return;
+            auto const us = [](std::chrono::nanoseconds _value) { return static_cast<double>(_value.count()) / 1000.0; };
+            _os << fmt::format("{} count={} mean={:.1f}us p50<={:.1f}us p90<={:.1f}us p99<={:.1f}us max={:.1f}us\n",
+                               _name,
+                               _histogram.count(),
+                               us(_histogram.mean()),
+                               us(_histogram.percentile(0.50)),
+                               us(_histogram.percentile(0.90)),
+                               us(_histogram.percentile(0.99)),
+                               us(_histogram.max()));
+        });
+    }
+
+  private:
+    template <typename T>
+    T& lookup(std::map<std::string, std::unique_ptr<T>, std::less<>>& _metrics, std::string_view _name)
+    {
+        auto _l = std::lock_guard{lock_};
+        if (auto i = _metrics.find(_name); i != _metrics.end())
+            return *i->second;
+        return *_metrics.emplace(std::string(_name), std::make_unique<T>()).first->second;
+    }
+
+    mutable std::mutex lock_;
+    std::map<std::string, std::unique_ptr<counter>, std::less<>> counters_;
+    std::map<std::string, std::unique_ptr<histogram>, std::less<>> histograms_;
+};
+
+/// Periodically writes all metrics of the registry into a file, replacing its previous contents.
+class exporter {
+  public:
+    exporter(std::string _path, std::chrono::milliseconds _interval) :
+        path_{ std::move(_path) },
+        interval_{ _interval },
+        thread_{ [this]() { run(); } }
+    {}
+
+    ~exporter()
+    {
+        {
+            auto _l = std::lock_guard{lock_};
+            terminating_ = true;
+        }
+        wakeup_.notify_one();
+        thread_.join();
+    }
+
+    exporter(exporter const&) = delete;
+    exporter& operator=(exporter const&) = delete;
+
+    std::string const& path() const noexcept { return path_; }
+
+  private:
+    void run()
+    {
+        auto _l = std::unique_lock{lock_};
+        do
+        {
+            auto file = std::ofstream{path_, std::ios::trunc};
+            registry::get().write(file);
+        }
+        while (!wakeup_.wait_for(_l, interval_, [this]() { return terminating_; }));
+    }
+
+    std::string path_;
+    std::chrono::milliseconds interval_;
+    std::mutex lock_;
+    std::condition_variable wakeup_;
+    bool terminating_ = false;
+    std::thread thread_;
+};
+
+} // end namespace
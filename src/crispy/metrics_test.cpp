@@ -0,0 +1,84 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/metrics.h>
+
+#include <catch2/catch.hpp>
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+using namespace crispy::metrics;
+
+TEST_CASE("metrics.counter")
+{
+    auto c = counter{};
+    CHECK(c.value() == 0);
+    c.add();
+    c.add(41);
+    CHECK(c.value() == 42);
+
+    vector<thread> threads;
+    for (int i = 0; i < 4; ++i)
+        threads.emplace_back([&]() { for (int k = 0; k < 1000; ++k) c.add(); });
+    for (auto& t : threads)
+        t.join();
+    CHECK(c.value() == 4042);
+}
+
+TEST_CASE("metrics.histogram.bucket_index")
+{
+    CHECK(histogram::bucket_index(0) == 0);
+    CHECK(histogram::bucket_index(1) == 0);
+    CHECK(histogram::bucket_index(2) == 1);
+    CHECK(histogram::bucket_index(3) == 1);
+    CHECK(histogram::bucket_index(1024) == 10);
+    CHECK(histogram::bucket_index(UINT64_MAX) == histogram::bucket_count - 1);
+}
+
+TEST_CASE("metrics.histogram.percentile")
+{
+    auto h = histogram{};
+    CHECK(h.percentile(0.5) == nanoseconds::zero());
+
+    for (int i = 0; i < 90; ++i)
+        h.record(nanoseconds(100));     // bucket [64, 128)
+    for (int i = 0; i < 10; ++i)
+        h.record(microseconds(10));     // bucket [8192, 16384)
+
+    CHECK(h.count() == 100);
+    CHECK(h.max() == microseconds(10));
+    CHECK(h.sum() == nanoseconds(90 * 100 + 10 * 10'000));
+    CHECK(h.mean() == nanoseconds(1090));
+    CHECK(h.percentile(0.5) == nanoseconds(127));
+    CHECK(h.percentile(0.9) == nanoseconds(127));
+    CHECK(h.percentile(0.99) == microseconds(10)); // capped by the maximum
+}
+
+TEST_CASE("metrics.registry")
+{
+    auto& r = registry::get();
+    auto& c = r.counter_for("test.counter");
+    CHECK(&c == &r.counter_for("test.counter"));
+    c.add(3);
+
+    r.histogram_for("test.histogram").record(milliseconds(1));
+
+    auto out = ostringstream{};
+    r.write(out);
+    CHECK(out.str().find("test.counter 3\n") != string::npos);
+    CHECK(out.str().find("test.histogram count=1 ") != string::npos);
+}
@@ -0,0 +1,129 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace crispy {
+
+/// Bounded lock-free single-producer single-consumer ring buffer of trivially copyable elements.
+///
+/// Exactly one thread may use the producer API (write(), free_space()) while at the same time
+/// exactly one other thread may use the consumer API (peek(), consume(), read()).
+/// size() and empty() may be called from anywhere, but are only a snapshot.
+template <typename T>
+class spsc_ring {
+  public:
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    /// Constructs the ring with at least @p _capacity elements, rounded up to the next power of two.
+    explicit spsc_ring(size_t _capacity) :
+        capacity_{ round_up(_capacity) },
+        buffer_{ new T[capacity_] } // not value-initialized, so untouched pages stay uncommitted
+    {}
+
+    spsc_ring(spsc_ring const&) = delete;
+    spsc_ring& operator=(spsc_ring const&) = delete;
+
+    size_t capacity() const noexcept { return capacity_; }
+
+    size_t size() const noexcept
+    {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+
+    // {{{ producer API
+    size_t free_space() const noexcept
+    {
+        return capacity_ - (head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_acquire));
+    }
+
+    /// Appends up to @p _count elements and returns the number of elements actually appended.
+    size_t write(T const* _data, size_t _count) noexcept
+    {
+        auto const head = head_.load(std::memory_order_relaxed);
+        auto const tail = tail_.load(std::memory_order_acquire);
+        auto const n = std::min(_count, capacity_ - (head - tail));
+
+        auto const offset = head & (capacity_ - 1);
+        auto const first = std::min(n, capacity_ - offset);
+        std::memcpy(buffer_.get() + offset, _data, first * sizeof(T));
+        std::memcpy(buffer_.get(), _data + first, (n - first) * sizeof(T));
+
+        head_.store(head + n, std::memory_order_release);
+        return n;
+    }
+    // }}}
+
+    // {{{ consumer API
+    /// @returns the largest contiguous block of readable elements, to be released via consume().
+    std::pair<T const*, size_t> peek() const noexcept
+    {
+        auto const tail = tail_.load(std::memory_order_relaxed);
+        auto const head = head_.load(std::memory_order_acquire);
+        auto const offset = tail & (capacity_ - 1);
+        return {buffer_.get() + offset, std::min(head - tail, capacity_ - offset)};
+    }
+
+    /// Releases @p _count elements (at most as many as were returned by peek()).
+    void consume(size_t _count) noexcept
+    {
+        tail_.store(tail_.load(std::memory_order_relaxed) + _count, std::memory_order_release);
+    }
+
+    /// Moves up to @p _count elements into @p _target and returns the number of elements moved.
+    size_t read(T* _target, size_t _count) noexcept
+    {
+        size_t total = 0;
+        while (total < _count)
+        {
+            auto const [data, available] = peek();
+            if (!available)
+                break;
+            auto const n = std::min(available, _count - total);
+            std::memcpy(_target + total, data, n * sizeof(T));
+            consume(n);
+            total += n;
+        }
+        return total;
+    }
+    // }}}
+
+  private:
+    static size_t round_up(size_t _value) noexcept
+    {
+        size_t n = 1;
+        while (n < _value)
+            n <<= 1;
+        return n;
+    }
+
+    size_t const capacity_;
+    std::unique_ptr<T[]> buffer_;
+
+    // Read and write positions are kept on separate cache lines to avoid false sharing
+    // between producer and consumer. Both are monotonically increasing and masked on access.
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+} // end namespace
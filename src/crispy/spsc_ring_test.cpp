@@ -0,0 +1,94 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/spsc_ring.h>
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <string_view>
+#include <thread>
+
+using namespace std;
+using crispy::spsc_ring;
+
+TEST_CASE("spsc_ring.capacity")
+{
+    CHECK(spsc_ring<char>(1).capacity() == 1);
+    CHECK(spsc_ring<char>(5).capacity() == 8);
+    CHECK(spsc_ring<char>(64).capacity() == 64);
+}
+
+TEST_CASE("spsc_ring.write_bounded")
+{
+    auto ring = spsc_ring<char>(8);
+    CHECK(ring.write("0123456789", 10) == 8);
+    CHECK(ring.size() == 8);
+    CHECK(ring.free_space() == 0);
+    CHECK(ring.write("X", 1) == 0);
+
+    char buf[16]{};
+    CHECK(ring.read(buf, sizeof(buf)) == 8);
+    CHECK(string_view(buf, 8) == "01234567");
+    CHECK(ring.empty());
+}
+
+TEST_CASE("spsc_ring.wrap_around")
+{
+    auto ring = spsc_ring<char>(8);
+    char buf[8]{};
+
+    REQUIRE(ring.write("abcdef", 6) == 6);
+    REQUIRE(ring.read(buf, 4) == 4);
+    CHECK(string_view(buf, 4) == "abcd");
+
+    // 2 bytes left at the end, 4 more fitting after wrap-around
+    REQUIRE(ring.write("ghijkl", 6) == 6);
+    CHECK(ring.size() == 8);
+
+    auto const [data, count] = ring.peek();
+    CHECK(string_view(data, count) == "efgh"); // contiguous part only
+    ring.consume(count);
+
+    REQUIRE(ring.read(buf, sizeof(buf)) == 4);
+    CHECK(string_view(buf, 4) == "ijkl");
+}
+
+TEST_CASE("spsc_ring.concurrent")
+{
+    auto constexpr N = 1'000'000u;
+    auto ring = spsc_ring<unsigned>(1024);
+
+    auto producer = thread([&]() {
+        unsigned i = 0;
+        while (i < N)
+            if (ring.write(&i, 1))
+                ++i;
+    });
+
+    unsigned expected = 0;
+    bool ordered = true;
+    while (expected < N)
+    {
+        unsigned value{};
+        if (ring.read(&value, 1))
+        {
+            ordered = ordered && value == expected;
+            ++expected;
+        }
+    }
+    producer.join();
+
+    CHECK(ordered);
+    CHECK(ring.empty());
+}
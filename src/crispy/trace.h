@@ -0,0 +1,312 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cerrno>
+#include <cstring>
+
+// Timeline tracing of scoped spans, to be used via the CRISPY_TRACE_* macros below only,
+// so that it compiles to nothing unless CRISPY_TRACING is defined.
+//
+//   CRISPY_TRACE_SPAN(name)        records the enclosing scope as a span on the calling thread.
+//   CRISPY_TRACE_THREAD_NAME(name) names the calling thread in the written trace.
+//
+// Names must be string constants, as only their address is recorded.
+//
+// The most recent spans of every thread are kept in memory and can be written as
+// Chrome trace file at any time (see registry::write_chrome_trace()),
+// to be viewed with chrome://tracing or https://ui.perfetto.dev.
+
+#define CRISPY_TRACE_CONCAT_(a, b) a##b
+#define CRISPY_TRACE_CONCAT(a, b) CRISPY_TRACE_CONCAT_(a, b)
+
+#if defined(CRISPY_TRACING)
+    #define CRISPY_TRACE_SPAN(name) \
+        ::crispy::trace::scoped_span const CRISPY_TRACE_CONCAT(crispy_trace_span_, __LINE__){name}
+    #define CRISPY_TRACE_THREAD_NAME(name) ::crispy::trace::span_buffer::local().set_thread_name(name)
+#else
+    #define CRISPY_TRACE_SPAN(name) do {} while (0)
+    #define CRISPY_TRACE_THREAD_NAME(name) do {} while (0)
+#endif
+
+namespace crispy::trace {
+
+/// Tests whether or not timeline tracing has been compiled in.
+constexpr bool enabled() noexcept
+{
+#if defined(CRISPY_TRACING)
+    return true;
+#else
+    return false;
+#endif
+}
+
+using clock = std::chrono::steady_clock;
+
+/// A completed span, with timestamps in nanoseconds of the steady clock.
+struct span_event {
+    char const* name;
+    int64_t start;
+    int64_t duration;
+};
+
+/// Fixed size ring buffer of the most recently completed spans of a single thread.
+///
+/// Only the owning thread records spans, and it never blocks on readers. Readers copy the
+/// buffer concurrently and afterwards drop whatever might have been overwritten meanwhile.
+class span_buffer {
+  public:
+    static constexpr size_t capacity = 16384;
+
+    explicit span_buffer(unsigned _thread_id) : thread_id_{ _thread_id } {}
+
+    /// @returns the span buffer of the calling thread, acquiring it on first use.
+    static span_buffer& local();
+
+    unsigned thread_id() const noexcept { return thread_id_.load(std::memory_order_relaxed); }
+
+    /// Drops all spans and the thread name, for reuse by the thread with the given id.
+    void reset(unsigned _thread_id) noexcept
+    {
+        {
+            auto _l = std::lock_guard{name_lock_};
+            thread_name_.clear();
+        }
+        thread_id_.store(_thread_id, std::memory_order_relaxed);
+        writing_.store(0, std::memory_order_relaxed);
+        head_.store(0, std::memory_order_release);
+    }
+
+    std::string thread_name() const
+    {
+        auto _l = std::lock_guard{name_lock_};
+        return thread_name_;
+    }
+
+    void set_thread_name(std::string _name)
+    {
+        auto _l = std::lock_guard{name_lock_};
+        thread_name_ = std::move(_name);
+    }
+
+    void record(char const* _name, clock::time_point _start, clock::time_point _end) noexcept
+    {
+        auto const index = head_.load(std::memory_order_relaxed);
+
+        // Announce the slot being overwritten before touching it (see snapshot()).
+        writing_.store(index, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        auto& slot = slots_[index % capacity];
+        slot.name.store(_name, std::memory_order_relaxed);
+        slot.start.store(_start.time_since_epoch().count(), std::memory_order_relaxed);
+        slot.duration.store((_end - _start).count(), std::memory_order_relaxed);
+
+        head_.store(index + 1, std::memory_order_release);
+    }
+
+    /// @returns a copy of all spans currently held, oldest first.
+    std::vector<span_event> snapshot() const
+    {
+        auto const end = head_.load(std::memory_order_acquire);
+        auto const begin = end > capacity ? end - capacity : uint64_t{0};
+
+        auto result = std::vector<span_event>{};
+        result.reserve(static_cast<size_t>(end - begin));
+        for (auto i = begin; i != end; ++i)
+        {
+            auto const& slot = slots_[i % capacity];
+            result.emplace_back(span_event{slot.name.load(std::memory_order_relaxed),
+                                           slot.start.load(std::memory_order_relaxed),
+                                           slot.duration.load(std::memory_order_relaxed)});
+        }
+
+        // Any slot the writer started overwriting while we were copying may be torn.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        auto const writing = writing_.load(std::memory_order_relaxed);
+        auto const valid = writing >= capacity ? writing - capacity + 1 : uint64_t{0};
+        if (valid > begin)
+            result.erase(result.begin(), result.begin() + static_cast<ptrdiff_t>(std::min(valid - begin, end - begin)));
+
+        return result;
+    }
+
+  private:
+    struct slot {
+        std::atomic<char const*> name{nullptr};
+        std::atomic<int64_t> start{0};
+        std::atomic<int64_t> duration{0};
+    };
+
+    std::atomic<unsigned> thread_id_;
+    mutable std::mutex name_lock_;
+    std::string thread_name_;
+
+    std::atomic<uint64_t> head_{0};
+    std::atomic<uint64_t> writing_{0};
+    std::array<slot, capacity> slots_{};
+};
+
+/// Process-wide registry of all threads' span buffers.
+///
+/// Buffers outlive their threads, so that spans of threads that have already exited
+/// still show up in the trace, until the buffer is reused by a thread started later on.
+/// Thus, memory is bounded by the maximum number of threads recording at the same time.
+class registry {
+  public:
+    static registry& get()
+    {
+        static registry instance;
+        return instance;
+    }
+
+    /// @returns a span buffer for a thread that starts recording, preferably one of an exited thread.
+    std::shared_ptr<span_buffer> acquire_buffer()
+    {
+        auto _l = std::lock_guard{lock_};
+        auto const thread_id = next_thread_id_++;
+        if (!released_.empty())
+        {
+            auto buffer = std::move(released_.back());
+            released_.pop_back();
+            buffer->reset(thread_id);
+            return buffer;
+        }
+
+        auto buffer = std::make_shared<span_buffer>(thread_id);
+        buffers_.push_back(buffer);
+        return buffer;
+    }
+
+    /// Hands back the buffer of an exiting thread, to be reused by acquire_buffer().
+    void release_buffer(std::shared_ptr<span_buffer> _buffer)
+    {
+        auto _l = std::lock_guard{lock_};
+        released_.push_back(std::move(_buffer));
+    }
+
+    /// @returns number of span buffers allocated, including the released ones.
+    size_t buffer_count() const
+    {
+        auto _l = std::lock_guard{lock_};
+        return buffers_.size();
+    }
+
+    /// Writes the spans of all threads in Chrome's trace event format (JSON).
+    void write_chrome_trace(std::ostream& _os) const
+    {
+        auto buffers = std::vector<std::shared_ptr<span_buffer>>{};
+        {
+            auto _l = std::lock_guard{lock_};
+            buffers = buffers_;
+        }
+
+        auto const us = [](int64_t _ns) { return static_cast<double>(_ns) / 1000.0; };
+        auto separator = "";
+
+        _os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        for (auto const& buffer : buffers)
+        {
+            if (auto const name = buffer->thread_name(); !name.empty())
+            {
+                _os << fmt::format("{}{{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+                                   separator, buffer->thread_id(), escape(name));
+                separator = ",\n";
+            }
+
+            for (auto const& span : buffer->snapshot())
+            {
+                _os << fmt::format("{}{{\"ph\":\"X\",\"name\":\"{}\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                                   separator, escape(span.name), buffer->thread_id(), us(span.start), us(span.duration));
+                separator = ",\n";
+            }
+        }
+        _os << "\n]}\n";
+    }
+
+    /// Writes the spans of all threads into a Chrome trace file, replacing its previous contents.
+    void write_chrome_trace(std::string const& _path) const
+    {
+        auto file = std::ofstream{_path, std::ios::trunc};
+        if (!file.good())
+            throw std::runtime_error{"Could not create trace file " + _path + ": " + std::strerror(errno)};
+        write_chrome_trace(file);
+    }
+
+  private:
+    static std::string escape(std::string_view _text)
+    {
+        auto result = std::string{};
+        for (char const ch : _text)
+        {
+            if (ch == '"' || ch == '\\')
+                result.push_back('\\');
+            if (static_cast<unsigned char>(ch) >= 0x20)
+                result.push_back(ch);
+        }
+        return result;
+    }
+
+    mutable std::mutex lock_;
+    std::vector<std::shared_ptr<span_buffer>> buffers_;
+    std::vector<std::shared_ptr<span_buffer>> released_;  // subset of buffers_ whose threads have exited
+    unsigned next_thread_id_ = 1;
+};
+
+inline span_buffer& span_buffer::local()
+{
+    // Hands the buffer back to the registry when the thread exits.
+    struct owner {
+        std::shared_ptr<span_buffer> buffer = registry::get().acquire_buffer();
+        ~owner() { registry::get().release_buffer(std::move(buffer)); }
+    };
+    thread_local owner const local;
+    return *local.buffer;
+}
+
+/// Records the lifetime of this object as a span on the calling thread.
+class scoped_span {
+  public:
+    explicit scoped_span(char const* _name) noexcept :
+        name_{ _name },
+        start_{ clock::now() }
+    {}
+
+    ~scoped_span() { span_buffer::local().record(name_, start_, clock::now()); }
+
+    scoped_span(scoped_span const&) = delete;
+    scoped_span& operator=(scoped_span const&) = delete;
+
+  private:
+    char const* name_;
+    clock::time_point start_;
+};
+
+} // end namespace
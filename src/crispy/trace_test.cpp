@@ -0,0 +1,85 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/trace.h>
+
+#include <catch2/catch.hpp>
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+using namespace crispy::trace;
+
+TEST_CASE("trace.span_buffer.snapshot")
+{
+    auto buffer = span_buffer{1};
+    CHECK(buffer.snapshot().empty());
+
+    auto const start = clock::now();
+    buffer.record("first", start, start + microseconds(5));
+    buffer.record("second", start + microseconds(10), start + microseconds(12));
+
+    auto const spans = buffer.snapshot();
+    REQUIRE(spans.size() == 2);
+    CHECK(string(spans[0].name) == "first");
+    CHECK(spans[0].duration == 5000);
+    CHECK(string(spans[1].name) == "second");
+    CHECK(spans[1].start - spans[0].start == 10000);
+}
+
+TEST_CASE("trace.span_buffer.wrap_around")
+{
+    auto buffer = make_unique<span_buffer>(1);
+    auto const start = clock::now();
+    for (size_t i = 0; i < span_buffer::capacity + 10; ++i)
+        buffer->record(i < 10 ? "old" : "new", start + nanoseconds(i), start + nanoseconds(i + 1));
+
+    auto const spans = buffer->snapshot();
+    CHECK(spans.size() == span_buffer::capacity);
+    CHECK(string(spans.front().name) == "new");
+    CHECK(spans.back().start - spans.front().start == static_cast<int64_t>(spans.size() - 1));
+}
+
+TEST_CASE("trace.registry.write_chrome_trace")
+{
+    auto worker = thread{[]() {
+        span_buffer::local().set_thread_name("worker");
+        auto const span = scoped_span{"work"};
+    }};
+    worker.join();
+
+    auto out = ostringstream{};
+    registry::get().write_chrome_trace(out);
+    auto const json = out.str();
+
+    CHECK(json.find("\"traceEvents\":[") != string::npos);
+    CHECK(json.find("\"args\":{\"name\":\"worker\"}") != string::npos);
+    CHECK(json.find("\"ph\":\"X\",\"name\":\"work\"") != string::npos);
+}
+
+TEST_CASE("trace.registry.reuses_buffers_of_exited_threads")
+{
+    auto const record = []() {
+        auto worker = thread{[]() { auto const span = scoped_span{"work"}; }};
+        worker.join();
+    };
+
+    record();
+    auto const buffers = registry::get().buffer_count();
+    for (int i = 0; i < 10; ++i)
+        record();
+    CHECK(registry::get().buffer_count() == buffers);
+}
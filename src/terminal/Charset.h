@@ -65,9 +65,14 @@ class CharsetMapping {
     void select(CharsetTable _table, CharsetId _id) noexcept
     {
         tables_[static_cast<size_t>(_table)] = charsetMap(_id);
+        ids_[static_cast<size_t>(_table)] = _id;
     }
 
     constexpr CharsetTable currentTable() const noexcept { return shift_; }
+    constexpr CharsetTable selectedTable() const noexcept { return selected_; }
+
+    /// @returns the charset designated to the given table.
+    constexpr CharsetId charsetId(CharsetTable _table) const noexcept { return ids_[static_cast<size_t>(_table)]; }
 
   private:
     CharsetTable shift_ = CharsetTable::G0;
@@ -75,6 +80,7 @@ class CharsetMapping {
 
     using Tables = std::array<CharsetMap const*, 4>;
     Tables tables_;
+    std::array<CharsetId, 4> ids_{CharsetId::USASCII, CharsetId::USASCII, CharsetId::USASCII, CharsetId::USASCII};
 };
 
 } // end namespace
@@ -175,6 +175,9 @@ struct ColorProfile {
     RGBColor mouseForeground = 0x800000;
     RGBColor mouseBackground = 0x808000;
 
+    RGBColor searchMatchForeground = 0x000000;
+    RGBColor searchMatchBackground = 0xC0C000;
+
     struct {
         RGBColor normal = 0x0070F0;
         RGBColor hover = 0xFF0000;
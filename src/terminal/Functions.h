@@ -321,6 +321,7 @@ constexpr inline auto SETFONT       = detail::OSC(50, "SETFONT", "Get or set fon
 constexpr inline auto SETFONTALL    = detail::OSC(60, "SETFONTALL", "Get or set all font faces, styles, size.");
 // printf "\033]52;c;$(printf "%s" "blabla" | base64)\a"
 constexpr inline auto CLIPBOARD     = detail::OSC(52, "CLIPBOARD", "Clipboard management.");
+constexpr inline auto SEMANTICPROMPT = detail::OSC(133, "SEMANTICPROMPT", "Shell integration: marks prompts and command output.");
 constexpr inline auto COLORSPECIAL  = detail::OSC(106, "COLORSPECIAL", "Enable/disable Special Color Number c.");
 constexpr inline auto RCOLORFG      = detail::OSC(110, "RCOLORFG", "Reset VT100 text foreground color.");
 constexpr inline auto RCOLORBG      = detail::OSC(111, "RCOLORBG", "Reset VT100 text background color.");
@@ -442,6 +443,7 @@ inline auto const& functions() noexcept
             SETFONT,
             SETFONTALL,
             CLIPBOARD,
+            SEMANTICPROMPT,
             COLORSPECIAL,
             RCOLORFG,
             RCOLORBG,
@@ -510,86 +512,6 @@ inline FunctionDefinition const* selectOSCommand(int _id)
     return select({FunctionCategory::OSC, 0, _id, 0, 0});
 }
 
-/// Tests if given function can be batched with regards to synchronized output (SM/RM ?2026).
-constexpr bool isBatchable(FunctionDefinition const& _function)
-{
-    switch (_function)
-    {
-        // C0
-        case BS:
-        case TAB:
-        case LF:
-        case VT:
-        case FF:
-        case CR:
-
-        // ESC
-        case SCS_G0_SPECIAL:
-        case SCS_G0_USASCII:
-        case SCS_G1_SPECIAL:
-        case SCS_G1_USASCII:
-        case DECALN:
-        case DECBI:
-        case DECFI:
-        case DECRS:
-        case DECSC:
-        case HTS:
-        case IND:
-        case NEL:
-        case RI:
-        case SS2:
-        case SS3:
-
-        // CSI
-        case ANSISYSSC:
-        case CBT:
-        case CHA:
-        case CHT:
-        case CNL:
-        case CPL:
-        case CUB:
-        case CUD:
-        case CUF:
-        case CUP:
-        case CUU:
-        case DCH:
-        case DECDC:
-        case DECIC:
-        case DECSCUSR:
-        case DECSLRM:
-        case DECSTBM:
-        case DL:
-        case ECH:
-        case ED:
-        case EL:
-        case HPA:
-        case HPR:
-        case HVP:
-        case ICH:
-        case IL:
-        case SCOSC:
-        case SD:
-        case SETMARK:
-        case SGR:
-        case SU:
-        case TBC:
-        case VPA:
-
-        // OSC
-        case HYPERLINK:
-        case RCOLORFG:
-        case RCOLORBG:
-        case RCOLORCURSOR:
-        case RCOLORMOUSEFG:
-        case RCOLORMOUSEBG:
-        case RCOLORHIGHLIGHTFG:
-        case RCOLORHIGHLIGHTBG:
-            return true;
-        default:
-            return false;
-    }
-}
-
 } // end namespace
 
 namespace std {
@@ -15,11 +15,14 @@
 
 #include <crispy/Comparison.h>
 #include <crispy/indexed.h>
+#include <crispy/metrics.h>
+#include <crispy/trace.h>
 #include <crispy/range.h>
 
 #include <unicode/convert.h>
 
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <optional>
 #include <tuple>
@@ -27,21 +30,26 @@
 
 using crispy::Comparison;
 
+using std::atomic;
 using std::back_inserter;
+using std::distance;
 using std::fill_n;
 using std::for_each;
 using std::front_inserter;
 using std::generate_n;
+using std::max;
 using std::min;
 using std::move;
 using std::next;
 using std::nullopt;
 using std::optional;
+using std::partition_point;
 using std::prev;
 using std::reverse;
 using std::rotate;
 using std::string;
 using std::tuple;
+using std::vector;
 
 #if defined(LIBTERMINAL_EXECUTION_PAR)
 #include <execution>
@@ -54,6 +62,13 @@ namespace terminal {
 
 namespace // {{{ helper
 {
+    /// @returns a new, process wide unique Grid::generation().
+    uint64_t nextGeneration() noexcept
+    {
+        static atomic<uint64_t> generation = 0;
+        return ++generation;
+    }
+
     bool is_blank(Cell const& _cell) noexcept
     {
         return !_cell.imageFragment() && _cell.codepointCount() == 0;
@@ -248,8 +263,10 @@ Grid::Grid(Size _screenSize, bool _reflowOnResize, optional<int> _maxHistoryLine
             Cell{},
             _reflowOnResize ? Line::Flags::Wrappable : Line::Flags::None
         )
-    )
+    ),
+    generation_{ nextGeneration() }
 {
+    assignLineIds(begin(lines_), end(lines_));
 }
 
 /**
@@ -297,6 +314,8 @@ void Grid::setMaxHistoryLineCount(optional<int> _maxHistoryLineCount)
 
 Coordinate Grid::resize(Size _newSize, Coordinate _currentCursorPos, bool _wrapPending)
 {
+    CRISPY_TRACE_SPAN("grid.resize");
+
     auto const growLines = [this](int _newHeight) -> Coordinate
     {
         // Grow line count by splicing available lines from history back into buffer, if available,
@@ -315,6 +334,7 @@ Coordinate Grid::resize(Size _newSize, Coordinate _currentCursorPos, bool _wrapP
             fillLineCount,
             [=]() { return Line(screenSize_.width, Cell{}, wrappableFlag); }
         );
+        assignLineIds(prev(end(lines_), fillLineCount), end(lines_));
 
         screenSize_.height = _newHeight;
 
@@ -390,7 +410,7 @@ Coordinate Grid::resize(Size _newSize, Coordinate _currentCursorPos, bool _wrapP
                     }
 
                     crispy::copy(line, back_inserter(logicalLineBuffer));
-                    logicalLineFlags = line.wrappableFlag() | line.markedFlag();
+                    logicalLineFlags = line.inheritableFlags();
 
                     logf(" - start new logical line: '{}'", line.toUtf8());
                 }
@@ -403,6 +423,7 @@ Coordinate Grid::resize(Size _newSize, Coordinate _currentCursorPos, bool _wrapP
             }
 
             lines_ = move(grownLines);
+            assignLineIds(begin(lines_), end(lines_));
             screenSize_.width = _newColumnCount;
 
             auto cy = 0;
@@ -500,12 +521,20 @@ Coordinate Grid::resize(Size _newSize, Coordinate _currentCursorPos, bool _wrapP
             addNewWrappedLines(shrinkedLines, _newColumnCount, move(wrappedColumns), previousFlags, false);
 
             lines_ = move(shrinkedLines);
+            assignLineIds(begin(lines_), end(lines_));
             screenSize_.width = _newColumnCount;
 
             return _cursor; // TODO
         }
     };
 
+    if (reflowOnResize_ && _newSize.width != screenSize_.width)
+    {
+        // Reflowing renumbers all lines, so the marker index is rebuilt below.
+        markers_.clear();
+        markerIndexEnd_ = discardedLineCount_;
+    }
+
     Coordinate cursorPosition = _currentCursorPos;
 
     // grow/shrink columns
@@ -534,6 +563,8 @@ Coordinate Grid::resize(Size _newSize, Coordinate _currentCursorPos, bool _wrapP
             break;
     }
 
+    updateMarkerIndex();
+
     return cursorPosition;
 }
 
@@ -548,14 +579,36 @@ void Grid::appendNewLines(int _count, GraphicsAttributes _attr)
             n,
             [&]() { return Line(screenSize_.width, Cell{{}, _attr}, wrappableFlag); }
         );
+        assignLineIds(prev(end(lines_), n), end(lines_));
         clampHistory();
+        updateMarkerIndex();
     }
 }
 
 void Grid::clearHistory()
 {
     if (historyLineCount())
+    {
+        discardedLineCount_ += static_cast<uint64_t>(historyLineCount());
         lines_.erase(begin(lines_), next(begin(lines_), historyLineCount()));
+        updateMarkerIndex();
+    }
+}
+
+void Grid::restore(Size _screenSize, Lines _lines, LineId _nextLineId, uint64_t _discardedLineCount)
+{
+    assert(static_cast<int>(_lines.size()) >= _screenSize.height);
+
+    screenSize_ = _screenSize;
+    lines_ = move(_lines);
+    nextLineId_ = _nextLineId;
+    discardedLineCount_ = _discardedLineCount;
+    generation_ = nextGeneration();
+
+    markers_.clear();
+    markerIndexEnd_ = _discardedLineCount;
+    clampHistory();
+    updateMarkerIndex();
 }
 
 void Grid::clampHistory()
@@ -582,11 +635,127 @@ void Grid::clampHistory()
         line.setFlag(Line::Flags::Wrappable, wrappable);
     }
 
+    discardedLineCount_ += static_cast<uint64_t>(diff);
     lines_.erase(begin(lines_), next(begin(lines_), diff));
+    updateMarkerIndex();
+}
+
+void Grid::updateMarkerIndex()
+{
+    auto const historyEnd = discardedLineCount_ + static_cast<uint64_t>(max(historyLineCount(), 0));
+
+    // Drop lines that have moved back into the main page.
+    while (!markers_.empty() && markers_.back().line >= historyEnd)
+        markers_.pop_back();
+    markerIndexEnd_ = min(markerIndexEnd_, historyEnd);
+
+    // Drop lines that have been pushed out of the scrollback.
+    while (!markers_.empty() && markers_.front().line < discardedLineCount_)
+        markers_.pop_front();
+    markerIndexEnd_ = max(markerIndexEnd_, discardedLineCount_);
+
+    // Index lines that have moved into the scrollback.
+    for (; markerIndexEnd_ < historyEnd; ++markerIndexEnd_)
+    {
+        auto const row = static_cast<int>(markerIndexEnd_ - discardedLineCount_);
+        if (auto const flags = absoluteLineAt(row).markerFlags(); flags != Line::Flags::None)
+            markers_.emplace_back(Marker{markerIndexEnd_, flags});
+    }
+}
+
+void Grid::assignLineIds(LineIterator _begin, LineIterator _end)
+{
+    for (auto line = _begin; line != _end; ++line)
+        line->setId(nextLineId_++);
+}
+
+void Grid::rotateLines(LineIterator _first, LineIterator _middle, LineIterator _last)
+{
+    rotate(_first, _middle, _last);
+
+    // The ids moved along with the lines, so they are rotated back by the same amount,
+    // in place by three reversals.
+    auto const reverseIds = [](LineIterator _begin, LineIterator _end) {
+        for (; _begin != _end && _begin != --_end; ++_begin)
+        {
+            auto const id = _begin->id();
+            _begin->setId(_end->id());
+            _end->setId(id);
+        }
+    };
+    auto const split = _first + distance(_middle, _last);
+    reverseIds(_first, split);
+    reverseIds(split, _last);
+    reverseIds(_first, _last);
+}
+
+optional<int> Grid::absoluteLineOf(LineId _id) const noexcept
+{
+    if (lines_.empty() || _id < lines_.front().id() || _id > lines_.back().id())
+        return nullopt;
+
+    if (auto const offset = _id - lines_.front().id(); offset < lines_.size() && lines_[offset].id() == _id)
+        return static_cast<int>(offset);
+
+    // Ids are not contiguous past lines that have been cut off the main page's bottom, but still ascending.
+    auto const i = partition_point(begin(lines_), end(lines_), [&](Line const& _line) { return _line.id() < _id; });
+    if (i != end(lines_) && i->id() == _id)
+        return static_cast<int>(distance(begin(lines_), i));
+
+    return nullopt;
+}
+
+optional<int> Grid::findMarkerBackward(int _line, Line::Flags _flags) const
+{
+    auto const historyLineCount = this->historyLineCount();
+    auto const end = min(_line, static_cast<int>(lines_.size()));
+
+    for (int row = end - 1; row >= historyLineCount; --row)
+        if (absoluteLineAt(row).isFlagEnabled(_flags))
+            return row;
+
+    if (end <= 0)
+        return nullopt;
+
+    auto const historyEnd = discardedLineCount_ + static_cast<uint64_t>(min(end, historyLineCount));
+    auto i = partition_point(markers_.begin(), markers_.end(),
+                             [&](Marker const& m) { return m.line < historyEnd; });
+    while (i != markers_.begin())
+    {
+        --i;
+        if (i->flags & _flags)
+            return static_cast<int>(i->line - discardedLineCount_);
+    }
+
+    return nullopt;
+}
+
+optional<int> Grid::findMarkerForward(int _line, Line::Flags _flags) const
+{
+    auto const historyLineCount = this->historyLineCount();
+    auto const begin = max(_line + 1, 0);
+
+    if (begin < historyLineCount)
+    {
+        auto const historyBegin = discardedLineCount_ + static_cast<uint64_t>(begin);
+        auto i = partition_point(markers_.begin(), markers_.end(),
+                                 [&](Marker const& m) { return m.line < historyBegin; });
+        for (; i != markers_.end(); ++i)
+            if (i->flags & _flags)
+                return static_cast<int>(i->line - discardedLineCount_);
+    }
+
+    for (int row = max(begin, historyLineCount); row < static_cast<int>(lines_.size()); ++row)
+        if (absoluteLineAt(row).isFlagEnabled(_flags))
+            return row;
+
+    return nullopt;
 }
 
 void Grid::scrollUp(int _n, GraphicsAttributes const& _defaultAttributes, Margin const& _margin)
 {
+    CRISPY_METRICS_COUNT("grid.lines_scrolled", static_cast<uint64_t>(min(_n, _margin.vertical.length())));
+
     if (_margin.horizontal != Margin::Range{1, screenSize_.width})
     {
         // a full "inside" scroll-up
@@ -649,7 +818,7 @@ void Grid::scrollUp(int _n, GraphicsAttributes const& _defaultAttributes, Margin
         auto const n = min(_n, marginHeight);
         if (n < marginHeight)
         {
-            rotate(
+            rotateLines(
                 next(begin(mainPage()), _margin.vertical.from - 1),
                 next(begin(mainPage()), _margin.vertical.from - 1 + n),
                 next(begin(mainPage()), _margin.vertical.to)
@@ -671,6 +840,7 @@ void Grid::scrollDown(int v_n, GraphicsAttributes const& _defaultAttributes, Mar
 {
     auto const marginHeight = _margin.vertical.length();
     auto const n = min(v_n, marginHeight);
+    CRISPY_METRICS_COUNT("grid.lines_scrolled", static_cast<uint64_t>(n));
 
     if (_margin.horizontal != Margin::Range{1, screenSize_.width})
     {
@@ -728,7 +898,7 @@ void Grid::scrollDown(int v_n, GraphicsAttributes const& _defaultAttributes, Mar
     }
     else if (_margin.vertical == Margin::Range{1, screenSize_.height})
     {
-        rotate(
+        rotateLines(
             begin(mainPage()),
             next(begin(mainPage()), marginHeight - n),
             end(mainPage())
@@ -749,7 +919,7 @@ void Grid::scrollDown(int v_n, GraphicsAttributes const& _defaultAttributes, Mar
     else
     {
         // scroll down only inside vertical margin with full horizontal extend
-        rotate(
+        rotateLines(
             next(begin(mainPage()), _margin.vertical.from - 1),
             next(begin(mainPage()), _margin.vertical.to - n),
             next(begin(mainPage()), _margin.vertical.to)
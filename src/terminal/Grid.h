@@ -218,11 +218,11 @@ class Cell {
         attributes_ = {};
         codepointCount_ = 0;
         width_ = 1;
-        hyperlink_ = nullptr;
+        hyperlink_ = 0;
         imageFragment_.reset();
     }
 
-    void reset(GraphicsAttributes _attribs, HyperlinkRef const& _hyperlink) noexcept
+    void reset(GraphicsAttributes _attribs, HyperlinkId _hyperlink) noexcept
     {
         attributes_ = std::move(_attribs);
         codepointCount_ = 0;
@@ -253,10 +253,10 @@ class Cell {
 
     std::optional<ImageFragment> const& imageFragment() const noexcept { return imageFragment_; }
 
-    void setImage(ImageFragment _imageFragment, HyperlinkRef _hyperlink)
+    void setImage(ImageFragment _imageFragment, HyperlinkId _hyperlink)
     {
         imageFragment_.emplace(std::move(_imageFragment));
-        hyperlink_ = std::move(_hyperlink);
+        hyperlink_ = _hyperlink;
         width_ = 1;
         codepointCount_ = 0;
     }
@@ -316,8 +316,9 @@ class Cell {
 
     std::string toUtf8() const;
 
-    HyperlinkRef hyperlink() const noexcept { return hyperlink_; }
-    void setHyperlink(HyperlinkRef const& _hyperlink) { hyperlink_ = _hyperlink; }
+    /// Id of the hyperlink in the owning screen's HyperlinkStorage, or 0 if none.
+    HyperlinkId hyperlink() const noexcept { return hyperlink_; }
+    void setHyperlink(HyperlinkId _hyperlink) noexcept { hyperlink_ = _hyperlink; }
 
   private:
     /// Unicode codepoint to be displayed.
@@ -332,7 +333,7 @@ class Cell {
     /// Number of combined codepoints stored in this cell.
     uint8_t codepointCount_;
 
-    HyperlinkRef hyperlink_ = nullptr;
+    HyperlinkId hyperlink_ = 0;
 
     /// Image fragment to be rendered in this cell.
     std::optional<ImageFragment> imageFragment_;
@@ -355,6 +356,9 @@ constexpr bool operator==(Cell const& a, Cell const& b) noexcept
 
 // }}}
 
+/// Identifies a line for as long as it exists, independent of its (shifting) absolute line number.
+using LineId = uint64_t;
+
 class Line { // {{{
   public:
     enum class Flags : uint8_t {
@@ -362,6 +366,12 @@ class Line { // {{{
         Wrappable = 0x0001,
         Wrapped   = 0x0002,
         Marked    = 0x0004,
+
+        // OSC 133 shell integration markers
+        PromptStart     = 0x0008,
+        OutputStart     = 0x0010,
+        CommandFinished = 0x0020,
+        OutputEnd       = 0x0040,   // the command finished after output on this line
     };
 
     using Buffer = std::deque<Cell>;
@@ -436,16 +446,33 @@ class Line { // {{{
     Flags wrappableFlag() const noexcept { return wrappable() ? Line::Flags::Wrappable : Line::Flags::None; }
     Flags markedFlag() const noexcept { return marked() ? Line::Flags::Marked : Line::Flags::None; }
 
+    /// @returns the marker flags (set via SETMARK or OSC 133) of this line.
+    Flags markerFlags() const noexcept
+    {
+        auto constexpr Markers = unsigned(Flags::Marked)
+                               | unsigned(Flags::PromptStart)
+                               | unsigned(Flags::OutputStart)
+                               | unsigned(Flags::CommandFinished);
+        return static_cast<Flags>(flags_ & Markers);
+    }
+
     std::string toUtf8() const;
 
     void setText(std::string_view _u8string);
 
+    /// Identifier assigned by the Grid, see Grid::absoluteLineOf().
+    LineId id() const noexcept { return id_; }
+    void setId(LineId _id) noexcept { id_ = _id; }
+
     Flags flags() const noexcept { return static_cast<Flags>(flags_); }
 
     Flags inheritableFlags() const noexcept
     {
         auto constexpr Inheritables = unsigned(Flags::Wrappable)
-                                    | unsigned(Flags::Marked);
+                                    | unsigned(Flags::Marked)
+                                    | unsigned(Flags::PromptStart)
+                                    | unsigned(Flags::OutputStart)
+                                    | unsigned(Flags::CommandFinished);
         return static_cast<Flags>(flags_ & Inheritables);
     }
 
@@ -462,6 +489,7 @@ class Line { // {{{
   private:
     Buffer buffer_;
     unsigned flags_;
+    LineId id_ = 0;
 };
 
 constexpr Line::Flags operator|(Line::Flags a, Line::Flags b) noexcept
@@ -539,13 +567,57 @@ class Grid {
 
     int historyLineCount() const noexcept { return static_cast<int>(lines_.size()) - screenSize_.height; }
 
+    /// @returns the number of lines that have been removed from the top of the scrollback so far.
+    ///
+    /// Absolute line numbers shift up by that amount whenever the history is clamped or cleared,
+    /// which allows readers that release the lock in between to detect and compensate that shift.
+    uint64_t discardedLineCount() const noexcept { return discardedLineCount_; }
+
+    /// Identifies the grid's current set of lines, which changes whenever all of them are replaced
+    /// (by constructing or restoring the grid), such as on a hard reset.
+    ///
+    /// Line numbers and ids remembered by readers are only meaningful for the same generation.
+    uint64_t generation() const noexcept { return generation_; }
+
+    /// Finds the nearest line above the absolute line @p _line that has any of the given marker @p _flags set.
+    ///
+    /// Scrollback lines are looked up in a sorted index, so that this is O(log n) in the history size.
+    ///
+    /// @returns the absolute line number of the marked line, if any.
+    std::optional<int> findMarkerBackward(int _line, Line::Flags _flags) const;
+
+    /// Finds the nearest line below the absolute line @p _line that has any of the given marker @p _flags set.
+    ///
+    /// @returns the absolute line number of the marked line, if any.
+    std::optional<int> findMarkerForward(int _line, Line::Flags _flags) const;
+
     /// Renders the full screen by passing every grid cell to the callback.
     template <typename RendererT>
     void render(RendererT && _render, std::optional<int> _scrollOffset = std::nullopt) const;
 
+    /// Renders the full screen by passing every visible line along with its row number to the callback.
+    ///
+    /// Lines may be shorter than the screen width, in which case the remaining columns are to be
+    /// treated as default constructed cells.
+    template <typename RendererT>
+    void renderLines(RendererT && _render, std::optional<int> _scrollOffset = std::nullopt) const;
+
     Line& absoluteLineAt(int _line) noexcept;
     Line const& absoluteLineAt(int _line) const noexcept;
 
+    /// @returns the identifier of the line at the given absolute line number.
+    LineId lineIdAt(int _line) const noexcept { return absoluteLineAt(_line).id(); }
+
+    /// Maps a line identifier to the line's current absolute line number.
+    ///
+    /// Ids are handed out in ascending order as lines are appended at the bottom, and stay with their
+    /// line as it scrolls up into and through the scrollback, so that this is mere offset arithmetic.
+    /// Lines moved around within the main page (by scrolling inside margins) keep the ids of their
+    /// positions though, and reflowing the lines on resize assigns new ids.
+    ///
+    /// @returns the absolute line number or std::nullopt if the line does not exist anymore.
+    std::optional<int> absoluteLineOf(LineId _id) const noexcept;
+
     /// @returns reference to Line at given relative offset @p _line.
     Line& lineAt(int _line) noexcept;
     Line const& lineAt(int _line) const noexcept;
@@ -573,6 +645,19 @@ class Grid {
     /// Completely deletes all scrollback lines.
     void clearHistory();
 
+    /// Replaces all lines of the grid, such as when restoring a saved screen state.
+    ///
+    /// The scrollback is clamped to this grid's maximum history line count.
+    ///
+    /// @param _screenSize          size of the main page area
+    /// @param _lines               scrollback lines followed by the main page lines
+    /// @param _nextLineId          id to be assigned to the next line appended
+    /// @param _discardedLineCount  number of lines that have been removed from the top of the scrollback
+    void restore(Size _screenSize, Lines _lines, LineId _nextLineId, uint64_t _discardedLineCount);
+
+    /// @returns the id to be assigned to the next line appended.
+    LineId nextLineId() const noexcept { return nextLineId_; }
+
     /// Scrolls up by @p _n lines within the given margin.
     ///
     /// @param _n number of lines to scroll up within the given margin.
@@ -602,11 +687,32 @@ class Grid {
     void clampHistory();
     void appendNewLines(int _count, GraphicsAttributes _attr);
 
+    /// Brings the marker index in line with the history's extent, after lines have moved into or out of it.
+    void updateMarkerIndex();
+
+    /// Assigns new (ascending) ids to the given lines.
+    void assignLineIds(LineIterator _begin, LineIterator _end);
+
+    /// Rotates the given lines such that @p _middle becomes the first one, with each position keeping its id.
+    void rotateLines(LineIterator _first, LineIterator _middle, LineIterator _last);
+
   private:
     Size screenSize_;
     bool reflowOnResize_;
     std::optional<int> maxHistoryLineCount_;
     Lines lines_;
+    LineId nextLineId_ = 0;
+    uint64_t discardedLineCount_ = 0;
+    uint64_t generation_;
+
+    // Scrollback lines carrying any marker flag, sorted by their line number plus discardedLineCount_.
+    // Main page lines are not indexed, as they are still subject to change (and few).
+    struct Marker {
+        uint64_t line;
+        Line::Flags flags;
+    };
+    std::deque<Marker> markers_;
+    uint64_t markerIndexEnd_ = 0; // one past the last indexed line
 };
 
 // {{{ inlines
@@ -618,11 +724,20 @@ inline void Grid::render(RendererT && _render, std::optional<int> _scrollOffset)
         for (auto const && [colNumber, column] : crispy::indexed(line, 1))
             _render({rowNumber, colNumber}, column);
 
+        static Cell const emptyCell{};
         for (auto const colNumber : crispy::times(line.size() + 1, std::max(0, screenSize_.width - line.size())))
-            _render({rowNumber, colNumber}, Cell{});
+            _render({rowNumber, colNumber}, emptyCell);
     }
 }
 
+template <typename RendererT>
+inline void Grid::renderLines(RendererT && _render, std::optional<int> _scrollOffset) const
+{
+    int row = 1;
+    for (Line const& line : pageAtScrollOffset(_scrollOffset))
+        _render(row++, line);
+}
+
 inline Line& Grid::absoluteLineAt(int _line) noexcept
 {
     assert(crispy::ascending(0, _line, static_cast<int>(lines_.size()) - 1));
@@ -439,3 +439,62 @@ TEST_CASE("Grid.reflow.tripple", "[grid]")
         // }}}
     }
 }
+
+TEST_CASE("Grid.lineIds", "[grid]")
+{
+    auto grid = Grid(Size{3, 2}, true, 2);
+    auto const full = Margin{{1, 2}, {1, 3}};
+
+    auto const first = grid.lineIdAt(0);
+    CHECK(grid.absoluteLineOf(first) == 0);
+    CHECK(grid.lineIdAt(1) > first);
+
+    SECTION("ids stay with lines scrolling through the scrollback") {
+        grid.scrollUp(1, GraphicsAttributes{}, full);
+        CHECK(grid.absoluteLineOf(first) == 0);
+        auto const second = grid.lineIdAt(1);
+
+        grid.scrollUp(2, GraphicsAttributes{}, full);
+        REQUIRE(grid.historyLineCount() == 2);
+        CHECK_FALSE(grid.absoluteLineOf(first).has_value()); // discarded
+        CHECK(grid.absoluteLineOf(second) == 0);
+        CHECK(grid.absoluteLineOf(grid.lineIdAt(3)) == 3);
+    }
+
+    SECTION("lines scrolled within margins keep the ids of their positions") {
+        grid.scrollUp(1, GraphicsAttributes{}, Margin{{1, 2}, {1, 3}});
+        auto const ids = std::array{grid.lineIdAt(0), grid.lineIdAt(1), grid.lineIdAt(2)};
+        grid.scrollDown(1, GraphicsAttributes{}, Margin{{1, 2}, {1, 3}});
+        CHECK(grid.lineIdAt(1) == ids[1]);
+        CHECK(grid.lineIdAt(2) == ids[2]);
+        CHECK(grid.absoluteLineOf(ids[2]) == 2);
+    }
+
+    SECTION("every position within partial margins keeps its id") {
+        auto tall = Grid(Size{3, 6}, true, 0);
+        auto const margin = Margin{{2, 6}, {1, 3}};
+        auto ids = std::array<LineId, 6>{};
+        for (int i = 0; i < 6; ++i)
+            ids[i] = tall.lineIdAt(i);
+
+        tall.scrollUp(2, GraphicsAttributes{}, margin);
+        tall.scrollDown(3, GraphicsAttributes{}, margin);
+        for (int i = 0; i < 6; ++i)
+            CHECK(tall.lineIdAt(i) == ids[i]);
+    }
+
+    SECTION("lines cut off the main page's bottom") {
+        grid.resize(Size{3, 1}, Coordinate{1, 1}, false);
+        grid.resize(Size{3, 2}, Coordinate{1, 1}, false);
+        auto const appended = grid.lineIdAt(1);
+        CHECK(appended > first + 1); // ids are never reused
+        CHECK(grid.absoluteLineOf(appended) == 1);
+        CHECK_FALSE(grid.absoluteLineOf(first + 1).has_value());
+    }
+
+    SECTION("reflow assigns new ids") {
+        grid.resize(Size{2, 2}, Coordinate{1, 1}, false);
+        CHECK_FALSE(grid.absoluteLineOf(first).has_value());
+        CHECK(grid.absoluteLineOf(grid.lineIdAt(0)) == 0);
+    }
+}
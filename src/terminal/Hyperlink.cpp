@@ -0,0 +1,128 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Hyperlink.h>
+
+#include <algorithm>
+#include <limits>
+
+using std::max;
+using std::min;
+using std::move;
+using std::numeric_limits;
+using std::string;
+
+namespace terminal {
+
+HyperlinkId HyperlinkStorage::add(string const& _id, URI const& _uri)
+{
+    auto key = Key{_id, _uri};
+    if (auto const i = keys_.find(key); i != keys_.end())
+        return i->second;
+
+    auto const id = allocate(_id, _uri);
+    if (id != 0)
+    {
+        keys_.emplace(move(key), id);
+        ++addedSinceCollection_;
+    }
+    return id;
+}
+
+HyperlinkId HyperlinkStorage::retain(URI const& _uri)
+{
+    auto const id = allocate(string{}, _uri);
+    if (id != 0)
+        entries_[id - 1].retained = true;
+    return id;
+}
+
+void HyperlinkStorage::release(HyperlinkId _id)
+{
+    if (_id != 0 && _id <= entries_.size() && entries_[_id - 1].retained)
+        free(_id);
+}
+
+bool HyperlinkStorage::collectionDue() const noexcept
+{
+    // Sweeping scans the whole table, so it is only done once the table has grown by a good part
+    // of its own size, keeping the amortized cost per added hyperlink low.
+    return addedSinceCollection_ >= max(collectionInterval_, size() / 2);
+}
+
+size_t HyperlinkStorage::sweep()
+{
+    size_t freed = 0;
+
+    for (size_t i = 0; i < entries_.size(); ++i)
+    {
+        auto const& entry = entries_[i];
+        if (entry.used && !entry.retained && entry.references == 0 && entry.generation != generation_)
+        {
+            free(static_cast<HyperlinkId>(i + 1));
+            ++freed;
+        }
+    }
+
+    if (freed != 0)
+        collectionInterval_ = MinCollectionInterval;
+    else
+        collectionInterval_ = min(2 * collectionInterval_, static_cast<size_t>(numeric_limits<HyperlinkId>::max()));
+
+    addedSinceCollection_ = 0;
+    ++generation_;
+    return freed;
+}
+
+HyperlinkId HyperlinkStorage::allocate(string const& _id, URI const& _uri)
+{
+    HyperlinkId id = 0;
+    if (!freeIds_.empty())
+    {
+        id = freeIds_.back();
+        freeIds_.pop_back();
+    }
+    else if (entries_.size() < numeric_limits<HyperlinkId>::max())
+    {
+        entries_.emplace_back();
+        id = static_cast<HyperlinkId>(entries_.size());
+    }
+    else
+        return 0;
+
+    auto& entry = entries_[id - 1];
+    entry.info = HyperlinkInfo{_id, _uri};
+    entry.generation = generation_ - 1; // not marked yet
+    entry.references = 0;
+    entry.used = true;
+    entry.retained = false;
+    return id;
+}
+
+void HyperlinkStorage::free(HyperlinkId _id)
+{
+    auto& entry = entries_[_id - 1];
+
+    if (auto const i = keys_.find(Key{entry.info.id, entry.info.uri}); i != keys_.end() && i->second == _id)
+        keys_.erase(i);
+
+    if (hovered_ == _id)
+        hovered_ = 0;
+
+    entry.info = HyperlinkInfo{};
+    entry.used = false;
+    entry.retained = false;
+    freeIds_.push_back(_id);
+}
+
+} // namespace terminal
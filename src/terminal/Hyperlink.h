@@ -13,10 +13,12 @@
  */
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <unordered_map>
-#include <list>
-#include <memory>
+#include <utility>
+#include <vector>
 
 namespace terminal {
 
@@ -36,7 +38,6 @@ using URI = std::string;
 struct HyperlinkInfo { // TODO: rename to Hyperlink
     std::string id;
     URI uri;
-    HyperlinkState state = HyperlinkState::Inactive;
 
     bool isLocal() const noexcept
     {
@@ -70,7 +71,139 @@ struct HyperlinkInfo { // TODO: rename to Hyperlink
     }
 };
 
-using HyperlinkRef = std::shared_ptr<HyperlinkInfo>;
+/// Index of a hyperlink in its screen's HyperlinkStorage, as stored in the grid cells.
+///
+/// The value 0 denotes the absence of a hyperlink.
+using HyperlinkId = uint16_t;
+
+/// Per-screen table of the hyperlinks (OSC 8) referenced by grid cells.
+///
+/// Cells only store the small HyperlinkId, so copying cells around (e.g. when scrolling,
+/// inserting or deleting characters) does not cause any reference counting.
+/// Hyperlinks of the same user provided id and URI share one entry.
+///
+/// Entries referenced by scrollback lines are counted by the owner as those lines enter
+/// and leave the scrollback (see addReference()), as scrollback lines do not change anymore.
+/// All other entries are reclaimed by a mark-and-sweep collection: the owner marks all ids
+/// still referenced by the (few) main page lines for the current generation, and sweep() then
+/// frees all entries that are neither marked nor referenced. Freed ids are reused.
+///
+/// Hyperlinks not stored in grid cells (such as automatically detected ones) are retained
+/// by their owner instead, and freed as soon as they are released.
+class HyperlinkStorage {
+  public:
+    /// Minimum number of hyperlinks to be added between two collections.
+    static constexpr size_t MinCollectionInterval = 256;
+
+    /// Adds a new hyperlink or returns the existing one of the same @p _id and @p _uri.
+    ///
+    /// @returns the hyperlink's id, or 0 if the table is full.
+    HyperlinkId add(std::string const& _id, URI const& _uri);
+
+    /// Adds a new hyperlink that is owned by the caller rather than by the grid cells.
+    ///
+    /// It is not subject to garbage collection, and must be freed via release().
+    ///
+    /// @returns the hyperlink's id, or 0 if the table is full.
+    HyperlinkId retain(URI const& _uri);
+
+    /// Frees a hyperlink previously added via retain().
+    void release(HyperlinkId _id);
+
+    /// @returns the hyperlink with the given id, or nullptr if @p _id is 0 or has been reclaimed.
+    HyperlinkInfo const* at(HyperlinkId _id) const noexcept
+    {
+        if (_id == 0 || _id > entries_.size() || !entries_[_id - 1].used)
+            return nullptr;
+        return &entries_[_id - 1].info;
+    }
+
+    /// Number of hyperlinks currently stored.
+    size_t size() const noexcept { return entries_.size() - freeIds_.size(); }
+
+    /// Forgets the known ids and URIs, such that they will not be resolved to existing hyperlinks anymore.
+    void clearUserIds() { keys_.clear(); }
+
+    // {{{ hover state
+    HyperlinkId hovered() const noexcept { return hovered_; }
+    void setHovered(HyperlinkId _id) noexcept { hovered_ = _id; }
+
+    HyperlinkState state(HyperlinkId _id) const noexcept
+    {
+        return _id != 0 && _id == hovered_ ? HyperlinkState::Hover : HyperlinkState::Inactive;
+    }
+    // }}}
+
+    // {{{ garbage collection
+    /// Whether enough hyperlinks have been added since the last collection to warrant another one.
+    bool collectionDue() const noexcept;
+
+    /// Marks the given hyperlink as still being referenced in the current generation.
+    void mark(HyperlinkId _id) noexcept
+    {
+        if (_id != 0 && _id <= entries_.size())
+            entries_[_id - 1].generation = generation_;
+    }
+
+    /// Counts a scrollback line referencing the given hyperlink, which keeps it from being swept.
+    void addReference(HyperlinkId _id) noexcept
+    {
+        if (_id != 0 && _id <= entries_.size())
+            ++entries_[_id - 1].references;
+    }
+
+    /// Uncounts a scrollback line referencing the given hyperlink, as it left the scrollback.
+    ///
+    /// @returns the number of remaining references.
+    uint32_t removeReference(HyperlinkId _id) noexcept
+    {
+        if (_id == 0 || _id > entries_.size() || entries_[_id - 1].references == 0)
+            return 0;
+        return --entries_[_id - 1].references;
+    }
+
+    /// Frees all hyperlinks neither marked in the current generation nor referenced,
+    /// and starts the next generation.
+    ///
+    /// Collections are spaced out further each time one frees nothing.
+    ///
+    /// @returns the number of hyperlinks freed.
+    size_t sweep();
+
+    /// Number of completed collections.
+    uint64_t generation() const noexcept { return generation_; }
+    // }}}
+
+  private:
+    struct Entry {
+        HyperlinkInfo info;
+        uint64_t generation = 0;    // generation the entry was last marked in
+        uint32_t references = 0;    // number of scrollback lines referencing it
+        bool used = false;
+        bool retained = false;      // owned by the caller of retain() rather than by the grid cells
+    };
+
+    using Key = std::pair<std::string, URI>;
+
+    struct KeyHash {
+        size_t operator()(Key const& _key) const noexcept
+        {
+            auto const hash = std::hash<std::string>{};
+            return hash(_key.first) * 31 + hash(_key.second);
+        }
+    };
+
+    HyperlinkId allocate(std::string const& _id, URI const& _uri);
+    void free(HyperlinkId _id);
+
+    std::vector<Entry> entries_;                            // entry i has the id i + 1
+    std::vector<HyperlinkId> freeIds_;
+    std::unordered_map<Key, HyperlinkId, KeyHash> keys_;    // user provided id and URI to hyperlink id
+    size_t addedSinceCollection_ = 0;
+    size_t collectionInterval_ = MinCollectionInterval;
+    uint64_t generation_ = 0;
+    HyperlinkId hovered_ = 0;
+};
 
 bool is_local(HyperlinkInfo const& _hyperlink);
 
@@ -0,0 +1,185 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Hyperlink.h>
+#include <terminal/Screen.h>
+#include <catch2/catch.hpp>
+
+#include <limits>
+#include <string>
+
+using namespace std;
+using namespace terminal;
+
+TEST_CASE("HyperlinkStorage.add", "[hyperlink]")
+{
+    auto storage = HyperlinkStorage{};
+
+    auto const a = storage.add("", "http://a/");
+    auto const b = storage.add("", "http://a/");
+    auto const c = storage.add("c", "http://c/");
+    auto const d = storage.add("c", "http://other/");
+    auto const e = storage.add("c", "http://c/");
+
+    CHECK(a != 0);
+    CHECK(a == b); // same id and URI
+    CHECK(c != d);
+    CHECK(c == e);
+    CHECK(storage.size() == 3);
+    REQUIRE(storage.at(c) != nullptr);
+    CHECK(storage.at(c)->uri == "http://c/");
+    CHECK(storage.at(0) == nullptr);
+
+    storage.clearUserIds();
+    CHECK(storage.add("c", "http://c/") != c);
+}
+
+TEST_CASE("HyperlinkStorage.sweep", "[hyperlink]")
+{
+    auto storage = HyperlinkStorage{};
+    auto const a = storage.add("a", "http://a/");
+    auto const b = storage.add("", "http://b/");
+    storage.setHovered(b);
+    CHECK(storage.state(b) == HyperlinkState::Hover);
+    CHECK(storage.state(a) == HyperlinkState::Inactive);
+
+    // hyperlinks neither marked nor referenced are freed
+    storage.mark(a);
+    CHECK(storage.sweep() == 1);
+    CHECK(storage.at(a) != nullptr);
+    CHECK(storage.at(b) == nullptr);
+    CHECK(storage.hovered() == 0);
+
+    // freed ids are reused
+    CHECK(storage.add("", "http://c/") == b);
+    CHECK(storage.add("a", "http://a/") == a);
+}
+
+TEST_CASE("HyperlinkStorage.references", "[hyperlink]")
+{
+    auto storage = HyperlinkStorage{};
+    auto const a = storage.add("", "http://a/");
+    storage.addReference(a);
+    storage.addReference(a);
+
+    // referenced hyperlinks survive sweeps without being marked
+    CHECK(storage.sweep() == 0);
+    CHECK(storage.removeReference(a) == 1);
+    CHECK(storage.sweep() == 0);
+    CHECK(storage.removeReference(a) == 0);
+    CHECK(storage.sweep() == 1);
+    CHECK(storage.at(a) == nullptr);
+}
+
+TEST_CASE("HyperlinkStorage.collection_backoff", "[hyperlink]")
+{
+    auto storage = HyperlinkStorage{};
+    auto const addMany = [&](size_t _count) {
+        for (size_t i = 0; i < _count; ++i)
+            storage.mark(storage.add("", fmt::format("http://host/{}", storage.size())));
+    };
+
+    addMany(HyperlinkStorage::MinCollectionInterval);
+    REQUIRE(storage.collectionDue());
+    CHECK(storage.sweep() == 0);
+
+    // nothing was freed, so the next collection is only due after twice as many additions
+    addMany(HyperlinkStorage::MinCollectionInterval);
+    CHECK_FALSE(storage.collectionDue());
+    addMany(HyperlinkStorage::MinCollectionInterval);
+    CHECK(storage.collectionDue());
+}
+
+TEST_CASE("Screen.collectHyperlinks", "[hyperlink]")
+{
+    auto screenEvents = ScreenEvents{};
+    auto screen = Screen{Size{5, 2}, screenEvents, false, false, 2};
+
+    screen.write("\033]8;;http://a/\033\\A\033]8;;\033\\\r\n");
+    screen.write("\033]8;;http://b/\033\\B\033]8;;\033\\\r\n");
+    REQUIRE(screen.hyperlinks().size() == 2);
+
+    auto const* a = screen.hyperlinks().at(screen.grid().absoluteLineAt(0)[0].hyperlink());
+    REQUIRE(a != nullptr);
+    CHECK(a->uri == "http://a/");
+
+    screen.collectHyperlinks(); // the generation the hyperlinks were added in
+    screen.collectHyperlinks();
+    CHECK(screen.hyperlinks().size() == 2); // both still referenced by history lines
+
+    // push the line with "A" out of the scrollback
+    screen.write("x\r\ny\r\n");
+    REQUIRE(screen.grid().discardedLineCount() > 0);
+    screen.collectHyperlinks();
+    CHECK(screen.hyperlinks().size() == 1);
+    CHECK(screen.hyperlinkAt({1, 1}) == nullptr);
+}
+
+TEST_CASE("Screen.hyperlink.periodic_collection", "[hyperlink]")
+{
+    auto screenEvents = ScreenEvents{};
+    auto screen = Screen{Size{5, 2}, screenEvents, false, false, 0};
+
+    // every hyperlink is overwritten by the next, so the table must not keep growing
+    for (size_t i = 0; i < 4 * HyperlinkStorage::MinCollectionInterval; ++i)
+        screen.write(fmt::format("\033]8;;http://host/{}\033\\X\033]8;;\033\\\r", i));
+
+    CHECK(screen.hyperlinks().generation() > 0);
+    CHECK(screen.hyperlinks().size() <= 2 * HyperlinkStorage::MinCollectionInterval);
+    REQUIRE(screen.hyperlinkAt({1, 1}) != nullptr);
+    CHECK(screen.hyperlinkAt({1, 1})->uri == fmt::format("http://host/{}", 4 * HyperlinkStorage::MinCollectionInterval - 1));
+}
+
+TEST_CASE("Screen.collectHyperlinks.scrollback", "[hyperlink]")
+{
+    auto screenEvents = ScreenEvents{};
+    auto screen = Screen{Size{5, 2}, screenEvents, false, false, 1000};
+
+    for (int i = 0; i < 100; ++i)
+        screen.write(fmt::format("\033]8;;http://host/{}\033\\X\033]8;;\033\\\r\n", i));
+    screen.collectHyperlinks();
+    screen.collectHyperlinks();
+    CHECK(screen.hyperlinks().size() == 100);
+
+    // the same hyperlink written again is shared, and the table stays the same after clearing the page
+    screen.write("\033]8;;http://host/99\033\\X\033]8;;\033\\\033[2J");
+    screen.collectHyperlinks();
+    CHECK(screen.hyperlinks().size() == 100);
+
+    // dropping the scrollback releases its references
+    screen.write("\033[3J");
+    screen.collectHyperlinks();
+    screen.collectHyperlinks();
+    CHECK(screen.hyperlinks().size() == 0);
+}
+
+TEST_CASE("Screen.hyperlink.full_table", "[hyperlink]")
+{
+    auto screenEvents = ScreenEvents{};
+    auto const capacity = size_t{numeric_limits<HyperlinkId>::max()};
+    auto screen = Screen{Size{4, 2}, screenEvents, false, false, static_cast<int>(capacity) + 100};
+
+    // every line of the scrollback keeps its own hyperlink, until the table is full
+    auto text = string{};
+    for (size_t i = 0; i < capacity + 10; ++i)
+        text += fmt::format("\033]8;;http://host/{}\033\\X\033]8;;\033\\\r\n", i);
+    screen.write(text);
+
+    // the hyperlinks of the oldest scrollback lines have been given up for the newest ones
+    REQUIRE(screen.grid().discardedLineCount() == 0);
+    CHECK(screen.hyperlinks().size() <= capacity);
+    auto const& oldest = screen.grid().absoluteLineAt(0);
+    CHECK(oldest[0].hyperlink() == 0);
+    REQUIRE(screen.hyperlinkAt({1, 1}) != nullptr);
+    CHECK(screen.hyperlinkAt({1, 1})->uri == fmt::format("http://host/{}", capacity + 9));
+}
@@ -0,0 +1,274 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/LinkDetector.h>
+
+#include <algorithm>
+
+using std::max;
+using std::nullopt;
+using std::optional;
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace terminal {
+
+namespace {
+    /// Stands in for all non-ASCII characters in the scanned text, and is not part of any link.
+    constexpr char NonAscii = '\x7f';
+
+    constexpr bool isAlpha(char _ch) noexcept { return ('a' <= _ch && _ch <= 'z') || ('A' <= _ch && _ch <= 'Z'); }
+    constexpr bool isDigit(char _ch) noexcept { return '0' <= _ch && _ch <= '9'; }
+    constexpr bool isAlnum(char _ch) noexcept { return isAlpha(_ch) || isDigit(_ch); }
+
+    constexpr bool isSchemeChar(char _ch) noexcept
+    {
+        return isAlnum(_ch) || _ch == '+' || _ch == '-' || _ch == '.';
+    }
+
+    constexpr bool isUrlChar(char _ch) noexcept
+    {
+        switch (_ch)
+        {
+            case '"': case '\'': case '<': case '>': case '\\':
+            case '^': case '`': case '{': case '|': case '}':
+                return false;
+            default:
+                return '!' <= _ch && _ch <= '~';
+        }
+    }
+
+    constexpr bool isPathChar(char _ch) noexcept
+    {
+        return isAlnum(_ch) || _ch == '/' || _ch == '.' || _ch == '_' || _ch == '-' || _ch == '~' || _ch == '+';
+    }
+
+    /// @returns the end of the URL starting at @p _begin and ending before @p _end,
+    ///          without trailing punctuation and unbalanced closing brackets.
+    size_t trimUrl(string_view _text, size_t _begin, size_t _end) noexcept
+    {
+        auto const balanced = [&](size_t _last, char _open, char _close) {
+            auto const url = _text.substr(_begin, _last - _begin + 1);
+            return std::count(url.begin(), url.end(), _open) >= std::count(url.begin(), url.end(), _close);
+        };
+
+        while (_end > _begin)
+        {
+            auto const last = _end - 1;
+            switch (_text[last])
+            {
+                case '.': case ',': case ':': case ';': case '!': case '?':
+                    --_end;
+                    continue;
+                case ')':
+                    if (!balanced(last, '(', ')')) { --_end; continue; }
+                    break;
+                case ']':
+                    if (!balanced(last, '[', ']')) { --_end; continue; }
+                    break;
+            }
+            break;
+        }
+        return _end;
+    }
+
+    /// Whether @p _path looks like a file name rather than e.g. a time of day.
+    bool looksLikePath(string_view _path) noexcept
+    {
+        auto const name = _path.substr(_path.rfind('/') + 1);
+        if (name.empty() || std::none_of(name.begin(), name.end(), isAlpha))
+            return false;
+
+        auto const dot = name.rfind('.');
+        auto const hasExtension = dot != name.npos && dot != 0 && dot + 1 != name.size();
+        return hasExtension || _path.find('/') != _path.npos;
+    }
+}
+
+LinkDetector::~LinkDetector()
+{
+    clear();
+}
+
+void LinkDetector::setWorkingDirectory(string const& _url)
+{
+    if (_url == workingDirectory_)
+        return;
+
+    clear();
+    workingDirectory_ = _url;
+}
+
+vector<LinkDetector::Span> const& LinkDetector::update(Grid const& _grid, int _line)
+{
+    Line const& line = _grid.absoluteLineAt(_line);
+    auto& cached = lines_[LineKey{_grid.generation(), line.id()}];
+    cached.used = true;
+    if (cached.final && _line < _grid.historyLineCount())
+        return cached.spans;
+
+    text_.clear();
+    for (Cell const& cell : line)
+    {
+        if (cell.codepointCount() == 0)
+            text_.push_back(' ');
+        else if (cell.codepointCount() == 1 && cell.codepoint(0) < 0x80)
+            text_.push_back(static_cast<char>(cell.codepoint(0)));
+        else
+            text_.push_back(NonAscii);
+    }
+
+    cached.final = _line < _grid.historyLineCount();
+    if (cached.text == text_)
+        return cached.spans;
+
+    release(cached);
+    cached.text = text_;
+
+    matches_.clear();
+    scan(text_, matches_);
+
+    for (auto const& match : matches_)
+        if (auto uri = uriOf(text_, match); uri.has_value())
+            if (auto const id = hyperlinks_.retain(*uri); id != 0)
+                cached.spans.emplace_back(Span{match.from + 1, match.to + 1, id});
+
+    return cached.spans;
+}
+
+void LinkDetector::prune()
+{
+    for (auto i = lines_.begin(); i != lines_.end();)
+    {
+        if (i->second.used)
+        {
+            i->second.used = false;
+            ++i;
+        }
+        else
+        {
+            release(i->second);
+            i = lines_.erase(i);
+        }
+    }
+}
+
+void LinkDetector::clear()
+{
+    for (auto& [_, line] : lines_)
+        release(line);
+    lines_.clear();
+}
+
+HyperlinkId LinkDetector::linkAt(Grid const& _grid, int _line, int _column) const noexcept
+{
+    auto const i = lines_.find(LineKey{_grid.generation(), _grid.lineIdAt(_line)});
+    if (i == lines_.end())
+        return 0;
+
+    auto const& spans = i->second.spans;
+    auto const span = std::partition_point(spans.begin(), spans.end(),
+                                           [&](Span const& s) { return s.toColumn < _column; });
+    if (span != spans.end() && span->fromColumn <= _column)
+        return span->hyperlink;
+
+    return 0;
+}
+
+void LinkDetector::release(CachedLine& _line)
+{
+    for (auto const& span : _line.spans)
+        hyperlinks_.release(span.hyperlink);
+    _line.spans.clear();
+}
+
+optional<URI> LinkDetector::uriOf(string_view _text, Match const& _match) const
+{
+    auto const text = _text.substr(static_cast<size_t>(_match.from),
+                                   static_cast<size_t>(_match.to - _match.from + 1));
+
+    if (_match.kind == Kind::Url)
+        return URI{text};
+
+    // A file position's line (and column) number is not part of the URI.
+    auto path = text.substr(0, text.find(':'));
+
+    auto const cwd = HyperlinkInfo{{}, workingDirectory_};
+    if (path.front() == '/')
+        return URI{"file://"} + string{cwd.host()} + string{path};
+
+    if (cwd.path().empty())
+        return nullopt; // relative paths cannot be resolved without knowing the working directory
+
+    while (path.substr(0, 2) == "./")
+        path.remove_prefix(2);
+
+    auto uri = URI{"file://"} + string{cwd.host()} + string{cwd.path()};
+    if (uri.back() != '/')
+        uri += '/';
+    uri += path;
+    return uri;
+}
+
+void LinkDetector::scan(string_view _text, vector<Match>& _output)
+{
+    // Both URLs and file positions contain a colon, which is rare enough in other text
+    // to only look closer at the positions around each colon.
+    size_t lastEnd = 0; // end of the last match, such that matches never overlap
+
+    for (auto colon = _text.find(':'); colon != _text.npos; colon = _text.find(':', max(colon + 1, lastEnd)))
+    {
+        if (_text.substr(colon + 1, 2) == "//")
+        {
+            auto begin = colon;
+            while (begin > lastEnd && isSchemeChar(_text[begin - 1]))
+                --begin;
+            while (begin < colon && !isAlpha(_text[begin]))
+                ++begin;
+
+            auto end = colon + 3;
+            while (end < _text.size() && isUrlChar(_text[end]))
+                ++end;
+            end = trimUrl(_text, colon + 3, end);
+
+            if (colon - begin >= 2 && end > colon + 3)
+            {
+                _output.emplace_back(Match{static_cast<int>(begin), static_cast<int>(end - 1), Kind::Url});
+                lastEnd = end;
+            }
+        }
+        else if (colon + 1 < _text.size() && isDigit(_text[colon + 1]))
+        {
+            auto begin = colon;
+            while (begin > lastEnd && isPathChar(_text[begin - 1]))
+                --begin;
+
+            if (!looksLikePath(_text.substr(begin, colon - begin)))
+                continue;
+
+            // line number, optionally followed by a column number
+            auto end = colon + 1;
+            while (end < _text.size() && isDigit(_text[end]))
+                ++end;
+            if (end + 1 < _text.size() && _text[end] == ':' && isDigit(_text[end + 1]))
+                for (++end; end < _text.size() && isDigit(_text[end]);)
+                    ++end;
+
+            _output.emplace_back(Match{static_cast<int>(begin), static_cast<int>(end - 1), Kind::FilePosition});
+            lastEnd = end;
+        }
+    }
+}
+
+} // namespace terminal
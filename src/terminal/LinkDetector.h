@@ -0,0 +1,126 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/Grid.h>
+#include <terminal/Hyperlink.h>
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace terminal {
+
+/// Detects plain text URLs (such as https://example.org/) and file positions (such as src/main.cpp:42)
+/// in the visible lines, and makes them available as hyperlinks.
+///
+/// Detected links are cached per line, keyed by its grid's generation and its LineId, such that lines
+/// of the primary and alternate grid, or of a replaced grid, are never mistaken for each other.
+/// A scrollback line is never looked at again once it has been cached in the scrollback, as it
+/// does not change anymore, whereas a main page line is only scanned again when its text has changed.
+/// Hover hit-testing is then a lookup in the cached spans of a single line.
+///
+/// The hyperlinks of the cached spans are retained in the screen's HyperlinkStorage, such that
+/// they can be stamped into rendered cells and share the hover and decoration handling of OSC 8 links.
+class LinkDetector {
+  public:
+    enum class Kind {
+        Url,
+        FilePosition,
+    };
+
+    /// A link found by scan(), as inclusive range of 0-based column offsets.
+    struct Match {
+        int from;
+        int to;
+        Kind kind;
+    };
+
+    /// A detected link in a line, as inclusive range of 1-based columns.
+    struct Span {
+        int fromColumn;
+        int toColumn;
+        HyperlinkId hyperlink;
+    };
+
+    explicit LinkDetector(HyperlinkStorage& _hyperlinks) : hyperlinks_{_hyperlinks} {}
+    ~LinkDetector();
+
+    LinkDetector(LinkDetector const&) = delete;
+    LinkDetector& operator=(LinkDetector const&) = delete;
+
+    /// Sets the file:// URL relative file positions are resolved against (as set via OSC 7).
+    ///
+    /// Changing it drops all cached lines.
+    void setWorkingDirectory(std::string const& _url);
+
+    /// Detects the links in the absolute line @p _line of @p _grid, unless it has not changed since it was last seen.
+    ///
+    /// @returns the line's links, ordered by column.
+    std::vector<Span> const& update(Grid const& _grid, int _line);
+
+    /// Drops all cached lines that have not been updated since the last call to prune().
+    void prune();
+
+    /// Drops all cached lines.
+    void clear();
+
+    /// @returns the hyperlink detected at the given column of the absolute line @p _line of @p _grid, or 0 if none.
+    HyperlinkId linkAt(Grid const& _grid, int _line, int _column) const noexcept;
+
+    /// Number of cached lines.
+    size_t lineCount() const noexcept { return lines_.size(); }
+
+    /// Finds all URLs and file positions in @p _text, with one byte per column, and appends them to @p _output.
+    static void scan(std::string_view _text, std::vector<Match>& _output);
+
+  private:
+    struct LineKey {
+        uint64_t grid;  // Grid::generation()
+        LineId line;
+
+        bool operator==(LineKey const& _other) const noexcept { return grid == _other.grid && line == _other.line; }
+    };
+
+    struct LineKeyHash {
+        size_t operator()(LineKey const& _key) const noexcept
+        {
+            return std::hash<uint64_t>{}(_key.grid * 0x9E3779B97F4A7C15ull ^ _key.line);
+        }
+    };
+
+    struct CachedLine {
+        std::string text;
+        std::vector<Span> spans;
+        bool used = false;
+        bool final = false;     // cached while in the scrollback, where it does not change anymore
+    };
+
+    void release(CachedLine& _line);
+    std::optional<URI> uriOf(std::string_view _text, Match const& _match) const;
+
+    HyperlinkStorage& hyperlinks_;
+    std::string workingDirectory_;
+    std::unordered_map<LineKey, CachedLine, LineKeyHash> lines_;
+
+    // scratch buffers, reused across update() calls
+    std::string text_;
+    std::vector<Match> matches_;
+};
+
+} // namespace terminal
@@ -0,0 +1,143 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/LinkDetector.h>
+#include <terminal/Screen.h>
+#include <catch2/catch.hpp>
+
+using namespace std;
+using namespace terminal;
+
+namespace {
+    vector<string> scan(string_view _text)
+    {
+        auto matches = vector<LinkDetector::Match>{};
+        LinkDetector::scan(_text, matches);
+
+        auto result = vector<string>{};
+        for (auto const& match : matches)
+            result.emplace_back(_text.substr(static_cast<size_t>(match.from),
+                                             static_cast<size_t>(match.to - match.from + 1)));
+        return result;
+    }
+}
+
+TEST_CASE("LinkDetector.scan.urls", "[link]")
+{
+    CHECK(scan("see https://example.org/a?b=c#d for details") == vector<string>{"https://example.org/a?b=c#d"});
+    CHECK(scan("(http://a.org/x_(y)) and git+ssh://host/repo.") == vector<string>{"http://a.org/x_(y)", "git+ssh://host/repo"});
+    CHECK(scan("<https://a.org/>, \"ftp://b.org\"") == vector<string>{"https://a.org/", "ftp://b.org"});
+    CHECK(scan("nothing :// here, x://") == vector<string>{});
+}
+
+TEST_CASE("LinkDetector.scan.file_positions", "[link]")
+{
+    CHECK(scan("src/main.cpp:42:7: error: oops") == vector<string>{"src/main.cpp:42:7"});
+    CHECK(scan("In file included from /usr/include/stdio.h:27,") == vector<string>{"/usr/include/stdio.h:27"});
+    CHECK(scan("at 12:30 and 1.5:2 and Makefile:3") == vector<string>{});
+    CHECK(scan("  File \"./a.py\", line 3 (b/c.py:9)") == vector<string>{"b/c.py:9"});
+}
+
+TEST_CASE("LinkDetector.update", "[link]")
+{
+    auto screenEvents = ScreenEvents{};
+    auto screen = Screen{Size{40, 2}, screenEvents};
+    auto& hyperlinks = screen.hyperlinks();
+    auto detector = LinkDetector{hyperlinks};
+    detector.setWorkingDirectory("file://host/home/user");
+
+    screen.write("a.cpp:1 see https://example.org/\r\nnone");
+    auto const& grid = screen.grid();
+
+    auto const spans = detector.update(grid, 0);
+    REQUIRE(spans.size() == 2);
+    CHECK(spans[0].fromColumn == 1);
+    CHECK(spans[0].toColumn == 7);
+    CHECK(spans[1].fromColumn == 13);
+    CHECK(spans[1].toColumn == 32);
+    REQUIRE(hyperlinks.at(spans[0].hyperlink) != nullptr);
+    CHECK(hyperlinks.at(spans[0].hyperlink)->uri == "file://host/home/user/a.cpp");
+    CHECK(hyperlinks.at(spans[1].hyperlink)->uri == "https://example.org/");
+
+    CHECK(detector.linkAt(grid, 0, 7) == spans[0].hyperlink);
+    CHECK(detector.linkAt(grid, 0, 8) == 0);
+    CHECK(detector.linkAt(grid, 0, 20) == spans[1].hyperlink);
+
+    // unchanged lines are not scanned again
+    CHECK(detector.update(grid, 0)[1].hyperlink == spans[1].hyperlink);
+    CHECK(hyperlinks.size() == 2);
+
+    // changed lines are
+    screen.moveCursorTo({1, 6});
+    screen.write("x");
+    REQUIRE(detector.update(grid, 0).size() == 1);
+    CHECK(hyperlinks.size() == 1);
+
+    // hyperlinks of detected links are not collected, as no cell references them
+    screen.collectHyperlinks();
+    screen.collectHyperlinks();
+    CHECK(hyperlinks.size() == 1);
+
+    // lines not seen since the last pruning are dropped
+    detector.prune();
+    detector.update(grid, 1);
+    detector.prune();
+    CHECK(detector.lineCount() == 1);
+    CHECK(hyperlinks.size() == 0);
+}
+
+TEST_CASE("LinkDetector.update.grids", "[link]")
+{
+    auto screenEvents = ScreenEvents{};
+    auto screen = Screen{Size{40, 2}, screenEvents, false, false, 10};
+    auto detector = LinkDetector{screen.hyperlinks()};
+
+    for (int i = 0; i < 6; ++i)
+        screen.write("https://primary.org/\r\n");
+    screen.write("\033[?1049hnone");
+    auto const& primary = screen.primaryGrid();
+    auto const& alternate = screen.grid();
+
+    // a line of the primary grid has the same id as the first line of the alternate grid, but other links
+    auto const row = primary.absoluteLineOf(alternate.lineIdAt(0));
+    REQUIRE(row.has_value());
+    REQUIRE(detector.update(primary, *row).size() == 1);
+    CHECK(detector.update(alternate, 0).empty());
+    CHECK(detector.linkAt(alternate, 0, 1) == 0);
+    CHECK(detector.linkAt(primary, *row, 1) != 0);
+
+    // a hard reset replaces the grids
+    screen.write("\033c");
+    CHECK(detector.linkAt(screen.grid(), 0, 1) == 0);
+}
+
+TEST_CASE("LinkDetector.update.scrollback", "[link]")
+{
+    auto screenEvents = ScreenEvents{};
+    auto screen = Screen{Size{40, 2}, screenEvents, false, false, 10};
+    auto detector = LinkDetector{screen.hyperlinks()};
+
+    screen.write("https://example.org/\r\n\r\n");
+    auto& grid = screen.grid();
+    REQUIRE(grid.historyLineCount() == 1);
+    REQUIRE(detector.update(grid, 0).size() == 1);
+
+    // scrollback lines are not looked at again, as they do not change anymore
+    grid.absoluteLineAt(0)[5].setCharacter('x');
+    CHECK(detector.update(grid, 0).size() == 1);
+
+    // unless they moved back into the main page
+    screen.resize(Size{40, 3});
+    REQUIRE(grid.historyLineCount() == 0);
+    CHECK(detector.update(grid, 0).empty());
+}
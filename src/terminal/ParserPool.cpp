@@ -0,0 +1,174 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/ParserPool.h>
+
+#include <crispy/trace.h>
+
+#include <algorithm>
+#include <cassert>
+
+using std::lock_guard;
+using std::max;
+using std::unique_lock;
+
+namespace terminal {
+
+ParserPool::ParserPool(size_t _threadCount)
+{
+    for (size_t i = 0; i < max(_threadCount, size_t{1}); ++i)
+        threads_.emplace_back([this]() { worker(); });
+}
+
+ParserPool::~ParserPool()
+{
+    {
+        auto _l = lock_guard{lock_};
+        assert(registrations_.empty() && "All handlers must be removed before destroying the pool.");
+        terminating_ = true;
+    }
+    workAvailable_.notify_all();
+
+    for (auto& thread : threads_)
+        thread.join();
+}
+
+ParserPool::Id ParserPool::add(Handler& _handler)
+{
+    auto _l = lock_guard{lock_};
+    auto const id = nextId_++;
+    registrations_[id].handler = &_handler;
+    return id;
+}
+
+void ParserPool::remove(Id _id)
+{
+    auto _l = unique_lock{lock_};
+    invocationFinished_.wait(_l, [&]() {
+        auto const i = registrations_.find(_id);
+        return i == registrations_.end() || !i->second.running;
+    });
+
+    if (registrations_.erase(_id))
+        queue_.erase(std::remove(queue_.begin(), queue_.end(), _id), queue_.end());
+}
+
+void ParserPool::wakeup(Id _id, bool _urgent)
+{
+    auto _l = lock_guard{lock_};
+    if (auto const i = registrations_.find(_id); i != registrations_.end())
+        enqueue(_id, i->second, _urgent);
+}
+
+size_t ParserPool::size() const
+{
+    auto _l = lock_guard{lock_};
+    return registrations_.size();
+}
+
+void ParserPool::enqueue(Id _id, Registration& _registration, bool _urgent)
+{
+    auto const promote = _urgent && !_registration.urgent;
+    _registration.urgent = _registration.urgent || _urgent;
+
+    if (_registration.queued)
+    {
+        if (promote && !_registration.running)
+        {
+            queue_.erase(std::find(queue_.begin(), queue_.end(), _id));
+            queue_.push_front(_id);
+        }
+        return;
+    }
+
+    _registration.queued = true;
+
+    // A running registration is queued by its worker once the invocation has finished.
+    if (!_registration.running)
+    {
+        push(_id, _registration);
+        workAvailable_.notify_one();
+    }
+}
+
+void ParserPool::push(Id _id, Registration const& _registration)
+{
+    if (_registration.urgent)
+        queue_.push_front(_id);
+    else
+        queue_.push_back(_id);
+}
+
+void ParserPool::worker()
+{
+    CRISPY_TRACE_THREAD_NAME("parser.pool");
+
+    auto _l = unique_lock{lock_};
+    for (;;)
+    {
+        auto const now = clock::now();
+        while (!deadlines_.empty() && deadlines_.begin()->first <= now)
+        {
+            auto const [deadline, id] = *deadlines_.begin();
+            deadlines_.erase(deadlines_.begin());
+            if (auto const i = registrations_.find(id); i != registrations_.end() && i->second.deadline == deadline)
+            {
+                i->second.deadline.reset();
+                enqueue(id, i->second, false);
+            }
+        }
+
+        if (terminating_)
+            return;
+
+        if (queue_.empty())
+        {
+            if (deadlines_.empty())
+                workAvailable_.wait(_l);
+            else
+                workAvailable_.wait_until(_l, deadlines_.begin()->first);
+            continue;
+        }
+
+        auto const id = queue_.front();
+        queue_.pop_front();
+
+        auto& registration = registrations_.at(id);
+        registration.queued = false;
+        registration.urgent = false;
+        registration.running = true;
+        auto const handler = registration.handler;
+
+        _l.unlock();
+        auto const deadline = handler->onParserWakeup();
+        _l.lock();
+
+        // The registration cannot have been removed meanwhile, as remove() waits for running invocations.
+        auto& current = registrations_.at(id);
+        current.running = false;
+        current.deadline = deadline;
+        if (deadline.has_value())
+        {
+            deadlines_.emplace(*deadline, id);
+            workAvailable_.notify_one(); // so that idle workers wait for the new deadline, too
+        }
+        if (current.queued)
+        {
+            push(id, current);
+            workAvailable_.notify_one();
+        }
+        invocationFinished_.notify_all();
+    }
+}
+
+} // end namespace
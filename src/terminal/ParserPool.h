@@ -0,0 +1,112 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace terminal {
+
+/// Runs the parser stage of any number of terminals on a fixed set of shared worker threads,
+/// rather than on a thread of their own (see Terminal's constructor).
+///
+/// A registered handler is invoked on any of the workers after it has been woken up, or once its
+/// requested deadline has passed. Invocations for the same registration never overlap, and a
+/// registration woken up while being invoked is invoked once more afterwards.
+///
+/// Woken up registrations are served in FIFO order (urgent ones first), so a handler is expected
+/// to only process a bounded amount of work per invocation and to wake itself up again if more
+/// is pending, such that busy terminals cannot starve the others.
+class ParserPool {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    class Handler {
+      public:
+        virtual ~Handler() = default;
+
+        /// Invoked on a worker thread after wakeup(), or once the previously returned deadline has passed.
+        ///
+        /// @returns the time at which to be invoked again even if not woken up, if any.
+        virtual std::optional<clock::time_point> onParserWakeup() = 0;
+    };
+
+    using Id = uint64_t;
+
+    /// Starts @p _threadCount worker threads (at least one).
+    explicit ParserPool(size_t _threadCount = std::thread::hardware_concurrency());
+
+    /// Stops all workers. All handlers must have been removed by then.
+    ~ParserPool();
+
+    ParserPool(ParserPool const&) = delete;
+    ParserPool& operator=(ParserPool const&) = delete;
+
+    /// Registers @p _handler, which is not invoked until woken up the first time.
+    ///
+    /// @returns a registration ID to be passed to wakeup() and remove().
+    Id add(Handler& _handler);
+
+    /// Unregisters the given handler.
+    ///
+    /// This call blocks until any currently running invocation of the handler has completed,
+    /// so that it may be safely destroyed afterwards. It must not be called from within the handler.
+    void remove(Id _id);
+
+    /// Schedules an invocation of the given handler. This function may be called from any thread.
+    ///
+    /// @param _urgent whether to serve the handler ahead of all others that are not urgent,
+    ///                such as for a terminal that received the response to a key press.
+    void wakeup(Id _id, bool _urgent = false);
+
+    size_t threadCount() const noexcept { return threads_.size(); }
+
+    /// @returns number of registered handlers.
+    size_t size() const;
+
+  private:
+    struct Registration {
+        Handler* handler = nullptr;
+        bool queued = false;                        // woken up, waiting for (another) invocation
+        bool urgent = false;                        // to be queued in front of the others
+        bool running = false;
+        std::optional<clock::time_point> deadline;  // as last returned by the handler
+    };
+
+    void worker();
+    void enqueue(Id _id, Registration& _registration, bool _urgent);
+    void push(Id _id, Registration const& _registration);
+
+    std::mutex mutable lock_;                       // guards all fields below.
+    std::condition_variable workAvailable_;
+    std::condition_variable invocationFinished_;
+    std::unordered_map<Id, Registration> registrations_;
+    std::deque<Id> queue_;
+    std::multimap<clock::time_point, Id> deadlines_; // may contain outdated entries, which are skipped
+    Id nextId_ = 1;
+    bool terminating_ = false;
+
+    std::vector<std::thread> threads_;
+};
+
+} // end namespace
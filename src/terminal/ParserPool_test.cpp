@@ -0,0 +1,170 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/ParserPool.h>
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace terminal;
+using namespace std;
+using namespace std::chrono;
+
+namespace
+{
+    /// Counts its invocations, and re-schedules itself until @c pending work is done.
+    class CountingHandler : public ParserPool::Handler {
+      public:
+        optional<ParserPool::clock::time_point> onParserWakeup() override
+        {
+            CHECK(!running.exchange(true)); // invocations never overlap
+            this_thread::sleep_for(microseconds{50});
+            ++invocations;
+            running = false;
+
+            if (pending > 0 && --pending > 0)
+                pool->wakeup(id);
+            return deadline;
+        }
+
+        ParserPool* pool = nullptr;
+        ParserPool::Id id = 0;
+        atomic<int> invocations = 0;
+        atomic<int> pending = 0;
+        atomic<bool> running = false;
+        optional<ParserPool::clock::time_point> deadline;
+    };
+
+    template <typename Predicate>
+    bool waitFor(Predicate _predicate)
+    {
+        auto const timeout = steady_clock::now() + seconds{5};
+        while (!_predicate())
+        {
+            if (steady_clock::now() > timeout)
+                return false;
+            this_thread::sleep_for(milliseconds{1});
+        }
+        return true;
+    }
+}
+
+TEST_CASE("ParserPool.wakeup", "[parser]")
+{
+    auto pool = ParserPool{4};
+    auto handlers = vector<CountingHandler>(16);
+    for (auto& handler : handlers)
+    {
+        handler.pool = &pool;
+        handler.id = pool.add(handler);
+        handler.pending = 10;
+    }
+    REQUIRE(pool.size() == 16);
+
+    for (auto& handler : handlers)
+        for (int i = 0; i < 3; ++i)
+            pool.wakeup(handler.id);
+
+    for (auto& handler : handlers)
+        CHECK(waitFor([&]() { return handler.pending == 0; }));
+
+    for (auto& handler : handlers)
+    {
+        pool.remove(handler.id);
+        CHECK(handler.invocations >= 10);
+    }
+    CHECK(pool.size() == 0);
+}
+
+TEST_CASE("ParserPool.deadline", "[parser]")
+{
+    auto pool = ParserPool{1};
+    auto handler = CountingHandler{};
+    handler.pool = &pool;
+    handler.id = pool.add(handler);
+    handler.deadline = ParserPool::clock::now() + milliseconds{20};
+
+    pool.wakeup(handler.id);
+    REQUIRE(waitFor([&]() { return handler.invocations == 1; }));
+    handler.deadline.reset();
+
+    // invoked once more after the deadline, without being woken up
+    CHECK(waitFor([&]() { return handler.invocations == 2; }));
+    this_thread::sleep_for(milliseconds{30});
+    CHECK(handler.invocations == 2);
+
+    pool.remove(handler.id);
+    pool.wakeup(handler.id); // ignored after removal
+}
+
+TEST_CASE("ParserPool.urgent", "[parser]")
+{
+    auto pool = ParserPool{1};
+    auto order = vector<int>{};
+    auto done = atomic<size_t>{0};
+    auto blocked = atomic<bool>{true};
+
+    // Occupies the only worker, such that the others queue up meanwhile.
+    struct BlockingHandler : ParserPool::Handler {
+        atomic<bool>* blocked;
+        atomic<bool> started = false;
+        optional<ParserPool::clock::time_point> onParserWakeup() override
+        {
+            started = true;
+            while (*blocked)
+                this_thread::sleep_for(microseconds{100});
+            return nullopt;
+        }
+    } blocker;
+    blocker.blocked = &blocked;
+
+    struct OrderedHandler : ParserPool::Handler {
+        vector<int>* order;
+        atomic<size_t>* done;
+        int value;
+        OrderedHandler(vector<int>* _order, atomic<size_t>* _done, int _value):
+            order{_order}, done{_done}, value{_value} {}
+        optional<ParserPool::clock::time_point> onParserWakeup() override
+        {
+            order->push_back(value);
+            ++*done;
+            return nullopt;
+        }
+    };
+    auto handlers = vector<OrderedHandler>{{&order, &done, 1}, {&order, &done, 2}, {&order, &done, 3}};
+
+    auto const blockerId = pool.add(blocker);
+    auto ids = vector<ParserPool::Id>{};
+    for (auto& handler : handlers)
+        ids.push_back(pool.add(handler));
+
+    pool.wakeup(blockerId);
+    REQUIRE(waitFor([&]() { return blocker.started.load(); }));
+
+    pool.wakeup(ids[0]);
+    pool.wakeup(ids[1]);
+    pool.wakeup(ids[2], true);
+    pool.wakeup(ids[1], true); // promotes the already queued one
+    blocked = false;
+
+    REQUIRE(waitFor([&]() { return done == 3; }));
+    CHECK(order == vector<int>{2, 3, 1});
+
+    pool.remove(blockerId);
+    for (auto const id : ids)
+        pool.remove(id);
+}
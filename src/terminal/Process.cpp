@@ -199,6 +199,12 @@ Process::Process(string const& _path,
             // reset signal(s) to default that may have been changed in the parent process.
             signal(SIGPIPE, SIG_DFL);
 
+            // Signals blocked by the parent (such as SIGUSR1 for saving traces) would otherwise stay
+            // blocked for the shell and everything started from it.
+            sigset_t signalMask;
+            sigemptyset(&signalMask);
+            sigprocmask(SIG_SETMASK, &signalMask, nullptr);
+
             ::execvp(_path.c_str(), argv);
             ::_exit(EXIT_FAILURE);
             break;
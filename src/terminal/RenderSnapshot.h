@@ -0,0 +1,93 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/Grid.h>
+#include <terminal/Hyperlink.h>
+#include <terminal/Selector.h>
+#include <terminal/Sequencer.h>     // CursorShape
+#include <terminal/Size.h>
+
+#include <crispy/span.h>
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace terminal {
+
+/// Copy of everything needed to render one frame of a terminal's screen.
+///
+/// It is taken while holding the screen lock (see Terminal::takeSnapshot()), such that text shaping,
+/// rasterization and GPU command building can all happen without blocking the terminal.
+/// Instances are meant to be reused across frames, so that no allocations happen in steady state.
+struct RenderSnapshot {
+    /// Size of the visible page.
+    Size pageSize{};
+
+    /// Visible cells, row-major, with pageSize.height rows of pageSize.width columns each.
+    std::vector<Cell> cells;
+
+    /// Visible selection ranges, with lines relative to the viewport (1-based), sorted by line.
+    std::vector<Selector::Range> selection;
+
+    /// Visible search matches, with lines relative to the viewport (1-based), sorted by line and column.
+    std::vector<Selector::Range> searchMatches;
+
+    /// Hyperlink currently under the mouse cursor, or 0 if none.
+    HyperlinkId hoveredHyperlink = 0;
+
+    struct {
+        bool visible = false;       // whether or not the cursor is to be drawn at all in this frame.
+        Coordinate position{};      // viewport-relative cursor position.
+        CursorShape shape = CursorShape::Block;
+        int width = 1;              // width of the cell the cursor is placed at.
+    } cursor;
+
+    bool reverseVideo = false;
+    bool primaryScreen = true;
+
+    /// Viewport's absolute scroll offset, or std::nullopt if scrolled to the bottom.
+    std::optional<int> scrollOffset;
+
+    /// Number of screen changes since the previous snapshot.
+    uint64_t changes = 0;
+
+    /// Time the screen lock was held for taking this snapshot.
+    std::chrono::nanoseconds lockHoldTime{};
+
+    /// @returns all cells of the given viewport-relative row (1-based), from left to right.
+    crispy::span<Cell const> row(int _row) const noexcept
+    {
+        return crispy::span<Cell const>(cells.data() + static_cast<size_t>((_row - 1) * pageSize.width),
+                                        static_cast<size_t>(pageSize.width));
+    }
+
+    Cell const& at(Coordinate const& _pos) const noexcept
+    {
+        return cells[static_cast<size_t>((_pos.row - 1) * pageSize.width + (_pos.column - 1))];
+    }
+
+    /// Tests whether or not the given viewport-relative position is covered by the selection.
+    bool isSelected(Coordinate const& _pos) const noexcept
+    {
+        for (auto const& range : selection)
+            if (range.line == _pos.row && range.fromColumn <= _pos.column && _pos.column <= range.toColumn)
+                return true;
+        return false;
+    }
+};
+
+} // end namespace
@@ -22,6 +22,8 @@
 #include <crispy/algorithm.h>
 #include <crispy/escape.h>
 #include <crispy/debuglog.h>
+#include <crispy/metrics.h>
+#include <crispy/trace.h>
 #include <crispy/times.h>
 #include <crispy/utils.h>
 
@@ -242,9 +244,10 @@ namespace // {{{ helper
 
     array<Grid, 2> emptyGrids(Size _size, optional<int> _maxHistoryLineCount)
     {
+        // The alternate screen's lines are only allocated once it gets used (see Screen::setBuffer()).
         return array<Grid, 2>{
             Grid(_size, GridTextReflowEnabled, _maxHistoryLineCount),
-            Grid(_size, false, 0)
+            Grid(Size{_size.width, 0}, false, 0)
         };
     }
 }
@@ -317,7 +320,8 @@ void Screen::resizeColumns(int _newColumnCount, bool _clear)
 void Screen::resize(Size const& _newSize)
 {
     cursor_.position = grid().resize(_newSize, cursor_.position, wrapPending_);
-    backgroundGrid().resize(_newSize, cursor_.position, false);
+    if (isAlternateScreen() || alternateGridAllocated())
+        backgroundGrid().resize(_newSize, cursor_.position, false);
 
     // update wrap-pending
     if (_newSize.width > size_.width)
@@ -405,10 +409,12 @@ namespace {
 void Screen::write(char const * _data, size_t _size)
 {
 #if defined(LIBTERMINAL_LOG_RAW)
-    if (crispy::logging_sink::for_debug().enabled())
+    if (crispy::debugtag::enabled(ScreenRawOutputTag))
         debuglog(ScreenRawOutputTag).write("raw: \"{}\"", escape(_data, _data + _size));
 #endif
 
+    CRISPY_TRACE_SPAN("screen.write");
+    CRISPY_METRICS_COUNT("vt.bytes_parsed", _size);
     parser_.parseFragment(string_view(_data, _size));
     eventListener_.screenUpdated();
 }
@@ -545,13 +551,7 @@ optional<int> Screen::findMarkerBackward(int _currentCursorLine) const
     if (_currentCursorLine < 0 || !isPrimaryScreen())
         return nullopt;
 
-    _currentCursorLine = min(_currentCursorLine, historyLineCount() + size_.height);
-
-    for (int i = _currentCursorLine - 1; i >= 0; --i)
-        if (grid().absoluteLineAt(i).marked())
-            return {i};
-
-    return nullopt;
+    return grid().findMarkerBackward(_currentCursorLine, Line::Flags::Marked | Line::Flags::PromptStart);
 }
 
 optional<int> Screen::findMarkerForward(int _currentCursorLine) const
@@ -559,11 +559,32 @@ optional<int> Screen::findMarkerForward(int _currentCursorLine) const
     if (_currentCursorLine < 0 || !isPrimaryScreen())
         return nullopt;
 
-    for (int i = _currentCursorLine + 1; i < historyLineCount() + grid().screenSize().height; ++i)
-        if (grid().absoluteLineAt(i).marked())
-            return {i};
+    return grid().findMarkerForward(_currentCursorLine, Line::Flags::Marked | Line::Flags::PromptStart);
+}
+
+optional<pair<int, int>> Screen::findLastCommandOutput() const
+{
+    if (!isPrimaryScreen())
+        return nullopt;
+
+    auto const finished = grid().findMarkerBackward(historyLineCount() + size_.height, Line::Flags::CommandFinished);
+    if (!finished.has_value())
+        return nullopt;
+
+    auto const outputStart = grid().findMarkerBackward(*finished + 1, Line::Flags::OutputStart);
+    if (!outputStart.has_value())
+        return nullopt;
 
-    return nullopt;
+    // The command finished on the line it started its output on, i.e. without any output.
+    if (*finished == *outputStart)
+        return nullopt;
+
+    // The command usually finishes at the beginning of the line below its last line of output,
+    // unless that output is not terminated by a newline.
+    if (grid().absoluteLineAt(*finished).isFlagEnabled(Line::Flags::OutputEnd))
+        return pair{*outputStart, *finished};
+
+    return pair{*outputStart, *finished - 1};
 }
 
 // {{{ tabs related
@@ -630,7 +651,7 @@ void Screen::resetSoft()
     setTopBottomMargin(1, size().height); // DECSTBM
     setLeftRightMargin(1, size().width); // DECRLM
 
-    currentHyperlink_ = {};
+    currentHyperlink_ = 0;
 
     // TODO: DECNKM (Numeric keypad)
     // TODO: DECSCA (Select character attribute)
@@ -664,7 +685,7 @@ void Screen::resetHard()
         Margin::Range{1, size_.width}
     };
 
-    currentHyperlink_ = {};
+    currentHyperlink_ = 0;
 }
 
 void Screen::moveCursorTo(Coordinate to)
@@ -685,6 +706,8 @@ void Screen::setBuffer(ScreenType _type)
                 activeGrid_ = &primaryGrid();
                 break;
             case ScreenType::Alternate:
+                if (!alternateGridAllocated())
+                    alternateGrid() = Grid(size_, false, 0);
                 if (isModeEnabled(DECMode::MouseAlternateScroll))
                     eventListener_.setMouseWheelMode(InputGenerator::MouseWheelMode::ApplicationCursorKeys);
                 else
@@ -694,6 +717,9 @@ void Screen::setBuffer(ScreenType _type)
         }
         screenType_ = _type;
 
+        // The cursor keeps its position, but now refers to the other grid's lines.
+        updateCursorIterators();
+
         eventListener_.bufferChanged(_type);
     }
 }
@@ -864,7 +890,7 @@ void Screen::sendTerminalId()
 void Screen::clearToEndOfScreen()
 {
     if (isAlternateScreen() && cursor_.position.row == 1 && cursor_.position.column == 1)
-        hyperlinks_.clear();
+        hyperlinks_.clearUserIds();
 
     clearToEndOfLine();
 
@@ -1083,20 +1109,121 @@ void Screen::setCurrentWorkingDirectory(string const& _url)
 void Screen::hyperlink(string const& _id, string const& _uri)
 {
     if (_uri.empty())
-        currentHyperlink_ = nullptr;
-    else if (_id.empty())
-        currentHyperlink_ = make_shared<HyperlinkInfo>(HyperlinkInfo{_id, _uri});
-    else if (auto i = hyperlinks_.find(_id); i != hyperlinks_.end())
-        currentHyperlink_ = i->second;
-    else
     {
-        currentHyperlink_ = make_shared<HyperlinkInfo>(HyperlinkInfo{_id, _uri});
-        hyperlinks_[_id] = currentHyperlink_;
+        currentHyperlink_ = 0;
+        return;
+    }
+
+    if (hyperlinks_.collectionDue())
+    {
+        currentHyperlink_ = 0;
+        collectHyperlinks();
+    }
+
+    currentHyperlink_ = hyperlinks_.add(_id, _uri);
+
+    if (currentHyperlink_ == 0)
+    {
+        // The table is full.
+        collectHyperlinks();
+        currentHyperlink_ = hyperlinks_.add(_id, _uri);
+    }
+
+    if (currentHyperlink_ == 0)
+    {
+        // Still full, so give up the hyperlinks of the oldest scrollback lines.
+        evictHyperlinks();
+        collectHyperlinks();
+        currentHyperlink_ = hyperlinks_.add(_id, _uri);
+    }
+}
+
+void Screen::collectHyperlinks()
+{
+    hyperlinks_.mark(currentHyperlink_);
+    hyperlinks_.mark(hyperlinks_.hovered());
+
+    for (size_t i = 0; i < grids_.size(); ++i)
+    {
+        updateScrollbackHyperlinks(i);
+        for (Line const& line : grids_[i].mainPage())
+            for (Cell const& cell : line)
+                hyperlinks_.mark(cell.hyperlink());
+    }
+
+    hyperlinks_.sweep();
+}
+
+void Screen::updateScrollbackHyperlinks(size_t _index)
+{
+    Grid const& grid = grids_[_index];
+    auto& scrollback = scrollbackHyperlinks_[_index];
+
+    auto const uncount = [this](vector<HyperlinkId> const& _ids) {
+        for (auto const id : _ids)
+            hyperlinks_.removeReference(id);
+    };
+
+    auto const discarded = grid.discardedLineCount();
+    if (grid.generation() != scrollback.gridGeneration || grid.screenSize() != scrollback.gridSize)
+    {
+        // The lines have been replaced or reflowed, so they are counted anew.
+        for (auto const& line : scrollback.lines)
+            uncount(line.second);
+        scrollback.lines.clear();
+        scrollback.gridGeneration = grid.generation();
+        scrollback.gridSize = grid.screenSize();
+        scrollback.end = discarded;
+    }
+
+    while (!scrollback.lines.empty() && scrollback.lines.front().first < discarded)
+    {
+        uncount(scrollback.lines.front().second);
+        scrollback.lines.pop_front();
+    }
+
+    auto const historyEnd = discarded + static_cast<uint64_t>(grid.historyLineCount());
+    auto ids = vector<HyperlinkId>{};
+    for (scrollback.end = max(scrollback.end, discarded); scrollback.end < historyEnd; ++scrollback.end)
+    {
+        ids.clear();
+        for (Cell const& cell : grid.absoluteLineAt(static_cast<int>(scrollback.end - discarded)))
+            if (auto const id = cell.hyperlink(); id != 0 && find(ids.begin(), ids.end(), id) == ids.end())
+                ids.push_back(id);
+
+        if (!ids.empty())
+        {
+            for (auto const id : ids)
+                hyperlinks_.addReference(id);
+            scrollback.lines.emplace_back(scrollback.end, ids);
+        }
+    }
+}
+
+void Screen::evictHyperlinks()
+{
+    size_t unreferenced = 0;
+
+    for (size_t i = 0; i < grids_.size(); ++i)
+    {
+        updateScrollbackHyperlinks(i);
+
+        auto& grid = grids_[i];
+        auto& lines = scrollbackHyperlinks_[i].lines;
+        while (!lines.empty() && unreferenced < HyperlinkStorage::MinCollectionInterval)
+        {
+            auto const& [line, ids] = lines.front();
+            for (Cell& cell : grid.absoluteLineAt(static_cast<int>(line - grid.discardedLineCount())))
+                if (cell.hyperlink() != 0)
+                    cell.setHyperlink(0);
+
+            for (auto const id : ids)
+                if (hyperlinks_.removeReference(id) == 0)
+                    ++unreferenced;
+
+            lines.pop_front();
+        }
     }
-    // TODO:
-    // Care about eviction.
-    // Move hyperlink store into ScreenBuffer, so it gets reset upon every switch into
-    // alternate screen (not for main screen!)
 }
 
 void Screen::moveCursorUp(int _n)
@@ -1411,6 +1538,25 @@ void Screen::setMark()
     currentLine_->setMarked(true);
 }
 
+void Screen::markPromptStart()
+{
+    currentLine_->setFlag(Line::Flags::PromptStart, true);
+}
+
+void Screen::markCommandOutputStart()
+{
+    currentLine_->setFlag(Line::Flags::OutputStart, true);
+}
+
+void Screen::markCommandFinished()
+{
+    currentLine_->setFlag(Line::Flags::CommandFinished, true);
+
+    // Output not terminated by a newline ends on this very line.
+    if (realCursorPosition().column > 1)
+        currentLine_->setFlag(Line::Flags::OutputEnd, true);
+}
+
 void Screen::saveModes(std::vector<DECMode> const& _modes)
 {
     modes_.save(_modes);
@@ -1454,8 +1600,10 @@ void Screen::setMode(DECMode _mode, bool _enable)
             }
             break;
         case DECMode::BatchedRendering:
-            // Only perform batched rendering when NOT in debugging mode.
-            // TODO: also, do I still need this here?
+            // Synchronized output. The screen is updated as usual, but presenting these updates
+            // is held back by the terminal until this mode gets disabled again.
+            if (_enable != isModeEnabled(_mode))
+                eventListener_.setSynchronizedOutput(_enable);
             break;
         case DECMode::TextReflow:
             if (isPrimaryScreen())
@@ -1676,6 +1824,10 @@ void Screen::singleShiftSelect(CharsetTable _table)
 
 void Screen::sixelImage(Size _pixelSize, Image::Data&& _data)
 {
+    // Without knowing the size of a cell, the image cannot be mapped onto the grid.
+    if (!cellPixelSize_.width || !cellPixelSize_.height)
+        return;
+
     auto const columnCount = int(ceilf(float(_pixelSize.width) / float(cellPixelSize_.width)));
     auto const rowCount = int(ceilf(float(_pixelSize.height) / float(cellPixelSize_.height)));
     auto const extent = Size{columnCount, rowCount};
@@ -37,6 +37,7 @@
 #include <fmt/format.h>
 
 #include <algorithm>
+#include <array>
 #include <deque>
 #include <functional>
 #include <list>
@@ -48,6 +49,7 @@
 #include <stack>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 namespace terminal {
@@ -97,6 +99,13 @@ class Modes {
         }
     }
 
+    // {{{ raw access, for saving and restoring the screen state
+    std::set<AnsiMode> const& enabledAnsiModes() const noexcept { return ansi_; }
+    std::set<DECMode> const& enabledDECModes() const noexcept { return dec_; }
+    std::map<DECMode, std::vector<bool>> const& savedModes() const noexcept { return savedModes_; }
+    std::map<DECMode, std::vector<bool>>& savedModes() noexcept { return savedModes_; }
+    // }}}
+
   private:
     // TODO: make this a vector<bool> by casting from Mode, but that requires ensured small linearity in Mode enum values.
     std::set<AnsiMode> ansi_;
@@ -194,6 +203,13 @@ class Screen {
         activeGrid_->render(std::forward<Renderer>(_render), _scrollOffset);
     }
 
+    /// Renders the full screen by passing every visible line along with its row number to the callback.
+    template <typename Renderer>
+    void renderLines(Renderer&& _render, std::optional<int> _scrollOffset = std::nullopt) const
+    {
+        activeGrid_->renderLines(std::forward<Renderer>(_render), _scrollOffset);
+    }
+
     /// Renders a single text line.
     std::string renderTextLine(int _row) const;
 
@@ -208,6 +224,19 @@ class Screen {
     ///          including initial clear screen, and initial cursor hide.
     std::string screenshot(std::function<std::string(int)> const& _postLine = {}) const;
 
+    /// Saves the complete screen state in a versioned binary format (see ScreenState.h).
+    ///
+    /// That is both grids including their scrollback, the cursors, modes, margins, tab stops,
+    /// window titles, as well as the hyperlinks and images referenced by the grid cells.
+    /// The parser state and the image color palette are not part of it.
+    std::string saveState() const;
+
+    /// Restores a screen state previously saved via saveState(), including its screen size.
+    ///
+    /// @throws std::runtime_error if @p _state is malformed or of an unsupported version,
+    ///         in which case the screen is left unchanged.
+    void restoreState(std::string_view _state);
+
     void setFocus(bool _focused) { focused_ = _focused; }
     bool focused() const noexcept { return focused_; }
 
@@ -258,6 +287,9 @@ class Screen {
     void reverseIndex(); // RI
 
     void setMark();
+    void markPromptStart();               // OSC 133 ; A
+    void markCommandOutputStart();        // OSC 133 ; C
+    void markCommandFinished();           // OSC 133 ; D
     void deviceStatusReport();            // DSR
     void reportCursorPosition();          // CPR
     void reportExtendedCursorPosition();  // DECXCPR
@@ -439,6 +471,19 @@ class Screen {
     /// Gets a reference to the cell relative to screen origin (top left, 1:1).
     Cell const& at(Coordinate const& _coord) const noexcept { return grid().at(_coord); }
 
+    /// @returns the hyperlink of the cell at the given screen coordinate, or nullptr if it has none.
+    HyperlinkInfo const* hyperlinkAt(Coordinate const& _coord) const noexcept { return hyperlinks_.at(at(_coord).hyperlink()); }
+
+    /// @returns the hyperlinks referenced by the cells of both, the primary and the alternate screen.
+    HyperlinkStorage const& hyperlinks() const noexcept { return hyperlinks_; }
+    HyperlinkStorage& hyperlinks() noexcept { return hyperlinks_; }
+
+    /// Reclaims all hyperlinks no longer referenced by any line of either grid, history included.
+    ///
+    /// Besides the main pages, only the lines that entered or left a scrollback since the previous
+    /// collection are looked at, as the references of scrollback lines are counted incrementally.
+    void collectHyperlinks();
+
     bool isPrimaryScreen() const noexcept { return activeGrid_ == &grids_[0]; }
     bool isAlternateScreen() const noexcept { return activeGrid_ == &grids_[1]; }
 
@@ -491,6 +536,14 @@ class Screen {
     ///         in the screen area, and in the savedLines area otherwise.
     std::optional<int> findMarkerBackward(int _currentCursorLine) const;
 
+    /// Finds the output of the most recently finished command, as delimited by OSC 133 markers.
+    ///
+    /// A command that finished on the line its output started on counts as having no output.
+    ///
+    /// @return inclusive range of absolute line numbers of the command's output,
+    ///         or std::nullopt if there is no finished command or it did not print anything.
+    std::optional<std::pair<int, int>> findLastCommandOutput() const;
+
     /// ScreenBuffer's type, such as main screen or alternate screen.
     ScreenType bufferType() const noexcept { return screenType_; }
 
@@ -505,6 +558,9 @@ class Screen {
 
     void setMaxImageSize(Size _size) noexcept { sequencer_.setMaxImageSize(_size); }
 
+    /// @returns total number of VT instructions processed so far.
+    int64_t instructionCount() const noexcept { return sequencer_.totalInstructionCount(); }
+
     void scrollUp(int n) { scrollUp(n, margin_); }
     void scrollDown(int n) { scrollDown(n, margin_); }
 
@@ -526,8 +582,12 @@ class Screen {
     Grid& primaryGrid() noexcept { return grids_[0]; }
 
     /// @returns the alternate  screen's grid.
+    ///
+    /// It has no lines until the alternate screen is used for the first time.
     Grid& alternateGrid() noexcept { return grids_[1]; }
 
+    bool alternateGridAllocated() const noexcept { return grids_[1].screenSize().height != 0; }
+
     /// @returns the primary screen's grid if primary screen is active.
     Grid const& grid() const noexcept { return *activeGrid_; }
 
@@ -595,6 +655,12 @@ class Screen {
     /// Sets the current column to given logical column number.
     void setCurrentColumn(int _n);
 
+    /// Counts the hyperlink references of the lines that entered or left the scrollback of grid @p _index.
+    void updateScrollbackHyperlinks(size_t _index);
+
+    /// Removes the hyperlinks of the oldest scrollback lines, such that some of them can be reclaimed.
+    void evictHyperlinks();
+
   private:
     ScreenEvents& eventListener_;
 
@@ -653,8 +719,17 @@ class Screen {
 
     // Hyperlink related
     //
-    HyperlinkRef currentHyperlink_ = {};
-    std::unordered_map<std::string, HyperlinkRef> hyperlinks_; // TODO: use a deque<> instead, always push_back, lookup reverse, evict in front.
+    HyperlinkId currentHyperlink_ = 0;
+    HyperlinkStorage hyperlinks_;
+
+    // Scrollback lines of a grid whose hyperlinks are counted as references in hyperlinks_.
+    struct ScrollbackHyperlinks {
+        uint64_t gridGeneration = 0;
+        Size gridSize{};
+        uint64_t end = 0;   // one past the last counted line, plus the grid's discarded line count
+        std::deque<std::pair<uint64_t, std::vector<HyperlinkId>>> lines; // counted lines having hyperlinks
+    };
+    std::array<ScrollbackHyperlinks, 2> scrollbackHyperlinks_;
 };
 
 }  // namespace terminal
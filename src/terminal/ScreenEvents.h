@@ -65,6 +65,7 @@ class ScreenEvents {
     virtual void setMouseProtocol(MouseProtocol, bool) {}
     virtual void setMouseTransport(MouseTransport) {}
     virtual void setMouseWheelMode(InputGenerator::MouseWheelMode) {}
+    virtual void setSynchronizedOutput(bool /*_enabled*/) {}
     virtual void setWindowTitle(std::string_view const& /*_title*/) {}
     virtual void useApplicationCursorKeys(bool /*_enabled*/) {}
 
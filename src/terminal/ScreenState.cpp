@@ -0,0 +1,678 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Screen.h>
+#include <terminal/ScreenState.h>
+
+#include <fmt/format.h>
+
+#include <array>
+#include <cstring>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <unordered_map>
+#include <variant>
+
+using std::array;
+using std::get_if;
+using std::map;
+using std::move;
+using std::runtime_error;
+using std::shared_ptr;
+using std::stack;
+using std::string;
+using std::string_view;
+using std::unordered_map;
+using std::vector;
+
+namespace terminal {
+
+namespace {
+    class StateWriter {
+      public:
+        explicit StateWriter(string& _output) : output_{_output} {}
+
+        template <typename T>
+        void put(T const& _value)
+        {
+            putArray(&_value, 1);
+        }
+
+        template <typename T>
+        void putArray(T const* _values, size_t _count)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            auto const offset = output_.size();
+            output_.resize(offset + sizeof(T) * _count);
+            std::memcpy(output_.data() + offset, _values, sizeof(T) * _count);
+        }
+
+        void putString(string_view _value)
+        {
+            put(static_cast<uint32_t>(_value.size()));
+            output_.append(_value.data(), _value.size());
+        }
+
+      private:
+        string& output_;
+    };
+
+    class StateReader {
+      public:
+        explicit StateReader(string_view _input) : input_{_input} {}
+
+        [[noreturn]] static void malformed()
+        {
+            throw runtime_error{"Malformed screen state."};
+        }
+
+        template <typename T>
+        T get()
+        {
+            T value;
+            getArray(&value, 1);
+            return value;
+        }
+
+        template <typename T>
+        void getArray(T* _values, size_t _count)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            expect(_count, sizeof(T));
+            std::memcpy(_values, input_.data(), sizeof(T) * _count);
+            input_.remove_prefix(sizeof(T) * _count);
+        }
+
+        /// Ensures that @p _count elements of @p _elementSize bytes can still be read.
+        void expect(size_t _count, size_t _elementSize) const
+        {
+            if (_count > input_.size() / _elementSize)
+                malformed();
+        }
+
+        /// Reads the element count of an array of elements of at least @p _elementSize bytes.
+        size_t count(size_t _elementSize)
+        {
+            auto const n = get<uint32_t>();
+            expect(n, _elementSize);
+            return n;
+        }
+
+        string getString()
+        {
+            auto const length = count(1);
+            auto result = string{input_.substr(0, length)};
+            input_.remove_prefix(length);
+            return result;
+        }
+
+        bool atEnd() const noexcept { return input_.empty(); }
+
+      private:
+        string_view input_;
+    };
+
+    static_assert(std::variant_size_v<Color> == 5, "SavedColor needs to be extended along with Color.");
+
+    SavedColor encodeColor(Color const& _color)
+    {
+        auto result = SavedColor{static_cast<uint8_t>(_color.index()), {}};
+        if (auto const indexed = get_if<IndexedColor>(&_color))
+            result.value[0] = static_cast<uint8_t>(*indexed);
+        else if (auto const bright = get_if<BrightColor>(&_color))
+            result.value[0] = static_cast<uint8_t>(*bright);
+        else if (auto const rgb = get_if<RGBColor>(&_color))
+        {
+            result.value[0] = rgb->red;
+            result.value[1] = rgb->green;
+            result.value[2] = rgb->blue;
+        }
+        return result;
+    }
+
+    Color decodeColor(SavedColor const& _color)
+    {
+        switch (_color.type)
+        {
+            case 0: return UndefinedColor{};
+            case 1: return DefaultColor{};
+            case 2: return static_cast<IndexedColor>(_color.value[0]);
+            case 3: return static_cast<BrightColor>(_color.value[0]);
+            case 4: return RGBColor{_color.value[0], _color.value[1], _color.value[2]};
+        }
+        StateReader::malformed();
+    }
+
+    SavedAttributes encodeAttributes(GraphicsAttributes const& _attributes)
+    {
+        return SavedAttributes{
+            encodeColor(_attributes.foregroundColor),
+            encodeColor(_attributes.backgroundColor),
+            encodeColor(_attributes.underlineColor),
+            static_cast<uint16_t>(_attributes.styles.mask()),
+            0
+        };
+    }
+
+    GraphicsAttributes decodeAttributes(SavedAttributes const& _attributes)
+    {
+        auto result = GraphicsAttributes{};
+        result.foregroundColor = decodeColor(_attributes.foregroundColor);
+        result.backgroundColor = decodeColor(_attributes.backgroundColor);
+        result.underlineColor = decodeColor(_attributes.underlineColor);
+        result.styles = CharacterStyleMask{static_cast<unsigned>(_attributes.styles)};
+        return result;
+    }
+
+    SavedCursor encodeCursor(Cursor const& _cursor)
+    {
+        auto result = SavedCursor{};
+        result.row = _cursor.position.row;
+        result.column = _cursor.position.column;
+        result.graphicsRendition = encodeAttributes(_cursor.graphicsRendition);
+        result.autoWrap = _cursor.autoWrap;
+        result.originMode = _cursor.originMode;
+        result.visible = _cursor.visible;
+        result.charsetShift = static_cast<uint8_t>(_cursor.charsets.currentTable());
+        result.charsetSelected = static_cast<uint8_t>(_cursor.charsets.selectedTable());
+        for (size_t i = 0; i < 4; ++i)
+            result.charsets[i] = static_cast<uint8_t>(_cursor.charsets.charsetId(static_cast<CharsetTable>(i)));
+        return result;
+    }
+
+    Cursor decodeCursor(SavedCursor const& _cursor, Size _size)
+    {
+        if (_cursor.row < 1 || _cursor.row > _size.height || _cursor.column < 1 || _cursor.column > _size.width
+                || _cursor.charsetShift > 3 || _cursor.charsetSelected > 3)
+            StateReader::malformed();
+
+        auto result = Cursor{};
+        result.position = Coordinate{_cursor.row, _cursor.column};
+        result.graphicsRendition = decodeAttributes(_cursor.graphicsRendition);
+        result.autoWrap = _cursor.autoWrap != 0;
+        result.originMode = _cursor.originMode != 0;
+        result.visible = _cursor.visible != 0;
+        for (size_t i = 0; i < 4; ++i)
+        {
+            if (_cursor.charsets[i] > static_cast<uint8_t>(CharsetId::USASCII))
+                StateReader::malformed();
+            result.charsets.select(static_cast<CharsetTable>(i), static_cast<CharsetId>(_cursor.charsets[i]));
+        }
+        result.charsets.selectDefaultTable(static_cast<CharsetTable>(_cursor.charsetSelected));
+        result.charsets.singleShift(static_cast<CharsetTable>(_cursor.charsetShift));
+        return result;
+    }
+
+    SavedCell encodeCell(Cell const& _cell, map<RasterizedImage const*, uint32_t> const& _images)
+    {
+        auto result = SavedCell{};
+        std::copy_n(_cell.codepoints().data(), _cell.codepointCount(), result.codepoints);
+        result.attributes = encodeAttributes(_cell.attributes());
+        if (auto const& fragment = _cell.imageFragment(); fragment.has_value())
+        {
+            result.image = _images.at(&fragment->rasterizedImage());
+            result.imageRow = static_cast<uint16_t>(fragment->offset().row);
+            result.imageColumn = static_cast<uint16_t>(fragment->offset().column);
+        }
+        result.hyperlink = _cell.hyperlink();
+        result.codepointCount = static_cast<uint8_t>(_cell.codepointCount());
+        result.width = static_cast<uint8_t>(_cell.width());
+        return result;
+    }
+
+    /// Tests whether the image can be rasterized, i.e. whether every cell of its cell span
+    /// maps to pixels within its RGBA pixel data.
+    bool isValidImage(SavedImage const& _image) noexcept
+    {
+        auto constexpr MaxExtent = 0xFFFFu;
+        auto const isValidExtent = [](uint32_t _value) { return _value >= 1 && _value <= MaxExtent; };
+        return _image.format <= static_cast<uint32_t>(ImageFormat::PNG)
+            && _image.alignment <= static_cast<uint32_t>(ImageAlignment::BottomEnd)
+            && _image.resize <= static_cast<uint32_t>(ImageResize::StretchToFill)
+            && isValidExtent(_image.width) && isValidExtent(_image.height)
+            && isValidExtent(_image.cellSpanWidth) && isValidExtent(_image.cellSpanHeight)
+            && isValidExtent(_image.cellWidth) && isValidExtent(_image.cellHeight)
+            && uint64_t{_image.dataSize} == uint64_t{_image.width} * _image.height * 4
+            && uint64_t{_image.cellSpanWidth - 1} * _image.cellWidth < _image.width
+            && uint64_t{_image.cellSpanHeight - 1} * _image.cellHeight < _image.height;
+    }
+
+    bool isValidCell(SavedCell const& _cell, vector<SavedImage> const& _images) noexcept
+    {
+        if (_cell.codepointCount > Cell::MaxCodepoints || _cell.image > _images.size())
+            return false;
+
+        if (_cell.image == 0)
+            return true;
+
+        auto const& image = _images[_cell.image - 1];
+        return _cell.imageRow < image.cellSpanHeight && _cell.imageColumn < image.cellSpanWidth;
+    }
+
+    bool isValidMode(AnsiMode _mode) noexcept { return !to_code(_mode).empty(); }
+    bool isValidMode(DECMode _mode) noexcept { return to_code(_mode) != "0"; }
+
+    /// Decodes a mode that has been saved as its numeric value, or throws if it is not a known mode.
+    template <typename Mode>
+    Mode decodeMode(uint32_t _value)
+    {
+        auto const mode = static_cast<Mode>(_value);
+        if (_value > 0xFFFF || !isValidMode(mode))
+            StateReader::malformed();
+        return mode;
+    }
+
+    /// Decodes a cell that has been checked with isValidCell() before.
+    Cell decodeCell(SavedCell const& _cell, vector<shared_ptr<RasterizedImage const>> const& _images)
+    {
+        auto result = Cell{};
+        if (_cell.image != 0)
+        {
+            auto const offset = Coordinate{_cell.imageRow, _cell.imageColumn};
+            result.setImage(ImageFragment{_images[_cell.image - 1], offset}, _cell.hyperlink);
+        }
+        else
+        {
+            for (uint8_t i = 0; i < _cell.codepointCount; ++i)
+                if (i == 0)
+                    result.setCharacter(_cell.codepoints[0]);
+                else
+                    result.appendCharacter(_cell.codepoints[i]);
+            result.setWidth(_cell.width);
+            result.setHyperlink(_cell.hyperlink);
+        }
+        result.attributes() = decodeAttributes(_cell.attributes);
+        return result;
+    }
+
+    /// Invokes @p _callback for every line of the given grid, top to bottom.
+    template <typename Callback>
+    void forEachLine(Grid const& _grid, Callback _callback)
+    {
+        auto const lineCount = _grid.historyLineCount() + _grid.screenSize().height;
+        for (int i = 0; i < lineCount; ++i)
+            _callback(_grid.absoluteLineAt(i));
+    }
+
+    /// DEC modes that affect input handling, and thus are to be passed on to the event listener.
+    constexpr DECMode InputModes[] = {
+        DECMode::UseApplicationCursorKeys,
+        DECMode::BracketedPaste,
+        DECMode::MouseAlternateScroll,
+        DECMode::FocusTracking,
+        DECMode::UsePrivateColorRegisters,
+        DECMode::VisibleCursor,
+        DECMode::MouseProtocolX10,
+        DECMode::MouseProtocolNormalTracking,
+        DECMode::MouseProtocolHighlightTracking,
+        DECMode::MouseProtocolButtonTracking,
+        DECMode::MouseProtocolAnyEventTracking,
+    };
+}
+
+string Screen::saveState() const
+{
+    auto state = string{};
+    auto writer = StateWriter{state};
+
+    auto header = SavedStateHeader{};
+    std::memcpy(header.magic, SavedStateMagic, sizeof(header.magic));
+    header.version = SavedStateVersion;
+    header.byteOrderMark = SavedStateByteOrderMark;
+    header.cellRecordSize = sizeof(SavedCell);
+    writer.put(header);
+
+    auto screen = SavedScreen{};
+    screen.width = static_cast<uint32_t>(size_.width);
+    screen.height = static_cast<uint32_t>(size_.height);
+    screen.screenType = static_cast<uint32_t>(screenType_);
+    screen.wrapPending = wrapPending_;
+    screen.tabWidth = tabWidth_;
+    screen.terminalId = static_cast<uint32_t>(terminalId_);
+    screen.marginTop = margin_.vertical.from;
+    screen.marginBottom = margin_.vertical.to;
+    screen.marginLeft = margin_.horizontal.from;
+    screen.marginRight = margin_.horizontal.to;
+    screen.currentHyperlink = currentHyperlink_;
+    writer.put(screen);
+
+    for (Cursor const* cursor : {&cursor_, &savedCursor_, &savedPrimaryCursor_})
+        writer.put(encodeCursor(*cursor));
+
+    writer.put(static_cast<uint32_t>(tabs_.size()));
+    for (int const tab : tabs_)
+        writer.put(static_cast<int32_t>(tab));
+
+    // {{{ modes
+    writer.put(static_cast<uint32_t>(modes_.enabledAnsiModes().size()));
+    for (AnsiMode const mode : modes_.enabledAnsiModes())
+        writer.put(static_cast<uint32_t>(mode));
+
+    writer.put(static_cast<uint32_t>(modes_.enabledDECModes().size()));
+    for (DECMode const mode : modes_.enabledDECModes())
+        writer.put(static_cast<uint32_t>(mode));
+
+    writer.put(static_cast<uint32_t>(modes_.savedModes().size()));
+    for (auto const& [mode, saved] : modes_.savedModes())
+    {
+        writer.put(static_cast<uint32_t>(mode));
+        writer.put(static_cast<uint32_t>(saved.size()));
+        for (bool const enabled : saved)
+            writer.put(static_cast<uint8_t>(enabled));
+    }
+    // }}}
+
+    writer.putString(windowTitle_);
+    auto savedTitles = savedWindowTitles_;
+    writer.put(static_cast<uint32_t>(savedTitles.size()));
+    for (; !savedTitles.empty(); savedTitles.pop())
+        writer.putString(savedTitles.top());
+
+    writer.putString(currentWorkingDirectory_);
+
+    // {{{ hyperlinks and images referenced by the grid cells
+    auto hyperlinks = std::set<HyperlinkId>{};
+    auto images = map<RasterizedImage const*, uint32_t>{};
+    auto imageOrder = vector<RasterizedImage const*>{};
+    for (Grid const& grid : grids_)
+    {
+        forEachLine(grid, [&](Line const& _line) {
+            for (Cell const& cell : _line)
+            {
+                if (cell.hyperlink() != 0)
+                    hyperlinks.insert(cell.hyperlink());
+                if (auto const& fragment = cell.imageFragment(); fragment.has_value())
+                {
+                    auto const image = &fragment->rasterizedImage();
+                    if (images.emplace(image, static_cast<uint32_t>(imageOrder.size() + 1)).second)
+                        imageOrder.push_back(image);
+                }
+            }
+        });
+    }
+    if (currentHyperlink_ != 0)
+        hyperlinks.insert(currentHyperlink_);
+
+    writer.put(static_cast<uint32_t>(hyperlinks.size()));
+    for (HyperlinkId const id : hyperlinks)
+    {
+        auto const info = hyperlinks_.at(id);
+        writer.put(id);
+        writer.putString(info ? string_view{info->id} : string_view{});
+        writer.putString(info ? string_view{info->uri} : string_view{});
+    }
+
+    writer.put(static_cast<uint32_t>(imageOrder.size()));
+    for (RasterizedImage const* image : imageOrder)
+    {
+        auto record = SavedImage{};
+        record.format = static_cast<uint32_t>(image->image().format());
+        record.alignment = static_cast<uint32_t>(image->alignmentPolicy());
+        record.resize = static_cast<uint32_t>(image->resizePolicy());
+        record.defaultColor = image->defaultColor().value;
+        record.width = static_cast<uint32_t>(image->image().width());
+        record.height = static_cast<uint32_t>(image->image().height());
+        record.cellSpanWidth = static_cast<uint32_t>(image->cellSpan().width);
+        record.cellSpanHeight = static_cast<uint32_t>(image->cellSpan().height);
+        record.cellWidth = static_cast<uint32_t>(image->cellSize().width);
+        record.cellHeight = static_cast<uint32_t>(image->cellSize().height);
+        record.dataSize = static_cast<uint32_t>(image->image().data().size());
+        writer.put(record);
+        writer.putArray(image->image().data().data(), image->image().data().size());
+    }
+    // }}}
+
+    auto cells = vector<SavedCell>{};
+    for (Grid const& grid : grids_)
+    {
+        auto record = SavedGrid{};
+        record.nextLineId = grid.nextLineId();
+        record.discardedLineCount = grid.discardedLineCount();
+        record.width = static_cast<uint32_t>(grid.screenSize().width);
+        record.height = static_cast<uint32_t>(grid.screenSize().height);
+        record.lineCount = static_cast<uint32_t>(grid.historyLineCount() + grid.screenSize().height);
+        writer.put(record);
+
+        forEachLine(grid, [&](Line const& _line) {
+            writer.put(SavedLine{_line.id(), static_cast<uint32_t>(_line.flags()), static_cast<uint32_t>(_line.size())});
+            cells.clear();
+            for (Cell const& cell : _line)
+                cells.emplace_back(encodeCell(cell, images));
+            writer.putArray(cells.data(), cells.size());
+        });
+    }
+
+    return state;
+}
+
+void Screen::restoreState(string_view _state)
+{
+    auto reader = StateReader{_state};
+
+    auto const header = reader.get<SavedStateHeader>();
+    if (std::memcmp(header.magic, SavedStateMagic, sizeof(header.magic)) != 0)
+        throw runtime_error{"Not a screen state."};
+    if (header.byteOrderMark != SavedStateByteOrderMark)
+        throw runtime_error{"Screen state has been saved on a host of different byte order."};
+    if (header.version != SavedStateVersion || header.cellRecordSize != sizeof(SavedCell))
+        throw runtime_error{fmt::format("Unsupported screen state version {}.", header.version)};
+
+    // Everything is decoded and validated up front, such that the screen is left unchanged
+    // if the state turns out to be malformed.
+
+    auto const screen = reader.get<SavedScreen>();
+    auto const size = Size{static_cast<int>(screen.width), static_cast<int>(screen.height)};
+    if (screen.width < 1 || screen.width > 0xFFFF || screen.height < 1 || screen.height > 0xFFFF
+            || screen.screenType > static_cast<uint32_t>(ScreenType::Alternate)
+            || screen.tabWidth < 0
+            || screen.marginTop < 1 || screen.marginTop > screen.marginBottom || screen.marginBottom > size.height
+            || screen.marginLeft < 1 || screen.marginLeft > screen.marginRight || screen.marginRight > size.width
+            || screen.currentHyperlink > 0xFFFF)
+        StateReader::malformed();
+
+    auto cursors = array<Cursor, 3>{};
+    for (Cursor& cursor : cursors)
+        cursor = decodeCursor(reader.get<SavedCursor>(), size);
+
+    // Tab stops are kept sorted by column.
+    auto tabs = vector<int>(reader.count(sizeof(int32_t)));
+    for (size_t i = 0; i < tabs.size(); ++i)
+    {
+        tabs[i] = reader.get<int32_t>();
+        if (tabs[i] < 1 || tabs[i] > size.width || (i != 0 && tabs[i] <= tabs[i - 1]))
+            StateReader::malformed();
+    }
+
+    // {{{ modes
+    auto modes = Modes{};
+    for (auto n = reader.count(sizeof(uint32_t)); n != 0; --n)
+        modes.set(decodeMode<AnsiMode>(reader.get<uint32_t>()), true);
+    for (auto n = reader.count(sizeof(uint32_t)); n != 0; --n)
+        modes.set(decodeMode<DECMode>(reader.get<uint32_t>()), true);
+    for (auto n = reader.count(2 * sizeof(uint32_t)); n != 0; --n)
+    {
+        auto& saved = modes.savedModes()[decodeMode<DECMode>(reader.get<uint32_t>())];
+        saved.resize(reader.count(sizeof(uint8_t)));
+        for (size_t i = 0; i < saved.size(); ++i)
+            saved[i] = reader.get<uint8_t>() != 0;
+    }
+    // }}}
+
+    auto windowTitle = reader.getString();
+    auto savedTitles = vector<string>(reader.count(sizeof(uint32_t)));
+    for (string& title : savedTitles)
+        title = reader.getString();
+
+    auto currentWorkingDirectory = reader.getString();
+
+    auto hyperlinks = vector<std::pair<HyperlinkId, HyperlinkInfo>>(reader.count(sizeof(HyperlinkId)));
+    for (auto& [id, info] : hyperlinks)
+    {
+        id = reader.get<HyperlinkId>();
+        info.id = reader.getString();
+        info.uri = reader.getString();
+    }
+
+    // Images are only added to the image pool once the whole state has been validated.
+    auto imageRecords = vector<SavedImage>(reader.count(sizeof(SavedImage)));
+    auto imageData = vector<Image::Data>(imageRecords.size());
+    for (size_t i = 0; i < imageRecords.size(); ++i)
+    {
+        auto const& record = imageRecords[i] = reader.get<SavedImage>();
+        if (!isValidImage(record))
+            StateReader::malformed();
+
+        reader.expect(record.dataSize, 1);
+        imageData[i].resize(record.dataSize);
+        reader.getArray(imageData[i].data(), imageData[i].size());
+    }
+
+    // Likewise, cells are only decoded (which requires their images) once validated.
+    auto grids = array<SavedGrid, 2>{};
+    auto savedLines = array<vector<SavedLine>, 2>{};
+    auto savedCells = array<vector<SavedCell>, 2>{};
+    for (size_t i = 0; i < grids.size(); ++i)
+    {
+        auto const& grid = grids[i] = reader.get<SavedGrid>();
+        auto const unallocated = i == 1 && grid.height == 0 && grid.lineCount == 0
+                              && screen.screenType == static_cast<uint32_t>(ScreenType::Main);
+        if (!unallocated && (grid.width != screen.width || grid.height != screen.height || grid.lineCount < grid.height))
+            StateReader::malformed();
+
+        reader.expect(grid.lineCount, sizeof(SavedLine));
+        savedLines[i].reserve(grid.lineCount);
+        for (uint32_t k = 0; k < grid.lineCount; ++k)
+        {
+            auto const line = reader.get<SavedLine>();
+            auto const mainPage = k >= grid.lineCount - grid.height;
+            if (line.cellCount > 0xFFFF || (mainPage && line.cellCount != grid.width))
+                StateReader::malformed();
+            savedLines[i].push_back(line);
+
+            auto& cells = savedCells[i];
+            auto const offset = cells.size();
+            cells.resize(offset + line.cellCount);
+            reader.getArray(cells.data() + offset, line.cellCount);
+            for (auto cell = cells.begin() + static_cast<ptrdiff_t>(offset); cell != cells.end(); ++cell)
+                if (!isValidCell(*cell, imageRecords))
+                    StateReader::malformed();
+        }
+    }
+
+    if (!reader.atEnd())
+        StateReader::malformed();
+
+    // {{{ apply
+    auto images = vector<shared_ptr<RasterizedImage const>>{};
+    images.reserve(imageRecords.size());
+    for (size_t i = 0; i < imageRecords.size(); ++i)
+    {
+        auto const& record = imageRecords[i];
+        images.emplace_back(imagePool_.rasterize(
+            imagePool_.create(static_cast<ImageFormat>(record.format),
+                              Size{static_cast<int>(record.width), static_cast<int>(record.height)},
+                              move(imageData[i])),
+            static_cast<ImageAlignment>(record.alignment),
+            static_cast<ImageResize>(record.resize),
+            RGBAColor{record.defaultColor},
+            Size{static_cast<int>(record.cellSpanWidth), static_cast<int>(record.cellSpanHeight)},
+            Size{static_cast<int>(record.cellWidth), static_cast<int>(record.cellHeight)}
+        ));
+    }
+
+    auto lines = array<Lines, 2>{};
+    for (size_t i = 0; i < grids.size(); ++i)
+    {
+        auto cell = savedCells[i].cbegin();
+        for (SavedLine const& line : savedLines[i])
+        {
+            auto buffer = Line::Buffer{};
+            for (uint32_t k = 0; k < line.cellCount; ++k, ++cell)
+                buffer.emplace_back(decodeCell(*cell, images));
+
+            lines[i].emplace_back(move(buffer), static_cast<Line::Flags>(line.flags));
+            lines[i].back().setId(line.id);
+        }
+        savedCells[i] = {};
+    }
+
+    auto const previousModes = modes_;
+
+    size_ = size;
+    wrapPending_ = screen.wrapPending;
+    tabWidth_ = screen.tabWidth;
+    tabs_ = move(tabs);
+    terminalId_ = static_cast<VTType>(screen.terminalId);
+    margin_ = Margin{
+        Margin::Range{screen.marginTop, screen.marginBottom},
+        Margin::Range{screen.marginLeft, screen.marginRight}
+    };
+    modes_ = move(modes);
+
+    windowTitle_ = move(windowTitle);
+    savedWindowTitles_ = stack<string>{};
+    for (auto i = savedTitles.rbegin(); i != savedTitles.rend(); ++i)
+        savedWindowTitles_.push(move(*i));
+    currentWorkingDirectory_ = move(currentWorkingDirectory);
+
+    // Hyperlinks are added anew, as ids may already be in use by this screen, and user provided
+    // ids are not to be resolved to hyperlinks of the screen state being replaced.
+    hyperlinks_.clearUserIds();
+    auto hyperlinkIds = unordered_map<HyperlinkId, HyperlinkId>{};
+    for (auto const& [id, info] : hyperlinks)
+        hyperlinkIds[id] = info.uri.empty() ? 0 : hyperlinks_.add(info.id, info.uri);
+    auto const mapHyperlink = [&](HyperlinkId _id) -> HyperlinkId {
+        if (auto const i = hyperlinkIds.find(_id); i != hyperlinkIds.end())
+            return i->second;
+        return 0;
+    };
+    for (Lines& gridLines : lines)
+        for (Line& line : gridLines)
+            for (Cell& cell : line)
+                if (cell.hyperlink() != 0)
+                    cell.setHyperlink(mapHyperlink(cell.hyperlink()));
+    currentHyperlink_ = mapHyperlink(static_cast<HyperlinkId>(screen.currentHyperlink));
+
+    for (size_t i = 0; i < grids.size(); ++i)
+        grids_[i].restore(Size{size.width, static_cast<int>(grids[i].height)},
+                          move(lines[i]),
+                          grids[i].nextLineId,
+                          grids[i].discardedLineCount);
+
+    setBuffer(static_cast<ScreenType>(screen.screenType));
+
+    cursor_ = cursors[0];
+    savedCursor_ = cursors[1];
+    savedPrimaryCursor_ = cursors[2];
+    updateCursorIterators();
+    lastColumn_ = currentColumn_;
+    lastCursorPosition_ = cursor_.position;
+
+    for (DECMode const mode : InputModes)
+        if (modes_.enabled(mode) || previousModes.enabled(mode))
+            setMode(mode, modes_.enabled(mode));
+
+    // Only one mouse transport can be in effect, with disabling either meaning the default one.
+    if (modes_.enabled(DECMode::MouseSGR) || !(modes_.enabled(DECMode::MouseExtended) || modes_.enabled(DECMode::MouseURXVT)))
+        setMode(DECMode::MouseSGR, modes_.enabled(DECMode::MouseSGR));
+    else if (modes_.enabled(DECMode::MouseExtended))
+        setMode(DECMode::MouseExtended, true);
+    else
+        setMode(DECMode::MouseURXVT, true);
+    // }}}
+
+    eventListener_.screenUpdated();
+}
+
+} // namespace terminal
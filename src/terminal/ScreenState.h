@@ -0,0 +1,151 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/Grid.h>
+#include <terminal/Hyperlink.h>
+
+#include <cstdint>
+#include <type_traits>
+
+namespace terminal {
+
+// A saved screen state (see Screen::saveState()) is a sequence of the fixed-size records below,
+// stored in host byte order, interleaved with variable-length arrays:
+//
+//   state     := SavedStateHeader SavedScreen SavedCursor{3} tabs modes titles CWD:string
+//                hyperlinks images grid{2}                        ; primary, then alternate grid
+//   tabs      := COUNT:u32 COLUMN:i32{COUNT}
+//   modes     := COUNT:u32 ANSI:u32{COUNT} COUNT:u32 DEC:u32{COUNT}
+//                COUNT:u32 (DEC:u32 DEPTH:u32 ENABLED:u8{DEPTH}){COUNT}
+//   titles    := TITLE:string COUNT:u32 SAVED:string{COUNT}       ; saved titles top to bottom
+//   hyperlinks:= COUNT:u32 (ID:u16 USERID:string URI:string){COUNT}
+//   images    := COUNT:u32 (SavedImage DATA:u8{dataSize}){COUNT}
+//   grid      := SavedGrid (SavedLine SavedCell{cellCount}){lineCount}
+//   string    := LENGTH:u32 BYTES:u8{LENGTH}
+//
+// The alternate grid is stored with a height and line count of 0 if it has not been allocated yet
+// (see Screen::setBuffer()), which is only valid while the main screen is active.
+//
+// The cells of a line are stored as one contiguous array, such that saving and restoring a line
+// is a single copy. Hyperlink ids in cells refer to the saved hyperlinks, and image indices
+// to the saved images (1-based, 0 meaning none); both are remapped on restore.
+//
+// The version is to be incremented with every change to these records or their order.
+// States of other versions, or saved on a host of a different byte order, are rejected.
+
+constexpr char SavedStateMagic[4] = {'C', 'S', 'T', 'A'};
+constexpr uint32_t SavedStateVersion = 1;
+constexpr uint32_t SavedStateByteOrderMark = 0x01020304;
+
+struct SavedStateHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    uint32_t cellRecordSize;    // sizeof(SavedCell), as an additional sanity check
+};
+
+/// Color, as index of its alternative in terminal::Color followed by up to three payload bytes.
+struct SavedColor {
+    uint8_t type;
+    uint8_t value[3];
+};
+
+struct SavedAttributes {
+    SavedColor foregroundColor;
+    SavedColor backgroundColor;
+    SavedColor underlineColor;
+    uint16_t styles;
+    uint16_t reserved;
+};
+
+struct SavedCell {
+    char32_t codepoints[Cell::MaxCodepoints];
+    SavedAttributes attributes;
+    uint32_t image;             // 1-based index into the saved images, or 0
+    uint16_t imageRow;          // offset of the image fragment
+    uint16_t imageColumn;
+    HyperlinkId hyperlink;
+    uint8_t codepointCount;
+    uint8_t width;
+};
+
+struct SavedCursor {
+    int32_t row;
+    int32_t column;
+    SavedAttributes graphicsRendition;
+    uint8_t autoWrap;
+    uint8_t originMode;
+    uint8_t visible;
+    uint8_t charsetShift;       // CharsetTable currently shifted to
+    uint8_t charsetSelected;    // CharsetTable locked to
+    uint8_t charsets[4];        // CharsetId designated to G0..G3
+    uint8_t reserved[3];
+};
+
+struct SavedScreen {
+    uint32_t width;
+    uint32_t height;
+    uint32_t screenType;
+    int32_t wrapPending;
+    int32_t tabWidth;
+    uint32_t terminalId;
+    int32_t marginTop;
+    int32_t marginBottom;
+    int32_t marginLeft;
+    int32_t marginRight;
+    uint32_t currentHyperlink;
+    uint32_t reserved;
+};
+
+struct SavedImage {
+    uint32_t format;
+    uint32_t alignment;
+    uint32_t resize;
+    uint32_t defaultColor;
+    uint32_t width;             // in pixels
+    uint32_t height;
+    uint32_t cellSpanWidth;
+    uint32_t cellSpanHeight;
+    uint32_t cellWidth;         // in pixels
+    uint32_t cellHeight;
+    uint32_t dataSize;
+};
+
+struct SavedGrid {
+    uint64_t nextLineId;
+    uint64_t discardedLineCount;
+    uint32_t width;
+    uint32_t height;            // 0 for an alternate screen that has not been used yet
+    uint32_t lineCount;         // scrollback lines plus height
+    uint32_t reserved;
+};
+
+struct SavedLine {
+    uint64_t id;
+    uint32_t flags;
+    uint32_t cellCount;
+};
+
+static_assert(sizeof(SavedStateHeader) == 16);
+static_assert(sizeof(SavedAttributes) == 16);
+static_assert(sizeof(SavedCell) == 64);
+static_assert(sizeof(SavedCursor) == 36);
+static_assert(sizeof(SavedScreen) == 48);
+static_assert(sizeof(SavedImage) == 44);
+static_assert(sizeof(SavedGrid) == 32);
+static_assert(sizeof(SavedLine) == 16);
+static_assert(std::is_trivially_copyable_v<SavedCell> && std::is_trivially_copyable_v<SavedLine>);
+
+} // namespace terminal
@@ -0,0 +1,239 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Screen.h>
+#include <terminal/ScreenState.h>
+
+#include <catch2/catch.hpp>
+
+#include <cstring>
+
+using namespace terminal;
+using namespace std;
+
+namespace
+{
+    class MockScreen : public MockScreenEvents,
+                       public Screen {
+      public:
+        explicit MockScreen(Size const& _size) :
+            Screen{_size, *this}
+        {
+        }
+
+        void discardImage(Image const&) override { ++discardedImages; }
+
+        int discardedImages = 0;
+    };
+
+    void checkGridsEqual(Grid const& a, Grid const& b)
+    {
+        REQUIRE(a.historyLineCount() == b.historyLineCount());
+        CHECK(a.renderAllText() == b.renderAllText());
+        CHECK(a.discardedLineCount() == b.discardedLineCount());
+        for (int i = 0; i < a.historyLineCount() + a.screenSize().height; ++i)
+        {
+            INFO("line " << i);
+            CHECK(a.lineIdAt(i) == b.lineIdAt(i));
+            CHECK(a.absoluteLineAt(i).flags() == b.absoluteLineAt(i).flags());
+        }
+    }
+
+    template <typename T>
+    T readAt(string const& _state, size_t _offset)
+    {
+        auto value = T{};
+        REQUIRE(_offset + sizeof(T) <= _state.size());
+        memcpy(&value, _state.data() + _offset, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    string patchedAt(string _state, size_t _offset, T const& _value)
+    {
+        REQUIRE(_offset + sizeof(T) <= _state.size());
+        memcpy(_state.data() + _offset, &_value, sizeof(T));
+        return _state;
+    }
+}
+
+TEST_CASE("ScreenState.roundtrip", "[screen]")
+{
+    auto screen = MockScreen{Size{12, 3}};
+    screen.write("\033]2;title\033\\");
+    screen.write("\033[1;31mred\033[m \033]8;id=x;https://example.org/\033\\link\033]8;;\033\\\r\n");
+    screen.write("one\r\ntwo\r\nthree\r\nfour");
+    screen.write("\033(0\033[?2004h\033[?1006h");
+    screen.write("\033[?1049halt\033[2;3r\033[3;4H");
+    REQUIRE(screen.primaryGrid().historyLineCount() == 2);
+
+    auto const state = screen.saveState();
+
+    auto restored = MockScreen{Size{5, 2}};
+    restored.write("previous");
+    restored.restoreState(state);
+
+    CHECK(restored.size() == Size{12, 3});
+    CHECK(restored.bufferType() == ScreenType::Alternate);
+    checkGridsEqual(restored.primaryGrid(), screen.primaryGrid());
+    checkGridsEqual(restored.alternateGrid(), screen.alternateGrid());
+
+    CHECK(restored.cursor().position == screen.cursor().position);
+    CHECK(restored.cursor().charsets.charsetId(CharsetTable::G0) == CharsetId::Special);
+    CHECK(restored.margin().vertical == Margin::Range{2, 3});
+    CHECK(restored.isModeEnabled(DECMode::BracketedPaste));
+    CHECK(restored.isModeEnabled(DECMode::MouseSGR));
+    CHECK(restored.windowTitle() == "title");
+
+    // cell attributes and hyperlinks
+    auto const& line = restored.primaryGrid().absoluteLineAt(0);
+    CHECK(line[0].attributes() == screen.primaryGrid().absoluteLineAt(0)[0].attributes());
+    auto const link = restored.hyperlinks().at(line[4].hyperlink());
+    REQUIRE(link != nullptr);
+    CHECK(link->uri == "https://example.org/");
+
+    // the saved cursors are restored as well
+    screen.write("\033[?1049l");
+    restored.write("\033[?1049l");
+    CHECK(restored.bufferType() == ScreenType::Main);
+    CHECK(restored.cursor().position == screen.cursor().position);
+
+    // the restored screen continues like the saved one
+    screen.write("\r\nfive");
+    restored.write("\r\nfive");
+    checkGridsEqual(restored.primaryGrid(), screen.primaryGrid());
+}
+
+TEST_CASE("ScreenState.unallocated_alternate_grid", "[screen]")
+{
+    auto screen = MockScreen{Size{6, 2}};
+    screen.write("main");
+    REQUIRE_FALSE(screen.alternateGridAllocated());
+    auto const state = screen.saveState();
+
+    // The alternate grid is saved without any lines, and restored as such.
+    auto restored = MockScreen{Size{4, 3}};
+    restored.write("\033[?1049hprevious\033[?1049l");
+    REQUIRE(restored.alternateGridAllocated());
+    restored.restoreState(state);
+    CHECK_FALSE(restored.alternateGridAllocated());
+    CHECK(restored.size() == Size{6, 2});
+    CHECK(restored.renderTextLine(1) == "main  ");
+
+    // It is allocated at the restored size once used.
+    restored.write("\033[?1049h\033[Halt");
+    REQUIRE(restored.alternateGridAllocated());
+    CHECK(restored.alternateGrid().screenSize() == Size{6, 2});
+    CHECK(restored.renderTextLine(1) == "alt   ");
+
+    // Once allocated, it is saved along with its lines.
+    auto const alternateState = restored.saveState();
+    auto restoredAgain = MockScreen{Size{6, 2}};
+    restoredAgain.restoreState(alternateState);
+    CHECK(restoredAgain.isAlternateScreen());
+    CHECK(restoredAgain.renderTextLine(1) == "alt   ");
+}
+
+TEST_CASE("ScreenState.malformed", "[screen]")
+{
+    auto screen = MockScreen{Size{4, 2}};
+    screen.write("\033[1;3H\033H\033[H"); // tab stop at column 3
+    screen.write("\033[?2004h");
+    screen.write("text");
+    auto const state = screen.saveState();
+
+    auto restored = MockScreen{Size{4, 2}};
+    restored.write("abc");
+
+    CHECK_THROWS_AS(restored.restoreState(state.substr(0, state.size() - 1)), runtime_error);
+    CHECK_THROWS_AS(restored.restoreState(state + '\0'), runtime_error);
+
+    auto otherVersion = state;
+    otherVersion[offsetof(SavedStateHeader, version)]++;
+    CHECK_THROWS_AS(restored.restoreState(otherVersion), runtime_error);
+
+    // tab stops must be within the screen
+    auto const tabsOffset = sizeof(SavedStateHeader) + sizeof(SavedScreen) + 3 * sizeof(SavedCursor);
+    REQUIRE(readAt<uint32_t>(state, tabsOffset) == 1);
+    REQUIRE(readAt<int32_t>(state, tabsOffset + 4) == 3);
+    CHECK_THROWS_AS(restored.restoreState(patchedAt(state, tabsOffset + 4, int32_t{5})), runtime_error);
+    CHECK_THROWS_AS(restored.restoreState(patchedAt(state, tabsOffset + 4, int32_t{0})), runtime_error);
+
+    // modes must be known ones
+    auto const ansiModesOffset = tabsOffset + 8;
+    auto const decModesOffset = ansiModesOffset + 4 + 4 * readAt<uint32_t>(state, ansiModesOffset);
+    REQUIRE(readAt<uint32_t>(state, decModesOffset) >= 1);
+    CHECK_THROWS_AS(restored.restoreState(patchedAt(state, decModesOffset + 4, uint32_t{9999})), runtime_error);
+
+    auto unknownAnsiMode = patchedAt(state, ansiModesOffset, readAt<uint32_t>(state, ansiModesOffset) + 1);
+    auto const mode = uint32_t{3};
+    unknownAnsiMode.insert(ansiModesOffset + 4, reinterpret_cast<char const*>(&mode), sizeof(mode));
+    CHECK_THROWS_AS(restored.restoreState(unknownAnsiMode), runtime_error);
+
+    // the screen is left unchanged
+    CHECK(restored.renderTextLine(1) == "abc ");
+}
+
+TEST_CASE("ScreenState.malformed_with_images", "[screen]")
+{
+    auto screen = MockScreen{Size{10, 4}};
+    screen.setCellPixelSize(Size{10, 20});
+    screen.write("\033Pq\"1;1;20;40#1;2;0;100;0#1!20~-!20~-!20~-!20~-!20~-!20~-!20~\033\\");
+    REQUIRE(screen.at({1, 1}).imageFragment().has_value());
+    auto const state = screen.saveState();
+
+    auto restored = MockScreen{Size{10, 4}};
+    auto const gridGeneration = restored.primaryGrid().generation();
+
+    // Nothing is added to (and thus discarded from) the image pool if the state is rejected.
+    CHECK_THROWS_AS(restored.restoreState(state.substr(0, state.size() - 1)), runtime_error);
+    CHECK(restored.discardedImages == 0);
+    CHECK(restored.primaryGrid().generation() == gridGeneration);
+
+    // Image records that would make rendering read past the image's pixel data are rejected.
+    auto imageOffset = size_t{0};
+    for (size_t i = sizeof(SavedStateHeader); i + sizeof(SavedImage) <= state.size() && !imageOffset; ++i)
+        if (auto const image = readAt<SavedImage>(state, i);
+                image.cellWidth == 10 && image.cellHeight == 20 && image.width != 0
+                && image.dataSize == image.width * image.height * 4)
+            imageOffset = i;
+    REQUIRE(imageOffset != 0);
+    auto const image = readAt<SavedImage>(state, imageOffset);
+    REQUIRE(image.cellSpanHeight > 1);
+
+    auto const malformedImage = [&](auto _patch) {
+        auto record = image;
+        _patch(record);
+        return patchedAt(state, imageOffset, record);
+    };
+    for (auto const& malformed : {
+            malformedImage([](SavedImage& _image) { _image.width /= 2; }),              // too much pixel data
+            malformedImage([](SavedImage& _image) { _image.cellWidth = 0; }),
+            malformedImage([](SavedImage& _image) { _image.cellSpanHeight = 0; }),
+            malformedImage([](SavedImage& _image) { _image.cellSpanWidth *= 10; }),     // beyond the pixels
+            malformedImage([](SavedImage& _image) { _image.cellSpanHeight = 1; }),      // cells outside the span
+            malformedImage([](SavedImage& _image) { _image.width = 0x10000; }) })
+    {
+        CHECK_THROWS_AS(restored.restoreState(malformed), runtime_error);
+    }
+    CHECK(restored.discardedImages == 0);
+    CHECK(restored.primaryGrid().generation() == gridGeneration);
+
+    restored.restoreState(state);
+    CHECK(restored.at({1, 1}).imageFragment().has_value());
+    CHECK(restored.at({2, 2}).imageFragment().has_value());
+    CHECK(restored.discardedImages == 0);
+
+    // Readers of the grid, such as the search index, can tell that all lines have been replaced.
+    CHECK(restored.primaryGrid().generation() != gridGeneration);
+}
@@ -1735,6 +1735,22 @@ TEST_CASE("render into history", "[screen]")
     }
 }
 
+TEST_CASE("render lines into history", "[screen]")
+{
+    auto screen = MockScreen{{5, 2}};
+    screen.write("12345\r\n67890\r\nABCDE\r\nFGHIJ\r\nKLMNO");
+
+    auto const renderLines = [&](optional<int> _scrollOffset) {
+        auto lines = vector<pair<int, string>>{};
+        screen.renderLines([&](int _row, Line const& _line) { lines.emplace_back(_row, _line.toUtf8()); },
+                           _scrollOffset);
+        return lines;
+    };
+
+    CHECK(renderLines(nullopt) == vector<pair<int, string>>{{1, "FGHIJ"}, {2, "KLMNO"}});
+    CHECK(renderLines(1) == vector<pair<int, string>>{{1, "67890"}, {2, "ABCDE"}});
+}
+
 TEST_CASE("HorizontalTabClear.AllTabs", "[screen]")
 {
     auto screen = MockScreen{{5, 3}};
@@ -2195,6 +2211,87 @@ TEST_CASE("findMarkerBackward", "[screen]")
     }
 }
 
+TEST_CASE("findMarker.clamped_history", "[screen]")
+{
+    auto screenEvents = ScreenEvents{};
+    auto screen = Screen{Size{4, 2}, screenEvents, false, false, 3};
+
+    for (auto const line : {"a1\r\n", "b2\r\n", "c3\r\n", "d4\r\n"})
+    {
+        screen.setMark();
+        screen.write(line);
+    }
+    REQUIRE(screen.historyLineCount() == 3);
+    REQUIRE(screen.grid().discardedLineCount() == 0);
+
+    CHECK(screen.findMarkerBackward(3).value() == 2);   // c3
+    CHECK(screen.findMarkerForward(0).value() == 1);    // b2
+
+    // "a1" and "b2" are pushed out of the scrollback, along with their marks
+    screen.write("e5\r\nf6\r\n");
+    REQUIRE(screen.grid().discardedLineCount() == 2);
+    REQUIRE(screen.grid().renderTextLineAbsolute(0) == "c3  ");
+
+    CHECK(screen.findMarkerBackward(5).value() == 1);   // d4
+    CHECK(screen.findMarkerBackward(1).value() == 0);   // c3
+    CHECK_FALSE(screen.findMarkerBackward(0).has_value());
+    CHECK(screen.findMarkerForward(0).value() == 1);
+    CHECK_FALSE(screen.findMarkerForward(1).has_value());
+
+    screen.grid().clearHistory();
+    CHECK_FALSE(screen.findMarkerBackward(2).has_value());
+}
+
+TEST_CASE("OSC133.findLastCommandOutput", "[screen]")
+{
+    auto screen = MockScreen{{10, 3}};
+    CHECK_FALSE(screen.findLastCommandOutput().has_value());
+
+    screen.write("\033]133;A\033\\$ ls\r\n"
+                 "\033]133;C\033\\a.txt\r\nb.txt\r\n"
+                 "\033]133;D;0\033\\\033]133;A\033\\$ pwd\r\n"
+                 "\033]133;C\033\\/tmp\r\n"
+                 "\033]133;D;0\033\\\033]133;A\033\\$ cat\r\n"
+                 "\033]133;C\033\\running");
+    REQUIRE(screen.historyLineCount() == 4);
+
+    // the still running command's output is not complete
+    auto const output = screen.findLastCommandOutput();
+    REQUIRE(output.has_value());
+    CHECK(output->first == 4);
+    CHECK(output->second == 4);
+    CHECK(screen.grid().renderTextLineAbsolute(4) == "/tmp      ");
+
+    // prompts count as marks for scrolling
+    CHECK(screen.findMarkerBackward(6).value() == 5);
+    CHECK(screen.findMarkerBackward(5).value() == 3);
+    CHECK(screen.findMarkerBackward(3).value() == 0);
+}
+
+TEST_CASE("OSC133.findLastCommandOutput.edges", "[screen]")
+{
+    auto screen = MockScreen{{10, 6}};
+
+    SECTION("no output")
+    {
+        screen.write("\033]133;A\033\\$ true\r\n"
+                     "\033]133;C\033\\\033]133;D;0\033\\\033]133;A\033\\$ ");
+        CHECK_FALSE(screen.findLastCommandOutput().has_value());
+    }
+
+    SECTION("no trailing newline")
+    {
+        screen.write("\033]133;A\033\\$ cat\r\n"
+                     "\033]133;C\033\\one\r\ntwo\033]133;D;0\033\\\r\n"
+                     "\033]133;A\033\\$ ");
+        auto const output = screen.findLastCommandOutput();
+        REQUIRE(output.has_value());
+        CHECK(output->first == 1);
+        CHECK(output->second == 2);
+        CHECK(screen.grid().renderTextLineAbsolute(2) == "two       ");
+    }
+}
+
 TEST_CASE("DECTABSR", "[screen]")
 {
     auto screen = MockScreen{{35, 2}};
@@ -2244,7 +2341,79 @@ TEST_CASE("save_restore_DEC_modes", "[screen]")
     CHECK_FALSE(screen.isModeEnabled(DECMode::MouseProtocolHighlightTracking));
 }
 
+TEST_CASE("synchronized_output", "[screen]")
+{
+    class SyncOutputEvents : public MockScreenEvents {
+      public:
+        void setSynchronizedOutput(bool _enabled) override { toggles.push_back(_enabled); }
+        vector<bool> toggles;
+    };
+    auto events = SyncOutputEvents{};
+    auto screen = Screen{Size{3, 1}, events};
+
+    // output is applied right away, only presenting it is up to the terminal.
+    screen.write("\033[?2026hAB");
+    CHECK(screen.isModeEnabled(DECMode::BatchedRendering));
+    CHECK("AB " == screen.renderTextLine(1));
+
+    // enabling it twice is not reported twice.
+    screen.write("\033[?2026hC\033[?2026l");
+    CHECK_FALSE(screen.isModeEnabled(DECMode::BatchedRendering));
+    CHECK("ABC" == screen.renderTextLine(1));
+    CHECK(events.toggles == vector<bool>{true, false});
+}
+
 // TODO: resize test (should be in Grid_test.cpp?)
+TEST_CASE("sixel", "[screen]")
+{
+    auto screen = MockScreen{Size{10, 4}};
+    auto const image = string_view("\033Pq\"1;1;20;40#1;2;0;100;0#1!20~-!20~-!20~-!20~-!20~-!20~-!20~\033\\");
+
+    SECTION("unknown cell pixel size") {
+        screen.write(image);
+        CHECK(screen.cursorPosition() == Coordinate{1, 1});
+        CHECK_FALSE(screen.at({1, 1}).imageFragment().has_value());
+    }
+
+    SECTION("placed at the cursor") {
+        screen.setCellPixelSize(Size{10, 20});
+        screen.write(image);
+        CHECK(screen.at({1, 1}).imageFragment().has_value());
+        CHECK(screen.at({2, 2}).imageFragment().has_value());
+        CHECK_FALSE(screen.at({3, 1}).imageFragment().has_value());
+    }
+}
+
+TEST_CASE("Screen.alternateGrid.deferred", "[screen]")
+{
+    auto screen = MockScreen{Size{4, 2}};
+    screen.write("main");
+    CHECK_FALSE(screen.alternateGridAllocated());
+
+    // Resizing does not allocate the alternate screen's lines either.
+    screen.resize(Size{6, 3});
+    CHECK_FALSE(screen.alternateGridAllocated());
+    CHECK(screen.alternateGrid().screenSize().height == 0);
+
+    // They are allocated at the current size once switched to.
+    screen.write("\033[?1049h");
+    REQUIRE(screen.alternateGridAllocated());
+    CHECK(screen.isAlternateScreen());
+    CHECK(screen.alternateGrid().screenSize() == Size{6, 3});
+    CHECK(screen.alternateGrid().historyLineCount() == 0);
+    screen.write("\033[Halt");
+    CHECK(screen.renderTextLine(1) == "alt   ");
+    CHECK(screen.renderTextLine(3) == "      ");
+
+    // From then on, the alternate screen is resized along with the primary one.
+    screen.write("\033[?1049l");
+    CHECK(screen.renderTextLine(1) == "main  ");
+    screen.resize(Size{5, 2});
+    CHECK(screen.alternateGrid().screenSize() == Size{5, 2});
+    screen.write("\033[?47h"); // without clearing it
+    CHECK(screen.renderTextLine(1) == "alt  ");
+}
+
 TEST_CASE("resize", "[screen]")
 {
     auto screen = MockScreen{{2, 2}};
@@ -0,0 +1,474 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Search.h>
+#include <terminal/Grid.h>
+
+#include <crispy/find.h>
+#include <crispy/trace.h>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+using namespace std;
+
+namespace terminal {
+
+// {{{ SearchIndex
+void SearchIndex::clear()
+{
+    firstLogicalLine_ += history_.size();
+    firstChangedLogicalLine_ = firstLogicalLine_;
+    history_.clear();
+    page_.clear();
+}
+
+uint64_t SearchIndex::takeChanges() noexcept
+{
+    auto const first = firstChangedLogicalLine_;
+    firstChangedLogicalLine_ = firstLogicalLine_ + history_.size();
+    return first;
+}
+
+bool SearchIndex::update(Grid const& _grid, int _maxLines)
+{
+    CRISPY_TRACE_SPAN("search.index");
+
+    auto const discarded = _grid.discardedLineCount();
+    if (_grid.generation() != generation_ || _grid.screenSize() != pageSize_ || discarded < discardedLineCount_)
+    {
+        // Lines have been reflowed or the grid has been replaced (e.g. by a hard reset).
+        clear();
+        generation_ = _grid.generation();
+        pageSize_ = _grid.screenSize();
+        nextLine_ = discarded;
+    }
+    discardedLineCount_ = discarded;
+
+    // Drop logical lines whose first line has been pushed out of the scrollback.
+    while (!history_.empty() && history_.front().line < discarded)
+    {
+        history_.pop_front();
+        ++firstLogicalLine_;
+    }
+    firstChangedLogicalLine_ = max(firstChangedLogicalLine_, firstLogicalLine_);
+    nextLine_ = max(nextLine_, discarded);
+
+    auto const historyLineCount = _grid.historyLineCount();
+    auto const historyEnd = discarded + static_cast<uint64_t>(historyLineCount);
+    auto const end = min(historyEnd, nextLine_ + static_cast<uint64_t>(max(_maxLines, 0)));
+
+    for (; nextLine_ < end; ++nextLine_)
+    {
+        Line const& line = _grid.absoluteLineAt(static_cast<int>(nextLine_ - discarded));
+        auto const continued = line.wrapped()
+                            && !history_.empty()
+                            && history_.back().line + static_cast<uint64_t>(history_.back().cellCount / pageSize_.width) == nextLine_;
+        if (!continued)
+            history_.push_back(LogicalLine{nextLine_, 0, {}, {}});
+
+        firstChangedLogicalLine_ = min(firstChangedLogicalLine_, firstLogicalLine_ + history_.size() - 1);
+        append(history_.back(), line);
+    }
+
+    if (nextLine_ != historyEnd)
+        return false;
+
+    page_.clear();
+    for (int row = historyLineCount; row < historyLineCount + pageSize_.height; ++row)
+    {
+        Line const& line = _grid.absoluteLineAt(row);
+        if (!line.wrapped() || page_.empty())
+            page_.push_back(LogicalLine{discarded + static_cast<uint64_t>(row), 0, {}, {}});
+        append(page_.back(), line);
+    }
+
+    return true;
+}
+
+void SearchIndex::append(LogicalLine& _logicalLine, Line const& _line) const
+{
+    auto& text = _logicalLine.text;
+    auto& cells = _logicalLine.cells;
+
+    auto const emit = [&](string_view _bytes, int _cell, int _width) {
+        if (cells.empty() && (_bytes.size() != 1 || _width != 1 || _cell != static_cast<int>(text.size())))
+        {
+            // Bytes and cells do not correspond one to one anymore, so use an explicit mapping.
+            cells.resize(text.size() + 1);
+            iota(cells.begin(), cells.end(), 0);
+        }
+
+        if (!cells.empty())
+        {
+            cells.back() = _cell;
+            for (size_t i = 1; i < _bytes.size(); ++i)
+                cells.push_back(_cell);
+            cells.push_back(_cell + _width);
+        }
+
+        text += _bytes;
+    };
+
+    // Restore the blanks that have been trimmed off the previous physical line.
+    auto const base = _logicalLine.cellCount;
+    for (auto cell = cells.empty() ? static_cast<int>(text.size()) : cells.back(); cell < base; ++cell)
+        emit(" ", cell, 1);
+
+    auto const columnCount = min(_line.size(), pageSize_.width);
+    for (int column = 0; column < columnCount;)
+    {
+        Cell const& cell = _line[static_cast<size_t>(column)];
+        auto const width = max(cell.width(), 1);
+
+        if (cell.codepointCount() == 0)
+            emit(" ", base + column, 1);
+        else if (cell.codepointCount() == 1 && cell.codepoint(0) < 0x80)
+        {
+            auto const ch = static_cast<char>(cell.codepoint(0));
+            emit(string_view(&ch, 1), base + column, width);
+        }
+        else
+            emit(cell.toUtf8(), base + column, width);
+
+        column += width;
+    }
+
+    _logicalLine.cellCount = base + pageSize_.width;
+
+    while (!text.empty() && text.back() == ' ')
+    {
+        text.pop_back();
+        if (!cells.empty())
+            cells.pop_back();
+    }
+}
+
+void SearchIndex::find(LogicalLine const& _line,
+                       SearchQuery const& _query,
+                       regex const* _regex,
+                       int _columnCount,
+                       vector<Match>& _output)
+{
+    auto const& text = _line.text;
+
+    auto const cellAt = [&](size_t _offset) -> int {
+        return _line.cells.empty() ? static_cast<int>(_offset) : _line.cells[_offset];
+    };
+
+    auto const positionOf = [&](int _cell) -> Position {
+        return Position{_line.line + static_cast<uint64_t>(_cell / _columnCount), _cell % _columnCount + 1};
+    };
+
+    auto const add = [&](size_t _begin, size_t _end) {
+        _output.push_back(Match{positionOf(cellAt(_begin)), positionOf(cellAt(_end) - 1)});
+    };
+
+    if (_regex)
+    {
+        // The regex is matched against windows of at most 2 * MaxRegexMatchLength bytes, as the
+        // standard library's backtracking matcher recurses per character and would otherwise run out
+        // of stack on very long lines. Windows overlap by half, such that every match of up to
+        // MaxRegexMatchLength bytes is found in full.
+        auto const end = text.data() + text.size();
+        auto const window = 2 * MaxRegexMatchLength;
+        auto match = cmatch{};
+        size_t offset = 0;
+        while (offset < text.size())
+        {
+            auto const windowBegin = text.data() + offset;
+            auto const windowEnd = windowBegin + min(window, text.size() - offset);
+            auto flags = regex_constants::match_default;
+            if (offset != 0)
+                flags |= regex_constants::match_prev_avail;
+            if (windowEnd != end)
+                flags |= regex_constants::match_not_eol;
+
+            if (!regex_search(windowBegin, windowEnd, match, *_regex, flags))
+            {
+                if (windowEnd == end)
+                    break;
+                offset += MaxRegexMatchLength;
+                continue;
+            }
+
+            auto const begin = offset + static_cast<size_t>(match.position());
+            if (windowEnd != end && static_cast<size_t>(match.position()) >= MaxRegexMatchLength)
+            {
+                // Might be cut short by the window's end, so it is matched again in the next window.
+                offset = begin;
+                continue;
+            }
+
+            if (match.length() == 0)
+            {
+                offset = begin + 1;
+                continue;
+            }
+
+            add(begin, begin + static_cast<size_t>(match.length()));
+            offset = begin + static_cast<size_t>(match.length());
+        }
+    }
+    else if (!_query.pattern.empty())
+    {
+        auto const& pattern = _query.pattern;
+        for (auto i = crispy::find_substring(text, pattern); i != string_view::npos;
+                  i = crispy::find_substring(text, pattern, i + pattern.size()))
+            add(i, i + pattern.size());
+    }
+}
+// }}}
+
+// {{{ ScrollbackSearch
+ScrollbackSearch::ScrollbackSearch(Grid const& _grid, mutex& _gridLock, function<void()> _changed) :
+    grid_{_grid},
+    gridLock_{_gridLock},
+    changed_{move(_changed)},
+    gridChanged_{true},
+    worker_{[this]() { run(); }}
+{
+}
+
+ScrollbackSearch::~ScrollbackSearch()
+{
+    {
+        auto const _l = lock_guard{lock_};
+        terminating_ = true;
+    }
+    wakeup_.notify_one();
+    worker_.join();
+}
+
+void ScrollbackSearch::setQuery(optional<SearchQuery> _query)
+{
+    auto compiled = optional<regex>{};
+    if (_query.has_value() && _query->regex)
+        compiled.emplace(_query->pattern, regex::ECMAScript | regex::optimize);
+
+    {
+        auto const _l = lock_guard{lock_};
+        query_ = move(_query);
+        regex_ = move(compiled);
+        queryChanged_ = true;
+    }
+    wakeup_.notify_one();
+}
+
+void ScrollbackSearch::notify()
+{
+    {
+        auto const _l = lock_guard{lock_};
+        gridChanged_ = true;
+    }
+    wakeup_.notify_one();
+}
+
+void ScrollbackSearch::wait()
+{
+    auto _l = unique_lock{lock_};
+    idle_.wait(_l, [this]() { return !busy_ && !queryChanged_ && !gridChanged_; });
+}
+
+bool ScrollbackSearch::aborted() const
+{
+    auto const _l = lock_guard{lock_};
+    return terminating_ || queryChanged_;
+}
+
+void ScrollbackSearch::run()
+{
+    CRISPY_TRACE_THREAD_NAME("search");
+
+    for (;;)
+    {
+        auto _l = unique_lock{lock_};
+        busy_ = false;
+        idle_.notify_all();
+        wakeup_.wait(_l, [this]() { return terminating_ || queryChanged_ || gridChanged_; });
+        if (terminating_)
+            return;
+
+        busy_ = true;
+        auto const restart = queryChanged_;
+        if (queryChanged_)
+        {
+            activeQuery_ = move(query_);
+            activeRegex_ = move(regex_);
+            queryChanged_ = false;
+        }
+        gridChanged_ = false;
+        _l.unlock();
+
+        if (restart && !activeQuery_.has_value())
+        {
+            {
+                auto const _rl = lock_guard{resultsLock_};
+                historyMatches_.clear();
+                pageMatches_.clear();
+            }
+            if (changed_)
+                changed_();
+        }
+
+        auto complete = false;
+        auto first = true;
+        while (!complete && !aborted())
+        {
+            {
+                auto const _gl = lock_guard{gridLock_};
+                complete = index_.update(grid_, BatchSize);
+            }
+
+            if (activeQuery_.has_value())
+            {
+                searchChanges(restart && first);
+                first = false;
+            }
+        }
+
+        if (activeQuery_.has_value() && changed_)
+            changed_();
+
+        // Rate-limit updates caused by continuous output. Queries are still handled right away.
+        _l.lock();
+        wakeup_.wait_for(_l, UpdateInterval, [this]() { return terminating_ || queryChanged_; });
+    }
+}
+
+void ScrollbackSearch::searchChanges(bool _restart)
+{
+    CRISPY_TRACE_SPAN("search.find");
+
+    auto const& history = index_.history();
+    auto const firstChanged = _restart ? index_.firstLogicalLine() : index_.takeChanges();
+    if (_restart)
+        index_.takeChanges();
+
+    auto const columnCount = index_.columnCount();
+    auto const* const regex = activeRegex_.has_value() ? &*activeRegex_ : nullptr;
+
+    // Lines in front of the first (remaining) history line are gone,
+    // and matches from the first changed line on are to be replaced.
+    auto const firstLine = history.empty() ? numeric_limits<uint64_t>::max() : history.front().line;
+    auto const changedIndex = static_cast<size_t>(firstChanged - index_.firstLogicalLine());
+    auto const changedLine = changedIndex < history.size() ? history[changedIndex].line : numeric_limits<uint64_t>::max();
+
+    {
+        auto const _rl = lock_guard{resultsLock_};
+        if (_restart)
+            historyMatches_.clear();
+        while (!historyMatches_.empty() && historyMatches_.front().from.line < firstLine)
+            historyMatches_.pop_front();
+        while (!historyMatches_.empty() && historyMatches_.back().from.line >= changedLine)
+            historyMatches_.pop_back();
+    }
+
+    // Search the changed history lines in chunks, so that a new query can interrupt a long search.
+    auto constexpr ChunkSize = size_t{4096};
+    auto found = vector<SearchIndex::Match>{};
+    for (auto i = changedIndex; i < history.size(); i += ChunkSize)
+    {
+        found.clear();
+        for (auto k = i; k < min(i + ChunkSize, history.size()); ++k)
+            SearchIndex::find(history[k], *activeQuery_, regex, columnCount, found);
+
+        {
+            auto const _rl = lock_guard{resultsLock_};
+            historyMatches_.insert(historyMatches_.end(), found.begin(), found.end());
+        }
+
+        if (aborted())
+            return;
+    }
+
+    found.clear();
+    for (auto const& line : index_.page())
+        SearchIndex::find(line, *activeQuery_, regex, columnCount, found);
+
+    auto const _rl = lock_guard{resultsLock_};
+    pageMatches_.swap(found);
+}
+
+SearchMatch ScrollbackSearch::toAbsolute(SearchIndex::Match const& _match) const noexcept
+{
+    auto const discarded = static_cast<int64_t>(grid_.discardedLineCount());
+    return SearchMatch{
+        Coordinate{static_cast<int>(static_cast<int64_t>(_match.from.line) - discarded), _match.from.column},
+        Coordinate{static_cast<int>(static_cast<int64_t>(_match.to.line) - discarded), _match.to.column}
+    };
+}
+
+vector<SearchMatch> ScrollbackSearch::matches(int _firstLine, int _lineCount) const
+{
+    auto const discarded = grid_.discardedLineCount();
+    auto const first = discarded + static_cast<uint64_t>(max(_firstLine, 0));
+    auto const end = first + static_cast<uint64_t>(max(_lineCount, 0));
+
+    auto result = vector<SearchMatch>{};
+
+    auto const collect = [&](auto const& _matches) {
+        auto i = partition_point(_matches.begin(), _matches.end(),
+                                 [&](SearchIndex::Match const& m) { return m.to.line < first; });
+        for (; i != _matches.end() && i->from.line < end; ++i)
+            result.emplace_back(toAbsolute(*i));
+    };
+
+    auto const _rl = lock_guard{resultsLock_};
+    collect(historyMatches_);
+    collect(pageMatches_);
+    return result;
+}
+
+optional<SearchMatch> ScrollbackSearch::findMatchForward(int _line) const
+{
+    auto const line = grid_.discardedLineCount() + static_cast<uint64_t>(max(_line, 0));
+    auto const after = [&](auto const& _matches) {
+        return partition_point(_matches.begin(), _matches.end(),
+                               [&](SearchIndex::Match const& m) { return m.from.line <= line; });
+    };
+
+    auto const _rl = lock_guard{resultsLock_};
+    if (auto const i = after(historyMatches_); i != historyMatches_.end())
+        return toAbsolute(*i);
+    if (auto const i = after(pageMatches_); i != pageMatches_.end())
+        return toAbsolute(*i);
+    return nullopt;
+}
+
+optional<SearchMatch> ScrollbackSearch::findMatchBackward(int _line) const
+{
+    auto const discarded = grid_.discardedLineCount();
+    auto const line = discarded + static_cast<uint64_t>(max(_line, 0));
+    auto const before = [&](auto const& _matches) {
+        return partition_point(_matches.begin(), _matches.end(),
+                               [&](SearchIndex::Match const& m) { return m.from.line < line; });
+    };
+
+    auto const _rl = lock_guard{resultsLock_};
+    if (auto const i = before(pageMatches_); i != pageMatches_.begin())
+        return toAbsolute(*prev(i));
+    if (auto const i = before(historyMatches_); i != historyMatches_.begin() && prev(i)->from.line >= discarded)
+        return toAbsolute(*prev(i));
+    return nullopt;
+}
+
+size_t ScrollbackSearch::matchCount() const
+{
+    auto const _rl = lock_guard{resultsLock_};
+    return historyMatches_.size() + pageMatches_.size();
+}
+// }}}
+
+} // namespace terminal
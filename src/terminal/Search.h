@@ -0,0 +1,206 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/Size.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace terminal {
+
+class Grid;
+class Line;
+
+struct SearchQuery {
+    std::string pattern;
+    bool regex = false;
+};
+
+/// A match of a search, as inclusive range of absolute coordinates.
+///
+/// A match continues on the next line(s) if it crosses the end of a wrapped line.
+struct SearchMatch {
+    Coordinate from;
+    Coordinate to;
+};
+
+/// Text projection of a grid's lines, to search through them without holding the grid's lock.
+///
+/// Wrapped lines are joined into logical lines of UTF-8 text. Lines are numbered by their
+/// absolute line number plus Grid::discardedLineCount(), so that positions remain valid
+/// while the scrollback is clamped.
+///
+/// Scrollback lines are appended incrementally, as they enter the history, while the few lines
+/// of the main page (which are still subject to change) are projected anew on each update.
+class SearchIndex {
+  public:
+    struct Position {
+        uint64_t line;
+        int column;
+    };
+
+    struct Match {
+        Position from;
+        Position to;
+    };
+
+    struct LogicalLine {
+        uint64_t line;              // number of its first physical line
+        int cellCount = 0;          // number of cells of all its physical lines
+        std::string text;           // UTF-8 text, with trailing blanks trimmed
+        std::vector<int> cells;     // cell offset of each byte, plus one past the end; empty if all cells are one byte
+    };
+
+    /// Indexes up to @p _maxLines further scrollback lines and re-projects the main page.
+    ///
+    /// Must be called with the grid being locked.
+    ///
+    /// @returns true if all scrollback lines are indexed.
+    bool update(Grid const& _grid, int _maxLines);
+
+    /// Forgets all indexed lines, e.g. after the scrollback was reflowed.
+    void clear();
+
+    std::deque<LogicalLine> const& history() const noexcept { return history_; }
+    std::vector<LogicalLine> const& page() const noexcept { return page_; }
+
+    /// Sequence number of the first logical line in history(), which increases as lines are being dropped.
+    uint64_t firstLogicalLine() const noexcept { return firstLogicalLine_; }
+
+    /// Sequence number of the first history logical line changed since the last call to takeChanges().
+    uint64_t takeChanges() noexcept;
+
+    int columnCount() const noexcept { return pageSize_.width; }
+
+    /// Longest regular expression match, in bytes, that is guaranteed to be found in full.
+    static constexpr size_t MaxRegexMatchLength = 1024;
+
+    /// Finds all (non-overlapping) matches of @p _query in @p _line and appends them to @p _output.
+    ///
+    /// Regular expression matches longer than MaxRegexMatchLength bytes may be truncated.
+    static void find(LogicalLine const& _line,
+                     SearchQuery const& _query,
+                     std::regex const* _regex,
+                     int _columnCount,
+                     std::vector<Match>& _output);
+
+  private:
+    void append(LogicalLine& _logicalLine, Line const& _line) const;
+
+    Size pageSize_{};
+    uint64_t generation_ = 0;
+    uint64_t discardedLineCount_ = 0;
+    uint64_t nextLine_ = 0;                 // next scrollback line to be indexed
+    uint64_t firstLogicalLine_ = 0;
+    uint64_t firstChangedLogicalLine_ = 0;
+    std::deque<LogicalLine> history_;
+    std::vector<LogicalLine> page_;
+};
+
+/// Searches a grid's scrollback and main page on a worker thread.
+///
+/// The worker keeps a SearchIndex up to date, only locking the grid while indexing a batch of lines,
+/// and then searches the changed lines without holding that lock.
+/// Results are kept in a separate, briefly held lock, such that readers may query them
+/// while holding the grid's lock (but not the other way around).
+class ScrollbackSearch {
+  public:
+    /// Number of lines indexed per grid lock acquisition.
+    static constexpr int BatchSize = 4096;
+
+    /// Minimum time between two index updates caused by screen updates.
+    static constexpr std::chrono::milliseconds UpdateInterval{50};
+
+    /// @param _grid      the grid to search, usually the primary screen's grid.
+    /// @param _gridLock  the lock guarding @p _grid.
+    /// @param _changed   invoked on the worker thread (without any locks held) when the results have changed.
+    ScrollbackSearch(Grid const& _grid, std::mutex& _gridLock, std::function<void()> _changed);
+    ~ScrollbackSearch();
+
+    ScrollbackSearch(ScrollbackSearch const&) = delete;
+    ScrollbackSearch& operator=(ScrollbackSearch const&) = delete;
+
+    /// Replaces the current search, if any, or stops searching if @p _query is std::nullopt.
+    ///
+    /// The index is kept up to date either way, so that subsequent searches start right away.
+    ///
+    /// @throws std::regex_error if the query's pattern is not a valid regular expression.
+    void setQuery(std::optional<SearchQuery> _query);
+
+    /// Tells the worker that the grid has changed. Cheap enough to be called on every screen update.
+    void notify();
+
+    /// Blocks until the worker has indexed and searched all lines (used for testing).
+    void wait();
+
+    // {{{ results, to be called with the grid being locked
+    /// @returns all matches that overlap with the given absolute lines, ordered by position.
+    std::vector<SearchMatch> matches(int _firstLine, int _lineCount) const;
+
+    /// @returns the first match starting below the absolute line @p _line.
+    std::optional<SearchMatch> findMatchForward(int _line) const;
+
+    /// @returns the last match starting above the absolute line @p _line.
+    std::optional<SearchMatch> findMatchBackward(int _line) const;
+
+    /// @returns the total number of matches.
+    size_t matchCount() const;
+    // }}}
+
+  private:
+    void run();
+    bool aborted() const;
+    void searchChanges(bool _restart);
+    SearchMatch toAbsolute(SearchIndex::Match const& _match) const noexcept;
+
+    Grid const& grid_;
+    std::mutex& gridLock_;
+    std::function<void()> changed_;
+
+    // guarded by lock_
+    std::mutex mutable lock_;
+    std::condition_variable wakeup_;
+    std::condition_variable idle_;
+    std::optional<SearchQuery> query_;
+    std::optional<std::regex> regex_;
+    bool queryChanged_ = false;
+    bool gridChanged_ = false;
+    bool busy_ = false;
+    bool terminating_ = false;
+
+    // only accessed by the worker
+    SearchIndex index_;
+    std::optional<SearchQuery> activeQuery_;
+    std::optional<std::regex> activeRegex_;
+
+    // guarded by resultsLock_, sorted by position
+    std::mutex mutable resultsLock_;
+    std::deque<SearchIndex::Match> historyMatches_;
+    std::vector<SearchIndex::Match> pageMatches_;
+
+    std::thread worker_;
+};
+
+} // namespace terminal
@@ -0,0 +1,243 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Screen.h>
+#include <terminal/Search.h>
+#include <catch2/catch.hpp>
+
+#include <mutex>
+
+using namespace std;
+using namespace terminal;
+
+namespace {
+    vector<SearchIndex::Match> findAll(SearchIndex const& _index, SearchQuery const& _query)
+    {
+        auto result = vector<SearchIndex::Match>{};
+        for (auto const& line : _index.history())
+            SearchIndex::find(line, _query, nullptr, _index.columnCount(), result);
+        for (auto const& line : _index.page())
+            SearchIndex::find(line, _query, nullptr, _index.columnCount(), result);
+        return result;
+    }
+}
+
+TEST_CASE("SearchIndex.wrapped_lines", "[search]")
+{
+    auto screenEvents = ScreenEvents{};
+    auto screen = Screen{Size{5, 2}, screenEvents, false, false, 10};
+    screen.write("abcdefgh\r\nxyz\r\nab\r\n");
+    REQUIRE(screen.historyLineCount() == 3);
+
+    auto index = SearchIndex{};
+    CHECK(index.update(screen.grid(), 1000));
+
+    REQUIRE(index.history().size() == 2);
+    CHECK(index.history()[0].line == 0);
+    CHECK(index.history()[0].text == "abcdefgh");
+    CHECK(index.history()[1].line == 2);
+    CHECK(index.history()[1].text == "xyz");
+
+    // "efg" crosses the end of the first line
+    auto const matches = findAll(index, SearchQuery{"efg"});
+    REQUIRE(matches.size() == 1);
+    CHECK(matches[0].from.line == 0);
+    CHECK(matches[0].from.column == 5);
+    CHECK(matches[0].to.line == 1);
+    CHECK(matches[0].to.column == 2);
+
+    // the page is searched too
+    CHECK(findAll(index, SearchQuery{"ab"}).size() == 2);
+}
+
+TEST_CASE("SearchIndex.wide_characters", "[search]")
+{
+    auto screenEvents = ScreenEvents{};
+    auto screen = Screen{Size{10, 2}, screenEvents};
+    screen.write("\xE4\xB8\xAD\xE6\x96\x87 x\xC3\xA4y"); // "中文 xäy"
+
+    auto index = SearchIndex{};
+    CHECK(index.update(screen.grid(), 1000));
+    REQUIRE(index.page().size() == 2);
+
+    auto const matches = findAll(index, SearchQuery{"\xE6\x96\x87 x\xC3\xA4"}); // "文 xä"
+    REQUIRE(matches.size() == 1);
+    CHECK(matches[0].from.column == 3);
+    CHECK(matches[0].to.column == 7);
+
+    auto const regex = std::regex{"x.y"};
+    auto regexMatches = vector<SearchIndex::Match>{};
+    SearchIndex::find(index.page()[0], SearchQuery{"x.y", true}, &regex, index.columnCount(), regexMatches);
+    CHECK(regexMatches.empty()); // "ä" takes two bytes
+
+    auto const utf8Regex = std::regex{"x..y"};
+    SearchIndex::find(index.page()[0], SearchQuery{"x..y", true}, &utf8Regex, index.columnCount(), regexMatches);
+    REQUIRE(regexMatches.size() == 1);
+    CHECK(regexMatches[0].from.column == 6);
+    CHECK(regexMatches[0].to.column == 8);
+}
+
+TEST_CASE("SearchIndex.long_lines", "[search]")
+{
+    // Long enough to overflow the stack if matched as a whole.
+    auto line = SearchIndex::LogicalLine{};
+    line.text = string(1020, 'x') + "needle" + string(300000, 'x') + "needle";
+    line.cellCount = static_cast<int>(line.text.size());
+
+    auto const find = [&](string const& _pattern) {
+        auto const regex = std::regex{_pattern};
+        auto matches = vector<SearchIndex::Match>{};
+        SearchIndex::find(line, SearchQuery{_pattern, true}, &regex, 80, matches);
+        return matches;
+    };
+
+    // matches crossing the windows' borders are found
+    auto const needles = find("n[a-z]*e");
+    REQUIRE(needles.size() == 2);
+    CHECK(needles[0].from.line == 12);
+    CHECK(needles[0].from.column == 61);
+    CHECK(needles[1].to.line == (line.text.size() - 1) / 80);
+
+    // anchors only match at the line's boundaries
+    CHECK(find("^x").size() == 1);
+    CHECK(find("e$").size() == 1);
+    CHECK(find("needle\\b").size() == 1);
+}
+
+TEST_CASE("SearchIndex.incremental", "[search]")
+{
+    auto screenEvents = ScreenEvents{};
+    auto screen = Screen{Size{4, 2}, screenEvents, false, false, 3};
+    for (auto const line : {"a1\r\n", "b2\r\n", "c3\r\n"})
+        screen.write(line);
+    REQUIRE(screen.historyLineCount() == 2);
+
+    auto index = SearchIndex{};
+    CHECK_FALSE(index.update(screen.grid(), 1));
+    CHECK(index.history().size() == 1);
+    CHECK(index.page().empty());
+    CHECK(index.update(screen.grid(), 1));
+    CHECK(index.history().size() == 2);
+    CHECK(index.takeChanges() == 0);
+
+    // "a1" and "b2" are pushed out of the scrollback
+    screen.write("d4\r\ne5\r\ng6\r\n");
+    REQUIRE(screen.grid().discardedLineCount() == 2);
+    CHECK(index.update(screen.grid(), 100));
+
+    CHECK(index.firstLogicalLine() == 2);
+    REQUIRE(index.history().size() == 3);
+    CHECK(index.history()[0].line == 2);
+    CHECK(index.history()[0].text == "c3");
+    CHECK(index.takeChanges() == 2);
+    CHECK(index.takeChanges() == 5);
+}
+
+TEST_CASE("SearchIndex.hard_reset", "[search]")
+{
+    auto screenEvents = ScreenEvents{};
+    auto screen = Screen{Size{5, 2}, screenEvents, false, false, 10};
+    screen.write("foo\r\nfoo\r\nfoo\r\n");
+    REQUIRE(screen.historyLineCount() == 2);
+
+    auto index = SearchIndex{};
+    CHECK(index.update(screen.grid(), 1000));
+    CHECK(findAll(index, SearchQuery{"foo"}).size() == 3);
+
+    // RIS replaces all lines, without any of them being discarded from the scrollback.
+    screen.write("\033cbar\r\nbar\r\nbar\r\n");
+    REQUIRE(screen.historyLineCount() == 2);
+    REQUIRE(screen.grid().discardedLineCount() == 0);
+
+    CHECK(index.update(screen.grid(), 1000));
+    CHECK(findAll(index, SearchQuery{"foo"}).empty());
+    CHECK(findAll(index, SearchQuery{"bar"}).size() == 3);
+    REQUIRE(index.history().size() == 2);
+    CHECK(index.history()[0].text == "bar");
+}
+
+TEST_CASE("ScrollbackSearch.find", "[search]")
+{
+    auto screenEvents = ScreenEvents{};
+    auto screen = Screen{Size{10, 3}, screenEvents, false, false, 100};
+    auto gridLock = mutex{};
+
+    for (int i = 0; i < 20; ++i)
+        screen.write(i % 5 == 0 ? "foo bar\r\n" : "baz\r\n");
+    REQUIRE(screen.historyLineCount() == 18);
+
+    auto search = ScrollbackSearch{screen.grid(), gridLock, {}};
+    search.setQuery(SearchQuery{"bar"});
+    search.wait();
+
+    auto const _l = lock_guard{gridLock};
+    CHECK(search.matchCount() == 4);
+
+    auto const visible = search.matches(4, 7);
+    REQUIRE(visible.size() == 2);
+    CHECK(visible[0].from == Coordinate{5, 5});
+    CHECK(visible[0].to == Coordinate{5, 7});
+    CHECK(visible[1].from.row == 10);
+
+    CHECK(search.findMatchForward(5).value().from.row == 10);
+    CHECK(search.findMatchBackward(5).value().from.row == 0);
+    CHECK_FALSE(search.findMatchBackward(0).has_value());
+    CHECK_FALSE(search.findMatchForward(15).has_value());
+}
+
+TEST_CASE("ScrollbackSearch.update", "[search]")
+{
+    auto screenEvents = ScreenEvents{};
+    auto screen = Screen{Size{10, 2}, screenEvents, false, false, 100};
+    auto gridLock = mutex{};
+
+    auto search = ScrollbackSearch{screen.grid(), gridLock, {}};
+    search.setQuery(SearchQuery{"[0-9]+", true});
+    search.wait();
+    CHECK(search.matchCount() == 0);
+
+    {
+        auto const _l = lock_guard{gridLock};
+        screen.write("x1\r\ny22\r\nz\r\n");
+    }
+    search.notify();
+    search.wait();
+    CHECK(search.matchCount() == 2);
+
+    search.setQuery(nullopt);
+    search.wait();
+    CHECK(search.matchCount() == 0);
+
+    CHECK_THROWS_AS(search.setQuery(SearchQuery{"(", true}), std::regex_error);
+}
+
+TEST_CASE("ScrollbackSearch.hard_reset", "[search]")
+{
+    auto screenEvents = ScreenEvents{};
+    auto screen = Screen{Size{10, 2}, screenEvents, false, false, 100};
+    auto gridLock = mutex{};
+    screen.write("foo\r\nfoo\r\n");
+
+    auto search = ScrollbackSearch{screen.grid(), gridLock, {}};
+    search.setQuery(SearchQuery{"foo"});
+    search.wait();
+    CHECK(search.matchCount() == 2);
+
+    {
+        auto const _l = lock_guard{gridLock};
+        screen.write("\033cbar\r\nbar\r\n");
+    }
+    search.notify();
+    search.wait();
+    CHECK(search.matchCount() == 0);
+}
@@ -0,0 +1,194 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/SelectionText.h>
+#include <terminal/Grid.h>
+#include <terminal/Terminal.h>
+
+#include <crispy/trace.h>
+
+#include <algorithm>
+#include <cctype>
+#include <mutex>
+
+using namespace std;
+
+namespace terminal {
+
+namespace {
+    void trimRight(string& _value)
+    {
+        while (!_value.empty() && isspace(static_cast<unsigned char>(_value.back())))
+            _value.pop_back();
+    }
+}
+
+// {{{ ChunkedText
+void ChunkedText::append(string_view _text)
+{
+    while (!_text.empty())
+    {
+        if (chunks_.empty() || chunks_.back().size() == ChunkSize)
+            chunks_.emplace_back();
+
+        auto& chunk = chunks_.back();
+        auto const n = min(ChunkSize - chunk.size(), _text.size());
+        chunk.append(_text.data(), n);
+        _text.remove_prefix(n);
+        size_ += n;
+    }
+}
+
+string ChunkedText::str() const
+{
+    string result;
+    result.reserve(size_);
+    for (auto const& chunk : chunks_)
+        result += chunk;
+    return result;
+}
+// }}}
+
+// {{{ SelectionText
+SelectionText::SelectionText(Selector const& _selection, Grid const& _grid) :
+    selection_{_selection},
+    grid_{_grid},
+    pageSize_{_grid.screenSize()},
+    discardedLineCount_{_grid.discardedLineCount()},
+    firstLine_{_selection.firstLine()},
+    lastLine_{_selection.lastLine()},
+    nextLine_{firstLine_}
+{
+}
+
+bool SelectionText::read(int _maxLines)
+{
+    if (done())
+        return true;
+
+    if (grid_.screenSize() != pageSize_)
+        return false; // lines might have been reflowed
+
+    // Number of lines the selected lines have moved up since the selection was captured.
+    auto const shift = grid_.discardedLineCount() - discardedLineCount_;
+    if (shift > static_cast<uint64_t>(nextLine_))
+        return false;
+
+    auto const offset = static_cast<int>(shift);
+    auto const totalRowCount = grid_.historyLineCount() + pageSize_.height;
+    auto const end = min(nextLine_ + _maxLines, lastLine_ + 1);
+
+    for (; nextLine_ < end; ++nextLine_)
+    {
+        auto const row = nextLine_ - offset;
+        if (row >= totalRowCount)
+            return false;
+
+        auto const range = selection_.rangeAt(nextLine_);
+        if (!range.has_value())
+            continue;
+
+        Line const& line = grid_.absoluteLineAt(row);
+
+        // Lines continued from the previous line are joined if the selection covers that line's end.
+        if (nextLine_ != firstLine_ && !(line.wrapped() && previousToColumn_ == pageSize_.width))
+        {
+            trimRight(currentLine_);
+            text_.append(currentLine_);
+            text_.append("\n");
+            currentLine_.clear();
+        }
+
+        for (auto column = range->fromColumn; column <= range->toColumn; ++column)
+        {
+            if (column <= line.size())
+                currentLine_ += line[static_cast<size_t>(column - 1)].toUtf8();
+            else
+                currentLine_ += ' ';
+        }
+
+        previousToColumn_ = range->toColumn;
+    }
+
+    if (done())
+    {
+        trimRight(currentLine_);
+        text_.append(currentLine_);
+        currentLine_.clear();
+    }
+
+    return true;
+}
+// }}}
+
+// {{{ SelectionTextExtractor
+SelectionTextExtractor::SelectionTextExtractor(Terminal const& _terminal,
+                                               ProgressHandler _progress,
+                                               CompletionHandler _completion) :
+    terminal_{_terminal},
+    progress_{move(_progress)},
+    completion_{move(_completion)}
+{
+    {
+        auto const _lock = scoped_lock{terminal_};
+        if (terminal_.isSelectionAvailable())
+            text_.emplace(*terminal_.selector(), terminal_.screen().grid());
+    }
+
+    worker_ = thread(&SelectionTextExtractor::run, this);
+}
+
+SelectionTextExtractor::~SelectionTextExtractor()
+{
+    cancel();
+    if (worker_.joinable())
+        worker_.join();
+}
+
+void SelectionTextExtractor::run()
+{
+    CRISPY_TRACE_SPAN("selection.extract");
+
+    if (!text_.has_value())
+    {
+        finished_ = true;
+        if (completion_)
+            completion_(ChunkedText{});
+        return;
+    }
+
+    auto available = true;
+    while (available && !text_->done() && !cancelled_)
+    {
+        {
+            auto const _lock = scoped_lock{terminal_};
+            available = text_->read(BatchSize);
+        }
+
+        if (progress_)
+            progress_(Progress{text_->linesRead(), text_->lineCount()});
+    }
+
+    finished_ = true;
+
+    if (cancelled_ || !completion_)
+        return;
+
+    if (available)
+        completion_(move(text_->text()));
+    else
+        completion_(nullopt);
+}
+// }}}
+
+} // namespace terminal
@@ -0,0 +1,143 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/Selector.h>
+#include <terminal/Size.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace terminal {
+
+class Grid;
+class Terminal;
+
+/// UTF-8 text stored as a sequence of chunks of at most ChunkSize bytes each.
+///
+/// Huge texts therefore neither require one contiguous allocation nor get copied when growing.
+/// A multi-byte UTF-8 sequence may span two chunks, so chunks must only be interpreted concatenated.
+class ChunkedText {
+  public:
+    static constexpr size_t ChunkSize = 1024 * 1024;
+
+    void append(std::string_view _text);
+
+    size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    std::vector<std::string> const& chunks() const noexcept { return chunks_; }
+
+    /// @returns the whole text as one contiguous string.
+    std::string str() const;
+
+  private:
+    std::vector<std::string> chunks_;
+    size_t size_ = 0;
+};
+
+/// Incrementally converts the cells covered by a selection into UTF-8 text.
+///
+/// Lines are converted in batches via read(), which must be called with the grid being locked.
+/// The grid may be modified in between two batches: lines that are pushed out of the scrollback
+/// are compensated for by the means of Grid::discardedLineCount(), and reading fails as soon
+/// as not yet read lines are no longer available (e.g. after clearing the scrollback or resizing).
+class SelectionText {
+  public:
+    SelectionText(Selector const& _selection, Grid const& _grid);
+
+    /// Converts up to @p _maxLines further lines of the selection.
+    ///
+    /// @retval true  lines have been converted (or all lines were already converted).
+    /// @retval false the remaining selected lines are not available anymore.
+    bool read(int _maxLines);
+
+    /// Tests whether or not all selected lines have been converted.
+    bool done() const noexcept { return nextLine_ > lastLine_; }
+
+    int linesRead() const noexcept { return nextLine_ - firstLine_; }
+    int lineCount() const noexcept { return lastLine_ - firstLine_ + 1; }
+
+    /// @returns the text converted so far, which is complete when done() is true.
+    ChunkedText& text() noexcept { return text_; }
+
+  private:
+    Selector selection_;
+    Grid const& grid_;
+    Size pageSize_;
+    uint64_t discardedLineCount_;
+    int firstLine_;
+    int lastLine_;
+    int nextLine_;
+    int previousToColumn_ = 0;
+    std::string currentLine_;
+    ChunkedText text_;
+};
+
+/// Extracts the text of a terminal's current selection on a worker thread.
+///
+/// The terminal is only locked while a batch of lines is being read, so that neither the
+/// terminal's output processing nor the GUI thread are blocked while huge selections are copied.
+class SelectionTextExtractor {
+  public:
+    struct Progress {
+        int lines;
+        int totalLines;
+    };
+
+    /// Invoked on the worker thread after each batch of lines.
+    using ProgressHandler = std::function<void(Progress)>;
+
+    /// Invoked on the worker thread with the extracted text,
+    /// or std::nullopt if the selected lines became unavailable. Not invoked when cancelled.
+    using CompletionHandler = std::function<void(std::optional<ChunkedText>)>;
+
+    /// Number of lines read per terminal lock acquisition.
+    static constexpr int BatchSize = 1024;
+
+    /// Starts extracting the text of @p _terminal's current selection.
+    ///
+    /// The selection's geometry is captured right away, so later changes to the selection
+    /// do not affect this extraction. The terminal must not be locked by the caller.
+    SelectionTextExtractor(Terminal const& _terminal,
+                           ProgressHandler _progress,
+                           CompletionHandler _completion);
+
+    /// Cancels the extraction, if still running, and waits for the worker to finish.
+    ~SelectionTextExtractor();
+
+    /// Requests the extraction to stop after the batch currently being read.
+    void cancel() noexcept { cancelled_ = true; }
+
+    bool finished() const noexcept { return finished_; }
+
+  private:
+    void run();
+
+    Terminal const& terminal_;
+    std::optional<SelectionText> text_;
+    ProgressHandler progress_;
+    CompletionHandler completion_;
+    std::atomic<bool> cancelled_ = false;
+    std::atomic<bool> finished_ = false;
+    std::thread worker_;
+};
+
+} // namespace terminal
@@ -0,0 +1,113 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Screen.h>
+#include <terminal/SelectionText.h>
+#include <terminal/Selector.h>
+#include <catch2/catch.hpp>
+
+using namespace std;
+using namespace terminal;
+
+TEST_CASE("ChunkedText.append", "[selection]")
+{
+    auto text = ChunkedText{};
+    CHECK(text.empty());
+
+    auto const block = string(ChunkedText::ChunkSize - 1, 'a');
+    text.append(block);
+    text.append("bc");
+    text.append("");
+
+    CHECK(text.size() == ChunkedText::ChunkSize + 1);
+    REQUIRE(text.chunks().size() == 2);
+    CHECK(text.chunks()[0].size() == ChunkedText::ChunkSize);
+    CHECK(text.chunks()[1] == "c");
+    CHECK(text.str() == block + "bc");
+}
+
+TEST_CASE("SelectionText.linear", "[selection]")
+{
+    auto screenEvents = ScreenEvents{};
+    auto screen = Screen{Size{11, 3}, screenEvents};
+    screen.write(
+        //       123456789AB
+        /* 0 */ "12345,67890\r\n"s +
+        /* 1 */ "ab,cdefg,hi\r\n"s +
+        /* 2 */ "12 4"s
+    );
+
+    auto selector = Selector{Selector::Mode::Linear, U",", screen, screen.toAbsolute({1, 7})};
+    selector.extend(screen.toAbsolute({3, 11}));
+    selector.stop();
+
+    auto text = SelectionText{selector, screen.grid()};
+    CHECK(text.lineCount() == 3);
+
+    // one line at a time, as if the grid was unlocked in between
+    while (!text.done())
+        REQUIRE(text.read(1));
+
+    CHECK(text.linesRead() == 3);
+    CHECK(text.text().str() == "67890\nab,cdefg,hi\n12 4");
+}
+
+TEST_CASE("SelectionText.wrapped_lines", "[selection]")
+{
+    auto screenEvents = ScreenEvents{};
+    auto screen = Screen{Size{5, 3}, screenEvents};
+    screen.write("abcdefgh\r\nxyz");
+
+    auto selector = Selector{Selector::Mode::Linear, U",", screen, screen.toAbsolute({1, 1})};
+    selector.extend(screen.toAbsolute({3, 3}));
+    selector.stop();
+
+    auto text = SelectionText{selector, screen.grid()};
+    REQUIRE(text.read(10));
+    REQUIRE(text.done());
+    CHECK(text.text().str() == "abcdefgh\nxyz");
+}
+
+TEST_CASE("SelectionText.history_shift", "[selection]")
+{
+    auto screenEvents = ScreenEvents{};
+    auto screen = Screen{Size{3, 2}, screenEvents, false, false, 4};
+    for (auto const line : {"a1\r\n", "b2\r\n", "c3\r\n", "d4\r\n", "e5\r\n"})
+        screen.write(line);
+    REQUIRE(screen.historyLineCount() == 4);
+
+    // select "a1" through "c3"
+    auto selector = Selector{Selector::Mode::FullLine, U",", screen, Coordinate{0, 1}};
+    selector.extend(Coordinate{2, 1});
+    selector.stop();
+
+    auto text = SelectionText{selector, screen.grid()};
+    REQUIRE(text.read(1));
+
+    SECTION("lines moving up are followed") {
+        screen.write("f6\r\n");
+        REQUIRE(screen.grid().discardedLineCount() == 1);
+        REQUIRE(text.read(10));
+        CHECK(text.text().str() == "a1\nb2\nc3");
+    }
+
+    SECTION("lines scrolled out fail") {
+        screen.write("f6\r\ng7\r\nh8\r\n");
+        CHECK_FALSE(text.read(10));
+    }
+
+    SECTION("cleared history fails") {
+        screen.grid().clearHistory();
+        CHECK_FALSE(text.read(10));
+    }
+}
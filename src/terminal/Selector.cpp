@@ -22,71 +22,98 @@ using namespace std;
 namespace terminal {
 
 Selector::Selector(Mode _mode,
-				   GetCellAt _getCellAt,
-                   GetWrappedFlag _wrappedFlag,
-				   std::u32string const& _wordDelimiters,
-				   int _totalRowCount,
-				   int _columnCount,
-				   Coordinate _from) :
-	mode_{_mode},
-	getCellAt_{move(_getCellAt)},
-    wrapped_{move(_wrappedFlag)},
-	wordDelimiters_{_wordDelimiters},
-	totalRowCount_{_totalRowCount},
-    columnCount_{_columnCount},
-	start_{_from},
-	from_{_from},
-	to_{_from}
+                   std::u32string const& _wordDelimiters,
+                   Grid const& _grid,
+                   Coordinate _from) :
+    mode_{_mode},
+    grid_{_grid},
+    wordDelimiters_{_wordDelimiters},
+    columnCount_{_grid.screenSize().width},
+    start_{_from},
+    from_{_from},
+    to_{_from}
 {
-	if (_mode == Mode::FullLine)
-	{
-		extend({from_.row, 1u});
-		swapDirection();
-		extend({from_.row, columnCount_});
+    if (_mode == Mode::FullLine)
+    {
+        extend({from_.row, 1u});
+        swapDirection();
+        extend({from_.row, columnCount_});
 
         // backward
-        while (from_.row > 0 && wrapped_(from_.row))
+        while (from_.row > 0 && wrapped(from_.row))
             from_.row--;
 
         // forward
-        while (to_.row < _totalRowCount && wrapped_(to_.row + 1))
+        while (to_.row + 1 < totalRowCount() && wrapped(to_.row + 1))
             to_.row++;
-	}
-	else if (isWordWiseSelection())
-	{
+    }
+    else if (isWordWiseSelection())
+    {
         // TODO: expand logical line to complete word, if on line boundary
-		state_ = State::InProgress;
-		extendSelectionBackward();
-		swapDirection();
-		extendSelectionForward();
-	}
+        state_ = State::InProgress;
+        extendSelectionBackward();
+        swapDirection();
+        extendSelectionForward();
+    }
+
+    updateBounds();
+    rememberLineIds();
 }
 
 Selector::Selector(Mode _mode,
                    std::u32string const& _wordDelimiters,
                    Screen const& _screen,
                    Coordinate _from) :
-    Selector{
-        _mode,
-        [screen = std::ref(_screen)](Coordinate _pos) -> Cell const* {
-            assert(_pos.row >= 0 && "must be absolute coordinate");
-            auto const& buffer = screen.get();
-            // convert line number  from absolute line to relative line number.
-            auto const row = _pos.row - buffer.historyLineCount() + 1;
-            if (row <= buffer.size().height)
-                return &buffer.at({row, _pos.column});
-            else
-                return nullptr;
-        },
-        [screen = std::ref(_screen)](int _line) -> bool {
-            return screen.get().lineWrapped(_line);
-        },
-        _wordDelimiters,
-        _screen.size().height + static_cast<int>(_screen.historyLineCount()),
-        _screen.size().width,
-        _from
-    }
+    Selector{_mode, _wordDelimiters, _screen.grid(), _from}
+{
+}
+
+void Selector::rememberLineIds()
 {
+    auto const idAt = [this](int _row) { return grid_.lineIdAt(clamp(_row, 0, totalRowCount() - 1)); };
+    startLineId_ = idAt(start_.row);
+    fromLineId_ = idAt(from_.row);
+    toLineId_ = idAt(to_.row);
+}
+
+bool Selector::followLineIds()
+{
+    auto const start = grid_.absoluteLineOf(startLineId_);
+    auto const from = grid_.absoluteLineOf(fromLineId_);
+    auto const to = grid_.absoluteLineOf(toLineId_);
+    if (!start.has_value() || !from.has_value() || !to.has_value())
+        return false;
+
+    start_.row = *start;
+    from_.row = *from;
+    to_.row = *to;
+    updateBounds();
+    return true;
+}
+
+int Selector::totalRowCount() const noexcept
+{
+    return grid_.historyLineCount() + grid_.screenSize().height;
+}
+
+Cell const* Selector::at(Coordinate const& _pos) const noexcept
+{
+    assert(_pos.row >= 0 && "must be absolute coordinate");
+
+    if (_pos.row >= totalRowCount())
+        return nullptr;
+
+    Line const& line = grid_.absoluteLineAt(_pos.row);
+    if (!crispy::ascending(1, _pos.column, line.size()))
+        return nullptr;
+
+    return &line[static_cast<size_t>(_pos.column - 1)];
+}
+
+bool Selector::wrapped(int _line) const noexcept
+{
+    return crispy::ascending(0, _line, totalRowCount() - 1)
+        && grid_.absoluteLineAt(_line).wrapped();
 }
 
 Coordinate Selector::stretchedColumn(Coordinate _coord) const noexcept
@@ -136,22 +163,24 @@ bool Selector::extend(Coordinate const& _coord)
             if (coord > start_)
             {
                 to_ = coord;
-                while (to_.row + 1 < totalRowCount_ && wrapped_(to_.row + 1))
+                while (to_.row + 1 < totalRowCount() && wrapped(to_.row + 1))
                     to_.row++;
             }
             else if (coord < start_)
             {
                 from_ = coord;
-                while (from_.row > 0 && wrapped_(from_.row))
+                while (from_.row > 0 && wrapped(from_.row))
                     from_.row--;
             }
             break;
         case Mode::Linear:
             to_ = stretchedColumn(coord);
             break;
+        case Mode::Rectangular:
+            to_ = coord;
+            break;
         case Mode::LinearWordWise:
             // TODO: handle logical line wraps
-        case Mode::Rectangular:
             if (coord > start_)
             {
                 to_ = coord;
@@ -168,6 +197,9 @@ bool Selector::extend(Coordinate const& _coord)
             break;
     }
 
+    updateBounds();
+    rememberLineIds();
+
     // TODO: indicates whether or not a scroll action must take place.
     return false;
 }
@@ -182,7 +214,7 @@ void Selector::extendSelectionBackward()
     auto last = to_;
     auto current = last;
     for (;;) {
-        auto const wrapIntoPreviousLine = current.column == 1 && current.row > 0 && wrapped_(current.row);
+        auto const wrapIntoPreviousLine = current.column == 1 && current.row > 0 && wrapped(current.row);
         if (current.column > 1)
             current.column--;
         else if (current.row > 0 || wrapIntoPreviousLine)
@@ -217,7 +249,7 @@ void Selector::extendSelectionForward()
     auto last = to_;
     auto current = last;
     for (;;) {
-        if (current.column == columnCount_ && current.row + 1 < totalRowCount_ && wrapped_(current.row + 1))
+        if (current.column == columnCount_ && current.row + 1 < totalRowCount() && wrapped(current.row + 1))
         {
             current.row++;
             current.column = 1;
@@ -228,7 +260,7 @@ void Selector::extendSelectionForward()
         {
             current = stretchedColumn({current.row, current.column + 1});
         }
-        else if (current.row < totalRowCount_)
+        else if (current.row < totalRowCount())
         {
             current.row++;
             current.column = 1;
@@ -250,97 +282,22 @@ void Selector::stop()
         state_ = State::Complete;
 }
 
-tuple<vector<Selector::Range>, Coordinate const, Coordinate const> prepare(Selector const& _selector)
-{
-    vector<Selector::Range> result;
-
-    auto const [from, to] = [&]() {
-        if (_selector.to() < _selector.from())
-            return pair{_selector.to(), _selector.from()};
-        else
-            return pair{_selector.from(), _selector.to()};
-    }();
-
-    auto const numLines = to.row - from.row + 1;
-    result.resize(numLines);
-
-    return {move(result), from, to};
-}
-
 vector<Selector::Range> Selector::selection() const
 {
-	switch (mode_)
-	{
-		case Mode::FullLine:
-			return lines();
-		case Mode::Linear:
-		case Mode::LinearWordWise:
-			return linear();
-		case Mode::Rectangular:
-			return rectangular();
-	}
-	return {};
+    return selection(top_.row, bottom_.row - top_.row + 1);
 }
 
-vector<Selector::Range> Selector::linear() const
+vector<Selector::Range> Selector::selection(int _firstLine, int _lineCount) const
 {
-    auto [result, from, to] = prepare(*this);
-
-    switch (result.size())
-    {
-        case 1:
-            result[0] = Range{from.row, from.column, to.column};
-            break;
-        case 2:
-            // Render first line partial from selected column to end.
-            result[0] = Range{from.row, from.column, columnCount_};
-            // Render last (second) line partial from beginning to last selected column.
-            result[1] = Range{to.row, 1, to.column};
-            break;
-        default:
-            // Render first line partial from selected column to end.
-            result[0] = Range{from.row, from.column, columnCount_};
-
-            // Render inner full.
-            for (size_t n = 1; n < result.size(); ++n)
-                result[n] = Range{from.row + static_cast<int>(n), 1, columnCount_};
+    auto const first = max(_firstLine, top_.row);
+    auto const last = min(_firstLine + _lineCount - 1, bottom_.row);
 
-            // Render last (second) line partial from beginning to last selected column.
-            result[result.size() - 1] = Range{to.row, 1, to.column};
-            break;
-    }
+    vector<Range> result;
+    result.reserve(static_cast<size_t>(max(last - first + 1, 0)));
 
-    return result;
-}
-
-vector<Selector::Range> Selector::lines() const
-{
-    auto [result, from, to] = prepare(*this);
-
-    for (int row = 0; row < static_cast<int>(result.size()); ++row)
-    {
-        result[row] = Range{
-            from.row + row,
-            1,
-            columnCount_
-        };
-    }
-
-    return result;
-}
-
-vector<Selector::Range> Selector::rectangular() const
-{
-    auto [result, from, to] = prepare(*this);
-
-    for (int row = 0; row < static_cast<int>(result.size()); ++row)
-    {
-        result[row] = Range{
-            from.row + row,
-            from.column,
-            to.column
-        };
-    }
+    for (auto line = first; line <= last; ++line)
+        if (auto const range = rangeAt(line); range.has_value())
+            result.emplace_back(*range);
 
     return result;
 }
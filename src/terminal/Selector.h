@@ -21,13 +21,16 @@
 
 #include <fmt/format.h>
 
-#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <optional>
 #include <vector>
 #include <utility>
 
 namespace terminal {
 
 class Screen;
+class Grid;
 class Cell;
 
 /**
@@ -74,22 +77,17 @@ class Selector {
 
 
     enum class Mode { Linear, LinearWordWise, FullLine, Rectangular };
-	using GetCellAt = std::function<Cell const*(Coordinate)>;
-    using GetWrappedFlag = std::function<bool(int)>;
 
     Selector(Mode _mode,
-			 GetCellAt _at,
-             GetWrappedFlag _wrappedFlag,
-			 std::u32string const& _wordDelimiters,
-			 int _totalRowCount,
-             int _columnCount,
-			 Coordinate _from);
-
-	/// Convenience constructor when access to Screen is available.
+             std::u32string const& _wordDelimiters,
+             Grid const& _grid,
+             Coordinate _from);
+
+    /// Convenience constructor when access to Screen is available.
     Selector(Mode _mode,
-			 std::u32string const& _wordDelimiters,
-			 Screen const& _screen,
-			 Coordinate _from);
+             std::u32string const& _wordDelimiters,
+             Screen const& _screen,
+             Coordinate _from);
 
     /// Tests whether the a selection is currently in progress.
     constexpr State state() const noexcept { return state_; }
@@ -104,26 +102,55 @@ class Selector {
     /// Marks the selection as completed.
     void stop();
 
+    /// Moves the selection along with the selected lines, e.g. after lines have been discarded
+    /// from the top of the scrollback.
+    ///
+    /// @retval false the selected lines do not exist anymore.
+    bool followLineIds();
+
     constexpr Coordinate const& from() const noexcept { return from_; }
     constexpr Coordinate const& to() const noexcept { return to_; }
 
-    /// @returns boolean indicating whether or not given absolute coordinate is within the range of the selection.
-    constexpr bool contains(Coordinate _coord) const noexcept
+    /// @returns the first (top most) absolute line covered by the selection.
+    constexpr int firstLine() const noexcept { return top_.row; }
+
+    /// @returns the last (bottom most) absolute line covered by the selection.
+    constexpr int lastLine() const noexcept { return bottom_.row; }
+
+    /// @returns the selected columns of the given absolute line, if that line is part of the selection.
+    ///
+    /// This is an O(1) operation, regardless of how many lines the selection spans.
+    constexpr std::optional<Range> rangeAt(int _line) const noexcept
     {
+        if (_line < top_.row || bottom_.row < _line)
+            return std::nullopt;
+
         switch (mode_)
         {
             case Mode::FullLine:
-                return crispy::ascending(from_.row, _coord.row, to_.row)
-                    || crispy::ascending(to_.row, _coord.row, from_.row);
+                return Range{_line, 1, columnCount_};
             case Mode::Linear:
             case Mode::LinearWordWise:
-                return crispy::ascending(from_, _coord, to_)
-                    || crispy::ascending(to_, _coord, from_);
+                return Range{
+                    _line,
+                    _line == top_.row ? top_.column : 1,
+                    _line == bottom_.row ? bottom_.column : columnCount_
+                };
             case Mode::Rectangular:
-                return crispy::ascending(from_.row, _coord.row, to_.row)
-                    && crispy::ascending(from_.column, _coord.column, to_.column);
+                return Range{
+                    _line,
+                    std::min(from_.column, to_.column),
+                    std::max(from_.column, to_.column)
+                };
         }
-        return false;
+        return std::nullopt;
+    }
+
+    /// @returns boolean indicating whether or not given absolute coordinate is within the range of the selection.
+    constexpr bool contains(Coordinate _coord) const noexcept
+    {
+        auto const range = rangeAt(_coord.row);
+        return range.has_value() && range->fromColumn <= _coord.column && _coord.column <= range->toColumn;
     }
 
     constexpr Mode mode() const noexcept { return mode_; }
@@ -141,26 +168,23 @@ class Selector {
     /// contains a wide character - or if the cell is empty, until the end of emptyness.
     Coordinate stretchedColumn(Coordinate _pos) const noexcept;
 
-	/// Retrieves a vector of ranges (with one range per line) of selected cells.
-	std::vector<Range> selection() const;
+    /// Retrieves a vector of ranges (with one range per line) of selected cells.
+    std::vector<Range> selection() const;
 
-	/// Constructs a vector of ranges for a linear selection strategy.
-	std::vector<Range> linear() const;
-
-	/// Constructs a vector of ranges for a full-line selection strategy.
-	std::vector<Range> lines() const;
-
-	/// Constructs a vector of ranges for a rectangular selection strategy.
-	std::vector<Range> rectangular() const;
+    /// Retrieves the ranges of selected cells that intersect with the given window of absolute lines.
+    ///
+    /// The cost of this call is bound by @p _lineCount, not by the size of the selection.
+    std::vector<Range> selection(int _firstLine, int _lineCount) const;
 
     /// Renders the current selection into @p _render.
     template <typename Renderer>
     void render(Renderer&& _render) const
     {
-        for (auto const& range : selection())
-            for (auto const col : crispy::times(range.fromColumn, range.length()))
-                if (Cell const* cell = at({range.line, col}); cell != nullptr)
-                    _render(Coordinate{range.line, col}, *cell);
+        for (auto line = top_.row; line <= bottom_.row; ++line)
+            if (auto const range = rangeAt(line); range.has_value())
+                for (auto const col : crispy::times(range->fromColumn, range->length()))
+                    if (Cell const* cell = at({line, col}); cell != nullptr)
+                        _render(Coordinate{line, col}, *cell);
     }
 
   private:
@@ -175,22 +199,49 @@ class Selector {
 		}
 	}
 
-	Cell const* at(Coordinate const& _pos) const { return getCellAt_(_pos); }
+    int totalRowCount() const noexcept;
+    Cell const* at(Coordinate const& _pos) const noexcept;
+    bool wrapped(int _line) const noexcept;
+
+    /// Updates the cached top-to-bottom ordered endpoints after from_ or to_ have been moved.
+    constexpr void updateBounds() noexcept
+    {
+        if (to_ < from_)
+        {
+            top_ = to_;
+            bottom_ = from_;
+        }
+        else
+        {
+            top_ = from_;
+            bottom_ = to_;
+        }
+    }
+
+    /// Remembers the ids of the lines of start_, from_ and to_, for followLineIds().
+    void rememberLineIds();
 
 	void extendSelectionBackward();
 	void extendSelectionForward();
 
   private:
     State state_{State::Waiting};
-	Mode mode_;
-	GetCellAt getCellAt_;
-    GetWrappedFlag wrapped_;
-	std::u32string wordDelimiters_;
-	int totalRowCount_;
+    Mode mode_;
+    Grid const& grid_;
+    std::u32string wordDelimiters_;
     int columnCount_;
     Coordinate start_{};
     Coordinate from_{};
     Coordinate to_{};
+
+    // from_ and to_, ordered from top to bottom
+    Coordinate top_{};
+    Coordinate bottom_{};
+
+    // ids of the lines of start_, from_ and to_ (see Grid::absoluteLineOf())
+    uint64_t startLineId_ = 0;
+    uint64_t fromLineId_ = 0;
+    uint64_t toLineId_ = 0;
 };
 
 } // namespace terminal
@@ -204,5 +204,94 @@ TEST_CASE("Selector.FullLine", "[selector]")
 
 TEST_CASE("Selector.Rectangular", "[selector]")
 {
-    // TODO
+    auto screenEvents = ScreenEvents{};
+    auto screen = Screen{Size{11, 3}, screenEvents};
+    screen.write(
+        //       123456789AB
+        /* 0 */ "12345,67890"s +
+        /* 1 */ "ab,cdefg,hi"s +
+        /* 2 */ "12345,67890"s
+    );
+
+    SECTION("upwards and to the left") {
+        auto selector = Selector{Selector::Mode::Rectangular, U",", screen, screen.toAbsolute({3, 4})};
+        selector.extend(screen.toAbsolute({2, 2}));
+        selector.stop();
+
+        vector<Selector::Range> const selection = selector.selection();
+        REQUIRE(selection.size() == 2);
+        CHECK(selection[0].line == screen.toAbsoluteLine(2));
+        CHECK(selection[0].fromColumn == 2);
+        CHECK(selection[0].toColumn == 4);
+        CHECK(selection[1].line == screen.toAbsoluteLine(3));
+        CHECK(selection[1].fromColumn == 2);
+        CHECK(selection[1].toColumn == 4);
+
+        CHECK(selector.contains(screen.toAbsolute({3, 2})));
+        CHECK_FALSE(selector.contains(screen.toAbsolute({3, 5})));
+        CHECK_FALSE(selector.contains(screen.toAbsolute({1, 3})));
+    }
+}
+
+TEST_CASE("Selector.VisibleLines", "[selector]")
+{
+    auto screenEvents = ScreenEvents{};
+    auto screen = Screen{Size{5, 2}, screenEvents, false, false, 1000};
+    for (int i = 0; i < 1000; ++i)
+        screen.write("abcde\r\n");
+    REQUIRE(screen.historyLineCount() == 999);
+
+    // select from the middle of the oldest history line into the main page
+    auto selector = Selector{Selector::Mode::Linear, U",", screen, Coordinate{0, 3}};
+    selector.extend(screen.toAbsolute({1, 2}));
+    selector.stop();
+
+    CHECK(selector.firstLine() == 0);
+    CHECK(selector.lastLine() == 999);
+
+    CHECK(selector.rangeAt(0)->fromColumn == 3);
+    CHECK(selector.rangeAt(0)->toColumn == 5);
+    CHECK(selector.rangeAt(500)->fromColumn == 1);
+    CHECK(selector.rangeAt(500)->toColumn == 5);
+    CHECK(selector.rangeAt(999)->fromColumn == 1);
+    CHECK(selector.rangeAt(999)->toColumn == 2);
+    CHECK_FALSE(selector.rangeAt(1000).has_value());
+
+    CHECK(selector.contains(Coordinate{500, 1}));
+    CHECK_FALSE(selector.contains(Coordinate{0, 2}));
+    CHECK_FALSE(selector.contains(Coordinate{999, 3}));
+
+    // only the requested window is being materialized
+    vector<Selector::Range> const window = selector.selection(998, 2);
+    REQUIRE(window.size() == 2);
+    CHECK(window[0].line == 998);
+    CHECK(window[0].length() == 5);
+    CHECK(window[1].line == 999);
+    CHECK(window[1].length() == 2);
+
+    CHECK(selector.selection(1000, 10).empty());
+    CHECK(selector.selection().size() == 1000);
+}
+
+TEST_CASE("Selector.followLineIds", "[selector]")
+{
+    auto screenEvents = ScreenEvents{};
+    auto screen = Screen{Size{3, 2}, screenEvents, false, false, 2};
+    screen.write("a1\r\nb2\r\nc3\r\n");
+    REQUIRE(screen.historyLineCount() == 2);
+
+    // select "b2"
+    auto selector = Selector{Selector::Mode::FullLine, U",", screen, Coordinate{1, 1}};
+    selector.stop();
+    REQUIRE(selector.firstLine() == 1);
+
+    screen.write("d4\r\n");
+    REQUIRE(screen.grid().discardedLineCount() == 1);
+    REQUIRE(selector.followLineIds());
+    CHECK(selector.firstLine() == 0);
+    CHECK(selector.lastLine() == 0);
+    CHECK(screen.grid().renderTextLineAbsolute(0) == "b2 ");
+
+    screen.write("e5\r\n");
+    CHECK_FALSE(selector.followLineIds());
 }
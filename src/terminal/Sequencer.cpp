@@ -21,6 +21,7 @@
 #include <crispy/base64.h>
 #include <crispy/escape.h>
 #include <crispy/debuglog.h>
+#include <crispy/metrics.h>
 #include <crispy/utils.h>
 
 #include <unicode/utf8.h>
@@ -41,8 +42,6 @@
 
 using std::array;
 using std::distance;
-using std::get;
-using std::holds_alternative;
 using std::make_shared;
 using std::make_unique;
 using std::min;
@@ -61,13 +60,41 @@ using std::vector;
 
 using namespace std::string_view_literals;
 
-#define CONTOUR_SYNCHRONIZED_OUTPUT 1
-
 namespace terminal {
 
 namespace {
     auto const VTParserTag = crispy::debugtag::make("vtparser.errors", "Logs terminal parser errors.");
     auto const VTParserTraceTag = crispy::debugtag::make("vtparser.trace", "Logs terminal parser instruction trace.");
+
+#if defined(CRISPY_METRICS)
+    /// @returns the counter of executed VT sequences of the given function, in O(1).
+    crispy::metrics::counter& sequenceCounter(FunctionDefinition const& _function)
+    {
+        auto const& funcs = functions();
+        static auto const counters = [&]() {
+            auto result = vector<crispy::metrics::counter*>{};
+            for (auto const& f : funcs)
+                result.push_back(&crispy::metrics::registry::get().counter_for(fmt::format("vt.sequence.{}", f.mnemonic)));
+            return result;
+        }();
+        return *counters[static_cast<size_t>(&_function - funcs.data())];
+    }
+
+    /// @returns the counter of executed C0 control functions of the given control code.
+    crispy::metrics::counter& controlCounter(char _c0)
+    {
+        static auto const counters = []() {
+            auto result = array<crispy::metrics::counter*, 0x20>{};
+            for (size_t i = 0; i < result.size(); ++i)
+                result[i] = &crispy::metrics::registry::get().counter_for(fmt::format("vt.control.0x{:02X}", i));
+            for (auto const& f : functions())
+                if (f.category == FunctionCategory::C0)
+                    result[static_cast<size_t>(f.finalSymbol) & 0x1F] = &crispy::metrics::registry::get().counter_for(fmt::format("vt.control.{}", f.mnemonic));
+            return result;
+        }();
+        return *counters[static_cast<size_t>(_c0) & 0x1F];
+    }
+#endif
 }
 
 namespace // {{{ helpers
@@ -697,6 +724,24 @@ namespace impl // {{{ some command generator helpers
             return ApplyResult::Unsupported;
     }
 
+    ApplyResult SEMANTICPROMPT(Sequence const& _seq, Screen& _screen)
+    {
+        // semantic_prompt_OSC ::= OSC '133' ';' ('A' | 'B' | 'C' | 'D') (';' params)?
+        auto const& value = _seq.intermediateCharacters();
+        if (value.empty())
+            return ApplyResult::Invalid;
+
+        switch (value[0])
+        {
+            case 'A': _screen.markPromptStart(); break;
+            case 'B': break; // end of prompt, start of command input
+            case 'C': _screen.markCommandOutputStart(); break;
+            case 'D': _screen.markCommandFinished(); break; // the exit code parameter is ignored
+            default: return ApplyResult::Unsupported;
+        }
+        return ApplyResult::Ok;
+    }
+
     ApplyResult SETCWD(Sequence const& _seq, Screen& _screen)
     {
         string const& url = _seq.intermediateCharacters();
@@ -954,13 +999,8 @@ void Sequencer::error(std::string_view const& _errorString)
 
 void Sequencer::print(char32_t _char)
 {
-    if (batching_)
-        batchedSequences_.emplace_back(_char);
-    else
-    {
-        instructionCounter_++;
-        screen_.writeText(_char);
-    }
+    instructionCounter_++;
+    screen_.writeText(_char);
 }
 
 void Sequencer::execute(char _controlCode)
@@ -1057,6 +1097,7 @@ void Sequencer::hook(char _finalChar)
     sequence_.setFinalChar(_finalChar);
     if (FunctionDefinition const* funcSpec = sequence_.functionDefinition(); funcSpec != nullptr)
     {
+        CRISPY_METRICS_ONLY(sequenceCounter(*funcSpec).add());
         switch (funcSpec->id())
         {
             case DECSIXEL:
@@ -1134,22 +1175,10 @@ unique_ptr<ParserExtension> Sequencer::hookSixel(Sequence const& _seq)
     return make_unique<SixelParser>(
         *sixelImageBuilder_,
         [this]() {
-#if defined(CONTOUR_SYNCHRONIZED_OUTPUT)
-            if (batching_)
-            {
-                batchedSequences_.emplace_back(SixelImage{
-                    sixelImageBuilder_->size(),
-                    sixelImageBuilder_->data()
-                });
-            }
-            else
-#endif
-            {
-                screen_.sixelImage(
-                    sixelImageBuilder_->size(),
-                    move(sixelImageBuilder_->data())
-                );
-            }
+            screen_.sixelImage(
+                sixelImageBuilder_->size(),
+                move(sixelImageBuilder_->data())
+            );
         }
     );
 }
@@ -1188,26 +1217,14 @@ unique_ptr<ParserExtension> Sequencer::hookDECRQSS(Sequence const& /*_seq*/)
 
             if (s.has_value())
                 screen_.requestStatusString(s.value());
-
-            // TODO: handle batching
         }
     );
 }
 
 void Sequencer::executeControlFunction(char _c0)
 {
-#if defined(CONTOUR_SYNCHRONIZED_OUTPUT)
-    if (batching_)
-    {
-        sequence_.clear();
-        sequence_.setCategory(FunctionCategory::C0);
-        sequence_.setFinalChar(_c0);
-        handleSequence();
-        return;
-    }
-#endif
-
     instructionCounter_++;
+    CRISPY_METRICS_ONLY(controlCounter(_c0).add());
     switch (_c0)
     {
         case 0x07: // BEL
@@ -1247,7 +1264,7 @@ void Sequencer::executeControlFunction(char _c0)
 void Sequencer::handleSequence()
 {
 #if defined(LIBTERMINAL_LOG_TRACE)
-    if (crispy::logging_sink::for_debug().enabled())
+    if (crispy::debugtag::enabled(VTParserTraceTag))
         debuglog(VTParserTraceTag).write("Handle VT sequence: {}", sequence_);
 #endif
     // std::cerr << fmt::format("\t{} \t; {}\n", sequence_,
@@ -1256,25 +1273,8 @@ void Sequencer::handleSequence()
     instructionCounter_++;
     if (FunctionDefinition const* funcSpec = sequence_.functionDefinition(); funcSpec != nullptr)
     {
-#if defined(CONTOUR_SYNCHRONIZED_OUTPUT)
-        if (*funcSpec == DECSM && sequence_.containsParameter(2026))
-        {
-            batching_ = true;
-            apply(*funcSpec, sequence_);
-        }
-        else if (*funcSpec == DECRM && sequence_.containsParameter(2026))
-        {
-            batching_ = false;
-            flushBatchedSequences();
-            apply(*funcSpec, sequence_);
-        }
-        else if (batching_ && isBatchable(*funcSpec))
-        {
-            batchedSequences_.emplace_back(sequence_);
-        }
-        else
-#endif
-            apply(*funcSpec, sequence_);
+        CRISPY_METRICS_ONLY(sequenceCounter(*funcSpec).add());
+        apply(*funcSpec, sequence_);
 
         screen_.verifyState();
     }
@@ -1282,38 +1282,9 @@ void Sequencer::handleSequence()
         debuglog(VTParserTag).write("Unknown VT sequence: {}", sequence_);
 }
 
-void Sequencer::flushBatchedSequences()
-{
-    for (auto const& batchable : batchedSequences_)
-    {
-        if (holds_alternative<char32_t>(batchable))
-            print(get<char32_t>(batchable));
-        else if (holds_alternative<Sequence>(batchable))
-        {
-            auto const& seq = get<Sequence>(batchable);
-            if (FunctionDefinition const* spec = seq.functionDefinition(); spec != nullptr)
-                apply(*spec, seq);
-        }
-        else if (holds_alternative<SixelImage>(batchable))
-        {
-            auto const& si = get<SixelImage>(batchable);
-            screen_.sixelImage(si.size, Image::Data(si.rgba));
-        }
-    }
-    batchedSequences_.clear();
-}
-
 /// Applies a FunctionDefinition to a given context, emitting the respective command.
 ApplyResult Sequencer::apply(FunctionDefinition const& _function, Sequence const& _seq)
 {
-#if defined(CONTOUR_SYNCHRONIZED_OUTPUT)
-    if (batching_ && isBatchable(_function))
-    {
-        batchedSequences_.emplace_back(_seq);
-        return ApplyResult::Ok;
-    }
-#endif
-
     // This function assumed that the incoming instruction has been already resolved to a given
     // FunctionDefinition
     switch (_function)
@@ -1435,6 +1406,7 @@ ApplyResult Sequencer::apply(FunctionDefinition const& _function, Sequence const
         case SETFONT: return impl::setFont(_seq, screen_);
         case SETFONTALL: return impl::setAllFont(_seq, screen_);
         case CLIPBOARD: return impl::clipboard(_seq, screen_);
+        case SEMANTICPROMPT: return impl::SEMANTICPROMPT(_seq, screen_);
         // TODO: case COLORSPECIAL: return impl::setOrRequestDynamicColor(_seq, _output, DynamicColorName::HighlightForegroundColor);
         case RCOLORFG: screen_.resetDynamicColor(DynamicColorName::DefaultForegroundColor); break;
         case RCOLORBG: screen_.resetDynamicColor(DynamicColorName::DefaultBackgroundColor); break;
@@ -370,15 +370,6 @@ enum class RequestStatusString {
     DECSNLS
 };
 
-/// DECSIXEL - Sixel Graphics Image.
-struct SixelImage { // TODO: this struct is only used internally in Sequencer, make it private
-    /// Size in pixels for this image
-    Size size;
-
-    /// RGBA buffer of the image to be rendered
-    Image::Data rgba;
-};
-
 inline std::string setDynamicColorValue(RGBColor const& color) // TODO: yet another helper. maybe SemanticsUtils static class?
 {
     auto const r = static_cast<unsigned>(static_cast<float>(color.red) / 255.0f * 0xFFFF);
@@ -543,8 +534,11 @@ class Sequencer : public ParserEvents {
     void setMaxImageColorRegisters(int _value) { maxImageRegisterCount_ = _value; }
     void setUsePrivateColorRegisters(bool _value) { usePrivateColorRegisters_ = _value; }
 
-    int64_t instructionCounter() const noexcept { return instructionCounter_; }
-    void resetInstructionCounter() noexcept { instructionCounter_ = 0; }
+    int64_t instructionCounter() const noexcept { return instructionCounter_ - instructionCounterBase_; }
+    void resetInstructionCounter() noexcept { instructionCounterBase_ = instructionCounter_; }
+
+    /// @returns total number of instructions (printed characters and control functions) processed so far.
+    int64_t totalInstructionCount() const noexcept { return instructionCounter_; }
 
     // helper methods
     //
@@ -576,17 +570,13 @@ class Sequencer : public ParserEvents {
     [[nodiscard]] std::unique_ptr<ParserExtension> hookSixel(Sequence const& _ctx);
     [[nodiscard]] std::unique_ptr<ParserExtension> hookDECRQSS(Sequence const& _ctx);
 
-    void flushBatchedSequences();
-
     ApplyResult apply(FunctionDefinition const& _function, Sequence const& _context);
 
   private:
     Sequence sequence_{};
     Screen& screen_;
-    bool batching_ = false;
     int64_t instructionCounter_ = 0;
-    using Batchable = std::variant<char32_t, Sequence, SixelImage>;
-    std::vector<Batchable> batchedSequences_;
+    int64_t instructionCounterBase_ = 0;
 
     std::unique_ptr<ParserExtension> hookedParser_;
     std::unique_ptr<SixelImageBuilder> sixelImageBuilder_;
@@ -0,0 +1,287 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/SessionClient.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using std::runtime_error;
+using std::string;
+using std::string_view;
+using std::unique_ptr;
+
+using namespace std::string_literals;
+
+namespace terminal {
+
+namespace {
+    constexpr uint8_t CopiedRow = 0x80;
+}
+
+string SessionLine::toUtf8() const
+{
+    auto result = string{};
+    for (Cell const& cell : cells)
+        result += cell.toUtf8();
+    return result;
+}
+
+SessionClient::SessionClient(int _fd) :
+    fd_{ _fd }
+{
+}
+
+SessionClient::~SessionClient()
+{
+    ::close(fd_);
+}
+
+unique_ptr<SessionClient> SessionClient::connect(string const& _path)
+{
+    auto address = sockaddr_un{};
+    if (_path.size() >= sizeof(address.sun_path))
+        throw runtime_error{"Session socket path too long: "s + _path};
+
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, _path.c_str(), sizeof(address.sun_path) - 1);
+
+    auto const fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        throw runtime_error{"Could not create session socket: "s + strerror(errno)};
+
+    if (::connect(fd, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) < 0)
+    {
+        auto const error = "Could not connect to session "s + _path + ": " + strerror(errno);
+        ::close(fd);
+        throw runtime_error{error};
+    }
+
+    return std::make_unique<SessionClient>(fd);
+}
+
+// {{{ requests
+void SessionClient::attach(Size _pageSize)
+{
+    sendSize(SessionMessage::Attach, _pageSize);
+}
+
+void SessionClient::resize(Size _pageSize)
+{
+    sendSize(SessionMessage::Resize, _pageSize);
+}
+
+void SessionClient::sendInput(string_view _data)
+{
+    send(SessionMessage::Input, _data);
+}
+
+void SessionClient::fetchHistory(LineId _before, int _count)
+{
+    auto encoder = SessionEncoder{output_};
+    encoder.begin(SessionMessage::FetchHistory);
+    encoder.varint(_before);
+    encoder.varint(static_cast<uint64_t>(_count));
+    encoder.end();
+    flush();
+}
+
+void SessionClient::detach()
+{
+    send(SessionMessage::Detach);
+}
+
+void SessionClient::sendSize(SessionMessage _type, Size _size)
+{
+    auto encoder = SessionEncoder{output_};
+    encoder.begin(_type);
+    encoder.varint(static_cast<uint64_t>(_size.width));
+    encoder.varint(static_cast<uint64_t>(_size.height));
+    encoder.end();
+    flush();
+}
+
+void SessionClient::send(SessionMessage _type, string_view _payload)
+{
+    auto encoder = SessionEncoder{output_};
+    encoder.begin(_type);
+    output_.append(_payload.data(), _payload.size());
+    encoder.end();
+    flush();
+}
+
+void SessionClient::flush()
+{
+    auto data = string_view{output_};
+    while (!data.empty())
+    {
+        auto const n = ::send(fd_, data.data(), data.size(), MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+        {
+            output_.clear();
+            throw runtime_error{"Could not send to session: "s + strerror(errno)};
+        }
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+    output_.clear();
+}
+// }}}
+
+bool SessionClient::receive(std::chrono::milliseconds _timeout)
+{
+    auto fds = pollfd{fd_, POLLIN, 0};
+    auto const ready = poll(&fds, 1, static_cast<int>(_timeout.count()));
+    if (ready < 0 && errno != EINTR)
+        throw runtime_error{"Could not poll session: "s + strerror(errno)};
+    if (ready <= 0)
+        return true;
+
+    char buf[16 * 1024];
+    auto const n = ::recv(fd_, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n == 0)
+        return false;
+    if (n < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+
+    bytesReceived_ += static_cast<uint64_t>(n);
+    input_.append(buf, static_cast<size_t>(n));
+
+    auto input = string_view{input_};
+    while (auto const frame = takeFrame(input))
+        handle(*frame);
+    input_.erase(0, input_.size() - input.size());
+
+    return true;
+}
+
+std::string const* SessionClient::hyperlink(HyperlinkId _id) const noexcept
+{
+    if (auto const i = hyperlinks_.find(_id); i != hyperlinks_.end())
+        return &i->second;
+    return nullptr;
+}
+
+void SessionClient::handle(SessionFrame const& _frame)
+{
+    auto decoder = SessionDecoder{_frame.payload};
+    switch (_frame.type)
+    {
+        case SessionMessage::Page:
+        {
+            auto const size = Size{decoder.integer(0xFFFF), decoder.integer(0xFFFF)};
+            historyLineCount_ = decoder.integer(std::numeric_limits<int>::max());
+            auto const primaryScreen = decoder.byte() != 0;
+            if (size != pageSize_)
+            {
+                pageSize_ = size;
+                page_.assign(static_cast<size_t>(size.height), SessionLine{});
+                for (auto& line : page_)
+                    line.cells.resize(static_cast<size_t>(size.width));
+            }
+            if (primaryScreen != primaryScreen_)
+                history_.clear();
+            primaryScreen_ = primaryScreen;
+            break;
+        }
+        case SessionMessage::Rows:
+            applyRows(decoder);
+            break;
+        case SessionMessage::Cursor:
+            cursorPosition_.row = decoder.integer(0xFFFF);
+            cursorPosition_.column = decoder.integer(0xFFFF);
+            cursorVisible_ = decoder.byte() != 0;
+            cursorShape_ = static_cast<CursorShape>(decoder.byte());
+            cursorDisplay_ = static_cast<CursorDisplay>(decoder.byte());
+            break;
+        case SessionMessage::Modes:
+        {
+            modes_.clear();
+            auto const count = decoder.integer(static_cast<int>(std::size(SessionModes)));
+            for (int i = 0; i < count; ++i)
+                modes_.insert(static_cast<DECMode>(decoder.integer(0xFFFF)));
+            break;
+        }
+        case SessionMessage::Hyperlink:
+        {
+            auto const id = static_cast<HyperlinkId>(decoder.integer(std::numeric_limits<HyperlinkId>::max()));
+            hyperlinks_[id] = string{decoder.bytes()};
+            break;
+        }
+        case SessionMessage::History:
+        {
+            decoder.varint(); // BEFORE, as requested
+            auto const count = decoder.integer(static_cast<int>(_frame.payload.size()));
+            for (int i = 0; i < count; ++i)
+            {
+                auto const id = decoder.varint();
+                auto& line = history_[id];
+                line.id = id;
+                line.flags = static_cast<Line::Flags>(decoder.byte());
+                decoder.cells(line.cells, pageSize_.width);
+            }
+            break;
+        }
+        case SessionMessage::Title:
+            windowTitle_ = string{_frame.payload};
+            break;
+        case SessionMessage::Closed:
+            closed_ = true;
+            break;
+        default:
+            break; // messages of newer servers are ignored
+    }
+}
+
+void SessionClient::applyRows(SessionDecoder& _decoder)
+{
+    // Copied rows refer to the page as it was before this message, which is why all rows
+    // are decoded before any of them is replaced.
+    auto const count = _decoder.integer(pageSize_.height);
+    updates_.resize(static_cast<size_t>(count));
+    for (auto& [row, line] : updates_)
+    {
+        row = _decoder.integer(pageSize_.height);
+        line.id = _decoder.varint();
+
+        auto const flags = _decoder.byte();
+        line.flags = static_cast<Line::Flags>(flags & ~CopiedRow);
+        if (flags & CopiedRow)
+        {
+            auto const source = _decoder.integer(pageSize_.height);
+            if (row < 1 || source < 1)
+                throw runtime_error{"Malformed session protocol message."};
+            line.cells = page_[static_cast<size_t>(source - 1)].cells;
+        }
+        else if (row < 1)
+            throw runtime_error{"Malformed session protocol message."};
+        else
+            _decoder.cells(line.cells, pageSize_.width);
+    }
+
+    for (auto& [row, line] : updates_)
+        std::swap(page_[static_cast<size_t>(row - 1)], line);
+
+    rowsReceived_ += static_cast<uint64_t>(count);
+}
+
+} // namespace terminal
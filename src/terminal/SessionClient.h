@@ -0,0 +1,142 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/SessionProtocol.h>
+#include <terminal/Size.h>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace terminal {
+
+/// A line as mirrored by a SessionClient.
+struct SessionLine {
+    LineId id = 0;
+    Line::Flags flags = Line::Flags::None;
+    std::vector<Cell> cells;
+
+    std::string toUtf8() const;
+};
+
+/// Mirrors the state of a terminal hosted by a SessionServer.
+///
+/// The visible page is kept up to date as the server sends its deltas, whereas scrollback lines
+/// are only available as far as they have been fetched via fetchHistory().
+class SessionClient {
+  public:
+    /// Uses the connected socket @p _fd, taking ownership of it.
+    explicit SessionClient(int _fd);
+    ~SessionClient();
+
+    SessionClient(SessionClient const&) = delete;
+    SessionClient& operator=(SessionClient const&) = delete;
+
+    /// Connects to the session server listening at @p _path.
+    ///
+    /// @throws std::runtime_error if the connection could not be established.
+    static std::unique_ptr<SessionClient> connect(std::string const& _path);
+
+    int fd() const noexcept { return fd_; }
+
+    // {{{ requests
+    // All of these throw std::runtime_error if the connection has been lost.
+
+    /// Attaches to the session, which makes the server send the visible page and any further changes.
+    void attach(Size _pageSize);
+    void resize(Size _pageSize);
+    void sendInput(std::string_view _data);
+
+    /// Asks for up to @p _count scrollback lines above the line @p _before, or the top page line if 0.
+    void fetchHistory(LineId _before, int _count);
+
+    void detach();
+    // }}}
+
+    /// Waits up to @p _timeout for data from the server, and applies all messages received.
+    ///
+    /// @returns false if the connection has been closed.
+    /// @throws std::runtime_error if the server sent malformed data.
+    bool receive(std::chrono::milliseconds _timeout);
+
+    // {{{ mirrored state
+    Size pageSize() const noexcept { return pageSize_; }
+
+    /// Visible lines, top to bottom.
+    std::vector<SessionLine> const& page() const noexcept { return page_; }
+
+    /// Number of lines in the server's scrollback.
+    int historyLineCount() const noexcept { return historyLineCount_; }
+    bool primaryScreen() const noexcept { return primaryScreen_; }
+
+    /// Scrollback lines fetched so far, by ascending LineId (i.e. top to bottom).
+    std::map<LineId, SessionLine> const& history() const noexcept { return history_; }
+
+    Coordinate cursorPosition() const noexcept { return cursorPosition_; }
+    bool cursorVisible() const noexcept { return cursorVisible_; }
+    CursorShape cursorShape() const noexcept { return cursorShape_; }
+    CursorDisplay cursorDisplay() const noexcept { return cursorDisplay_; }
+
+    bool isModeEnabled(DECMode _mode) const noexcept { return modes_.count(_mode) != 0; }
+
+    /// @returns the URI of the given hyperlink, as used in the cells, or nullptr if unknown.
+    std::string const* hyperlink(HyperlinkId _id) const noexcept;
+
+    std::string const& windowTitle() const noexcept { return windowTitle_; }
+
+    /// Whether the application of the session has terminated.
+    bool closed() const noexcept { return closed_; }
+
+    /// Number of rows received, either as cells or as copy of a previous row.
+    uint64_t rowsReceived() const noexcept { return rowsReceived_; }
+    uint64_t bytesReceived() const noexcept { return bytesReceived_; }
+    // }}}
+
+  private:
+    void send(SessionMessage _type, std::string_view _payload = {});
+    void sendSize(SessionMessage _type, Size _size);
+    void flush();
+    void handle(SessionFrame const& _frame);
+    void applyRows(SessionDecoder& _decoder);
+
+    int fd_;
+    std::string input_;
+    std::string output_;
+
+    Size pageSize_{};
+    std::vector<SessionLine> page_;
+    std::vector<std::pair<int, SessionLine>> updates_;  // scratch buffer of applyRows()
+    int historyLineCount_ = 0;
+    bool primaryScreen_ = true;
+    std::map<LineId, SessionLine> history_;
+    Coordinate cursorPosition_{1, 1};
+    bool cursorVisible_ = true;
+    CursorShape cursorShape_ = CursorShape::Block;
+    CursorDisplay cursorDisplay_ = CursorDisplay::Steady;
+    std::set<DECMode> modes_;
+    std::unordered_map<HyperlinkId, std::string> hyperlinks_;
+    std::string windowTitle_;
+    bool closed_ = false;
+    uint64_t rowsReceived_ = 0;
+    uint64_t bytesReceived_ = 0;
+};
+
+} // namespace terminal
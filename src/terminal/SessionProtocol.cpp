@@ -0,0 +1,266 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/SessionProtocol.h>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+using std::nullopt;
+using std::optional;
+using std::runtime_error;
+using std::string_view;
+using std::vector;
+
+namespace terminal {
+
+namespace {
+    constexpr size_t FrameHeaderSize = 5;
+
+    // cell header bits
+    constexpr uint8_t CodepointCountMask = 0x0F;
+    constexpr uint8_t HasAttributes = 0x10;
+    constexpr uint8_t HasHyperlink = 0x20;
+    constexpr uint8_t HasWidth = 0x40;
+
+    // color tags, as the index of the respective Color alternative
+    constexpr uint8_t UndefinedColorTag = 0;
+    constexpr uint8_t DefaultColorTag = 1;
+    constexpr uint8_t IndexedColorTag = 2;
+    constexpr uint8_t BrightColorTag = 3;
+    constexpr uint8_t RGBColorTag = 4;
+
+    [[noreturn]] void malformed()
+    {
+        throw runtime_error{"Malformed session protocol message."};
+    }
+}
+
+optional<SessionFrame> takeFrame(string_view& _input)
+{
+    if (_input.size() < FrameHeaderSize)
+        return nullopt;
+
+    auto const length = static_cast<size_t>(static_cast<uint8_t>(_input[1]))
+                      | static_cast<size_t>(static_cast<uint8_t>(_input[2])) << 8
+                      | static_cast<size_t>(static_cast<uint8_t>(_input[3])) << 16
+                      | static_cast<size_t>(static_cast<uint8_t>(_input[4])) << 24;
+
+    if (length > MaxSessionFrameSize)
+        throw runtime_error{"Session protocol frame exceeds maximum size."};
+
+    if (_input.size() < FrameHeaderSize + length)
+        return nullopt;
+
+    auto const frame = SessionFrame{static_cast<SessionMessage>(_input[0]), _input.substr(FrameHeaderSize, length)};
+    _input.remove_prefix(FrameHeaderSize + length);
+    return frame;
+}
+
+// {{{ SessionEncoder
+void SessionEncoder::begin(SessionMessage _type)
+{
+    frameStart_ = output_.size();
+    byte(static_cast<uint8_t>(_type));
+    output_.append(FrameHeaderSize - 1, '\0');
+}
+
+void SessionEncoder::end()
+{
+    auto const length = output_.size() - frameStart_ - FrameHeaderSize;
+    for (size_t i = 0; i < 4; ++i)
+        output_[frameStart_ + 1 + i] = static_cast<char>((length >> (8 * i)) & 0xFF);
+}
+
+void SessionEncoder::varint(uint64_t _value)
+{
+    while (_value >= 0x80)
+    {
+        byte(static_cast<uint8_t>((_value & 0x7F) | 0x80));
+        _value >>= 7;
+    }
+    byte(static_cast<uint8_t>(_value));
+}
+
+void SessionEncoder::bytes(string_view _data)
+{
+    varint(_data.size());
+    output_.append(_data.data(), _data.size());
+}
+
+void SessionEncoder::cell(Cell const& _cell, Cell const& _previous)
+{
+    auto header = static_cast<uint8_t>(_cell.codepointCount());
+    if (_cell.attributes() != _previous.attributes())
+        header |= HasAttributes;
+    if (_cell.hyperlink() != _previous.hyperlink())
+        header |= HasHyperlink;
+    if (_cell.width() != 1)
+        header |= HasWidth;
+
+    byte(header);
+    if (header & HasAttributes)
+        attributes(_cell.attributes());
+    if (header & HasHyperlink)
+        varint(_cell.hyperlink());
+    if (header & HasWidth)
+        byte(static_cast<uint8_t>(_cell.width()));
+    for (char32_t const codepoint : _cell.codepoints())
+        varint(codepoint);
+}
+
+void SessionEncoder::attributes(GraphicsAttributes const& _attributes)
+{
+    color(_attributes.foregroundColor);
+    color(_attributes.backgroundColor);
+    color(_attributes.underlineColor);
+    varint(_attributes.styles.mask());
+}
+
+void SessionEncoder::color(Color const& _color)
+{
+    auto const tag = static_cast<uint8_t>(_color.index());
+    byte(tag);
+    switch (tag)
+    {
+        case IndexedColorTag:
+            byte(static_cast<uint8_t>(std::get<IndexedColor>(_color)));
+            break;
+        case BrightColorTag:
+            byte(static_cast<uint8_t>(std::get<BrightColor>(_color)));
+            break;
+        case RGBColorTag:
+        {
+            auto const rgb = std::get<RGBColor>(_color);
+            byte(rgb.red);
+            byte(rgb.green);
+            byte(rgb.blue);
+            break;
+        }
+    }
+}
+// }}}
+
+// {{{ SessionDecoder
+uint8_t SessionDecoder::byte()
+{
+    if (atEnd())
+        malformed();
+    return static_cast<uint8_t>(data_[pos_++]);
+}
+
+uint64_t SessionDecoder::varint()
+{
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7)
+    {
+        auto const b = byte();
+        value |= uint64_t(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            return value;
+    }
+    malformed();
+}
+
+int SessionDecoder::integer(int _max)
+{
+    auto const value = varint();
+    if (value > static_cast<uint64_t>(_max))
+        malformed();
+    return static_cast<int>(value);
+}
+
+string_view SessionDecoder::bytes()
+{
+    auto const length = varint();
+    if (length > data_.size() - pos_)
+        malformed();
+    auto const result = data_.substr(pos_, static_cast<size_t>(length));
+    pos_ += static_cast<size_t>(length);
+    return result;
+}
+
+void SessionDecoder::cells(vector<Cell>& _output, int _columns)
+{
+    auto const count = integer(static_cast<int>(data_.size() - pos_));
+
+    _output.clear();
+    _output.reserve(static_cast<size_t>(std::max(count, _columns)));
+
+    auto attribs = GraphicsAttributes{};
+    auto hyperlink = HyperlinkId{0};
+    for (int i = 0; i < count; ++i)
+    {
+        auto const header = byte();
+        if (header & HasAttributes)
+            attributes(attribs);
+        if (header & HasHyperlink)
+            hyperlink = static_cast<HyperlinkId>(integer(std::numeric_limits<HyperlinkId>::max()));
+        auto const width = header & HasWidth ? byte() : 1;
+
+        auto const codepointCount = header & CodepointCountMask;
+        if (codepointCount > static_cast<int>(Cell::MaxCodepoints))
+            malformed();
+
+        Cell& cell = _output.emplace_back();
+        cell.reset(attribs, hyperlink);
+        for (int k = 0; k < codepointCount; ++k)
+        {
+            auto const codepoint = static_cast<char32_t>(integer(0x10FFFF));
+            if (k == 0)
+                cell.setCharacter(codepoint);
+            else
+                cell.appendCharacter(codepoint);
+        }
+        cell.setWidth(width);
+    }
+
+    if (count < _columns)
+        _output.resize(static_cast<size_t>(_columns));
+}
+
+void SessionDecoder::attributes(GraphicsAttributes& _attributes)
+{
+    _attributes.foregroundColor = color();
+    _attributes.backgroundColor = color();
+    _attributes.underlineColor = color();
+    _attributes.styles = CharacterStyleMask{static_cast<unsigned>(integer(0xFFFF))};
+}
+
+Color SessionDecoder::color()
+{
+    switch (byte())
+    {
+        case UndefinedColorTag:
+            return UndefinedColor{};
+        case DefaultColorTag:
+            return DefaultColor{};
+        case IndexedColorTag:
+            return static_cast<IndexedColor>(byte());
+        case BrightColorTag:
+            return static_cast<BrightColor>(byte());
+        case RGBColorTag:
+        {
+            auto const red = byte();
+            auto const green = byte();
+            auto const blue = byte();
+            return RGBColor{red, green, blue};
+        }
+        default:
+            malformed();
+    }
+}
+// }}}
+
+} // namespace terminal
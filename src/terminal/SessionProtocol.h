@@ -0,0 +1,171 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/Grid.h>
+#include <terminal/Sequencer.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace terminal {
+
+// The session protocol is spoken between a SessionServer, hosting a Terminal, and its SessionClients
+// over a local stream socket. Both ends are expected to run the same build on the same host.
+//
+//   frame := TYPE:u8 LENGTH:u32le PAYLOAD
+//
+// Instead of replaying the VT output, the server sends the state of the visible page as compact
+// deltas: only rows that changed since they were last sent to a client, and cursor, modes and title
+// only when they changed. Scrollback lines are only sent when asked for (FetchHistory).
+//
+//   row   := ROW:varint LINEID:varint FLAGS:u8 (CELLS | COPY:varint)
+//   cells := COUNT:varint cell*        (trailing blank cells are omitted)
+//   cell  := HEADER:u8 [ATTRIBUTES] [HYPERLINK:varint] [WIDTH:u8] CODEPOINT:varint*
+//
+// Bit 0x80 of a row's FLAGS is set if the row is a COPY of the given row of the client's previous page,
+// as it happens for all rows when the page scrolls. The other bits carry the line's Line::Flags.
+// The lower four bits of a cell's HEADER are its number of codepoints. The other bits tell whether
+// its attributes or hyperlink differ from the previous cell of the row (starting with the defaults),
+// and whether its width is other than 1. Image fragments are not transferred.
+
+enum class SessionMessage : uint8_t {
+    // {{{ client to server
+    Attach = 0x01,          // COLUMNS:varint ROWS:varint, page size of the client's window
+    Input = 0x02,           // raw bytes to be sent to the application
+    Resize = 0x03,          // COLUMNS:varint ROWS:varint
+    FetchHistory = 0x04,    // BEFORE:varint COUNT:varint, lines above line BEFORE (0 for the top page line)
+    Detach = 0x05,
+    // }}}
+
+    // {{{ server to client
+    Page = 0x81,            // COLUMNS:varint ROWS:varint HISTORY:varint PRIMARY:u8, drops the client's rows on resize
+    Rows = 0x82,            // COUNT:varint row*
+    Cursor = 0x83,          // ROW:varint COLUMN:varint VISIBLE:u8 SHAPE:u8 DISPLAY:u8
+    Modes = 0x84,           // COUNT:varint DECMODE:varint*, all enabled modes of SessionModes
+    Hyperlink = 0x85,       // ID:varint URI, (re)defines a hyperlink id used by subsequent rows
+    History = 0x86,         // BEFORE:varint COUNT:varint (LINEID:varint FLAGS:u8 CELLS)*, top to bottom
+    Title = 0x87,           // window title, UTF-8
+    Closed = 0x88,          // the application has terminated
+    // }}}
+};
+
+/// DEC modes mirrored to clients, i.e. the ones that change how input is encoded or the page is presented.
+constexpr DECMode SessionModes[] = {
+    DECMode::UseApplicationCursorKeys,
+    DECMode::ReverseVideo,
+    DECMode::MouseProtocolX10,
+    DECMode::MouseProtocolNormalTracking,
+    DECMode::MouseProtocolHighlightTracking,
+    DECMode::MouseProtocolButtonTracking,
+    DECMode::MouseProtocolAnyEventTracking,
+    DECMode::MouseExtended,
+    DECMode::MouseSGR,
+    DECMode::MouseURXVT,
+    DECMode::MouseAlternateScroll,
+    DECMode::VisibleCursor,
+    DECMode::UseAlternateScreen,
+    DECMode::BracketedPaste,
+    DECMode::FocusTracking,
+    DECMode::BatchedRendering,
+};
+
+/// A complete frame, as split off the received bytes by takeFrame().
+struct SessionFrame {
+    SessionMessage type;
+    std::string_view payload;
+};
+
+/// Largest accepted frame payload, guarding against garbage being received.
+constexpr size_t MaxSessionFrameSize = 64 * 1024 * 1024;
+
+/// Splits the first complete frame off @p _input.
+///
+/// @returns the frame, or std::nullopt if @p _input does not contain a complete frame yet.
+/// @throws std::runtime_error if the frame exceeds MaxSessionFrameSize.
+std::optional<SessionFrame> takeFrame(std::string_view& _input);
+
+/// Appends encoded frames to a buffer.
+class SessionEncoder {
+  public:
+    explicit SessionEncoder(std::string& _output) : output_{_output} {}
+
+    /// Starts a frame of the given type, to be completed by end().
+    void begin(SessionMessage _type);
+    void end();
+
+    void byte(uint8_t _value) { output_.push_back(static_cast<char>(_value)); }
+    void varint(uint64_t _value);
+    void bytes(std::string_view _data);
+
+    /// Encodes the cells of a line (see cells grammar above).
+    template <typename Iterator>
+    void cells(Iterator _begin, Iterator _end);
+
+  private:
+    void cell(Cell const& _cell, Cell const& _previous);
+    void attributes(GraphicsAttributes const& _attributes);
+    void color(Color const& _color);
+
+    std::string& output_;
+    size_t frameStart_ = 0;
+};
+
+/// Sequentially reads the values of a frame's payload.
+///
+/// All reads throw std::runtime_error if the payload is truncated or malformed.
+class SessionDecoder {
+  public:
+    explicit SessionDecoder(std::string_view _payload) : data_{_payload} {}
+
+    bool atEnd() const noexcept { return pos_ == data_.size(); }
+
+    uint8_t byte();
+    uint64_t varint();
+    int integer(int _max);
+    std::string_view bytes();
+
+    /// Decodes the cells of a line, and pads them with blank cells to (at least) @p _columns.
+    void cells(std::vector<Cell>& _output, int _columns);
+
+  private:
+    void attributes(GraphicsAttributes& _attributes);
+    Color color();
+
+    std::string_view data_;
+    size_t pos_ = 0;
+};
+
+template <typename Iterator>
+void SessionEncoder::cells(Iterator _begin, Iterator _end)
+{
+    auto const blank = Cell{};
+    while (_end != _begin && std::prev(_end)->empty() && std::prev(_end)->hyperlink() == 0
+            && std::prev(_end)->attributes() == blank.attributes())
+        --_end;
+
+    varint(static_cast<uint64_t>(std::distance(_begin, _end)));
+
+    Cell const* previous = &blank;
+    for (auto i = _begin; i != _end; ++i)
+    {
+        cell(*i, *previous);
+        previous = &*i;
+    }
+}
+
+} // namespace terminal
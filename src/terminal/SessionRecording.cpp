@@ -0,0 +1,275 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/SessionRecording.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace terminal {
+
+namespace {
+    constexpr string_view Magic = "CREC";
+    constexpr uint8_t Version = 1;
+    constexpr size_t HeaderSize = Magic.size() + 1 + 2 + 2;
+
+    void appendVarInt(string& _out, uint64_t _value)
+    {
+        while (_value >= 0x80)
+        {
+            _out.push_back(static_cast<char>((_value & 0x7F) | 0x80));
+            _value >>= 7;
+        }
+        _out.push_back(static_cast<char>(_value));
+    }
+
+    void appendU16(string& _out, int _value)
+    {
+        _out.push_back(static_cast<char>(_value & 0xFF));
+        _out.push_back(static_cast<char>((_value >> 8) & 0xFF));
+    }
+
+    /// Sequentially reads the encoded values of a recording.
+    class Decoder {
+      public:
+        explicit Decoder(string_view _data) : data_{ _data } {}
+
+        bool atEnd() const noexcept { return pos_ == data_.size(); }
+
+        optional<uint8_t> byte()
+        {
+            if (atEnd())
+                return nullopt;
+            return static_cast<uint8_t>(data_[pos_++]);
+        }
+
+        optional<uint64_t> varInt()
+        {
+            uint64_t value = 0;
+            for (unsigned shift = 0; shift < 64; shift += 7)
+            {
+                auto const b = byte();
+                if (!b)
+                    return nullopt;
+                value |= uint64_t(*b & 0x7F) << shift;
+                if (!(*b & 0x80))
+                    return value;
+            }
+            return nullopt;
+        }
+
+        optional<string_view> bytes(uint64_t _count)
+        {
+            if (_count > data_.size() - pos_)
+                return nullopt;
+            auto const result = data_.substr(pos_, static_cast<size_t>(_count));
+            pos_ += static_cast<size_t>(_count);
+            return result;
+        }
+
+      private:
+        string_view data_;
+        size_t pos_ = 0;
+    };
+}
+
+// {{{ SessionRecorder
+SessionRecorder::SessionRecorder(string const& _path, Size _size, clock::time_point _start) :
+    path_{ _path },
+    file_{ _path, ios::binary | ios::trunc },
+    lastEvent_{ _start }
+{
+    if (!file_.good())
+        throw runtime_error{"Could not create session recording file "s + _path + ": " + strerror(errno)};
+
+    auto header = string{Magic};
+    header.push_back(static_cast<char>(Version));
+    appendU16(header, _size.width);
+    appendU16(header, _size.height);
+    file_.write(header.data(), static_cast<streamsize>(header.size()));
+
+    writer_ = thread{ [this]() { writerThread(); } };
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    {
+        auto _l = lock_guard{lock_};
+        terminating_ = true;
+    }
+    eventsAvailable_.notify_one();
+    writer_.join();
+}
+
+void SessionRecorder::output(clock::time_point _now, char const* _data, size_t _size)
+{
+    auto _l = unique_lock{lock_};
+    auto const offset = pending_.size();
+    beginEvent(RecordingEventType::Output, _now);
+    appendVarInt(pending_, _size);
+    pending_.append(_data, _size);
+    endEvent(_l, offset);
+}
+
+void SessionRecorder::resize(clock::time_point _now, Size _size)
+{
+    auto _l = unique_lock{lock_};
+    auto const offset = pending_.size();
+    beginEvent(RecordingEventType::Resize, _now);
+    appendVarInt(pending_, static_cast<uint64_t>(_size.width));
+    appendVarInt(pending_, static_cast<uint64_t>(_size.height));
+    endEvent(_l, offset);
+}
+
+SessionRecorderStats SessionRecorder::stats() const
+{
+    auto _l = lock_guard{lock_};
+    return stats_;
+}
+
+void SessionRecorder::beginEvent(RecordingEventType _type, clock::time_point _now)
+{
+    // Events may be timestamped by different threads right before being recorded,
+    // so the clock may appear to go backwards by a tiny bit.
+    auto const delta = max(duration_cast<microseconds>(_now - lastEvent_), microseconds::zero());
+    lastEvent_ += delta;
+
+    pending_.push_back(static_cast<char>(_type));
+    appendVarInt(pending_, static_cast<uint64_t>(delta.count()));
+}
+
+void SessionRecorder::endEvent(unique_lock<mutex>& _lock, size_t _offset)
+{
+    ++stats_.events;
+    stats_.bytesRecorded += pending_.size() - _offset;
+    stats_.maxBacklog = max(stats_.maxBacklog, pending_.size());
+    _lock.unlock();
+
+    if (_offset == 0)
+        eventsAvailable_.notify_one();
+}
+
+void SessionRecorder::writerThread()
+{
+    // Events are double-buffered: while this thread writes one batch, the next one gets
+    // recorded into pending_. Both buffers keep their capacity across swaps.
+    string batch;
+    for (;;)
+    {
+        {
+            auto _l = unique_lock{lock_};
+            eventsAvailable_.wait(_l, [this]() { return !pending_.empty() || terminating_; });
+            if (pending_.empty())
+                break;
+            swap(batch, pending_);
+        }
+
+        file_.write(batch.data(), static_cast<streamsize>(batch.size()));
+        file_.flush();
+
+        {
+            auto _l = lock_guard{lock_};
+            stats_.bytesWritten += batch.size();
+        }
+        batch.clear();
+    }
+}
+// }}}
+
+// {{{ SessionRecording
+uint64_t SessionRecording::outputBytes() const noexcept
+{
+    uint64_t total = 0;
+    for (auto const& event : events)
+        total += event.output.size();
+    return total;
+}
+
+SessionRecording SessionRecording::load(string const& _path)
+{
+    auto file = ifstream{_path, ios::binary};
+    if (!file.good())
+        throw runtime_error{"Could not open session recording file "s + _path + ": " + strerror(errno)};
+
+    auto const data = string{istreambuf_iterator<char>(file), istreambuf_iterator<char>()};
+    return decode(data);
+}
+
+SessionRecording SessionRecording::decode(string_view _data)
+{
+    if (_data.size() < HeaderSize || _data.substr(0, Magic.size()) != Magic)
+        throw runtime_error{"Not a session recording."};
+
+    if (static_cast<uint8_t>(_data[Magic.size()]) != Version)
+        throw runtime_error{"Unsupported session recording version "s + to_string(static_cast<uint8_t>(_data[Magic.size()])) + "."};
+
+    auto const u16 = [&](size_t _offset) {
+        return static_cast<int>(static_cast<uint8_t>(_data[_offset]))
+             | (static_cast<int>(static_cast<uint8_t>(_data[_offset + 1])) << 8);
+    };
+
+    auto recording = SessionRecording{};
+    recording.size = Size{u16(Magic.size() + 1), u16(Magic.size() + 3)};
+
+    auto decoder = Decoder{_data.substr(HeaderSize)};
+    auto time = microseconds::zero();
+    while (!decoder.atEnd())
+    {
+        auto const type = decoder.byte();
+        auto const delta = decoder.varInt();
+        if (!delta)
+            break;
+
+        auto event = RecordingEvent{};
+        event.time = time += microseconds(*delta);
+
+        switch (static_cast<RecordingEventType>(*type))
+        {
+            case RecordingEventType::Output:
+            {
+                auto const length = decoder.varInt();
+                auto const output = length ? decoder.bytes(*length) : nullopt;
+                if (!output)
+                    return recording;
+                event.type = RecordingEventType::Output;
+                event.output = string(*output);
+                break;
+            }
+            case RecordingEventType::Resize:
+            {
+                auto const columns = decoder.varInt();
+                auto const rows = decoder.varInt();
+                if (!rows)
+                    return recording;
+                event.type = RecordingEventType::Resize;
+                event.size = Size{static_cast<int>(*columns), static_cast<int>(*rows)};
+                break;
+            }
+            default:
+                throw runtime_error{"Invalid session recording event type "s + to_string(*type) + "."};
+        }
+
+        recording.events.emplace_back(move(event));
+    }
+
+    return recording;
+}
+// }}}
+
+} // end namespace
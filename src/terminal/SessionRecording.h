@@ -0,0 +1,147 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/Size.h>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace terminal {
+
+// A session recording is a compact binary file, consisting of a header followed by a sequence
+// of events:
+//
+//   header := "CREC" VERSION:u8 COLUMNS:u16le ROWS:u16le
+//   event  := TYPE:u8 DELTA:varint PAYLOAD
+//
+// DELTA is the time in microseconds since the previous event (or the start of the recording).
+// The payload of an Output event is LENGTH:varint followed by the raw PTY output bytes,
+// and the one of a Resize event is COLUMNS:varint ROWS:varint.
+
+enum class RecordingEventType : uint8_t {
+    Output = 1,
+    Resize = 2,
+};
+
+struct RecordingEvent {
+    RecordingEventType type;
+    std::chrono::microseconds time;     // time since the start of the recording
+    std::string output;                 // raw PTY output, for Output events
+    Size size;                          // new screen size, for Resize events
+};
+
+struct SessionRecorderStats {
+    uint64_t events = 0;                // number of recorded events
+    uint64_t bytesRecorded = 0;         // number of encoded bytes handed to the writer
+    uint64_t bytesWritten = 0;          // number of encoded bytes written to the file
+    size_t maxBacklog = 0;              // largest number of bytes waiting for the writer
+};
+
+/// Records raw PTY output and screen resizes of a terminal session into a file.
+///
+/// Recording only appends the encoded event to an in-memory buffer, which is written
+/// to the file by a background thread, so that recording does not slow down the PTY reader.
+class SessionRecorder {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    /// Creates the recording file at @p _path.
+    ///
+    /// @throws std::runtime_error if the file could not be created.
+    SessionRecorder(std::string const& _path, Size _size, clock::time_point _start = clock::now());
+
+    /// Writes all pending events to the file and closes it.
+    ~SessionRecorder();
+
+    SessionRecorder(SessionRecorder const&) = delete;
+    SessionRecorder& operator=(SessionRecorder const&) = delete;
+
+    std::string const& path() const noexcept { return path_; }
+
+    void output(clock::time_point _now, char const* _data, size_t _size);
+    void resize(clock::time_point _now, Size _size);
+
+    SessionRecorderStats stats() const;
+
+  private:
+    void beginEvent(RecordingEventType _type, clock::time_point _now);
+    void endEvent(std::unique_lock<std::mutex>& _lock, size_t _offset);
+    void writerThread();
+
+    std::string path_;
+    std::ofstream file_;
+
+    std::mutex mutable lock_;           // guards the fields below.
+    std::condition_variable eventsAvailable_;
+    clock::time_point lastEvent_;
+    std::string pending_;               // encoded events not yet handed to the writer thread.
+    bool terminating_ = false;
+    SessionRecorderStats stats_;
+
+    std::thread writer_;
+};
+
+/// An entire session recording, as loaded from a file.
+struct SessionRecording {
+    Size size;                          // initial screen size
+    std::vector<RecordingEvent> events;
+
+    /// @returns total number of PTY output bytes in this recording.
+    uint64_t outputBytes() const noexcept;
+
+    /// Loads the recording from @p _path.
+    ///
+    /// @throws std::runtime_error if the file could not be read or is not a valid recording.
+    static SessionRecording load(std::string const& _path);
+
+    /// Decodes a recording from its file contents.
+    ///
+    /// Truncated trailing events, as left behind by a crashed recorder, are ignored.
+    ///
+    /// @throws std::runtime_error if @p _data is not a valid recording.
+    static SessionRecording decode(std::string_view _data);
+};
+
+} // end namespace
+
+namespace fmt // {{{
+{
+    template <>
+    struct formatter<terminal::SessionRecorderStats> {
+        template <typename ParseContext>
+        constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+        template <typename FormatContext>
+        auto format(terminal::SessionRecorderStats const& _stats, FormatContext& ctx)
+        {
+            return format_to(
+                ctx.out(),
+                "events: {}, recorded: {} bytes, written: {} bytes, max backlog: {} bytes",
+                _stats.events,
+                _stats.bytesRecorded,
+                _stats.bytesWritten,
+                _stats.maxBacklog
+            );
+        }
+    };
+} // }}}
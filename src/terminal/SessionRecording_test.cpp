@@ -0,0 +1,97 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/SessionRecording.h>
+
+#include <crispy/stdfs.h>
+
+#include <catch2/catch.hpp>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace std;
+using namespace std::chrono;
+using namespace terminal;
+
+namespace {
+    string tempRecordingPath()
+    {
+        return (FileSystem::temp_directory_path() / "libterminal_test.rec").string();
+    }
+
+    string readFile(string const& _path)
+    {
+        auto file = ifstream{_path, ios::binary};
+        return string{istreambuf_iterator<char>(file), istreambuf_iterator<char>()};
+    }
+}
+
+TEST_CASE("SessionRecording.roundtrip", "[recording]")
+{
+    auto const path = tempRecordingPath();
+    auto const start = steady_clock::now();
+
+    {
+        auto recorder = SessionRecorder{path, Size{80, 25}, start};
+        recorder.output(start + milliseconds(1), "Hello", 5);
+        recorder.resize(start + milliseconds(20), Size{132, 50});
+        recorder.output(start + seconds(3), "\033[1mWorld\033[m", 12);
+
+        auto const stats = recorder.stats();
+        CHECK(stats.events == 3);
+    }
+
+    auto const recording = SessionRecording::load(path);
+    CHECK(recording.size == Size{80, 25});
+    REQUIRE(recording.events.size() == 3);
+
+    CHECK(recording.events[0].type == RecordingEventType::Output);
+    CHECK(recording.events[0].time == milliseconds(1));
+    CHECK(recording.events[0].output == "Hello");
+
+    CHECK(recording.events[1].type == RecordingEventType::Resize);
+    CHECK(recording.events[1].time == milliseconds(20));
+    CHECK(recording.events[1].size == Size{132, 50});
+
+    CHECK(recording.events[2].type == RecordingEventType::Output);
+    CHECK(recording.events[2].time == seconds(3));
+    CHECK(recording.events[2].output == "\033[1mWorld\033[m");
+
+    CHECK(recording.outputBytes() == 17);
+
+    FileSystem::remove(path);
+}
+
+TEST_CASE("SessionRecording.truncated", "[recording]")
+{
+    auto const path = tempRecordingPath();
+    auto const start = steady_clock::now();
+
+    {
+        auto recorder = SessionRecorder{path, Size{80, 25}, start};
+        recorder.output(start, "first", 5);
+        recorder.output(start, "second", 6);
+    }
+
+    auto const data = readFile(path);
+    FileSystem::remove(path);
+
+    // A partially written last event is dropped.
+    auto const recording = SessionRecording::decode(string_view(data).substr(0, data.size() - 2));
+    REQUIRE(recording.events.size() == 1);
+    CHECK(recording.events[0].output == "first");
+
+    CHECK_THROWS(SessionRecording::decode("not a recording"));
+}
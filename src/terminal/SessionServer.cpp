@@ -0,0 +1,554 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/SessionServer.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using std::array;
+using std::lock_guard;
+using std::max;
+using std::min;
+using std::nullopt;
+using std::optional;
+using std::runtime_error;
+using std::string;
+using std::string_view;
+using std::unique_ptr;
+using std::vector;
+
+using namespace std::string_literals;
+
+namespace terminal {
+
+namespace {
+    constexpr uint8_t CopiedRow = 0x80;
+
+    /// Largest number of history lines sent per FetchHistory request.
+    constexpr int MaxHistoryChunk = 4096;
+
+    array<int, 2> makePipe()
+    {
+        auto fds = array<int, 2>{-1, -1};
+        if (pipe(fds.data()) < 0)
+            throw runtime_error{"Could not create session server wakeup pipe: "s + strerror(errno)};
+        for (int const fd : fds)
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        return fds;
+    }
+
+    /// @returns the user id of the process connected to the socket @p _fd, if known.
+    optional<uid_t> peerUserId(int _fd)
+    {
+#if defined(__linux__)
+        auto credentials = ucred{};
+        auto size = socklen_t{sizeof(credentials)};
+        if (getsockopt(_fd, SOL_SOCKET, SO_PEERCRED, &credentials, &size) < 0)
+            return nullopt;
+        return credentials.uid;
+#else
+        auto uid = uid_t{};
+        auto gid = gid_t{};
+        if (getpeereid(_fd, &uid, &gid) < 0)
+            return nullopt;
+        return uid;
+#endif
+    }
+
+    void encodeLine(string& _output, Line const& _line)
+    {
+        auto encoder = SessionEncoder{_output};
+        encoder.byte(static_cast<uint8_t>(_line.flags()));
+        encoder.cells(_line.begin(), _line.end());
+    }
+}
+
+SessionServer::SessionServer(unique_ptr<Pty> _pty, optional<size_t> _maxHistoryLineCount) :
+    wakeupPipe_{ makePipe() },
+    terminal_{ move(_pty), *this, _maxHistoryLineCount }
+{
+}
+
+SessionServer::~SessionServer()
+{
+    for (auto& client : clients_)
+        disconnect(*client);
+
+    if (listener_ >= 0)
+    {
+        ::close(listener_);
+        unlink(socketPath_.c_str());
+    }
+
+    // The terminal (and thus its threads calling wakeup()) is only destroyed after this,
+    // which is why the pipe stays open.
+}
+
+void SessionServer::listen(string const& _path)
+{
+    auto address = sockaddr_un{};
+    if (_path.size() >= sizeof(address.sun_path))
+        throw runtime_error{"Session socket path too long: "s + _path};
+
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, _path.c_str(), sizeof(address.sun_path) - 1);
+
+    listener_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener_ < 0)
+        throw runtime_error{"Could not create session socket: "s + strerror(errno)};
+
+    // The socket gives full control over the session, so only its owner may connect to it.
+    // Nobody can connect before listen(), so restricting the permissions after bind() is not racy.
+    unlink(_path.c_str());
+    if (bind(listener_, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) < 0
+            || chmod(_path.c_str(), S_IRUSR | S_IWUSR) < 0
+            || ::listen(listener_, 8) < 0)
+    {
+        auto const error = "Could not listen on session socket "s + _path + ": " + strerror(errno);
+        ::close(listener_);
+        unlink(_path.c_str());
+        listener_ = -1;
+        throw runtime_error{error};
+    }
+
+    socketPath_ = _path;
+}
+
+void SessionServer::addClient(int _fd)
+{
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+    auto client = std::make_unique<Client>();
+    client->fd = _fd;
+    clients_.emplace_back(move(client));
+}
+
+void SessionServer::stop()
+{
+    stopping_ = true;
+    wakeup();
+}
+
+// {{{ Terminal::Events
+void SessionServer::screenUpdated()
+{
+    wakeup();
+}
+
+void SessionServer::setWindowTitle(string_view const& /*_title*/)
+{
+    wakeup();
+}
+
+void SessionServer::onClosed()
+{
+    closed_ = true;
+    wakeup();
+}
+// }}}
+
+void SessionServer::wakeup()
+{
+    if (!wakeupPending_.exchange(true))
+    {
+        char const ch = 0;
+        [[maybe_unused]] auto const _ = write(wakeupPipe_[1], &ch, 1);
+    }
+}
+
+void SessionServer::run()
+{
+    auto fds = vector<pollfd>{};
+
+    while (!stopping_)
+    {
+        for (auto& client : clients_)
+        {
+            if (client->attached && client->dirty && client->output.empty())
+                update(*client);
+
+            // Closed is only sent after the final screen update.
+            if (closed_ && !client->closed && !(client->attached && client->dirty))
+            {
+                auto encoder = SessionEncoder{client->output};
+                encoder.begin(SessionMessage::Closed);
+                encoder.end();
+                client->closed = true;
+            }
+
+            if (!client->output.empty() && !flush(*client))
+                disconnect(*client);
+        }
+
+        clients_.erase(std::remove_if(clients_.begin(), clients_.end(), [](auto const& c) { return c->fd < 0; }),
+                       clients_.end());
+
+        if (closed_ && std::all_of(clients_.begin(), clients_.end(),
+                                   [](auto const& c) { return c->closed && c->output.empty(); }))
+            break;
+
+        fds.clear();
+        fds.emplace_back(pollfd{wakeupPipe_[0], POLLIN, 0});
+        if (listener_ >= 0)
+            fds.emplace_back(pollfd{listener_, POLLIN, 0});
+        for (auto const& client : clients_)
+            fds.emplace_back(pollfd{client->fd, static_cast<short>(POLLIN | (client->output.empty() ? 0 : POLLOUT)), 0});
+
+        if (poll(fds.data(), fds.size(), -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw runtime_error{"Session server failed to poll: "s + strerror(errno)};
+        }
+
+        auto fd = fds.begin();
+        if (fd->revents & POLLIN)
+        {
+            char buf[64];
+            while (read(wakeupPipe_[0], buf, sizeof(buf)) > 0)
+                ;
+            wakeupPending_ = false;
+            for (auto& client : clients_)
+                client->dirty = true;
+        }
+        ++fd;
+
+        if (listener_ >= 0)
+        {
+            if (fd->revents & POLLIN)
+                accept();
+            ++fd;
+        }
+
+        // Clients accepted just now are not polled yet, and thus not part of fds.
+        for (size_t i = 0; fd != fds.end(); ++i, ++fd)
+        {
+            auto& client = *clients_[i];
+            if (fd->revents & POLLIN && !receive(client))
+                disconnect(client);
+            else if (fd->revents & (POLLERR | POLLHUP | POLLNVAL))
+                disconnect(client);
+        }
+    }
+}
+
+void SessionServer::accept()
+{
+    auto const fd = ::accept4(listener_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    // Also checked here, in case the socket's permissions have been changed after the fact.
+    if (peerUserId(fd) != getuid())
+    {
+        ::close(fd);
+        return;
+    }
+
+    addClient(fd);
+}
+
+bool SessionServer::receive(Client& _client)
+{
+    char buf[4096];
+    for (;;)
+    {
+        auto const n = read(_client.fd, buf, sizeof(buf));
+        if (n > 0)
+            _client.input.append(buf, static_cast<size_t>(n));
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else
+            return false;
+    }
+
+    try
+    {
+        auto input = string_view{_client.input};
+        while (_client.fd >= 0)
+        {
+            auto const frame = takeFrame(input);
+            if (!frame)
+                break;
+            handle(_client, *frame);
+        }
+        _client.input.erase(0, _client.input.size() - input.size());
+    }
+    catch (runtime_error const&)
+    {
+        return false; // malformed input, the client is not speaking our protocol
+    }
+
+    return _client.fd >= 0;
+}
+
+void SessionServer::handle(Client& _client, SessionFrame const& _frame)
+{
+    auto decoder = SessionDecoder{_frame.payload};
+    switch (_frame.type)
+    {
+        case SessionMessage::Attach:
+        case SessionMessage::Resize:
+        {
+            auto const columns = decoder.integer(0xFFFF);
+            auto const rows = decoder.integer(0xFFFF);
+            if (columns > 0 && rows > 0 && Size{columns, rows} != terminal_.screenSize())
+                terminal_.resizeScreen(Size{columns, rows}, nullopt);
+
+            if (_frame.type == SessionMessage::Attach)
+            {
+                // Forget what the client might have had, and send it the visible page.
+                _client.attached = true;
+                _client.pageSize = Size{};
+                _client.historyLineCount = -1;
+                _client.rows.clear();
+                _client.cursor.clear();
+                _client.modes.clear();
+                _client.title.clear();
+                _client.hyperlinks.clear();
+            }
+            _client.dirty = true;
+            break;
+        }
+        case SessionMessage::Input:
+            terminal_.sendRaw(_frame.payload);
+            break;
+        case SessionMessage::FetchHistory:
+        {
+            auto const before = decoder.varint();
+            auto const count = decoder.integer(MaxHistoryChunk * 16);
+            sendHistory(_client, before, min(count, MaxHistoryChunk));
+            break;
+        }
+        case SessionMessage::Detach:
+            disconnect(_client);
+            break;
+        default:
+            break; // messages of newer clients are ignored
+    }
+}
+
+void SessionServer::sendHyperlinks(Client& _client, Line const& _line)
+{
+    auto const& hyperlinks = terminal_.screen().hyperlinks();
+    auto encoder = SessionEncoder{_client.output};
+    for (Cell const& cell : _line)
+    {
+        if (cell.hyperlink() == 0)
+            continue;
+        auto const info = hyperlinks.at(cell.hyperlink());
+        auto const uri = info ? string_view{info->uri} : string_view{};
+        if (auto& sent = _client.hyperlinks[cell.hyperlink()]; sent != uri)
+        {
+            sent = uri;
+            encoder.begin(SessionMessage::Hyperlink);
+            encoder.varint(cell.hyperlink());
+            encoder.bytes(uri);
+            encoder.end();
+        }
+    }
+}
+
+void SessionServer::sendHistory(Client& _client, LineId _before, int _count)
+{
+    auto _l = lock_guard{terminal_};
+    auto const& grid = terminal_.screen().grid();
+
+    auto const end = [&]() -> optional<int> {
+        if (_before == 0)
+            return grid.historyLineCount();
+        return grid.absoluteLineOf(_before);
+    }();
+    auto const begin = end.has_value() ? max(0, min(*end, grid.historyLineCount()) - _count) : 0;
+    auto const count = end.has_value() ? min(*end, grid.historyLineCount()) - begin : 0;
+
+    // The ids of hyperlinks may have been reused since the client has last seen them.
+    for (int line = begin; line < begin + count; ++line)
+        sendHyperlinks(_client, grid.absoluteLineAt(line));
+
+    auto encoder = SessionEncoder{_client.output};
+    encoder.begin(SessionMessage::History);
+    encoder.varint(_before);
+    encoder.varint(static_cast<uint64_t>(max(count, 0)));
+    for (int line = begin; line < begin + count; ++line)
+    {
+        auto const& source = grid.absoluteLineAt(line);
+        encoder.varint(source.id());
+        encodeLine(_client.output, source);
+    }
+    encoder.end();
+}
+
+void SessionServer::update(Client& _client)
+{
+    auto _l = lock_guard{terminal_};
+    auto const& screen = terminal_.screen();
+    auto const pageSize = screen.size();
+    auto const historyLineCount = screen.historyLineCount();
+    auto const primaryScreen = screen.isPrimaryScreen();
+
+    _client.dirty = false;
+    auto encoder = SessionEncoder{_client.output};
+
+    // {{{ page
+    if (pageSize != _client.pageSize
+            || historyLineCount != _client.historyLineCount
+            || primaryScreen != _client.primaryScreen)
+    {
+        encoder.begin(SessionMessage::Page);
+        encoder.varint(static_cast<uint64_t>(pageSize.width));
+        encoder.varint(static_cast<uint64_t>(pageSize.height));
+        encoder.varint(static_cast<uint64_t>(historyLineCount));
+        encoder.byte(primaryScreen ? 1 : 0);
+        encoder.end();
+
+        if (pageSize != _client.pageSize)
+            _client.rows.assign(static_cast<size_t>(pageSize.height), Row{});
+
+        _client.pageSize = pageSize;
+        _client.historyLineCount = historyLineCount;
+        _client.primaryScreen = primaryScreen;
+    }
+    // }}}
+
+    // {{{ rows
+    rowsFrame_.clear();
+    auto rowsEncoder = SessionEncoder{rowsFrame_};
+    auto rowCount = 0;
+    rows_.resize(_client.rows.size());
+
+    for (int row = 1; row <= pageSize.height; ++row)
+    {
+        auto const& line = screen.grid().lineAt(row);
+        auto& previous = _client.rows[static_cast<size_t>(row - 1)];
+
+        rowData_.clear();
+        encodeLine(rowData_, line);
+
+        rows_[static_cast<size_t>(row - 1)].id = line.id();
+        rows_[static_cast<size_t>(row - 1)].data.assign(rowData_);
+
+        if (previous.id == line.id() && previous.data == rowData_)
+            continue;
+
+        sendHyperlinks(_client, line);
+
+        rowsEncoder.varint(static_cast<uint64_t>(row));
+        rowsEncoder.varint(line.id());
+
+        // Lines scrolled up (or down) are referred to by where the client had them before.
+        auto const source = std::find_if(_client.rows.begin(), _client.rows.end(), [&](Row const& _row) {
+            return _row.id == line.id() && _row.data == rowData_;
+        });
+        if (source != _client.rows.end())
+        {
+            rowsEncoder.byte(static_cast<uint8_t>(rowData_.front()) | CopiedRow);
+            rowsEncoder.varint(static_cast<uint64_t>(std::distance(_client.rows.begin(), source) + 1));
+        }
+        else
+            rowsFrame_.append(rowData_);
+
+        ++rowCount;
+    }
+    std::swap(_client.rows, rows_);
+
+    if (rowCount != 0)
+    {
+        encoder.begin(SessionMessage::Rows);
+        encoder.varint(static_cast<uint64_t>(rowCount));
+        _client.output.append(rowsFrame_);
+        encoder.end();
+    }
+    // }}}
+
+    // {{{ cursor, modes, title
+    auto const& cursor = screen.cursor();
+    rowData_.clear();
+    auto state = SessionEncoder{rowData_};
+    state.begin(SessionMessage::Cursor);
+    state.varint(static_cast<uint64_t>(cursor.position.row));
+    state.varint(static_cast<uint64_t>(cursor.position.column));
+    state.byte(cursor.visible ? 1 : 0);
+    state.byte(static_cast<uint8_t>(terminal_.cursorShape()));
+    state.byte(static_cast<uint8_t>(terminal_.cursorDisplay()));
+    state.end();
+    if (rowData_ != _client.cursor)
+    {
+        _client.output.append(rowData_);
+        _client.cursor = rowData_;
+    }
+
+    rowData_.clear();
+    state.begin(SessionMessage::Modes);
+    auto const enabled = std::count_if(std::begin(SessionModes), std::end(SessionModes),
+                                       [&](DECMode _mode) { return screen.isModeEnabled(_mode); });
+    state.varint(static_cast<uint64_t>(enabled));
+    for (DECMode const mode : SessionModes)
+        if (screen.isModeEnabled(mode))
+            state.varint(static_cast<uint64_t>(mode));
+    state.end();
+    if (rowData_ != _client.modes)
+    {
+        _client.output.append(rowData_);
+        _client.modes = rowData_;
+    }
+
+    if (screen.windowTitle() != _client.title)
+    {
+        _client.title = screen.windowTitle();
+        encoder.begin(SessionMessage::Title);
+        _client.output.append(_client.title);
+        encoder.end();
+    }
+    // }}}
+}
+
+bool SessionServer::flush(Client& _client)
+{
+    while (!_client.output.empty())
+    {
+        auto const n = send(_client.fd, _client.output.data(), _client.output.size(), MSG_NOSIGNAL);
+        if (n > 0)
+            _client.output.erase(0, static_cast<size_t>(n));
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else
+            return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+    return true;
+}
+
+void SessionServer::disconnect(Client& _client)
+{
+    if (_client.fd >= 0)
+    {
+        ::close(_client.fd);
+        _client.fd = -1;
+    }
+    _client.output.clear();
+    _client.closed = true;
+}
+
+} // namespace terminal
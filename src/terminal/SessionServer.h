@@ -0,0 +1,123 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/SessionProtocol.h>
+#include <terminal/Terminal.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace terminal {
+
+/// Hosts a Terminal, i.e. its PTY, screen and scrollback, for clients connecting via a local socket,
+/// such that GUI windows can be closed (or crash) and attach to the session again later.
+///
+/// Clients are kept up to date with deltas of the visible page (see SessionProtocol.h).
+/// For each client, the server remembers the encoded rows it has last sent, so that a screen update
+/// only sends the rows that actually changed. While a client has not yet received all data sent to it,
+/// no further updates are composed for it, which coalesces the updates for slow clients.
+class SessionServer : private Terminal::Events {
+  public:
+    /// Starts the terminal on @p _pty.
+    explicit SessionServer(std::unique_ptr<Pty> _pty, std::optional<size_t> _maxHistoryLineCount = std::nullopt);
+    ~SessionServer() override;
+
+    SessionServer(SessionServer const&) = delete;
+    SessionServer& operator=(SessionServer const&) = delete;
+
+    /// Only access the terminal's screen when having it locked.
+    Terminal& terminal() noexcept { return terminal_; }
+
+    /// Accepts clients on a Unix domain socket at @p _path, replacing any stale socket file.
+    ///
+    /// The socket is only accessible by the current user, and clients of other users are rejected.
+    ///
+    /// @throws std::runtime_error if the socket could not be created.
+    void listen(std::string const& _path);
+
+    /// Adds a connected client socket, taking ownership of it.
+    void addClient(int _fd);
+
+    /// Serves the clients until the application has terminated or stop() is called.
+    void run();
+
+    /// Makes run() return. May be called from any thread.
+    void stop();
+
+    /// Number of connected clients. Only to be called from the thread calling run().
+    size_t clientCount() const noexcept { return clients_.size(); }
+
+  private:
+    struct Row {
+        LineId id = 0;
+        std::string data;   // encoded flags and cells, as last sent
+    };
+
+    struct Client {
+        int fd = -1;
+        bool attached = false;
+        bool dirty = false;                 // the screen changed since the last update was composed
+        bool closed = false;                // Closed has been sent
+        std::string input;                  // received bytes not yet processed
+        std::string output;                 // encoded frames not yet sent
+        Size pageSize{};
+        int historyLineCount = -1;
+        bool primaryScreen = true;
+        std::vector<Row> rows;
+        std::string cursor;
+        std::string modes;
+        std::string title;
+        std::unordered_map<HyperlinkId, std::string> hyperlinks;    // URIs of hyperlink ids as sent
+    };
+
+    // Terminal::Events
+    void screenUpdated() override;
+    void setWindowTitle(std::string_view const& _title) override;
+    void onClosed() override;
+
+    void wakeup();
+    void accept();
+    bool receive(Client& _client);
+    void handle(Client& _client, SessionFrame const& _frame);
+    void sendHyperlinks(Client& _client, Line const& _line);
+    void sendHistory(Client& _client, LineId _before, int _count);
+    void update(Client& _client);
+    bool flush(Client& _client);
+    void disconnect(Client& _client);
+
+    std::array<int, 2> wakeupPipe_;     // written to by the terminal's threads to wake up run()
+    std::atomic<bool> wakeupPending_{false};
+    std::atomic<bool> closed_{false};       // the application has terminated
+    std::atomic<bool> stopping_{false};
+
+    int listener_ = -1;
+    std::string socketPath_;
+    std::vector<std::unique_ptr<Client>> clients_;
+
+    // scratch buffers, reused across updates
+    std::string rowsFrame_;
+    std::string rowData_;
+    std::vector<Row> rows_;
+
+    // Destroyed first, as its threads call into this object.
+    Terminal terminal_;
+};
+
+} // namespace terminal
@@ -0,0 +1,247 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/SessionClient.h>
+#include <terminal/SessionProtocol.h>
+#include <terminal/SessionServer.h>
+#include <terminal/pty/MockPty.h>
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace std::chrono;
+using namespace terminal;
+
+namespace {
+    /// Receives from the server until @p _condition holds, giving up after a few seconds.
+    template <typename Condition>
+    bool receiveUntil(SessionClient& _client, Condition _condition)
+    {
+        auto const deadline = steady_clock::now() + seconds(5);
+        while (!_condition())
+            if (steady_clock::now() > deadline || !_client.receive(milliseconds(50)))
+                return _condition();
+        return true;
+    }
+
+    string text(SessionLine const& _line)
+    {
+        auto s = _line.toUtf8();
+        return s.substr(0, s.find_last_not_of(' ') + 1);
+    }
+}
+
+TEST_CASE("SessionProtocol.cells", "[session]")
+{
+    auto attributes = GraphicsAttributes{};
+    attributes.foregroundColor = RGBColor{1, 2, 3};
+    attributes.backgroundColor = IndexedColor::Blue;
+    attributes.styles = CharacterStyleMask::Bold;
+
+    auto line = vector<Cell>(8);
+    line[0] = Cell{'a', attributes};
+    line[1] = Cell{'b', attributes};
+    line[1].setHyperlink(7);
+    line[2].setCharacter(0x1F600);
+    line[2].setWidth(2);
+    line[4] = Cell{'e', {}};
+    line[4].appendCharacter(0x301);
+
+    auto data = string{};
+    auto encoder = SessionEncoder{data};
+    encoder.begin(SessionMessage::Rows);
+    encoder.cells(line.begin(), line.end());
+    encoder.end();
+
+    auto input = string_view{data};
+    auto const frame = takeFrame(input);
+    REQUIRE(frame.has_value());
+    CHECK(frame->type == SessionMessage::Rows);
+    CHECK(input.empty());
+
+    auto decoded = vector<Cell>{};
+    auto decoder = SessionDecoder{frame->payload};
+    decoder.cells(decoded, 8);
+    CHECK(decoder.atEnd());
+
+    REQUIRE(decoded.size() == line.size());
+    for (size_t i = 0; i < line.size(); ++i)
+    {
+        INFO("column " << i + 1);
+        CHECK(decoded[i] == line[i]);
+        CHECK(decoded[i].width() == line[i].width());
+        CHECK(decoded[i].hyperlink() == line[i].hyperlink());
+    }
+
+    // incomplete frames are left in the input
+    auto partial = string_view{data}.substr(0, data.size() - 1);
+    CHECK_FALSE(takeFrame(partial).has_value());
+    CHECK(partial.size() == data.size() - 1);
+
+    // truncated payloads are rejected
+    auto truncated = SessionDecoder{frame->payload.substr(0, frame->payload.size() - 1)};
+    CHECK_THROWS_AS(truncated.cells(decoded, 8), runtime_error);
+}
+
+TEST_CASE("SessionServer.attach", "[session]")
+{
+    auto const socketPath = "/tmp/libterminal-session-test-" + to_string(getpid()) + ".sock";
+
+    auto pty = make_unique<MockPty>(Size{20, 5});
+    auto& mockPty = *pty;
+    auto server = SessionServer{move(pty)};
+    server.listen(socketPath);
+    auto serverThread = thread{[&]() { server.run(); }};
+
+    mockPty.appendStdOut("\033]2;title\033\\\033[?2004hhello\r\nworld");
+
+    auto client = SessionClient::connect(socketPath);
+    client->attach(Size{20, 5});
+    REQUIRE(receiveUntil(*client, [&]() { return client->page().size() == 5 && text(client->page()[1]) == "world"; }));
+    CHECK(text(client->page()[0]) == "hello");
+    CHECK(client->cursorPosition() == Coordinate{2, 6});
+    CHECK(client->isModeEnabled(DECMode::BracketedPaste));
+    CHECK_FALSE(client->isModeEnabled(DECMode::MouseSGR));
+    REQUIRE(receiveUntil(*client, [&]() { return client->windowTitle() == "title"; }));
+
+    SECTION("deltas")
+    {
+        // only the changed row is sent
+        auto const rows = client->rowsReceived();
+        mockPty.appendStdOut("!");
+        REQUIRE(receiveUntil(*client, [&]() { return text(client->page()[1]) == "world!"; }));
+        CHECK(client->rowsReceived() == rows + 1);
+
+        // scrolled rows are copied from where the client had them before
+        auto const bytes = client->bytesReceived();
+        mockPty.appendStdOut("\r\n\r\n\r\n\r\n");
+        REQUIRE(receiveUntil(*client, [&]() { return client->historyLineCount() == 1; }));
+        REQUIRE(receiveUntil(*client, [&]() { return text(client->page()[0]) == "world!"; }));
+        CHECK(client->bytesReceived() - bytes < 128);
+
+        // history is only sent when asked for, after processing the input sent before
+        CHECK(client->history().empty());
+        client->sendInput("ls\r");
+        client->fetchHistory(0, 10);
+        REQUIRE(receiveUntil(*client, [&]() { return client->history().size() == 1; }));
+        CHECK(text(client->history().begin()->second) == "hello");
+        CHECK(mockPty.stdinBuffer() == "ls\r");
+    }
+
+    SECTION("reattach")
+    {
+        client->detach();
+        client.reset();
+
+        mockPty.appendStdOut("!");
+
+        client = SessionClient::connect(socketPath);
+        client->attach(Size{20, 5});
+        REQUIRE(receiveUntil(*client, [&]() { return client->page().size() == 5 && text(client->page()[1]) == "world!"; }));
+        CHECK(text(client->page()[0]) == "hello");
+        CHECK(client->cursorPosition() == Coordinate{2, 7});
+        CHECK(client->windowTitle() == "title");
+    }
+
+    SECTION("history hyperlinks")
+    {
+        // The link scrolls into the history while no client is attached.
+        client->detach();
+        client.reset();
+        mockPty.appendStdOut("\r\n\033]8;;https://example.org/\033\\link\033]8;;\033\\\r\n\r\n\r\n\r\n\r\n");
+
+        client = SessionClient::connect(socketPath);
+        client->attach(Size{20, 5});
+        REQUIRE(receiveUntil(*client, [&]() { return client->historyLineCount() == 3; }));
+        client->fetchHistory(0, 10);
+        REQUIRE(receiveUntil(*client, [&]() { return client->history().size() == 3; }));
+
+        auto const& line = prev(client->history().end())->second;
+        REQUIRE(text(line) == "link");
+        REQUIRE(line.cells[0].hyperlink() != 0);
+        auto const uri = client->hyperlink(line.cells[0].hyperlink());
+        REQUIRE(uri != nullptr);
+        CHECK(*uri == "https://example.org/");
+    }
+
+    SECTION("resize")
+    {
+        client->resize(Size{10, 3});
+        REQUIRE(receiveUntil(*client, [&]() { return client->pageSize() == Size{10, 3}; }));
+        CHECK(server.terminal().screenSize() == Size{10, 3});
+    }
+
+    mockPty.close();
+    REQUIRE(receiveUntil(*client, [&]() { return client->closed(); }));
+    serverThread.join();
+}
+
+TEST_CASE("SessionServer.listen", "[session]")
+{
+    auto const socketPath = "/tmp/libterminal-session-test-" + to_string(getpid()) + ".sock";
+
+    auto pty = make_unique<MockPty>(Size{20, 5});
+    auto& mockPty = *pty;
+    auto server = SessionServer{move(pty)};
+    server.listen(socketPath);
+
+    // only the owner may connect
+    struct stat st{};
+    REQUIRE(stat(socketPath.c_str(), &st) == 0);
+    CHECK((st.st_mode & 0777) == 0600);
+
+    // clients of other users are rejected, even if the socket's permissions were widened
+    if (getuid() == 0)
+    {
+        auto serverThread = thread{[&]() { server.run(); }};
+        REQUIRE(chmod(socketPath.c_str(), 0666) == 0);
+
+        auto const child = fork();
+        REQUIRE(child >= 0);
+        if (child == 0)
+        {
+            if (setgid(65534) < 0 || setuid(65534) < 0)
+                _exit(2);
+            auto address = sockaddr_un{};
+            address.sun_family = AF_UNIX;
+            strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+            auto const fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (connect(fd, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) < 0)
+                _exit(3);
+            auto pfd = pollfd{fd, POLLIN, 0};
+            char ch{};
+            _exit(poll(&pfd, 1, 5000) == 1 && read(fd, &ch, 1) == 0 ? 0 : 1);
+        }
+
+        int status = 0;
+        REQUIRE(waitpid(child, &status, 0) == child);
+        CHECK(WIFEXITED(status));
+        CHECK(WEXITSTATUS(status) == 0);
+
+        server.stop();
+        serverThread.join();
+    }
+
+    mockPty.close();
+}
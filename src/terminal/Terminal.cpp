@@ -19,7 +19,11 @@
 #include <crispy/escape.h>
 #include <crispy/stdfs.h>
 #include <crispy/debuglog.h>
+#include <crispy/metrics.h>
+#include <crispy/trace.h>
 
+#include <algorithm>
+#include <cassert>
 #include <chrono>
 #include <utility>
 
@@ -45,7 +49,8 @@ Terminal::Terminal(std::unique_ptr<Pty> _pty,
                    string const& _wordDelimiters,
                    Size _maxImageSize,
                    int _maxImageColorRegisters,
-                   bool _sixelCursorConformance
+                   bool _sixelCursorConformance,
+                   ParserPool* _parserPool
 ) :
     changes_{ 0 },
     eventListener_{ _eventListener },
@@ -68,37 +73,488 @@ Terminal::Terminal(std::unique_ptr<Pty> _pty,
         _maxImageColorRegisters,
         _sixelCursorConformance
     },
-    screenUpdateThread_{ [this]() { screenUpdateThread(); } },
-    viewport_{ screen_ }
+    ptyBuffer_{ PtyBufferCapacity },
+    parserPool_{ _parserPool },
+    viewport_{ screen_ },
+    linkDetector_{ screen_.hyperlinks() }
 {
+    if (parserPool_)
+        parserPoolId_ = parserPool_->add(*this);
+    else
+        parserThread_ = std::thread{ [this]() { parserThread(); } };
+
+#if defined(__linux__)
+    if (pty_->pollableHandle() >= 0)
+    {
+        auto const id = PtyReactor::get().add(pty_->pollableHandle(), *this);
+        auto _l = lock_guard{ptyBufferLock_};
+        ptyReactorId_ = id;
+    }
+    else
+#endif
+        ptyReaderThread_ = std::thread{ [this]() { ptyReaderThread(); } };
 }
 
 Terminal::~Terminal()
 {
-    screenUpdateThread_.join();
+    unwatchPty();
+
+    {
+        auto _l = lock_guard{ptyBufferLock_};
+        terminating_ = true;
+    }
+    ptyDataAvailable_.notify_all();
+    ptySpaceAvailable_.notify_all();
+
+    if (ptyReaderThread_.joinable())
+        ptyReaderThread_.join();
+
+    if (parserPoolId_.has_value())
+        parserPool_->remove(parserPoolId_.value());
+    else
+        parserThread_.join();
+
+    // Only now that no more screen updates notify it. Destroyed without holding the screen lock,
+    // as its worker takes that lock until it has been joined.
+    auto const search = [this]() {
+        auto const _l = lock_guard{screenLock_};
+        return move(search_);
+    }();
+}
+
+// {{{ PTY output pipeline
+void Terminal::closeDevice()
+{
+    // Output still in flight is dropped along with the PTY, so its hang-up is signaled right here.
+    if (unwatchPty())
+        onPtyClosed();
+
+    pty_->close();
+}
+
+bool Terminal::unwatchPty()
+{
+#if defined(__linux__)
+    auto const id = [this]() {
+        auto _l = lock_guard{ptyBufferLock_};
+        return exchange(ptyReactorId_, nullopt);
+    }();
+
+    // Not under the lock, as this waits for the reactor's running onPtyData(), which takes it as well.
+    if (id.has_value())
+    {
+        PtyReactor::get().remove(id.value());
+        return true;
+    }
+#endif
+    return false;
 }
 
-void Terminal::screenUpdateThread()
+void Terminal::ptyReaderThread()
 {
-    constexpr size_t BufSize = 32 * 1024;
     vector<char> buf;
-    buf.resize(BufSize);
+    buf.resize(PtyReactor::ReadBufferSize);
+
+    for (;;)
+    {
+        auto const n = pty_->read(buf.data(), buf.size());
+        if (n == -1)
+        {
+            onPtyClosed();
+            break;
+        }
+
+        if (!onPtyData(buf.data(), static_cast<size_t>(n)))
+        {
+            auto _l = unique_lock{ptyBufferLock_};
+            ptySpaceAvailable_.wait(_l, [this]() { return !ptyReaderPaused_ || terminating_; });
+            if (terminating_)
+                break;
+        }
+    }
+}
+
+bool Terminal::onPtyData(char const* _data, size_t _size)
+{
+    // The high watermark is kept at least one full read below the capacity, so this always fits.
+    [[maybe_unused]] auto const written = ptyBuffer_.write(_data, _size);
+    assert(written == _size);
+
+    ptyStats_.bytesRead += _size;
+
+    {
+        auto _l = lock_guard{recorderLock_};
+        if (recorder_)
+            recorder_->output(steady_clock::now(), _data, _size);
+    }
+
+    auto const buffered = ptyBuffer_.size();
+    if (buffered > ptyStats_.peakBytesBuffered.load(memory_order_relaxed))
+        ptyStats_.peakBytesBuffered.store(buffered, memory_order_relaxed);
+
+    bool continueReading = true;
+    bool echo = false;
+    {
+        auto _l = lock_guard{ptyBufferLock_};
+        if (inputLatency_.keyPressedAt.has_value() && !inputLatency_.echoEnd)
+        {
+            auto const latency = steady_clock::now() - *inputLatency_.keyPressedAt;
+            if (latency < InputEchoTimeout)
+            {
+                echo = true;
+                inputLatency_.echoEnd = ptyStats_.bytesRead.load();
+                inputLatency_.echoLatency.record(latency);
+                CRISPY_METRICS_RECORD("terminal.input.echo_latency", latency);
+            }
+            else
+            {
+                ++inputLatency_.unanswered;
+                inputLatency_.keyPressedAt.reset();
+            }
+        }
+
+        if (buffered >= ptyBufferLimits_.highWatermark)
+        {
+            continueReading = false;
+            ptyReaderPaused_ = true;
+            ptyReaderPausedAt_ = steady_clock::now();
+            ++ptyStats_.readerPauses;
+        }
+    }
+    // The response to a key press is processed ahead of other terminals' output.
+    notifyParser(echo);
+
+    return continueReading;
+}
+
+void Terminal::onPtyClosed()
+{
+    {
+        auto _l = lock_guard{ptyBufferLock_};
+        ptyClosed_ = true;
+    }
+    notifyParser();
+}
+
+void Terminal::notifyParser(bool _urgent)
+{
+    if (parserPoolId_.has_value())
+        parserPool_->wakeup(parserPoolId_.value(), _urgent);
+    else
+        ptyDataAvailable_.notify_one();
+}
+
+void Terminal::resumePtyReader()
+{
+    auto ptyReactorId = optional<PtyReactor::Id>{};
+    {
+        auto _l = lock_guard{ptyBufferLock_};
+        if (!ptyReaderPaused_ || ptyBuffer_.size() > ptyBufferLimits_.lowWatermark)
+            return;
+
+        ptyReaderPaused_ = false;
+        ptyStats_.readerBlockedNanos += duration_cast<nanoseconds>(steady_clock::now() - ptyReaderPausedAt_).count();
+        ptyReactorId = ptyReactorId_;
+    }
+
+#if defined(__linux__)
+    if (ptyReactorId.has_value())
+        PtyReactor::get().resume(ptyReactorId.value());
+    else
+#endif
+        ptySpaceAvailable_.notify_one();
+}
+
+void Terminal::parserThread()
+{
+    CRISPY_TRACE_THREAD_NAME("parser");
+
+    // Time at which held back screen updates must be presented, even if no more output arrives.
+    // (A plain time point rather than an optional, which trips -Wmaybe-uninitialized.)
+    constexpr auto NoDeadline = steady_clock::time_point::max();
+    auto syncOutputDeadline = NoDeadline;
 
     for (;;)
     {
-        if (auto const n = pty_->read(buf.data(), buf.size()); n != -1)
+        size_t sliceSize = 0;
+        {
+            auto _l = unique_lock{ptyBufferLock_};
+            auto const ready = [this]() { return !ptyBuffer_.empty() || ptyClosed_ || terminating_; };
+            if (syncOutputDeadline == NoDeadline)
+                ptyDataAvailable_.wait(_l, ready);
+            else if (!ptyDataAvailable_.wait_until(_l, syncOutputDeadline, ready))
+            {
+                _l.unlock();
+                syncOutputDeadline = NoDeadline;
+                auto _sl = lock_guard{screenLock_};
+                checkSynchronizedOutputTimeout(steady_clock::now());
+                eventListener_.screenUpdated();
+                continue;
+            }
+            if (terminating_)
+                return;
+            if (ptyBuffer_.empty()) // PTY closed and all of its output processed.
+                break;
+            sliceSize = nextSliceSize();
+        }
+
+        syncOutputDeadline = parseSlice(sliceSize).value_or(NoDeadline);
+    }
+
+    eventListener_.onClosed();
+}
+
+optional<steady_clock::time_point> Terminal::onParserWakeup()
+{
+    size_t sliceSize = 0;
+    {
+        auto _l = unique_lock{ptyBufferLock_};
+        if (terminating_ || parserFinished_)
+            return nullopt;
+
+        if (ptyBuffer_.empty() && !ptyClosed_)
         {
-            //log("outputThread.data: {}", crispy::escape(buf, buf + n));
-            lock_guard<decltype(screenLock_)> _l{ screenLock_ };
-            screen_.write(buf.data(), n);
+            // Woken up either by the synchronized output deadline, or for output processed already.
+            _l.unlock();
+            if (!pooledSyncOutputDeadline_.has_value() || steady_clock::now() < *pooledSyncOutputDeadline_)
+                return pooledSyncOutputDeadline_;
+
+            pooledSyncOutputDeadline_.reset();
+            auto _sl = lock_guard{screenLock_};
+            checkSynchronizedOutputTimeout(steady_clock::now());
+            eventListener_.screenUpdated();
+            return nullopt;
         }
+
+        if (ptyBuffer_.empty()) // PTY closed and all of its output processed.
+            parserFinished_ = true;
         else
+            sliceSize = nextSliceSize();
+    }
+
+    if (parserFinished_)
+    {
+        eventListener_.onClosed();
+        return nullopt;
+    }
+
+    pooledSyncOutputDeadline_ = parseSlice(sliceSize);
+
+    // Any remaining output is processed after the other terminals of the pool had their turn.
+    auto const pending = [this]() {
+        auto _l = lock_guard{ptyBufferLock_};
+        return !ptyBuffer_.empty() || ptyClosed_;
+    }();
+    if (pending)
+        parserPool_->wakeup(parserPoolId_.value());
+
+    return pooledSyncOutputDeadline_;
+}
+
+size_t Terminal::nextSliceSize() const noexcept
+{
+    // A slice ends with the response to a key press, so that it can be presented
+    // right away, rather than only after processing any output following it.
+    auto const processed = ptyStats_.sliceBytes.load();
+    if (inputLatency_.echoEnd > processed)
+        return min(ptyBufferLimits_.sliceSize, static_cast<size_t>(inputLatency_.echoEnd - processed));
+
+    return ptyBufferLimits_.sliceSize;
+}
+
+optional<steady_clock::time_point> Terminal::parseSlice(size_t _sliceSize)
+{
+    auto syncOutputDeadline = optional<steady_clock::time_point>{};
+
+    // Process one slice, so that the renderer never waits for more than that on the screen lock.
+    size_t processed = 0;
+    {
+        CRISPY_METRICS_ONLY(auto const lockRequestedAt = steady_clock::now());
+        auto _l = [this]() {
+            CRISPY_TRACE_SPAN("terminal.parser_lock_wait");
+            return lock_guard{screenLock_};
+        }();
+        CRISPY_METRICS_RECORD("terminal.parser_lock_wait", steady_clock::now() - lockRequestedAt);
+        CRISPY_METRICS_TIME_SCOPE("terminal.parse_slice");
+        CRISPY_TRACE_SPAN("terminal.parse_slice");
+        while (processed < _sliceSize)
         {
-            eventListener_.onClosed();
-            break;
+            auto const [data, available] = ptyBuffer_.peek();
+            if (!available)
+                break;
+            auto const n = min(available, _sliceSize - processed);
+            //log("parser.data: {}", crispy::escape(data, data + n));
+            screen_.write(data, n);
+            ptyBuffer_.consume(n);
+            processed += n;
+        }
+        followLineIds();
+
+        if (syncOutputStartedAt_.has_value())
+        {
+            // Output arriving right up to the deadline lets it pass while processing.
+            checkSynchronizedOutputTimeout(steady_clock::now());
+            syncOutputDeadline = *syncOutputStartedAt_ + SynchronizedOutputTimeout;
         }
+
+        // Updated while still locked, so that takeSnapshot() knows exactly what has been processed.
+        ++ptyStats_.sliceCount;
+        ptyStats_.sliceBytes += processed;
+        if (processed > ptyStats_.maxSliceSize.load(memory_order_relaxed))
+            ptyStats_.maxSliceSize.store(processed, memory_order_relaxed);
+    }
+
+    resumePtyReader();
+
+    return syncOutputDeadline;
+}
+
+void Terminal::followLineIds()
+{
+    viewport_.followLineIds();
+
+    if (selector_ && !selector_->followLineIds())
+        selector_.reset();
+}
+
+void Terminal::updateHoveredHyperlink()
+{
+    screen_.hyperlinks().setHovered(hyperlinkIdAt(currentMousePosition_));
+}
+
+HyperlinkId Terminal::hyperlinkIdAt(Coordinate const& _pos) const noexcept
+{
+    if (!screen_.contains(_pos))
+        return 0;
+
+    auto const pos = absoluteCoordinate(_pos);
+    Line const& line = screen_.grid().absoluteLineAt(pos.row);
+    if (pos.column <= line.size())
+        if (auto const id = line[static_cast<size_t>(pos.column - 1)].hyperlink(); id != 0)
+            return id;
+
+    return linkDetector_.linkAt(screen_.grid(), pos.row, pos.column);
+}
+
+void Terminal::setPtyBufferLimits(PtyBufferLimits _limits)
+{
+    _limits.highWatermark = clamp(_limits.highWatermark, size_t{1}, PtyBufferCapacity - PtyReactor::ReadBufferSize);
+    _limits.lowWatermark = min(_limits.lowWatermark, _limits.highWatermark - 1);
+    _limits.sliceSize = max(_limits.sliceSize, size_t{1});
+
+    {
+        auto _l = lock_guard{ptyBufferLock_};
+        ptyBufferLimits_ = _limits;
+    }
+
+    // The reader might be paused on a watermark that just got raised.
+    resumePtyReader();
+}
+
+SynchronizedOutputStats Terminal::synchronizedOutputStats() const
+{
+    auto _l = lock_guard{screenLock_};
+    return syncOutputStats_;
+}
+
+PtyBufferLimits Terminal::ptyBufferLimits() const
+{
+    auto _l = lock_guard{ptyBufferLock_};
+    return ptyBufferLimits_;
+}
+
+PtyBufferStats Terminal::ptyBufferStats() const
+{
+    auto stats = PtyBufferStats{};
+    stats.bytesRead = ptyStats_.bytesRead.load();
+    stats.bytesBuffered = ptyBuffer_.size();
+    stats.peakBytesBuffered = ptyStats_.peakBytesBuffered.load();
+    stats.readerPauses = ptyStats_.readerPauses.load();
+    stats.readerBlockedTime = nanoseconds(ptyStats_.readerBlockedNanos.load());
+    stats.sliceCount = ptyStats_.sliceCount.load();
+    stats.sliceBytes = ptyStats_.sliceBytes.load();
+    stats.maxSliceSize = ptyStats_.maxSliceSize.load();
+    return stats;
+}
+// }}}
+
+// {{{ input latency
+void Terminal::framePresented(steady_clock::time_point _now)
+{
+    auto _l = lock_guard{ptyBufferLock_};
+    if (!inputLatency_.presentingKeyPressedAt.has_value())
+        return;
+
+    auto const latency = _now - *inputLatency_.presentingKeyPressedAt;
+    inputLatency_.presentingKeyPressedAt.reset();
+    inputLatency_.frameLatency.record(latency);
+    CRISPY_METRICS_RECORD("terminal.input.frame_latency", latency);
+}
+
+bool Terminal::keyPressPending(steady_clock::time_point _now) const
+{
+    auto _l = lock_guard{ptyBufferLock_};
+    return inputLatency_.presentingKeyPressedAt.has_value()
+        || (inputLatency_.keyPressedAt.has_value() && _now - *inputLatency_.keyPressedAt < InputEchoTimeout);
+}
+
+InputLatencyStats Terminal::inputLatencyStats() const
+{
+    auto const percentiles = [](crispy::metrics::histogram const& _histogram) {
+        return LatencyPercentiles{
+            _histogram.percentile(0.50),
+            _histogram.percentile(0.90),
+            _histogram.percentile(0.99),
+            _histogram.max()
+        };
+    };
+
+    auto _l = lock_guard{ptyBufferLock_};
+    auto stats = InputLatencyStats{};
+    stats.keyPresses = inputLatency_.keyPresses;
+    stats.unanswered = inputLatency_.unanswered;
+    stats.echoes = inputLatency_.echoLatency.count();
+    stats.frames = inputLatency_.frameLatency.count();
+    stats.echoLatency = percentiles(inputLatency_.echoLatency);
+    stats.frameLatency = percentiles(inputLatency_.frameLatency);
+    return stats;
+}
+// }}}
+
+// {{{ session recording
+void Terminal::startRecording(string const& _path)
+{
+    auto recorder = make_unique<SessionRecorder>(_path, screenSize());
+    {
+        auto _l = lock_guard{recorderLock_};
+        swap(recorder, recorder_);
     }
+    // A previous recorder is destroyed outside the lock, as that waits for its pending events to be written.
+}
+
+void Terminal::stopRecording()
+{
+    auto recorder = unique_ptr<SessionRecorder>{};
+    {
+        auto _l = lock_guard{recorderLock_};
+        swap(recorder, recorder_);
+    }
+}
+
+bool Terminal::recording() const
+{
+    auto _l = lock_guard{recorderLock_};
+    return !!recorder_;
+}
+
+optional<SessionRecorderStats> Terminal::recorderStats() const
+{
+    auto _l = lock_guard{recorderLock_};
+    if (!recorder_)
+        return nullopt;
+    return recorder_->stats();
 }
+// }}}
 
 bool Terminal::send(KeyInputEvent const& _keyEvent, chrono::steady_clock::time_point _now)
 {
@@ -112,7 +568,7 @@ bool Terminal::send(KeyInputEvent const& _keyEvent, chrono::steady_clock::time_p
         return true;
 
     bool const success = inputGenerator_.generate(_keyEvent);
-    flushInput();
+    flushInput(_now);
     return success;
 }
 
@@ -131,7 +587,7 @@ bool Terminal::send(CharInputEvent const& _charEvent, chrono::steady_clock::time
         return true;
 
     bool const success = inputGenerator_.generate(_charEvent);
-    flushInput();
+    flushInput(_now);
     return success;
 }
 
@@ -201,6 +657,37 @@ void Terminal::clearSelection()
     changes_++;
 }
 
+void Terminal::search(SearchQuery _query)
+{
+    // The search is created without holding the screen lock, as its worker takes that lock.
+    // For the same reason, an unused one is only destroyed after the lock has been released.
+    auto search = unique_ptr<ScrollbackSearch>{};
+    auto const exists = [this]() {
+        auto const _l = lock_guard{screenLock_};
+        return search_ != nullptr;
+    }();
+    if (!exists)
+    {
+        search = make_unique<ScrollbackSearch>(screen_.primaryGrid(), screenLock_, [this]() {
+            auto const _l = lock_guard{screenLock_};
+            changes_++;
+            eventListener_.screenUpdated();
+        });
+    }
+
+    auto const _l = lock_guard{screenLock_};
+    if (!search_)
+        search_ = move(search);
+    search_->setQuery(move(_query));
+}
+
+void Terminal::clearSearch()
+{
+    auto const _l = lock_guard{screenLock_};
+    if (search_)
+        search_->setQuery(nullopt);
+}
+
 
 bool Terminal::send(MouseMoveEvent const& _mouseMove, chrono::steady_clock::time_point /*_now*/)
 {
@@ -212,6 +699,11 @@ bool Terminal::send(MouseMoveEvent const& _mouseMove, chrono::steady_clock::time
 
     currentMousePosition_ = newPosition;
 
+    {
+        auto _l = lock_guard{screenLock_};
+        updateHoveredHyperlink();
+    }
+
     if (inputGenerator_.generate(_mouseMove))
     {
         flushInput();
@@ -335,11 +827,29 @@ void Terminal::sendRaw(std::string_view const& _text)
     flushInput();
 }
 
-void Terminal::flushInput()
+void Terminal::flushInput(optional<steady_clock::time_point> _keyPressedAt)
 {
     inputGenerator_.swap(pendingInput_);
     if (!pendingInput_.empty())
     {
+        if (_keyPressedAt.has_value())
+        {
+            // Taken before writing, as the response might be read before write() even returns.
+            auto _l = lock_guard{ptyBufferLock_};
+            auto& latency = inputLatency_;
+            ++latency.keyPresses;
+            if (latency.keyPressedAt.has_value() && *_keyPressedAt - *latency.keyPressedAt >= InputEchoTimeout)
+            {
+                // Never answered or never presented, e.g. as no frames are rendered at all.
+                if (!latency.echoEnd)
+                    ++latency.unanswered;
+                latency.keyPressedAt.reset();
+                latency.echoEnd = 0;
+            }
+            if (!latency.keyPressedAt.has_value())
+                latency.keyPressedAt = _keyPressedAt;
+        }
+
         // XXX should be the only location that does write to the PTY's stdin to avoid race conditions.
         pty_->write(pendingInput_.data(), pendingInput_.size());
         debuglog(KeyboardTag).write(crispy::escape(begin(pendingInput_), end(pendingInput_)));
@@ -379,14 +889,158 @@ std::chrono::milliseconds Terminal::nextRender(chrono::steady_clock::time_point
         return chrono::milliseconds::min();
 }
 
+uint64_t Terminal::takeSnapshot(RenderSnapshot& _snapshot, chrono::steady_clock::time_point _now)
+{
+    CRISPY_METRICS_ONLY(auto const lockRequestedAt = steady_clock::now());
+    auto _l = [this]() {
+        CRISPY_TRACE_SPAN("terminal.snapshot_lock_wait");
+        return lock_guard{screenLock_};
+    }();
+    auto const lockedAt = steady_clock::now();
+    CRISPY_METRICS_RECORD("terminal.snapshot_lock_wait", lockedAt - lockRequestedAt);
+
+    // Keep presenting the previous frame while the application is updating the screen.
+    if (synchronizedOutputPending(_now) && !_snapshot.cells.empty())
+    {
+        _snapshot.changes = 0;
+        _snapshot.lockHoldTime = steady_clock::now() - lockedAt;
+        return 0;
+    }
+
+    {
+        // The response to a pending key press is presented with this snapshot if processed already.
+        auto _pl = lock_guard{ptyBufferLock_};
+        if (inputLatency_.echoEnd && ptyStats_.sliceBytes.load() >= inputLatency_.echoEnd)
+        {
+            inputLatency_.presentingKeyPressedAt = inputLatency_.keyPressedAt;
+            inputLatency_.keyPressedAt.reset();
+            inputLatency_.echoEnd = 0;
+        }
+    }
+
+    auto const changes = preRender(_now);
+    auto const pageSize = screen_.size();
+    auto const scrollOffset = viewport_.absoluteScrollOffset();
+    auto const primaryScreen = screen_.isPrimaryScreen();
+    auto const cellCount = static_cast<size_t>(pageSize.width * pageSize.height);
+
+    if (changes != 0
+            || _snapshot.cells.size() != cellCount
+            || _snapshot.pageSize != pageSize
+            || _snapshot.scrollOffset != scrollOffset
+            || _snapshot.primaryScreen != primaryScreen)
+    {
+        linkDetector_.setWorkingDirectory(screen_.currentWorkingDirectory());
+
+        _snapshot.cells.resize(cellCount);
+        auto const firstLine = scrollOffset.value_or(screen_.historyLineCount());
+        screen_.renderLines(
+            [&](int _row, Line const& _line) {
+                if (_row > pageSize.height)
+                    return;
+                auto const target = next(_snapshot.cells.begin(), (_row - 1) * pageSize.width);
+                auto const count = min(_line.size(), pageSize.width);
+                auto const padding = copy_n(_line.begin(), count, target);
+                fill_n(padding, pageSize.width - count, Cell{});
+
+                // Detected links are only stamped into the copies, never into the grid.
+                for (auto const& span : linkDetector_.update(screen_.grid(), firstLine + _row - 1))
+                    for (auto column = span.fromColumn; column <= min(span.toColumn, count); ++column)
+                        if (Cell& cell = target[column - 1]; cell.hyperlink() == 0)
+                            cell.setHyperlink(span.hyperlink);
+            },
+            scrollOffset
+        );
+
+        linkDetector_.prune();
+        updateHoveredHyperlink();
+    }
+
+    _snapshot.pageSize = pageSize;
+    _snapshot.scrollOffset = scrollOffset;
+    _snapshot.primaryScreen = primaryScreen;
+    _snapshot.reverseVideo = screen_.isModeEnabled(DECMode::ReverseVideo);
+    _snapshot.changes = changes;
+
+    // selection and search matches, with lines made relative to the viewport
+    auto const baseLine = scrollOffset.value_or(screen_.historyLineCount());
+
+    _snapshot.selection.clear();
+    if (isSelectionAvailable())
+    {
+        for (auto const& range : selector_->selection(baseLine, pageSize.height))
+            _snapshot.selection.emplace_back(Selector::Range{range.line - baseLine + 1, range.fromColumn, range.toColumn});
+    }
+
+    _snapshot.searchMatches.clear();
+    if (search_ && primaryScreen)
+    {
+        auto const lastLine = baseLine + pageSize.height - 1;
+        for (auto const& match : search_->matches(baseLine, pageSize.height))
+            for (auto line = max(match.from.row, baseLine); line <= min(match.to.row, lastLine); ++line)
+                _snapshot.searchMatches.emplace_back(Selector::Range{
+                    line - baseLine + 1,
+                    line == match.from.row ? match.from.column : 1,
+                    line == match.to.row ? match.to.column : pageSize.width
+                });
+    }
+
+    _snapshot.hoveredHyperlink = screen_.hyperlinks().hovered();
+
+    auto const& cursor = screen_.cursor();
+    _snapshot.cursor.visible = cursor.visible
+                            && (cursorDisplay_ == CursorDisplay::Steady || cursorBlinkState_)
+                            && viewport_.isLineVisible(cursor.position.row);
+    if (_snapshot.cursor.visible)
+    {
+        _snapshot.cursor.position = Coordinate{cursor.position.row + viewport_.relativeScrollOffset(),
+                                               cursor.position.column};
+        _snapshot.cursor.shape = screen_.focused() ? cursorShape_ : CursorShape::Rectangle;
+        _snapshot.cursor.width = screen_.at(cursor.position).width();
+    }
+
+    _snapshot.lockHoldTime = steady_clock::now() - lockedAt;
+
+    return changes;
+}
+
 void Terminal::resizeScreen(Size _cells, optional<Size> _pixels)
 {
     lock_guard<decltype(screenLock_)> _l{ screenLock_ };
     screen_.resize(_cells);
     if (_pixels)
         screen_.setCellPixelSize(*_pixels / _cells);
+    followLineIds();
 
     pty_->resizeScreen(_cells, _pixels);
+
+    auto _rl = lock_guard{recorderLock_};
+    if (recorder_)
+        recorder_->resize(steady_clock::now(), _cells);
+}
+
+string Terminal::saveScreenState() const
+{
+    auto _l = lock_guard{screenLock_};
+    return screen_.saveState();
+}
+
+void Terminal::restoreScreenState(string_view _state)
+{
+    auto _l = lock_guard{screenLock_};
+    screen_.restoreState(_state);
+
+    // Cached links refer to lines of the replaced state.
+    linkDetector_.clear();
+    if (search_)
+        search_->notify();
+
+    if (screen_.size() != pty_->screenSize())
+        screen_.resize(pty_->screenSize());
+
+    selector_.reset();
+    viewport_.forceScrollToBottom();
+    changes_++;
 }
 
 void Terminal::setCursorDisplay(CursorDisplay _display)
@@ -433,10 +1087,51 @@ void Terminal::screenUpdated()
 {
     changes_++;
 
+    if (search_)
+        search_->notify();
+
+    // Presented once synchronized output ends or times out.
+    if (synchronizedOutputPending(steady_clock::now()))
+        return;
+
     // Screen output commands be here - anything this terminal is interested in?
     eventListener_.screenUpdated();
 }
 
+void Terminal::setSynchronizedOutput(bool _enabled)
+{
+    if (_enabled)
+    {
+        syncOutputStartedAt_ = steady_clock::now();
+        syncOutputStartInstruction_ = screen_.instructionCount();
+        syncOutputTimedOut_ = false;
+        return;
+    }
+
+    if (!syncOutputStartedAt_.has_value())
+        return;
+
+    auto const duration = duration_cast<nanoseconds>(steady_clock::now() - *syncOutputStartedAt_);
+    auto const instructions = static_cast<uint64_t>(screen_.instructionCount() - syncOutputStartInstruction_);
+    syncOutputStartedAt_.reset();
+
+    auto& stats = syncOutputStats_;
+    stats.batches++;
+    stats.instructions += instructions;
+    stats.maxInstructions = max(stats.maxInstructions, instructions);
+    stats.totalDuration += duration;
+    stats.maxDuration = max(stats.maxDuration, duration);
+}
+
+void Terminal::checkSynchronizedOutputTimeout(steady_clock::time_point _now)
+{
+    if (!syncOutputStartedAt_.has_value() || syncOutputTimedOut_ || synchronizedOutputPending(_now))
+        return;
+
+    syncOutputTimedOut_ = true;
+    syncOutputStats_.timeouts++;
+}
+
 FontDef Terminal::getFontDef()
 {
     return eventListener_.getFontDef();
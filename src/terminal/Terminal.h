@@ -14,16 +14,26 @@
 #pragma once
 
 #include <terminal/InputGenerator.h>
+#include <terminal/LinkDetector.h>
+#include <terminal/ParserPool.h>
 #include <terminal/pty/Pty.h>
+#include <terminal/pty/PtyReactor.h>
+#include <terminal/RenderSnapshot.h>
 #include <terminal/ScreenEvents.h>
+#include <terminal/SessionRecording.h>
 #include <terminal/Screen.h>
+#include <terminal/Search.h>
 #include <terminal/Selector.h>
 #include <terminal/Viewport.h>
 
+#include <crispy/metrics.h>
+#include <crispy/spsc_ring.h>
+
 #include <fmt/format.h>
 
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -33,13 +43,69 @@
 
 namespace terminal {
 
+/// Limits of the PTY output pipeline, that is, PTY reader -> byte ring buffer -> VT parser.
+struct PtyBufferLimits {
+    /// Number of buffered bytes at which reading from the PTY is paused, so that the
+    /// application gets blocked by the kernel rather than the terminal buffering endlessly.
+    size_t highWatermark = 768 * 1024;
+
+    /// Number of buffered bytes below which reading from the PTY is resumed.
+    size_t lowWatermark = 256 * 1024;
+
+    /// Maximum number of bytes to be processed per acquisition of the screen lock.
+    size_t sliceSize = 16 * 1024;
+};
+
+/// Counters of the PTY output pipeline.
+struct PtyBufferStats {
+    uint64_t bytesRead = 0;                         // total number of bytes read from the PTY
+    size_t bytesBuffered = 0;                       // bytes read but not processed yet
+    size_t peakBytesBuffered = 0;                   // maximum of bytesBuffered so far
+    uint64_t readerPauses = 0;                      // number of times the high watermark was hit
+    std::chrono::nanoseconds readerBlockedTime{};   // accumulated time reading was paused
+    uint64_t sliceCount = 0;                        // number of screen lock acquisitions for processing
+    uint64_t sliceBytes = 0;                        // total number of bytes processed
+    size_t maxSliceSize = 0;                        // largest number of bytes processed in one slice
+};
+
+/// Counters of synchronized output (DECSM 2026) batches.
+struct SynchronizedOutputStats {
+    uint64_t batches = 0;                       // number of completed batches
+    uint64_t timeouts = 0;                      // batches presented by the timeout rather than by their end
+    uint64_t instructions = 0;                  // total number of VT instructions processed within batches
+    uint64_t maxInstructions = 0;               // largest batch, in VT instructions
+    std::chrono::nanoseconds totalDuration{};   // accumulated time batches were open
+    std::chrono::nanoseconds maxDuration{};     // longest time a batch was open
+};
+
+/// Percentiles of a latency distribution, each with the precision of a power-of-two bucket.
+struct LatencyPercentiles {
+    std::chrono::nanoseconds p50{};
+    std::chrono::nanoseconds p90{};
+    std::chrono::nanoseconds p99{};
+    std::chrono::nanoseconds max{};
+};
+
+/// End-to-end latencies of keyboard input, from the key press to the application's response.
+///
+/// Only the oldest key press that has not been answered yet is tracked, so keys typed faster
+/// than the application responds are measured from the first of them.
+struct InputLatencyStats {
+    uint64_t keyPresses = 0;            // key presses that generated input to the application
+    uint64_t unanswered = 0;            // key presses without any PTY output within InputEchoTimeout
+    uint64_t echoes = 0;                // number of echoLatency samples
+    uint64_t frames = 0;                // number of frameLatency samples
+    LatencyPercentiles echoLatency;     // key press to the first PTY read after it
+    LatencyPercentiles frameLatency;    // key press to presenting the first frame containing that read
+};
+
 /// Terminal API to manage input and output devices of a pseudo terminal, such as keyboard, mouse, and screen.
 ///
 /// With a terminal being attached to a Process, the terminal's screen
 /// gets updated according to the process' outputted text,
 /// whereas input to the process can be send high-level via the various
 /// send(...) member functions.
-class Terminal : public ScreenEvents {
+class Terminal : public ScreenEvents, private PtyReactor::Handler, private ParserPool::Handler {
   public:
     class Events {
       public:
@@ -65,6 +131,11 @@ class Terminal : public ScreenEvents {
         virtual void discardImage(Image const&) {}
     };
 
+    /// Constructs a terminal session on the given PTY.
+    ///
+    /// If @p _parserPool is given, PTY output is parsed on that pool's shared workers instead of
+    /// on a thread of its own, which is meant for hosting many (possibly headless) sessions in
+    /// a single process. The pool must outlive this terminal.
     Terminal(std::unique_ptr<Pty> _pty,
              Events& _eventListener,
              std::optional<size_t> _maxHistoryLineCount = std::nullopt,
@@ -73,7 +144,8 @@ class Terminal : public ScreenEvents {
              std::string const& _wordDelimiters = "",
              Size _maxImageSize = Size{800, 600},
              int _maxImageColorRegisters = 256,
-             bool _sixelCursorConformance = true);
+             bool _sixelCursorConformance = true,
+             ParserPool* _parserPool = nullptr);
     ~Terminal();
 
     /// Retrieves the time point this terminal instance has been spawned.
@@ -82,6 +154,12 @@ class Terminal : public ScreenEvents {
     /// Retrieves reference to the underlying PTY device.
     Pty& device() noexcept { return *pty_; }
 
+    /// Closes the underlying PTY device, which is to be preferred over closing it directly.
+    ///
+    /// This also releases the PtyReactor's duplicate of the PTY master, such that the
+    /// other side sees the hang-up right away.
+    void closeDevice();
+
     Size screenSize() const noexcept { return pty_->screenSize(); }
     void resizeScreen(Size _cells, std::optional<Size> _pixels);
 
@@ -104,6 +182,74 @@ class Terminal : public ScreenEvents {
     void sendRaw(std::string_view const& _text);
     // }}}
 
+    // {{{ PTY output pipeline
+    /// Capacity of the buffer between reading the PTY and processing its output.
+    static constexpr size_t PtyBufferCapacity = 1024 * 1024;
+
+    /// Configures backpressure and processing slices of the PTY output pipeline.
+    ///
+    /// The high watermark is clamped such that a full PTY read always fits into the buffer.
+    void setPtyBufferLimits(PtyBufferLimits _limits);
+    PtyBufferLimits ptyBufferLimits() const;
+
+    PtyBufferStats ptyBufferStats() const;
+    // }}}
+
+    // {{{ synchronized output
+    /// Maximum time presenting screen updates is held back while synchronized output
+    /// (DECSM 2026) is enabled, so that a misbehaving application cannot freeze the display.
+    static constexpr std::chrono::milliseconds SynchronizedOutputTimeout{150};
+
+    /// Tests whether presenting screen updates is currently being held back by synchronized output.
+    ///
+    /// Only call this while having locked.
+    bool synchronizedOutputPending(std::chrono::steady_clock::time_point _now) const noexcept
+    {
+        return syncOutputStartedAt_.has_value() && _now < *syncOutputStartedAt_ + SynchronizedOutputTimeout;
+    }
+
+    SynchronizedOutputStats synchronizedOutputStats() const;
+    // }}}
+
+    // {{{ input latency
+    /// Time after which a key press without any PTY output is no longer waited for.
+    static constexpr std::chrono::milliseconds InputEchoTimeout{1000};
+
+    /// Informs that a frame with the contents of the last takeSnapshot() has been presented,
+    /// which completes the latency measurement of a key press that has been answered by it.
+    void framePresented(std::chrono::steady_clock::time_point _now);
+
+    /// Tests whether a key press is still waiting for the application's response to be presented,
+    /// in which case frames should be rendered without any pacing delay.
+    bool keyPressPending(std::chrono::steady_clock::time_point _now) const;
+
+    InputLatencyStats inputLatencyStats() const;
+    // }}}
+
+    // {{{ session recording
+    /// Starts recording the PTY output and screen resizes of this session into the file at @p _path,
+    /// replacing any recording in progress.
+    ///
+    /// @throws std::runtime_error if the recording file could not be created.
+    void startRecording(std::string const& _path);
+
+    /// Stops the recording in progress, if any, after writing all of it to the file.
+    void stopRecording();
+
+    bool recording() const;
+    std::optional<SessionRecorderStats> recorderStats() const;
+    // }}}
+
+    // {{{ screen state
+    /// Saves the complete screen state, such as for crash recovery (see Screen::saveState()).
+    std::string saveScreenState() const;
+
+    /// Restores a screen state previously saved via saveScreenState(), resized to the PTY's screen size.
+    ///
+    /// @throws std::runtime_error if @p _state is malformed or of an unsupported version.
+    void restoreScreenState(std::string_view _state);
+    // }}}
+
     // {{{ screen proxy
     /// @returns absolute coordinate of @p _pos with scroll offset and applied.
     Coordinate absoluteCoordinate(Coordinate const& _pos) const noexcept
@@ -147,6 +293,16 @@ class Terminal : public ScreenEvents {
         updateCursorVisibilityState(_now);
         return changes;
     }
+
+    /// Copies everything needed for rendering the current viewport into @p _snapshot.
+    ///
+    /// The screen lock is held only for the duration of this copy, so that the actual rendering
+    /// can happen without blocking the terminal's screen updates.
+    /// Cells are only copied again if the screen or viewport changed since the previous snapshot,
+    /// which is also when the copied lines are checked for URLs and file positions (see LinkDetector).
+    ///
+    /// @returns number of screen changes since the previous render.
+    uint64_t takeSnapshot(RenderSnapshot& _snapshot, std::chrono::steady_clock::time_point _now);
     // }}}
 
     void lock() const { screenLock_.lock(); }
@@ -160,6 +316,15 @@ class Terminal : public ScreenEvents {
 
     bool lineWrapped(int _lineNumber) const { return screen_.lineWrapped(_lineNumber); }
 
+    /// @returns the hyperlink at the given viewport coordinate, either set via OSC 8 or detected
+    ///          in the text, or nullptr if there is none.
+    ///
+    /// Only access this when having locked.
+    HyperlinkInfo const* hyperlinkAt(Coordinate const& _pos) const noexcept
+    {
+        return screen_.hyperlinks().at(hyperlinkIdAt(_pos));
+    }
+
     Coordinate const& currentMousePosition() const noexcept { return currentMousePosition_; }
 
     // {{{ cursor management
@@ -219,11 +384,58 @@ class Terminal : public ScreenEvents {
     bool selectionAvailable() const noexcept { return !!selector_; }
     // }}}
 
+    // {{{ scrollback search
+    /// Searches the primary screen's scrollback and main page for @p _query on a worker thread.
+    ///
+    /// Matches are highlighted when rendering and can be navigated to via the Viewport.
+    /// Must not be called with the screen being locked.
+    ///
+    /// @throws std::regex_error if the query's pattern is not a valid regular expression.
+    void search(SearchQuery _query);
+
+    /// Stops searching and removes all search highlights.
+    /// Must not be called with the screen being locked.
+    void clearSearch();
+
+    /// @returns the scrollback search, or nullptr if nothing has been searched for yet.
+    /// Must be called with the screen being locked.
+    ScrollbackSearch const* scrollbackSearch() const noexcept { return search_.get(); }
+    // }}}
+
   private:
-    void flushInput();
-    void screenUpdateThread();
+    /// Writes the generated input to the PTY.
+    ///
+    /// @param _keyPressedAt time of the key press that generated the input, for measuring input latency.
+    void flushInput(std::optional<std::chrono::steady_clock::time_point> _keyPressedAt = std::nullopt);
+    void ptyReaderThread();
+    void parserThread();
+    std::optional<std::chrono::steady_clock::time_point> parseSlice(size_t _sliceSize);
+    std::optional<std::chrono::steady_clock::time_point> onParserWakeup() override;
+    size_t nextSliceSize() const noexcept;
+    void notifyParser(bool _urgent = false);
+    bool onPtyData(char const* _data, size_t _size) override;
+    void onPtyClosed() override;
+    void resumePtyReader();
+
+    /// Stops reading the PTY via the PtyReactor, if it did.
+    ///
+    /// @returns whether or not the PTY has been watched by the PtyReactor.
+    bool unwatchPty();
     void updateCursorVisibilityState(std::chrono::steady_clock::time_point _now) const;
 
+    /// Moves the viewport and the selection along with their lines, which might have shifted
+    /// due to the scrollback being clamped or reflowed. Must be called with the screen being locked.
+    void followLineIds();
+
+    /// Counts the current synchronized output batch as timed out once its deadline has passed.
+    /// Must be called with the screen being locked.
+    void checkSynchronizedOutputTimeout(std::chrono::steady_clock::time_point _now);
+
+    /// Updates the hover state of the hyperlinks to the cell under the mouse cursor.
+    void updateHoveredHyperlink();
+
+    HyperlinkId hyperlinkIdAt(Coordinate const& _pos) const noexcept;
+
     template <typename Renderer, typename... RemainingPasses>
     void renderPass(Renderer const& pass, RemainingPasses... remainingPasses) const
     {
@@ -256,6 +468,7 @@ class Terminal : public ScreenEvents {
     void setMouseProtocol(MouseProtocol _protocol, bool _enabled) override;
     void setMouseTransport(MouseTransport _transport) override;
     void setMouseWheelMode(InputGenerator::MouseWheelMode _mode) override;
+    void setSynchronizedOutput(bool _enabled) override;
     void setWindowTitle(std::string_view const& _title) override;
     void setTerminalProfile(std::string const& _configProfileName) override;
     void useApplicationCursorKeys(bool _enabled) override;
@@ -291,9 +504,139 @@ class Terminal : public ScreenEvents {
     InputGenerator::Sequence pendingInput_;
     Screen screen_;
     std::mutex mutable screenLock_;
-    std::thread screenUpdateThread_;
+
+    // {{{ PTY output pipeline
+    // The reader stage (PtyReactor or ptyReaderThread_) pushes PTY output into ptyBuffer_,
+    // which the parser stage (parserThread_ or parserPool_) consumes in slices.
+    crispy::spsc_ring<char> ptyBuffer_;
+    std::mutex mutable ptyBufferLock_;              // guards the fields below and the wakeups.
+    std::condition_variable ptyDataAvailable_;      // wakes up the parser stage.
+    std::condition_variable ptySpaceAvailable_;     // wakes up a paused ptyReaderThread_.
+    PtyBufferLimits ptyBufferLimits_;
+    bool ptyReaderPaused_ = false;
+    std::chrono::steady_clock::time_point ptyReaderPausedAt_;
+    bool ptyClosed_ = false;
+    bool terminating_ = false;
+    struct {
+        std::atomic<uint64_t> bytesRead = 0;
+        std::atomic<size_t> peakBytesBuffered = 0;
+        std::atomic<uint64_t> readerPauses = 0;
+        std::atomic<int64_t> readerBlockedNanos = 0;
+        std::atomic<uint64_t> sliceCount = 0;
+        std::atomic<uint64_t> sliceBytes = 0;
+        std::atomic<size_t> maxSliceSize = 0;
+    } ptyStats_;
+
+    std::mutex mutable recorderLock_;               // guards recorder_.
+    std::unique_ptr<SessionRecorder> recorder_;     // tees PTY output into a session recording, if set.
+
+    std::optional<PtyReactor::Id> ptyReactorId_;  // set if PTY output is read by the shared PtyReactor (guarded by ptyBufferLock_).
+    std::thread ptyReaderThread_;               // fallback reader for PTYs that cannot be polled.
+    std::thread parserThread_;
+
+    struct {                                        // (guarded by ptyBufferLock_)
+        std::optional<std::chrono::steady_clock::time_point> keyPressedAt; // oldest key press not presented yet
+        uint64_t echoEnd = 0;                       // bytesRead up to its first PTY read, or 0 if not read yet
+        std::optional<std::chrono::steady_clock::time_point> presentingKeyPressedAt; // answered by the last snapshot
+        uint64_t keyPresses = 0;
+        uint64_t unanswered = 0;
+        crispy::metrics::histogram echoLatency;
+        crispy::metrics::histogram frameLatency;
+    } inputLatency_;
+
+    ParserPool* parserPool_;                      // set if PTY output is parsed by a shared ParserPool.
+    std::optional<ParserPool::Id> parserPoolId_;
+    // Only accessed by (never overlapping) parser pool invocations.
+    std::optional<std::chrono::steady_clock::time_point> pooledSyncOutputDeadline_;
+    bool parserFinished_ = false;
+    // }}}
+
+    // {{{ synchronized output (guarded by screenLock_)
+    std::optional<std::chrono::steady_clock::time_point> syncOutputStartedAt_;
+    int64_t syncOutputStartInstruction_ = 0;
+    bool syncOutputTimedOut_ = false;             // the current batch has been counted as timed out
+    SynchronizedOutputStats syncOutputStats_;
+    // }}}
     Viewport viewport_;
+    LinkDetector linkDetector_;
     std::unique_ptr<Selector> selector_;
+    std::unique_ptr<ScrollbackSearch> search_;
 };
 
 }  // namespace terminal
+
+namespace fmt // {{{
+{
+    template <>
+    struct formatter<terminal::PtyBufferStats> {
+        template <typename ParseContext>
+        constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+        template <typename FormatContext>
+        auto format(terminal::PtyBufferStats const& _stats, FormatContext& ctx)
+        {
+            return format_to(
+                ctx.out(),
+                "read: {} bytes, buffered: {} (peak {}), reader paused: {}x for {} ms, slices: {} (avg {}, max {} bytes)",
+                _stats.bytesRead,
+                _stats.bytesBuffered,
+                _stats.peakBytesBuffered,
+                _stats.readerPauses,
+                std::chrono::duration_cast<std::chrono::milliseconds>(_stats.readerBlockedTime).count(),
+                _stats.sliceCount,
+                _stats.sliceCount ? _stats.sliceBytes / _stats.sliceCount : 0,
+                _stats.maxSliceSize
+            );
+        }
+    };
+
+    template <>
+    struct formatter<terminal::InputLatencyStats> {
+        template <typename ParseContext>
+        constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+        template <typename FormatContext>
+        auto format(terminal::InputLatencyStats const& _stats, FormatContext& ctx)
+        {
+            auto const us = [](std::chrono::nanoseconds _value) { return static_cast<double>(_value.count()) / 1000.0; };
+            return format_to(
+                ctx.out(),
+                "key presses: {} ({} unanswered), "
+                "echo: {} p50<={:.1f}us p90<={:.1f}us p99<={:.1f}us max={:.1f}us, "
+                "frame: {} p50<={:.1f}us p90<={:.1f}us p99<={:.1f}us max={:.1f}us",
+                _stats.keyPresses,
+                _stats.unanswered,
+                _stats.echoes,
+                us(_stats.echoLatency.p50),
+                us(_stats.echoLatency.p90),
+                us(_stats.echoLatency.p99),
+                us(_stats.echoLatency.max),
+                _stats.frames,
+                us(_stats.frameLatency.p50),
+                us(_stats.frameLatency.p90),
+                us(_stats.frameLatency.p99),
+                us(_stats.frameLatency.max)
+            );
+        }
+    };
+
+    template <>
+    struct formatter<terminal::SynchronizedOutputStats> {
+        template <typename ParseContext>
+        constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+        template <typename FormatContext>
+        auto format(terminal::SynchronizedOutputStats const& _stats, FormatContext& ctx)
+        {
+            using std::chrono::duration_cast;
+            using std::chrono::microseconds;
+            return format_to(
+                ctx.out(),
+                "batches: {} ({} timed out), instructions: avg {} max {}, duration: avg {} us max {} us",
+                _stats.batches,
+                _stats.timeouts,
+                _stats.batches ? _stats.instructions / _stats.batches : 0,
+                _stats.maxInstructions,
+                _stats.batches ? duration_cast<microseconds>(_stats.totalDuration).count() / static_cast<int64_t>(_stats.batches) : 0,
+                duration_cast<microseconds>(_stats.maxDuration).count()
+            );
+        }
+    };
+} // }}}
@@ -0,0 +1,267 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/ParserPool.h>
+#include <terminal/Terminal.h>
+#include <terminal/pty/Pty.h>
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace terminal;
+using namespace std;
+using namespace std::chrono;
+
+namespace
+{
+    /// Pty whose slave side is one end of a socket pair, so that tests can act as the application.
+    class SocketPty : public Pty {
+      public:
+        SocketPty()
+        {
+            int fds[2];
+            REQUIRE(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == 0);
+            master_ = fds[0];
+            application_ = fds[1];
+            fcntl(master_, F_SETFL, fcntl(master_, F_GETFL) | O_NONBLOCK);
+        }
+
+        ~SocketPty() override
+        {
+            close();
+            ::close(application_);
+        }
+
+        /// Application side of the PTY.
+        int application() const noexcept { return application_; }
+
+        void close() override
+        {
+            if (master_ >= 0)
+                ::close(master_);
+            master_ = -1;
+        }
+
+        void prepareParentProcess() override {}
+        void prepareChildProcess() override {}
+        int read(char* _buf, size_t _size) override { return static_cast<int>(::read(master_, _buf, _size)); }
+        int pollableHandle() const noexcept override { return master_; }
+        int write(char const* _buf, size_t _size) override { return static_cast<int>(::write(master_, _buf, _size)); }
+        Size screenSize() const noexcept override { return Size{10, 3}; }
+        void resizeScreen(Size, optional<Size>) override {}
+
+      private:
+        int master_ = -1;
+        int application_ = -1;
+    };
+
+    class ClosedEvents : public Terminal::Events {
+      public:
+        void onClosed() override { closed = true; }
+        atomic<bool> closed = false;
+    };
+
+    class UpdateEvents : public ClosedEvents {
+      public:
+        void screenUpdated() override { ++updates; }
+        atomic<int> updates = 0;
+    };
+
+    /// Constructs a terminal whose parser stage runs on @p _pool.
+    Terminal makePooledTerminal(unique_ptr<Pty> _pty, Terminal::Events& _events, ParserPool& _pool)
+    {
+        return Terminal{move(_pty), _events, nullopt, milliseconds{500}, steady_clock::now(), "",
+                        Size{800, 600}, 256, true, &_pool};
+    }
+
+    void sendAll(int _fd, string_view _data)
+    {
+        while (!_data.empty())
+        {
+            auto const n = ::send(_fd, _data.data(), _data.size(), 0);
+            REQUIRE(n > 0);
+            _data.remove_prefix(static_cast<size_t>(n));
+        }
+    }
+
+    template <typename Predicate>
+    bool waitFor(Predicate _predicate)
+    {
+        auto const timeout = steady_clock::now() + seconds{5};
+        while (!_predicate())
+        {
+            if (steady_clock::now() > timeout)
+                return false;
+            this_thread::sleep_for(milliseconds{1});
+        }
+        return true;
+    }
+}
+
+TEST_CASE("Terminal.closeDevice", "[terminal]")
+{
+    auto events = ClosedEvents{};
+    auto pty = make_unique<SocketPty>();
+    auto const application = pty->application();
+    auto terminal = Terminal{move(pty), events};
+
+    terminal.closeDevice();
+
+    // No duplicate of the master side is left open, so the application sees the hang-up right away.
+    char ch{};
+    CHECK(::recv(application, &ch, 1, MSG_DONTWAIT) == 0);
+    CHECK(waitFor([&]() { return events.closed.load(); }));
+}
+
+TEST_CASE("Terminal.inputLatency", "[terminal]")
+{
+    auto events = Terminal::Events{};
+    auto pty = make_unique<SocketPty>();
+    auto const application = pty->application();
+    auto terminal = Terminal{move(pty), events};
+
+    REQUIRE(terminal.send(CharInputEvent{U'a', Modifier{}}, steady_clock::now()));
+    CHECK(terminal.keyPressPending(steady_clock::now()));
+
+    // The application echoes the key press back.
+    char ch{};
+    REQUIRE(waitFor([&]() { return ::recv(application, &ch, 1, MSG_DONTWAIT) == 1; }));
+    CHECK(ch == 'a');
+    REQUIRE(::send(application, &ch, 1, 0) == 1);
+    REQUIRE(waitFor([&]() { return terminal.ptyBufferStats().sliceBytes >= 1; }));
+    CHECK(terminal.inputLatencyStats().echoes == 1);
+
+    auto snapshot = RenderSnapshot{};
+    terminal.takeSnapshot(snapshot, steady_clock::now());
+    terminal.framePresented(steady_clock::now());
+
+    auto const stats = terminal.inputLatencyStats();
+    CHECK(stats.keyPresses == 1);
+    CHECK(stats.unanswered == 0);
+    CHECK(stats.echoes == 1);
+    CHECK(stats.frames == 1);
+    CHECK(stats.frameLatency.max >= stats.echoLatency.max);
+    CHECK_FALSE(terminal.keyPressPending(steady_clock::now()));
+
+    terminal.closeDevice();
+}
+
+TEST_CASE("Terminal.synchronizedOutput", "[terminal]")
+{
+    auto events = UpdateEvents{};
+    auto pty = make_unique<SocketPty>();
+    auto const application = pty->application();
+    auto terminal = Terminal{move(pty), events};
+
+    SECTION("ended in time")
+    {
+        sendAll(application, "\033[?2026hin time\033[?2026l");
+        REQUIRE(waitFor([&]() { return terminal.synchronizedOutputStats().batches == 1; }));
+        CHECK(terminal.synchronizedOutputStats().timeouts == 0);
+    }
+
+    SECTION("timed out")
+    {
+        // The parser thread counts the timeout once the deadline fires without further output.
+        sendAll(application, "\033[?2026hheld back");
+        REQUIRE(waitFor([&]() { return terminal.synchronizedOutputStats().timeouts == 1; }));
+        CHECK(terminal.synchronizedOutputStats().batches == 0);
+        CHECK(events.updates.load() > 0);
+    }
+
+    terminal.closeDevice();
+}
+
+TEST_CASE("Terminal.parserPool", "[terminal]")
+{
+    auto pool = ParserPool{2};
+    auto events = UpdateEvents{};
+    auto pty = make_unique<SocketPty>();
+    auto const application = pty->application();
+
+    {
+        auto terminal = makePooledTerminal(move(pty), events, pool);
+        CHECK(pool.size() == 1);
+
+        SECTION("slices")
+        {
+            // Output exceeding a slice is processed in several invocations, re-queued in between.
+            auto limits = terminal.ptyBufferLimits();
+            limits.sliceSize = 4;
+            terminal.setPtyBufferLimits(limits);
+
+            sendAll(application, "0123456789abcdefghij\r\nxyz");
+            REQUIRE(waitFor([&]() { return terminal.ptyBufferStats().sliceBytes == 25; }));
+            CHECK(terminal.ptyBufferStats().sliceCount >= 7);
+            CHECK(terminal.ptyBufferStats().maxSliceSize <= 4);
+
+            auto const _l = scoped_lock{terminal};
+            CHECK(terminal.screen().renderTextLine(2) == "abcdefghij");
+            CHECK(terminal.screen().renderTextLine(3) == "xyz       ");
+        }
+
+        SECTION("synchronized output")
+        {
+            // Held back updates are presented once the deadline has passed, without further output.
+            sendAll(application, "\033[?2026hheld back");
+            REQUIRE(waitFor([&]() { return terminal.ptyBufferStats().sliceBytes == 17; }));
+            auto const pending = [&]() {
+                auto const _l = scoped_lock{terminal};
+                return terminal.synchronizedOutputPending(steady_clock::now());
+            };
+            auto const updates = events.updates.load();
+            auto const startedAt = steady_clock::now();
+            CHECK(pending());
+
+            REQUIRE(waitFor([&]() { return events.updates.load() > updates; }));
+            CHECK(steady_clock::now() - startedAt >= Terminal::SynchronizedOutputTimeout / 2);
+            CHECK_FALSE(pending());
+
+            // The timeout is counted when the deadline fires, and not once more by the late end of the batch.
+            CHECK(terminal.synchronizedOutputStats().timeouts == 1);
+            CHECK(terminal.synchronizedOutputStats().batches == 0);
+            sendAll(application, "\033[?2026l");
+            REQUIRE(waitFor([&]() { return terminal.synchronizedOutputStats().batches == 1; }));
+            CHECK(terminal.synchronizedOutputStats().timeouts == 1);
+        }
+
+        SECTION("closed")
+        {
+            // The hang-up is reported after all remaining output has been processed.
+            sendAll(application, "bye");
+            REQUIRE(::shutdown(application, SHUT_WR) == 0);
+            REQUIRE(waitFor([&]() { return events.closed.load(); }));
+            CHECK(terminal.ptyBufferStats().sliceBytes == 3);
+        }
+
+        SECTION("destruction")
+        {
+            // The terminal is destroyed with output in flight.
+            sendAll(application, string(4096, 'x'));
+        }
+    }
+
+    // Destroying the terminal unregistered it from the pool.
+    CHECK(pool.size() == 0);
+}
@@ -14,6 +14,7 @@
 #pragma once
 
 #include <terminal/Screen.h>
+#include <terminal/Search.h>
 
 #include <algorithm>
 #include <optional>
@@ -104,6 +105,7 @@ class Viewport {
         if (0 <= _absoluteScrollOffset && _absoluteScrollOffset < historyLineCount())
         {
             scrollOffset_.emplace(_absoluteScrollOffset);
+            topLineId_ = screen_.grid().lineIdAt(_absoluteScrollOffset);
             return true;
         }
 
@@ -113,6 +115,22 @@ class Viewport {
         return false;
     }
 
+    /// Keeps showing the same lines while lines are being discarded from the top of the scrollback.
+    ///
+    /// Must be called with the screen being locked.
+    void followLineIds()
+    {
+        if (!scrollOffset_.has_value())
+            return;
+
+        if (auto const line = screen_.grid().absoluteLineOf(topLineId_); line.has_value())
+            scrollToAbsolute(*line);
+        else if (historyLineCount() > 0)
+            scrollToAbsolute(std::min(scrollOffset_.value(), historyLineCount() - 1)); // e.g. reflowed
+        else
+            forceScrollToBottom();
+    }
+
     bool scrollMarkUp()
     {
         if (scrollingDisabled())
@@ -140,6 +158,33 @@ class Viewport {
         return true;
     }
 
+    /// Scrolls to the previous line (above the viewport's top line) containing a search match.
+    bool scrollToPreviousSearchMatch(ScrollbackSearch const& _search)
+    {
+        if (scrollingDisabled())
+            return false;
+
+        auto const match = _search.findMatchBackward(absoluteScrollOffset().value_or(historyLineCount()));
+        if (match.has_value())
+            return scrollToAbsolute(match->from.row);
+
+        return false;
+    }
+
+    /// Scrolls to the next line (below the viewport's top line) containing a search match,
+    /// or to the bottom if there is none.
+    bool scrollToNextSearchMatch(ScrollbackSearch const& _search)
+    {
+        if (scrollingDisabled())
+            return false;
+
+        auto const match = _search.findMatchForward(absoluteScrollOffset().value_or(historyLineCount()));
+        if (match.has_value())
+            return scrollToAbsolute(match->from.row);
+        else
+            return forceScrollToBottom();
+    }
+
   private:
     int historyLineCount() const noexcept { return screen_.historyLineCount(); }
     int screenLineCount() const noexcept { return screen_.size().height; }
@@ -153,6 +198,7 @@ class Viewport {
   private:
     Screen& screen_;
     std::optional<int> scrollOffset_; //!< scroll offset relative to scroll top (0) or nullopt if not scrolled into history
+    LineId topLineId_ = 0;            //!< id of the top line while scrolled into history
 };
 
 }
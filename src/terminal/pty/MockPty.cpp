@@ -0,0 +1,106 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/pty/MockPty.h>
+
+#include <algorithm>
+#include <cstring>
+
+using std::lock_guard;
+using std::min;
+using std::optional;
+using std::string_view;
+using std::unique_lock;
+
+namespace terminal {
+
+MockPty::MockPty(Size const& windowSize) :
+    size_{ windowSize }
+{
+}
+
+MockPty::~MockPty()
+{
+    close();
+}
+
+int MockPty::read(char* buf, size_t size)
+{
+    auto _l = unique_lock{lock_};
+    outputAvailable_.wait(_l, [this]() { return outputOffset_ < outputBuffer_.size() || closed_; });
+
+    if (outputOffset_ == outputBuffer_.size())
+        return -1; // closed, and all output has been read.
+
+    auto const n = min(size, outputBuffer_.size() - outputOffset_);
+    std::memcpy(buf, outputBuffer_.data() + outputOffset_, n);
+    outputOffset_ += n;
+
+    if (outputOffset_ == outputBuffer_.size())
+    {
+        outputBuffer_.clear();
+        outputOffset_ = 0;
+    }
+
+    return static_cast<int>(n);
+}
+
+int MockPty::write(char const* buf, size_t size)
+{
+    inputBuffer_.append(buf, size);
+    return static_cast<int>(size);
+}
+
+Size MockPty::screenSize() const noexcept
+{
+    return size_;
+}
+
+void MockPty::resizeScreen(Size _cells, optional<Size> /*_pixels*/)
+{
+    size_ = _cells;
+}
+
+void MockPty::prepareChildProcess()
+{
+}
+
+void MockPty::prepareParentProcess()
+{
+}
+
+void MockPty::close()
+{
+    {
+        auto _l = lock_guard{lock_};
+        closed_ = true;
+    }
+    outputAvailable_.notify_all();
+}
+
+void MockPty::appendStdOut(string_view _data)
+{
+    {
+        auto _l = lock_guard{lock_};
+        outputBuffer_.append(_data.data(), _data.size());
+    }
+    outputAvailable_.notify_all();
+}
+
+bool MockPty::isClosed() const
+{
+    auto _l = lock_guard{lock_};
+    return closed_;
+}
+
+} // end namespace
@@ -15,15 +15,24 @@
 
 #include <terminal/pty/Pty.h>
 
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <string_view>
+
 namespace terminal {
 
-/// Mock-PTY, to be used in unit tests.
+/// Mock-PTY, to be used in unit tests and benchmarks.
+///
+/// Instead of talking to a child process, the application's output is fed in via appendStdOut(),
+/// and whatever the terminal sends to the application is collected in stdinBuffer().
 class MockPty : public Pty
 {
   public:
     explicit MockPty(Size const& windowSize);
     ~MockPty() override;
 
+    /// Blocks until application output is available or the PTY has been closed.
     int read(char* buf, size_t size) override;
     int write(char const* buf, size_t size) override;
     Size screenSize() const noexcept override;
@@ -33,10 +42,22 @@ class MockPty : public Pty
     void prepareParentProcess() override;
     void close() override;
 
+    /// Appends @p _data to the output as if it had been written by the application.
+    void appendStdOut(std::string_view _data);
+
+    /// @returns everything written to the application so far. Only access this from the writing thread.
+    std::string& stdinBuffer() noexcept { return inputBuffer_; }
+
+    bool isClosed() const;
+
   private:
     Size size_;
     std::string inputBuffer_;
     std::string outputBuffer_;
+    size_t outputOffset_ = 0;
+    bool closed_ = false;
+    std::mutex mutable lock_;
+    std::condition_variable outputAvailable_;
 };
 
 } // end namespace
@@ -47,6 +47,10 @@ class Pty {
     /// @returns number of bytes stored in @p buf or -1 on error.
     virtual int read(char* buf, size_t size) = 0;
 
+    /// @returns a file descriptor that can be watched for readability (see PtyReactor),
+    ///          or -1 if output can only be retrieved via blocking read() calls.
+    virtual int pollableHandle() const noexcept { return -1; }
+
     /// Writes to the PTY device, so the other end can read from it.
     ///
     /// @param buf    Buffer of data to be written.
@@ -0,0 +1,229 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/pty/PtyReactor.h>
+
+#include <crispy/debuglog.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using std::lock_guard;
+using std::runtime_error;
+using namespace std::string_literals;
+
+namespace terminal {
+
+namespace {
+    auto const PtyReactorTag = crispy::debugtag::make("pty.reactor", "Logs PTY reactor registrations and hang-ups.");
+
+    /// epoll user data value reserved for the reactor's own wakeup event.
+    constexpr PtyReactor::Id WakeupId = 0;
+
+    /// Maximum number of reads per source and wakeup, so that a single very busy PTY
+    /// cannot starve the others that are served by the same reactor.
+    constexpr int MaxReadsPerWakeup = 4;
+}
+
+PtyReactor::PtyReactor() :
+    epollFd_{ epoll_create1(EPOLL_CLOEXEC) },
+    wakeupFd_{ eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK) },
+    running_{ true },
+    readBuffer_(ReadBufferSize)
+{
+    if (epollFd_ < 0)
+        throw runtime_error{ "Failed to create epoll instance. "s + strerror(errno) };
+
+    if (wakeupFd_ < 0)
+        throw runtime_error{ "Failed to create eventfd. "s + strerror(errno) };
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = WakeupId;
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeupFd_, &ev) < 0)
+        throw runtime_error{ "Failed to watch eventfd. "s + strerror(errno) };
+
+    thread_ = std::thread{ [this]() { run(); } };
+}
+
+PtyReactor::~PtyReactor()
+{
+    running_ = false;
+    uint64_t const one = 1;
+    [[maybe_unused]] auto const _ = ::write(wakeupFd_, &one, sizeof(one));
+    thread_.join();
+
+    for (auto const& [id, source] : sources_)
+        ::close(source.fd);
+
+    ::close(wakeupFd_);
+    ::close(epollFd_);
+}
+
+PtyReactor& PtyReactor::get()
+{
+    static PtyReactor reactor;
+    return reactor;
+}
+
+PtyReactor::Id PtyReactor::add(int _fd, Handler& _handler)
+{
+    int const fd = fcntl(_fd, F_DUPFD_CLOEXEC, 0);
+    if (fd < 0)
+        throw runtime_error{ "Failed to duplicate PTY file descriptor. "s + strerror(errno) };
+
+    auto _l = lock_guard{lock_};
+    auto const id = nextId_++;
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = id;
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) < 0)
+    {
+        auto const error = errno;
+        ::close(fd);
+        throw runtime_error{ "Failed to watch PTY. "s + strerror(error) };
+    }
+
+    sources_.emplace(id, Source{fd, &_handler, false});
+    debuglog(PtyReactorTag).write("Watching PTY fd {} as #{} ({} total).", _fd, id, sources_.size());
+    return id;
+}
+
+void PtyReactor::remove(Id _id)
+{
+    auto _l = lock_guard{lock_};
+    removeLocked(_id);
+}
+
+void PtyReactor::removeLocked(Id _id)
+{
+    if (auto const i = sources_.find(_id); i != sources_.end())
+    {
+        if (!i->second.paused)
+            epoll_ctl(epollFd_, EPOLL_CTL_DEL, i->second.fd, nullptr);
+        ::close(i->second.fd);
+        sources_.erase(i);
+        debuglog(PtyReactorTag).write("Unwatched PTY #{} ({} left).", _id, sources_.size());
+    }
+}
+
+void PtyReactor::resume(Id _id)
+{
+    auto _l = lock_guard{lock_};
+    auto const i = sources_.find(_id);
+    if (i == sources_.end() || !i->second.paused)
+        return;
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = _id;
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, i->second.fd, &ev) < 0)
+    {
+        debuglog(PtyReactorTag).write("Failed to resume PTY #{}. {}", _id, strerror(errno));
+        return;
+    }
+
+    i->second.paused = false;
+    debuglog(PtyReactorTag).write("Resumed reading PTY #{}.", _id);
+}
+
+size_t PtyReactor::size() const
+{
+    auto _l = lock_guard{lock_};
+    return sources_.size();
+}
+
+void PtyReactor::run()
+{
+    auto events = std::array<epoll_event, 32>{};
+
+    while (running_)
+    {
+        int const count = epoll_wait(epollFd_, events.data(), static_cast<int>(events.size()), -1);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            debuglog(PtyReactorTag).write("epoll_wait failed. {}", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            if (events[i].data.u64 == WakeupId)
+            {
+                uint64_t value{};
+                [[maybe_unused]] auto const _ = ::read(wakeupFd_, &value, sizeof(value));
+                continue;
+            }
+
+            auto _l = lock_guard{lock_};
+            drain(events[i].data.u64);
+        }
+    }
+}
+
+void PtyReactor::drain(Id _id)
+{
+    auto const i = sources_.find(_id);
+    if (i == sources_.end())
+        return; // has been removed while this event was pending.
+
+    auto& source = i->second;
+
+    for (int k = 0; k < MaxReadsPerWakeup; ++k)
+    {
+        auto const n = ::read(source.fd, readBuffer_.data(), readBuffer_.size());
+        if (n > 0)
+        {
+            if (!source.handler->onPtyData(readBuffer_.data(), static_cast<size_t>(n)))
+            {
+                // Paused sources are removed from the epoll set entirely (rather than just
+                // clearing their event mask), as hang-ups would otherwise still be reported.
+                epoll_ctl(epollFd_, EPOLL_CTL_DEL, source.fd, nullptr);
+                source.paused = true;
+                debuglog(PtyReactorTag).write("Paused reading PTY #{}.", _id);
+                return;
+            }
+
+            // A short read means the kernel buffer has been drained, which spares us
+            // the otherwise inevitable EAGAIN round-trip.
+            if (static_cast<size_t>(n) < readBuffer_.size())
+                return;
+        }
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else
+        {
+            // EOF or EIO, the slave side has been hung up.
+            debuglog(PtyReactorTag).write("PTY #{} closed. {}", _id, n < 0 ? strerror(errno) : "EOF");
+            auto* const handler = source.handler;
+            removeLocked(_id);
+            handler->onPtyClosed();
+            return;
+        }
+    }
+}
+
+} // end namespace
@@ -0,0 +1,116 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace terminal {
+
+/// Event driven PTY output reader, multiplexing any number of PTY master devices
+/// onto a single I/O thread (via epoll).
+///
+/// Registered file descriptors must be in non-blocking mode. Whenever one becomes
+/// readable, it is drained into a reusable read buffer and the data is handed over
+/// to the registered Handler, all on the reactor's thread.
+///
+/// A handler may apply backpressure by refusing further data, in which case the PTY
+/// is not read from anymore until resume() is called.
+class PtyReactor {
+  public:
+    class Handler {
+      public:
+        virtual ~Handler() = default;
+
+        /// Invoked on the reactor thread with freshly read PTY output.
+        ///
+        /// @retval true  more data may be read from the PTY.
+        /// @retval false the PTY must not be read from until PtyReactor::resume() is called.
+        virtual bool onPtyData(char const* _data, size_t _size) = 0;
+
+        /// Invoked on the reactor thread once the PTY has been hung up or failed.
+        ///
+        /// The registration has been removed already at the time this is called.
+        virtual void onPtyClosed() = 0;
+    };
+
+    using Id = uint64_t;
+
+    /// Size of the reusable read buffer. Also the upper bound of a single onPtyData() call.
+    static constexpr size_t ReadBufferSize = 64 * 1024;
+
+    PtyReactor();
+    ~PtyReactor();
+
+    PtyReactor(PtyReactor const&) = delete;
+    PtyReactor(PtyReactor&&) = delete;
+    PtyReactor& operator=(PtyReactor const&) = delete;
+    PtyReactor& operator=(PtyReactor&&) = delete;
+
+    /// @returns the process wide reactor instance, that is shared across all terminals.
+    static PtyReactor& get();
+
+    /// Starts watching @p _fd for readability.
+    ///
+    /// The file descriptor is duplicated internally, so that the owner may close its
+    /// own descriptor at any time without silently dropping the hang-up notification.
+    ///
+    /// @returns a registration ID to be passed to remove().
+    Id add(int _fd, Handler& _handler);
+
+    /// Stops watching the given registration.
+    ///
+    /// When called from outside the reactor thread, this call blocks until
+    /// any currently running handler invocation has completed,
+    /// so that the handler may be safely destroyed afterwards.
+    void remove(Id _id);
+
+    /// Continues reading from a PTY that has been paused by its handler.
+    ///
+    /// This function may be called from any thread.
+    void resume(Id _id);
+
+    /// @returns number of currently watched PTY devices.
+    size_t size() const;
+
+  private:
+    struct Source {
+        int fd;
+        Handler* handler;
+        bool paused;
+    };
+
+    void run();
+    void drain(Id _id);
+    void removeLocked(Id _id);
+
+    int epollFd_ = -1;
+    int wakeupFd_ = -1;
+    std::atomic<bool> running_;
+
+    /// Guards sources_ and is held while dispatching to handlers.
+    std::recursive_mutex mutable lock_;
+    std::unordered_map<Id, Source> sources_;
+    Id nextId_ = 1;
+
+    std::vector<char> readBuffer_;
+    std::thread thread_;
+};
+
+} // end namespace
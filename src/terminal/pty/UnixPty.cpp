@@ -14,6 +14,7 @@
 #include <terminal/pty/UnixPty.h>
 
 #include <cassert>
+#include <cerrno>
 #include <cstddef>
 #include <cstdlib>
 #include <cstring>
@@ -28,12 +29,12 @@
 #endif
 
 #include <fcntl.h>
+#include <poll.h>
 #include <utmp.h>
 #include <pwd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/ioctl.h>
-#include <sys/select.h>
 #include <unistd.h>
 
 using std::runtime_error;
@@ -114,6 +115,10 @@ UnixPty::UnixPty(Size const& _windowSize) :
     // TODO: termios term{};
     if (openpty(&master_, &slave_, nullptr, /*&term*/ nullptr, wsa) < 0)
         throw runtime_error{ "Failed to open PTY. "s + strerror(errno) };
+
+    // The master end stays non-blocking for its entire lifetime.
+    if (fcntl(master_, F_SETFL, fcntl(master_, F_GETFL) | O_NONBLOCK) < 0)
+        throw runtime_error{ "Failed to configure PTY. "s + strerror(errno) };
 }
 
 UnixPty::~UnixPty()
@@ -138,52 +143,57 @@ void UnixPty::close()
 
 int UnixPty::read(char* buf, size_t size)
 {
-    ssize_t rv = ::read(master_, buf, size);
-    if (rv < 0 || rv >= static_cast<decltype(rv)>(size))
-        return rv;
-#if 1
-    //size_t const cap = size;
-    ssize_t nread = rv;
-    int i = 1;
-    size -= rv;
-    buf += rv;
-
-    auto const oldFlags = fcntl(master_, F_GETFL);
-    fcntl(master_, F_SETFL, oldFlags | O_NONBLOCK);
-
-    fd_set in, out, err;
-    FD_ZERO(&in);
-    FD_ZERO(&out);
-    FD_ZERO(&err);
-    FD_SET(master_, &in);
-
-    while (size > 0)
+    // The master device is in non-blocking mode (so it can be served by the PtyReactor),
+    // hence emulate a blocking read here for callers that are reading synchronously.
+    for (;;)
     {
-        ++i;
-        timeval tv{0, 0};
-        int const selected = select(master_ + 1, &in, &out, &err, &tv);
-        if (selected <= 0)
-            break;
-        rv = ::read(master_, buf, size);
-        if (rv < 0)
-            break;
-        nread += rv;
-        size -= rv;
-        buf += rv;
+        ssize_t const rv = ::read(master_, buf, size);
+        if (rv >= 0)
+            return static_cast<int>(rv);
+
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            if (!waitFor(POLLIN))
+                return -1;
+        }
+        else if (errno != EINTR)
+            return -1;
     }
-
-    fcntl(master_, F_SETFL, oldFlags);
-    //printf("pty.read: %zu/%zu bytes (%ld%%, #%d)\n", nread, cap, nread * 100 / cap, i);
-    return nread;
-#else
-    return rv;
-#endif
 }
 
 int UnixPty::write(char const* buf, size_t size)
 {
-    ssize_t rv = ::write(master_, buf, size);
-    return static_cast<int>(rv);
+    // Writes must not be short when the child is not consuming its input fast enough (e.g. large pastes).
+    size_t nwritten = 0;
+    while (nwritten < size)
+    {
+        ssize_t const rv = ::write(master_, buf + nwritten, size - nwritten);
+        if (rv >= 0)
+            nwritten += static_cast<size_t>(rv);
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            if (!waitFor(POLLOUT))
+                break;
+        }
+        else if (errno != EINTR)
+            break;
+    }
+    return nwritten != 0 || size == 0 ? static_cast<int>(nwritten) : -1;
+}
+
+bool UnixPty::waitFor(short _events)
+{
+    pollfd pfd{};
+    pfd.fd = master_;
+    pfd.events = _events;
+    for (;;)
+    {
+        int const rv = poll(&pfd, 1, -1);
+        if (rv > 0)
+            return (pfd.revents & (POLLERR | POLLNVAL)) == 0;
+        if (rv < 0 && errno != EINTR)
+            return false;
+    }
 }
 
 Size UnixPty::screenSize() const noexcept
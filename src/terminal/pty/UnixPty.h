@@ -33,6 +33,7 @@ class UnixPty : public Pty
 
     int read(char* buf, size_t size) override;
     int write(char const* buf, size_t size) override;
+    int pollableHandle() const noexcept override { return master_; }
     Size screenSize() const noexcept override;
     void resizeScreen(Size _cells, std::optional<Size> _pixels = std::nullopt) override;
 
@@ -41,6 +42,9 @@ class UnixPty : public Pty
     void close() override;
 
   private:
+    /// Blocks until the master device is ready for the given poll() @p _events.
+    bool waitFor(short _events);
+
     Size size_;
     int master_;
     int slave_;
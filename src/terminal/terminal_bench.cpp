@@ -0,0 +1,363 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// In-process microbenchmarks of libterminal's hot paths, without any GUI or GPU involved.
+//
+// Usage: terminal_bench [--repeat N] [--size MB] [FILTER...]
+//
+// Each scenario is run once for warm-up, followed by N measured runs, of which the median
+// and best run are reported. Only the workload is timed, not setting up the screen or
+// terminal it runs on. FILTER restricts the scenarios to those whose name contains it.
+
+#include <terminal/Screen.h>
+#include <terminal/ScreenEvents.h>
+#include <terminal/Selector.h>
+#include <terminal/Terminal.h>
+#include <terminal/pty/MockPty.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+using namespace terminal;
+
+namespace {
+
+constexpr auto PageSize = Size{200, 60};
+constexpr auto MaxHistoryLineCount = 10'000;
+
+/// Result of a single scenario run.
+struct Run {
+    uint64_t bytes;         // number of VT bytes processed (0 if not applicable)
+    uint64_t ops;           // number of scenario specific operations
+};
+
+struct Scenario {
+    string name;
+    string opName;          // what a single operation is, as reported in ns/op.
+    function<function<Run()>()> prepare;    // sets up a run and returns the part to be timed
+};
+
+class NullEvents : public ScreenEvents {};
+
+/// Screen along with the events it reports to, kept alive by the prepared run.
+struct ScreenFixture {
+    NullEvents events;
+    unique_ptr<Screen> screen;
+};
+
+shared_ptr<ScreenFixture> makeScreen(Size _size = PageSize)
+{
+    auto fixture = make_shared<ScreenFixture>();
+    fixture->screen = make_unique<Screen>(_size, fixture->events, false, false, MaxHistoryLineCount);
+    return fixture;
+}
+
+/// Terminal along with its events and PTY, kept alive by the prepared run.
+struct TerminalFixture {
+    Terminal::Events events;
+    MockPty* pty = nullptr;
+    unique_ptr<Terminal> terminal;
+
+    ~TerminalFixture()
+    {
+        if (pty)
+            pty->close();
+    }
+};
+
+/// Repeats @p _pattern until the result is at least @p _size bytes long.
+string repeatToSize(string const& _pattern, size_t _size)
+{
+    string result;
+    result.reserve(_size + _pattern.size());
+    while (result.size() < _size)
+        result += _pattern;
+    return result;
+}
+
+// {{{ workloads
+string plainText(size_t _size)
+{
+    string_view constexpr alphabet =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ "
+        "abcdefghijklmnopqrstuvwxyz "
+        "0123456789 []{}();+-*/=";
+
+    string line;
+    for (size_t i = 0; i < 120; ++i)
+        line += alphabet[i % alphabet.size()];
+    line += "\r\n";
+    return repeatToSize(line, _size);
+}
+
+string sgrText(size_t _size)
+{
+    string line;
+    for (int i = 0; i < 16; ++i)
+    {
+        line += fmt::format("\033[{};38;2;{};{};{};48;5;{}m", i % 2 ? 1 : 22, i * 16, 255 - i * 16, 128, 232 + i);
+        line += "word";
+        line += "\033[m ";
+    }
+    line += "\r\n";
+    return repeatToSize(line, _size);
+}
+
+string tuiRedraw(size_t _size, int& _frames)
+{
+    string frame;
+    for (int row = 1; row <= PageSize.height; ++row)
+    {
+        frame += fmt::format("\033[{};1H\033[{}m", row, 30 + row % 8);
+        for (int col = 0; col < PageSize.width - 10; ++col)
+            frame += static_cast<char>('a' + (row + col) % 26);
+        frame += "\033[K";
+    }
+    frame += "\033[H";
+
+    _frames = static_cast<int>((_size + frame.size() - 1) / frame.size());
+    return repeatToSize(frame, _size);
+}
+
+string scrollRegion(size_t _size)
+{
+    string line = "\033[5;50r\033[50;1H";
+    for (int i = 0; i < 100; ++i)
+        line += fmt::format("line {} inside the scrolling region\n", i);
+    line += "\033[r";
+    return repeatToSize(line, _size);
+}
+
+string wideText(size_t _size)
+{
+    string line;
+    for (int i = 0; i < 8; ++i)
+        line += u8"漢字かなカナ한국어 \U0001F600\U0001F680❗ ";
+    line += "\r\n";
+    return repeatToSize(line, _size);
+}
+
+string sixelImage(int _width, int _height)
+{
+    string image = "\033Pq\"1;1;" + to_string(_width) + ";" + to_string(_height);
+    image += "#0;2;100;0;0#1;2;0;100;0";
+    for (int band = 0; band < (_height + 5) / 6; ++band)
+    {
+        image += band % 2 ? "#0" : "#1";
+        image += '!' + to_string(_width) + '~';
+        image += '-';
+    }
+    image += "\033\\";
+    return image;
+}
+// }}}
+
+// {{{ scenarios
+Scenario screenWrite(string _name, string _opName, function<string()> _makeData)
+{
+    auto data = make_shared<string>();
+    return Scenario{
+        move(_name),
+        move(_opName),
+        [data, makeData = move(_makeData)]() -> function<Run()> {
+            if (data->empty())
+                *data = makeData();
+            return [data, fixture = makeScreen()]() {
+                fixture->screen->write(data->data(), data->size());
+                return Run{data->size(), data->size()};
+            };
+        }
+    };
+}
+
+vector<Scenario> makeScenarios(size_t _size)
+{
+    vector<Scenario> scenarios;
+
+    scenarios.emplace_back(screenWrite("text.ascii", "byte", [=]() { return plainText(_size); }));
+    scenarios.emplace_back(screenWrite("text.sgr", "byte", [=]() { return sgrText(_size); }));
+    scenarios.emplace_back(screenWrite("text.wide", "byte", [=]() { return wideText(_size); }));
+    scenarios.emplace_back(screenWrite("scroll.region", "byte", [=]() { return scrollRegion(_size); }));
+
+    {
+        int frames = 0;
+        auto const data = make_shared<string>(tuiRedraw(_size, frames));
+        scenarios.emplace_back(Scenario{"tui.redraw", "frame", [data, frames]() -> function<Run()> {
+            return [data, frames, fixture = makeScreen()]() {
+                fixture->screen->write(data->data(), data->size());
+                return Run{data->size(), static_cast<uint64_t>(frames)};
+            };
+        }});
+    }
+
+    {
+        auto constexpr ImageCount = 20;
+        auto const image = make_shared<string>(sixelImage(400, 240));
+        scenarios.emplace_back(Scenario{"sixel", "image", [image]() -> function<Run()> {
+            auto fixture = makeScreen();
+            fixture->screen->setCellPixelSize(Size{10, 20}); // the image covers 40x12 cells
+            return [image, fixture]() {
+                for (int i = 0; i < ImageCount; ++i)
+                {
+                    fixture->screen->write("\033[H");
+                    fixture->screen->write(image->data(), image->size());
+                }
+                return Run{image->size() * ImageCount, ImageCount};
+            };
+        }});
+    }
+
+    {
+        auto const text = make_shared<string>(plainText(2 * 1024 * 1024));
+        scenarios.emplace_back(Scenario{"resize.reflow", "resize", [text]() -> function<Run()> {
+            auto fixture = makeScreen(Size{80, 25});
+            fixture->screen->write(text->data(), text->size());
+            return [fixture]() {
+                auto constexpr ResizeCount = 20;
+                for (int i = 0; i < ResizeCount; ++i)
+                    fixture->screen->resize(i % 2 ? Size{80, 25} : Size{133, 40});
+                return Run{0, ResizeCount};
+            };
+        }});
+    }
+
+    {
+        auto const text = make_shared<string>(plainText(1024 * 1024));
+        scenarios.emplace_back(Scenario{"selection.extract", "cell", [text]() -> function<Run()> {
+            auto fixture = makeScreen();
+            fixture->screen->write(text->data(), text->size());
+            return [fixture]() {
+                auto& screen = *fixture->screen;
+                auto const lastRow = static_cast<int>(screen.historyLineCount()) + PageSize.height - 1;
+                auto selector = Selector{Selector::Mode::Linear, U" ", screen, Coordinate{0, 1}};
+                selector.extend(Coordinate{lastRow, PageSize.width});
+                selector.stop();
+
+                uint64_t cells = 0;
+                string extracted;
+                selector.render([&](Coordinate const&, Cell const& _cell) {
+                    extracted += _cell.toUtf8();
+                    ++cells;
+                });
+                return Run{extracted.size(), cells};
+            };
+        }});
+    }
+
+    {
+        auto const text = make_shared<string>(sgrText(_size));
+        scenarios.emplace_back(Scenario{"terminal.pipeline", "byte", [text]() -> function<Run()> {
+            auto fixture = make_shared<TerminalFixture>();
+            auto pty = make_unique<MockPty>(PageSize);
+            fixture->pty = pty.get();
+            fixture->terminal = make_unique<Terminal>(move(pty), fixture->events, size_t{MaxHistoryLineCount});
+            return [text, fixture]() {
+                fixture->pty->appendStdOut(*text);
+                while (fixture->terminal->ptyBufferStats().sliceBytes < text->size())
+                    this_thread::yield();
+                return Run{text->size(), text->size()};
+            };
+        }});
+    }
+
+    return scenarios;
+}
+// }}}
+
+void printResult(Scenario const& _scenario, vector<pair<Run, nanoseconds>> _runs)
+{
+    sort(_runs.begin(), _runs.end(), [](auto const& a, auto const& b) { return a.second < b.second; });
+    auto const& [run, median] = _runs[_runs.size() / 2];
+    auto const best = _runs.front().second;
+
+    auto const mbps = [&](nanoseconds _time) -> string {
+        if (!run.bytes)
+            return "-";
+        auto const seconds = duration<double>(_time).count();
+        return fmt::format("{:.2f}", static_cast<double>(run.bytes) / (1024.0 * 1024.0) / seconds);
+    };
+
+    auto const nsPerOp = run.ops ? static_cast<double>(median.count()) / static_cast<double>(run.ops) : 0.0;
+
+    cout << fmt::format("{:<20} {:>10} {:>10} {:>12.1f} ns/{:<8} {:>10.2f} ms\n",
+                        _scenario.name,
+                        mbps(median),
+                        mbps(best),
+                        nsPerOp,
+                        _scenario.opName,
+                        duration<double, std::milli>(median).count());
+}
+
+} // end namespace
+
+int main(int argc, char const* argv[])
+{
+    auto repeat = 5;
+    auto sizeMB = size_t{16};
+    vector<string_view> filters;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        auto const arg = string_view(argv[i]);
+        if (arg == "--repeat" && i + 1 < argc)
+            repeat = max(1, atoi(argv[++i]));
+        else if (arg == "--size" && i + 1 < argc)
+            sizeMB = static_cast<size_t>(max(1, atoi(argv[++i])));
+        else if (arg == "--help" || arg == "-h")
+        {
+            cout << "Usage: " << argv[0] << " [--repeat N] [--size MB] [FILTER...]\n";
+            return EXIT_SUCCESS;
+        }
+        else
+            filters.emplace_back(arg);
+    }
+
+    cout << fmt::format("{:<20} {:>10} {:>10} {:>24} {:>13}\n", "scenario", "MB/s (med)", "MB/s (best)", "median per op", "median");
+
+    for (auto const& scenario : makeScenarios(sizeMB * 1024 * 1024))
+    {
+        auto const selected = filters.empty() || any_of(filters.begin(), filters.end(), [&](string_view f) {
+            return scenario.name.find(f) != string::npos;
+        });
+        if (!selected)
+            continue;
+
+        scenario.prepare()(); // warm-up
+
+        vector<pair<Run, nanoseconds>> runs;
+        for (int i = 0; i < repeat; ++i)
+        {
+            auto const run = scenario.prepare();
+            auto const start = steady_clock::now();
+            auto const result = run();
+            runs.emplace_back(result, steady_clock::now() - start);
+        }
+
+        printResult(scenario, move(runs));
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,308 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Hosts many headless terminal sessions in a single process, all sharing the PtyReactor and
+// a ParserPool, and reports the memory and CPU time spent per session.
+//
+// Usage: terminal_headless_bench [--idle N] [--active N] [--size KB] [--threads N] [--history N]
+//
+// Idle sessions merely receive a shell prompt, whereas active sessions each receive
+// KB kilobytes of colored text output. Instead of kernel PTYs, which are a rather limited
+// resource, each session is connected to a socket pair.
+//
+// The defaults (2000 idle and 50 active sessions, 64 KB each, 1000 history lines) take about
+// 900 MB of memory, as an active session's memory is dominated by its filled up scrollback.
+
+#include <terminal/ParserPool.h>
+#include <terminal/Terminal.h>
+#include <terminal/pty/Pty.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace std::chrono;
+using namespace terminal;
+
+namespace {
+
+constexpr auto PageSize = Size{80, 24};
+
+/// Pty whose application side is one end of a socket pair, written to by the benchmark.
+class SocketPty : public Pty {
+  public:
+    SocketPty()
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0)
+            throw runtime_error{fmt::format("Failed to create socket pair. {}", strerror(errno))};
+        master_ = fds[0];
+        application_ = fds[1];
+        fcntl(master_, F_SETFL, fcntl(master_, F_GETFL) | O_NONBLOCK);
+    }
+
+    ~SocketPty() override
+    {
+        close();
+    }
+
+    /// Writes @p _data as if it was output of the application.
+    void feed(string_view _data)
+    {
+        while (!_data.empty())
+        {
+            auto const n = ::write(application_, _data.data(), _data.size());
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0)
+                throw runtime_error{fmt::format("Failed to write to session. {}", strerror(errno))};
+            _data.remove_prefix(static_cast<size_t>(n));
+        }
+    }
+
+    void close() override
+    {
+        for (int* fd : {&master_, &application_})
+        {
+            if (*fd >= 0)
+                ::close(*fd);
+            *fd = -1;
+        }
+    }
+
+    void prepareParentProcess() override {}
+    void prepareChildProcess() override {}
+    int read(char* _buf, size_t _size) override { return static_cast<int>(::read(master_, _buf, _size)); }
+    int pollableHandle() const noexcept override { return master_; }
+    int write(char const*, size_t _size) override { return static_cast<int>(_size); } // input is discarded
+    Size screenSize() const noexcept override { return PageSize; }
+    void resizeScreen(Size, optional<Size>) override {}
+
+  private:
+    int master_ = -1;
+    int application_ = -1;
+};
+
+struct Session {
+    Terminal::Events events;    // headless, all events are ignored.
+    SocketPty* pty;
+    unique_ptr<Terminal> terminal;
+};
+
+unique_ptr<Session> createSession(ParserPool& _pool, size_t _maxHistoryLineCount)
+{
+    auto session = make_unique<Session>();
+    auto pty = make_unique<SocketPty>();
+    session->pty = pty.get();
+    session->terminal = make_unique<Terminal>(move(pty),
+                                              session->events,
+                                              _maxHistoryLineCount,
+                                              milliseconds{500},
+                                              steady_clock::now(),
+                                              "",
+                                              Size{800, 600},
+                                              256,
+                                              true,
+                                              &_pool);
+    return session;
+}
+
+/// Blocks until all output fed to the given sessions has been processed.
+void waitProcessed(vector<unique_ptr<Session>> const& _sessions, uint64_t _bytes)
+{
+    for (auto const& session : _sessions)
+        while (session->terminal->ptyBufferStats().sliceBytes < _bytes)
+            this_thread::sleep_for(milliseconds{1});
+}
+
+/// @returns resident set size of this process in bytes.
+size_t residentSetSize()
+{
+    auto statm = ifstream("/proc/self/statm");
+    size_t pages = 0;
+    size_t resident = 0;
+    statm >> pages >> resident;
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+/// @returns number of threads of this process.
+int threadCount()
+{
+    auto status = ifstream("/proc/self/status");
+    for (string line; getline(status, line); )
+        if (line.rfind("Threads:", 0) == 0)
+            return atoi(line.c_str() + 8);
+    return 0;
+}
+
+/// @returns CPU time (user and system) consumed by this process so far.
+nanoseconds cpuTime()
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    auto const toNanos = [](timeval const& tv) { return seconds(tv.tv_sec) + microseconds(tv.tv_usec); };
+    return toNanos(usage.ru_utime) + toNanos(usage.ru_stime);
+}
+
+/// Colored, `ls -l` like output to be fed to the active sessions.
+string makeOutput(size_t _size)
+{
+    auto output = string{};
+    for (int i = 0; output.size() < _size; ++i)
+        output += fmt::format("-rw-r--r-- 1 user user {:>8} Jan  1 00:00 \033[1;3{}mfile-{}.txt\033[m\r\n",
+                              i * 37 % 100000, i % 7 + 1, i);
+    output.resize(_size);
+    return output;
+}
+
+double perSession(double _value, size_t _count)
+{
+    return _count ? _value / static_cast<double>(_count) : 0.0;
+}
+
+/// Raises the limit of open file descriptors as far as permitted, as every session takes three.
+void raiseFileLimit(size_t _sessionCount)
+{
+    rlimit limit{};
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur < _sessionCount * 3 + 64)
+        cerr << fmt::format("Warning: file descriptor limit {} is likely too low for {} sessions.\n",
+                            limit.rlim_cur, _sessionCount);
+}
+
+} // end namespace
+
+int main(int argc, char const* argv[])
+{
+    size_t idleCount = 2000;
+    size_t activeCount = 50;
+    size_t outputKB = 64;
+    size_t threads = thread::hardware_concurrency();
+    size_t maxHistoryLineCount = 1000;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        auto const arg = string_view(argv[i]);
+        auto const next = [&]() { return static_cast<size_t>(max(0, atoi(argv[++i]))); };
+        if (arg == "--idle" && i + 1 < argc)
+            idleCount = next();
+        else if (arg == "--active" && i + 1 < argc)
+            activeCount = next();
+        else if (arg == "--size" && i + 1 < argc)
+            outputKB = next();
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = next();
+        else if (arg == "--history" && i + 1 < argc)
+            maxHistoryLineCount = next();
+        else
+        {
+            cout << "Usage: " << argv[0] << " [--idle N] [--active N] [--size KB] [--threads N] [--history N]\n";
+            return arg == "--help" || arg == "-h" ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    raiseFileLimit(idleCount + activeCount);
+
+    auto pool = ParserPool{threads};
+    auto const prompt = string_view("\033[1;32muser@host\033[m:\033[1;34m~\033[m$ ");
+
+    // {{{ idle sessions
+    auto const rssBefore = residentSetSize();
+    auto const idleCpuBefore = cpuTime();
+    auto const idleStart = steady_clock::now();
+
+    vector<unique_ptr<Session>> idle;
+    idle.reserve(idleCount);
+    for (size_t i = 0; i < idleCount; ++i)
+    {
+        idle.emplace_back(createSession(pool, maxHistoryLineCount));
+        idle.back()->pty->feed(prompt);
+    }
+    waitProcessed(idle, prompt.size());
+
+    auto const idleTime = steady_clock::now() - idleStart;
+    auto const idleCpu = cpuTime() - idleCpuBefore;
+    auto const idleRss = residentSetSize() - rssBefore;
+    // }}}
+
+    // {{{ active sessions
+    auto const output = makeOutput(outputKB * 1024);
+    auto const rssBeforeActive = residentSetSize();
+
+    vector<unique_ptr<Session>> active;
+    active.reserve(activeCount);
+    for (size_t i = 0; i < activeCount; ++i)
+        active.emplace_back(createSession(pool, maxHistoryLineCount));
+
+    auto const activeCpuBefore = cpuTime();
+    auto const activeStart = steady_clock::now();
+
+    // Feeds all sessions in turns, such that they are busy at the same time.
+    constexpr size_t ChunkSize = 4096;
+    for (size_t offset = 0; offset < output.size(); offset += ChunkSize)
+        for (auto& session : active)
+            session->pty->feed(string_view(output).substr(offset, ChunkSize));
+    waitProcessed(active, output.size());
+
+    auto const activeTime = steady_clock::now() - activeStart;
+    auto const activeCpu = cpuTime() - activeCpuBefore;
+    auto const activeRss = residentSetSize() - rssBeforeActive;
+    // }}}
+
+    auto const ms = [](auto d) { return duration<double, std::milli>(d).count(); };
+    auto const kb = [](size_t bytes) { return static_cast<double>(bytes) / 1024.0; };
+
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    cout << fmt::format("{} parser pool threads, {} process threads, {}x{} cells, {} history lines, peak RSS {} MB\n",
+                        pool.threadCount(), threadCount(), PageSize.width, PageSize.height, maxHistoryLineCount,
+                        usage.ru_maxrss / 1024);
+    cout << fmt::format("{:<8} {:>8} {:>14} {:>16} {:>12} {:>14}\n",
+                        "sessions", "count", "RSS/session", "CPU/session", "wall time", "throughput");
+    cout << fmt::format("{:<8} {:>8} {:>11.1f} KB {:>13.3f} ms {:>9.1f} ms {:>14}\n",
+                        "idle", idleCount,
+                        perSession(kb(idleRss), idleCount),
+                        perSession(ms(idleCpu), idleCount),
+                        ms(idleTime),
+                        "-");
+    cout << fmt::format("{:<8} {:>8} {:>11.1f} KB {:>13.3f} ms {:>9.1f} ms {:>9.1f} MB/s\n",
+                        "active", activeCount,
+                        perSession(kb(activeRss), activeCount),
+                        perSession(ms(activeCpu), activeCount),
+                        ms(activeTime),
+                        static_cast<double>(output.size() * activeCount) / 1024.0 / 1024.0
+                            / duration<double>(activeTime).count());
+
+    active.clear();
+    idle.clear();
+
+    return EXIT_SUCCESS;
+}
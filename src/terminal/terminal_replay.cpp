@@ -0,0 +1,208 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays a session recording into a headless Terminal, for reproducing performance problems.
+//
+// Usage: terminal_replay [--realtime] [--fps N] FILE
+//
+// By default, the recorded output is fed in as fast as possible. With --realtime, the recorded
+// timing is preserved. Frames are taken (as render snapshots) whenever the screen got updated,
+// at most N times per second (default: 60, 0 for no limit).
+
+#include <terminal/RenderSnapshot.h>
+#include <terminal/SessionRecording.h>
+#include <terminal/Terminal.h>
+#include <terminal/pty/MockPty.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+using namespace terminal;
+
+namespace {
+
+/// Wakes up the frame loop whenever the terminal's screen got updated.
+class FrameTrigger : public Terminal::Events {
+  public:
+    void screenUpdated() override
+    {
+        {
+            auto _l = lock_guard{lock_};
+            dirty_ = true;
+        }
+        updated_.notify_one();
+    }
+
+    /// Waits until the screen got updated or @p _deadline is reached.
+    ///
+    /// @returns whether or not the screen got updated.
+    bool wait(steady_clock::time_point _deadline)
+    {
+        auto _l = unique_lock{lock_};
+        updated_.wait_until(_l, _deadline, [this]() { return dirty_; });
+        return exchange(dirty_, false);
+    }
+
+  private:
+    mutex lock_;
+    condition_variable updated_;
+    bool dirty_ = false;
+};
+
+nanoseconds percentile(vector<nanoseconds> const& _sorted, double _p)
+{
+    if (_sorted.empty())
+        return nanoseconds::zero();
+    auto const i = static_cast<size_t>(_p * static_cast<double>(_sorted.size() - 1) + 0.5);
+    return _sorted[i];
+}
+
+double toMicroseconds(nanoseconds _value)
+{
+    return duration<double, std::micro>(_value).count();
+}
+
+} // end namespace
+
+int main(int argc, char const* argv[])
+{
+    auto realtime = false;
+    auto fps = 60;
+    auto path = string{};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        auto const arg = string_view(argv[i]);
+        if (arg == "--realtime")
+            realtime = true;
+        else if (arg == "--fps" && i + 1 < argc)
+            fps = max(0, atoi(argv[++i]));
+        else if (arg == "--help" || arg == "-h" || !path.empty())
+        {
+            cout << "Usage: " << argv[0] << " [--realtime] [--fps N] FILE\n";
+            return arg == "--help" || arg == "-h" ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        else
+            path = string(arg);
+    }
+
+    if (path.empty())
+    {
+        cerr << "Usage: " << argv[0] << " [--realtime] [--fps N] FILE\n";
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        auto const recording = SessionRecording::load(path);
+        auto const totalBytes = recording.outputBytes();
+
+        auto trigger = FrameTrigger{};
+        auto pty = make_unique<MockPty>(recording.size);
+        auto& mockPty = *pty;
+        auto term = Terminal{move(pty), trigger};
+
+        auto const start = steady_clock::now();
+        auto feeder = thread{[&]() {
+            for (auto const& event : recording.events)
+            {
+                if (realtime)
+                    this_thread::sleep_until(start + event.time);
+
+                switch (event.type)
+                {
+                    case RecordingEventType::Output:
+                        mockPty.appendStdOut(event.output);
+                        break;
+                    case RecordingEventType::Resize:
+                        term.resizeScreen(event.size, nullopt);
+                        break;
+                }
+            }
+        }};
+
+        // Frame loop: takes a render snapshot per screen update, just like the GUI does.
+        auto const frameInterval = fps ? nanoseconds(seconds(1)) / fps : nanoseconds::zero();
+        auto snapshot = RenderSnapshot{};
+        auto frameTimes = vector<nanoseconds>{};
+        auto lastFrame = steady_clock::time_point{};
+        auto processed = uint64_t{0};
+
+        while (processed < totalBytes)
+        {
+            if (!trigger.wait(steady_clock::now() + milliseconds(100)))
+            {
+                processed = term.ptyBufferStats().sliceBytes;
+                continue;
+            }
+
+            if (frameInterval.count())
+                this_thread::sleep_until(lastFrame + frameInterval);
+
+            auto const frameStart = steady_clock::now();
+            term.takeSnapshot(snapshot, frameStart);
+            lastFrame = steady_clock::now();
+            frameTimes.emplace_back(lastFrame - frameStart);
+
+            processed = term.ptyBufferStats().sliceBytes;
+        }
+
+        auto const elapsed = steady_clock::now() - start;
+        feeder.join();
+        mockPty.close();
+
+        sort(frameTimes.begin(), frameTimes.end());
+
+        auto const elapsedSeconds = duration<double>(elapsed).count();
+        auto const ptyStats = term.ptyBufferStats();
+        cout << fmt::format("recording:      {} ({} events, {:.2f} MB, {}x{})\n",
+                            path,
+                            recording.events.size(),
+                            static_cast<double>(totalBytes) / (1024.0 * 1024.0),
+                            recording.size.width,
+                            recording.size.height);
+        cout << fmt::format("mode:           {}\n", realtime ? "realtime" : "max-speed");
+        cout << fmt::format("elapsed:        {:.3f} s\n", elapsedSeconds);
+        cout << fmt::format("throughput:     {:.2f} MB/s ({} parser slices)\n",
+                            static_cast<double>(ptyStats.sliceBytes) / (1024.0 * 1024.0) / elapsedSeconds,
+                            ptyStats.sliceCount);
+        cout << fmt::format("frames:         {} ({:.1f} fps)\n",
+                            frameTimes.size(),
+                            static_cast<double>(frameTimes.size()) / elapsedSeconds);
+        cout << fmt::format("frame time:     p50 {:.1f} us, p90 {:.1f} us, p99 {:.1f} us, max {:.1f} us\n",
+                            toMicroseconds(percentile(frameTimes, 0.50)),
+                            toMicroseconds(percentile(frameTimes, 0.90)),
+                            toMicroseconds(percentile(frameTimes, 0.99)),
+                            toMicroseconds(frameTimes.empty() ? nanoseconds::zero() : frameTimes.back()));
+    }
+    catch (exception const& e)
+    {
+        cerr << "Replay failed. " << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
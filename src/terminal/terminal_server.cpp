@@ -0,0 +1,74 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Hosts a terminal session for GUI clients to attach to (see SessionServer).
+//
+// Usage: terminal_server SOCKET [PROGRAM [ARGS...]]
+//
+// Runs PROGRAM (default: the user's login shell) on a new PTY, and serves the session on the Unix
+// domain socket SOCKET until the program terminates.
+
+#include <terminal/Process.h>
+#include <terminal/SessionServer.h>
+#include <terminal/pty/UnixPty.h>
+
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace terminal;
+
+int main(int argc, char const* argv[])
+{
+    if (argc < 2 || string_view(argv[1]) == "--help" || string_view(argv[1]) == "-h")
+    {
+        cerr << "Usage: " << argv[0] << " SOCKET [PROGRAM [ARGS...]]\n";
+        return argc < 2 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    try
+    {
+        auto shell = Process::ExecInfo{};
+        shell.program = argc > 2 ? string(argv[2]) : Process::loginShell();
+        shell.arguments = vector<string>(argv + min(argc, 3), argv + argc);
+        shell.workingDirectory = Process::homeDirectory();
+
+        // The first client attaching resizes the page to the size of its window.
+        auto server = SessionServer{make_unique<UnixPty>(Size{80, 25})};
+        server.listen(argv[1]);
+
+        auto process = Process{shell, server.terminal().device()};
+        auto processExitWatcher = thread{[&]() {
+            (void) process.wait();
+            server.terminal().device().close();
+        }};
+
+        server.run();
+        processExitWatcher.join();
+    }
+    catch (exception const& e)
+    {
+        cerr << argv[0] << ": " << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -31,18 +31,30 @@ BackgroundRenderer::BackgroundRenderer(GridMetrics const& _gridMetrics,
 {
 }
 
-void BackgroundRenderer::renderCell(Coordinate const& _pos, RGBColor const& _color)
+void BackgroundRenderer::renderRow(RenderRow const& _row)
 {
-    if (row_ == _pos.row && color_ == _color)
-        columnCount_++;
-    else
-    {
-        renderPendingCells();
+    renderPendingCells();
 
-        startColumn_ = _pos.column;
-        row_ = _pos.row;
-        color_ = _color;
-        columnCount_ = 1;
+    auto const& colors = _row.background;
+    auto const count = colors.size();
+
+    for (size_t start = 0; start < count; )
+    {
+        auto const color = colors[start];
+        auto end = start + 1;
+        while (end < count && colors[end] == color)
+            ++end;
+
+        if (color != defaultColor_)
+        {
+            row_ = _row.row;
+            startColumn_ = static_cast<int>(start) + 1;
+            columnCount_ = static_cast<unsigned>(end - start);
+            color_ = color;
+            renderCellRange();
+        }
+
+        start = end;
     }
 }
 
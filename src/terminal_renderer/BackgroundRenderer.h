@@ -13,6 +13,8 @@
  */
 #pragma once
 
+#include <terminal_renderer/RenderRow.h>
+
 #include <terminal/Screen.h>
 
 #include <memory>
@@ -37,11 +39,8 @@ class BackgroundRenderer {
 
     constexpr void setOpacity(float _value) noexcept { opacity_ = _value; }
 
-    // TODO: pass background color directly (instead of whole grid cell),
-    // because there is no need to detect bg/fg color more than once per grid cell!
-
-    /// Queues up a render with given background
-    void renderCell(Coordinate const& _pos, RGBColor const& _color);
+    /// Renders the background of a whole row, merging adjacent cells of the same color.
+    void renderRow(RenderRow const& _row);
 
     void renderOnce(Coordinate const& _pos, RGBColor const& _color, unsigned _count);
 
@@ -253,15 +253,38 @@ void DecorationRenderer::rebuild()
     // TODO: Encircle
 }
 
+void DecorationRenderer::renderRow(RenderRow const& _row)
+{
+    constexpr unsigned DecorationStyles = CharacterStyleMask::Underline
+                                        | CharacterStyleMask::DoublyUnderlined
+                                        | CharacterStyleMask::CurlyUnderlined
+                                        | CharacterStyleMask::DottedUnderline
+                                        | CharacterStyleMask::DashedUnderline
+                                        | CharacterStyleMask::Overline
+                                        | CharacterStyleMask::CrossedOut
+                                        | CharacterStyleMask::Framed
+                                        | CharacterStyleMask::Encircled;
+
+    for (int column = 1; column <= _row.columnCount(); ++column)
+    {
+        Cell const& cell = _row.at(column);
+        if (!cell.hyperlink() && !(cell.attributes().styles & DecorationStyles))
+            continue;
+
+        renderCell(Coordinate{_row.row, column}, cell, _row.isHyperlinkHovered(cell));
+    }
+}
+
 void DecorationRenderer::renderCell(Coordinate const& _pos,
-                                    Cell const& _cell)
+                                    Cell const& _cell,
+                                    bool _hyperlinkHovered)
 {
     if (_cell.hyperlink())
     {
-        auto const& color = _cell.hyperlink()->state == HyperlinkState::Hover
+        auto const& color = _hyperlinkHovered
                             ? colorProfile_.hyperlinkDecoration.hover
                             : colorProfile_.hyperlinkDecoration.normal;
-        auto const decoration = _cell.hyperlink()->state == HyperlinkState::Hover
+        auto const decoration = _hyperlinkHovered
                             ? hyperlinkHover_
                             : hyperlinkNormal_;
         renderDecoration(decoration, _pos, 1, color);
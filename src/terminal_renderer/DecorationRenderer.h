@@ -14,6 +14,7 @@
 #pragma once
 
 #include <terminal_renderer/Atlas.h>
+#include <terminal_renderer/RenderRow.h>
 
 #include <terminal/Screen.h>
 
@@ -74,7 +75,10 @@ class DecorationRenderer {
         hyperlinkHover_ = _hover;
     }
 
-    void renderCell(Coordinate const& _pos, Cell const& _cell);
+    /// Renders the decorations of all cells of the given row.
+    void renderRow(RenderRow const& _row);
+
+    void renderCell(Coordinate const& _pos, Cell const& _cell, bool _hyperlinkHovered);
 
     void renderDecoration(Decorator _decoration,
                           Coordinate const& _pos,
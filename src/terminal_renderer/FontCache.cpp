@@ -0,0 +1,100 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal_renderer/FontCache.h>
+
+#include <text_shaper/open_shaper.h>
+
+#include <mutex>
+
+using std::lock_guard;
+using std::make_shared;
+using std::make_unique;
+using std::map;
+using std::mutex;
+using std::nullopt;
+using std::optional;
+using std::pair;
+using std::shared_ptr;
+using std::weak_ptr;
+
+namespace terminal::renderer {
+
+namespace {
+    template <typename Key, typename T>
+    void eraseExpired(map<Key, weak_ptr<T>>& _registry)
+    {
+        for (auto i = _registry.begin(); i != _registry.end();)
+        {
+            if (i->second.expired())
+                i = _registry.erase(i);
+            else
+                ++i;
+        }
+    }
+}
+
+shared_ptr<FontCache> FontCache::get(text::vec2 _dpi)
+{
+    static mutex lock;
+    static map<pair<int, int>, weak_ptr<FontCache>> registry;
+
+    auto const _l = lock_guard{lock};
+    eraseExpired(registry);
+
+    auto& entry = registry[pair{_dpi.x, _dpi.y}];
+    if (auto fontCache = entry.lock())
+        return fontCache;
+
+    auto fontCache = make_shared<FontCache>(make_unique<text::open_shaper>(_dpi));
+    entry = fontCache;
+    return fontCache;
+}
+
+shared_ptr<GlyphCache> FontCache::glyphCache(FontKeys const& _fonts, text::render_mode _mode)
+{
+    eraseExpired(glyphCaches_);
+
+    auto& entry = glyphCaches_[pair{_fonts, _mode}];
+    if (auto glyphCache = entry.lock())
+        return glyphCache;
+
+    auto glyphCache = make_shared<GlyphCache>();
+    entry = glyphCache;
+    return glyphCache;
+}
+
+void GlyphCache::retain(text::glyph_key const& _key,
+                        optional<text::rasterized_glyph> const& _glyph,
+                        bool _shared)
+{
+    if (!_glyph.has_value())
+    {
+        glyphs.emplace(_key, nullopt);
+        return;
+    }
+
+    if (!_shared)
+        return;
+
+    if (bitmapBytes + _glyph->bitmap.size() > MaxBitmapBytes)
+    {
+        glyphs.clear();
+        bitmapBytes = 0;
+    }
+
+    if (glyphs.emplace(_key, _glyph).second)
+        bitmapBytes += _glyph->bitmap.size();
+}
+
+} // end namespace
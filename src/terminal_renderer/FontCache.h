@@ -0,0 +1,146 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/Grid.h> // CharacterStyleMask
+
+#include <text_shaper/font.h>
+#include <text_shaper/shaper.h>
+
+#include <crispy/FNV.h>
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+namespace terminal::renderer
+{
+    using GlyphId = text::glyph_key;
+
+    struct CacheKey {
+        std::u32string_view text;
+        CharacterStyleMask styles;
+
+        bool operator==(CacheKey const& _rhs) const noexcept
+        {
+            return text == _rhs.text && styles == _rhs.styles;
+        }
+
+        bool operator!=(CacheKey const& _rhs) const noexcept
+        {
+            return !(*this == _rhs);
+        }
+
+        bool operator<(CacheKey const& _rhs) const noexcept
+        {
+            if (text < _rhs.text)
+                return true;
+
+            if (static_cast<unsigned>(styles) < static_cast<unsigned>(_rhs.styles))
+                return true;
+
+            return false;
+        }
+    };
+}
+
+namespace std
+{
+    template <>
+    struct hash<terminal::renderer::CacheKey> {
+        size_t operator()(terminal::renderer::CacheKey const& _key) const noexcept
+        {
+            auto fnv = crispy::FNV<char32_t>{};
+            return static_cast<size_t>(fnv(fnv(_key.text.data(), _key.text.size()), static_cast<char32_t>(_key.styles)));
+        }
+    };
+}
+
+namespace terminal::renderer {
+
+struct FontKeys {
+    text::font_key regular;
+    text::font_key bold;
+    text::font_key italic;
+    text::font_key boldItalic;
+    text::font_key emoji;
+};
+
+inline bool operator<(FontKeys const& a, FontKeys const& b) noexcept
+{
+    return std::tie(a.regular, a.bold, a.italic, a.boldItalic, a.emoji)
+         < std::tie(b.regular, b.bold, b.italic, b.boldItalic, b.emoji);
+}
+
+/// Text shaping results and rasterized glyphs of one set of fonts and render mode.
+struct GlyphCache {
+    /// Upper bound of the bitmap bytes kept in glyphs, after which all of them are dropped.
+    static constexpr size_t MaxBitmapBytes = 16 * 1024 * 1024;
+
+    std::list<std::u32string> keyStorage;                     // owns the text of the keys in shapes
+    std::unordered_map<CacheKey, text::shape_result> shapes;
+    std::unordered_map<text::glyph_key, std::optional<text::rasterized_glyph>> glyphs;
+    size_t bitmapBytes = 0;                                   // sum of the bitmap sizes in glyphs
+
+    /// Remembers the rasterization result of @p _key for the other renderers using this cache.
+    ///
+    /// Failed rasterizations are always remembered, bitmaps only if the cache is @p _shared
+    /// with another renderer, as a single renderer finds them in its texture atlas anyway.
+    void retain(text::glyph_key const& _key,
+                std::optional<text::rasterized_glyph> const& _glyph,
+                bool _shared);
+#if !defined(NDEBUG)
+    std::unordered_map<CacheKey, int64_t> hits;
+#endif
+};
+
+/// Font loader and glyph caches shared by all renderers of the same DPI within this process.
+///
+/// Every renderer holds its FontCache (and the GlyphCache of the fonts it currently uses)
+/// by std::shared_ptr, so that they are destroyed together with the last renderer using them,
+/// and a newly opened window starts with the fonts already loaded and shaped text and glyphs
+/// already cached.
+///
+/// Apart from get(), it is not thread-safe and must only be used by the thread rendering
+/// all windows, i.e. the GUI thread.
+class FontCache {
+  public:
+    explicit FontCache(std::unique_ptr<text::shaper> _shaper) : shaper_{std::move(_shaper)} {}
+
+    /// @returns the font cache of the given DPI, shared with all other callers in this process.
+    static std::shared_ptr<FontCache> get(text::vec2 _dpi);
+
+    text::shaper& shaper() noexcept { return *shaper_; }
+
+    /// @returns the glyph cache of the given fonts and render mode, shared with all other callers.
+    ///
+    /// Font keys identify the same fonts for all callers, as they are all loaded by the same shaper.
+    std::shared_ptr<GlyphCache> glyphCache(FontKeys const& _fonts, text::render_mode _mode);
+
+    /// Number of glyph caches currently in use.
+    size_t glyphCacheCount() const noexcept { return glyphCaches_.size(); }
+
+  private:
+    std::unique_ptr<text::shaper> shaper_;
+    std::map<std::pair<FontKeys, text::render_mode>, std::weak_ptr<GlyphCache>> glyphCaches_;
+};
+
+} // end namespace
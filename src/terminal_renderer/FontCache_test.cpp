@@ -0,0 +1,181 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal_renderer/FontCache.h>
+
+#include <catch2/catch.hpp>
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+using namespace terminal::renderer;
+using std::make_unique;
+using std::nullopt;
+using std::optional;
+
+namespace
+{
+    /// Shaper loading no fonts at all, such that FontCache can be tested without any font files.
+    class StubShaper : public text::shaper {
+      public:
+        optional<text::font_key> load_font(text::font_description const&, text::font_size) override
+        {
+            return nullopt;
+        }
+
+        text::font_metrics metrics(text::font_key) const override { return {}; }
+
+        void shape(text::font_key, std::u32string_view, crispy::span<int>, unicode::Script,
+                   text::shape_result&) override {}
+
+        optional<text::rasterized_glyph> rasterize(text::glyph_key, text::render_mode) override
+        {
+            return nullopt;
+        }
+
+        bool has_color(text::font_key) const override { return false; }
+    };
+
+    FontKeys makeFontKeys(unsigned _base)
+    {
+        return FontKeys{
+            text::font_key{_base},
+            text::font_key{_base + 1},
+            text::font_key{_base + 2},
+            text::font_key{_base + 3},
+            text::font_key{_base + 4}
+        };
+    }
+
+    text::glyph_key makeGlyphKey(unsigned _index)
+    {
+        return text::glyph_key{text::font_key{0}, text::font_size{12.0}, text::glyph_index{_index}};
+    }
+
+    text::rasterized_glyph makeGlyph(unsigned _index, size_t _bytes)
+    {
+        auto glyph = text::rasterized_glyph{};
+        glyph.index = text::glyph_index{_index};
+        glyph.format = text::bitmap_format::alpha_mask;
+        glyph.bitmap.resize(_bytes);
+        return glyph;
+    }
+}
+
+TEST_CASE("FontCache.get")
+{
+    auto const a = FontCache::get(text::vec2{96, 96});
+    auto const b = FontCache::get(text::vec2{96, 96});
+    auto c = FontCache::get(text::vec2{192, 192});
+    CHECK(a == b);
+    CHECK(a != c);
+
+    // Once released by all its users, the font cache of that DPI is destroyed.
+    auto const released = std::weak_ptr<FontCache>(c);
+    c.reset();
+    CHECK(released.expired());
+
+    c = FontCache::get(text::vec2{192, 192});
+    CHECK(c != nullptr);
+    CHECK(FontCache::get(text::vec2{192, 192}) == c);
+}
+
+TEST_CASE("FontCache.glyphCache.shared")
+{
+    auto fontCache = FontCache(make_unique<StubShaper>());
+    auto const fonts = makeFontKeys(1);
+
+    auto const a = fontCache.glyphCache(fonts, text::render_mode::gray);
+    auto const b = fontCache.glyphCache(fonts, text::render_mode::gray);
+    CHECK(a == b);
+    CHECK(fontCache.glyphCacheCount() == 1);
+
+    SECTION("other render mode") {
+        auto const c = fontCache.glyphCache(fonts, text::render_mode::lcd);
+        CHECK(c != a);
+        CHECK(fontCache.glyphCacheCount() == 2);
+    }
+
+    SECTION("other fonts") {
+        auto const c = fontCache.glyphCache(makeFontKeys(10), text::render_mode::gray);
+        CHECK(c != a);
+        CHECK(fontCache.glyphCacheCount() == 2);
+    }
+}
+
+TEST_CASE("FontCache.glyphCache.expiry")
+{
+    auto fontCache = FontCache(make_unique<StubShaper>());
+    auto const fonts = makeFontKeys(1);
+
+    auto a = fontCache.glyphCache(fonts, text::render_mode::gray);
+    a->shapes[CacheKey{U"A", terminal::CharacterStyleMask{}}] = text::shape_result{};
+    auto b = fontCache.glyphCache(fonts, text::render_mode::lcd);
+    REQUIRE(fontCache.glyphCacheCount() == 2);
+
+    // Expired caches are only erased when the next one is requested.
+    a.reset();
+    auto const c = fontCache.glyphCache(fonts, text::render_mode::lcd);
+    CHECK(c == b);
+    CHECK(fontCache.glyphCacheCount() == 1);
+
+    // The cache of the released render mode starts out empty again.
+    auto const d = fontCache.glyphCache(fonts, text::render_mode::gray);
+    CHECK(d->shapes.empty());
+    CHECK(fontCache.glyphCacheCount() == 2);
+
+    b.reset();
+}
+
+TEST_CASE("GlyphCache.retain")
+{
+    auto cache = GlyphCache{};
+
+    SECTION("failed rasterization") {
+        cache.retain(makeGlyphKey(1), nullopt, false);
+        REQUIRE(cache.glyphs.count(makeGlyphKey(1)) == 1);
+        CHECK(!cache.glyphs.at(makeGlyphKey(1)).has_value());
+        CHECK(cache.bitmapBytes == 0);
+    }
+
+    SECTION("not shared") {
+        cache.retain(makeGlyphKey(1), makeGlyph(1, 100), false);
+        CHECK(cache.glyphs.empty());
+        CHECK(cache.bitmapBytes == 0);
+    }
+
+    SECTION("shared") {
+        cache.retain(makeGlyphKey(1), makeGlyph(1, 100), true);
+        cache.retain(makeGlyphKey(2), makeGlyph(2, 50), true);
+        CHECK(cache.glyphs.size() == 2);
+        CHECK(cache.bitmapBytes == 150);
+
+        // Retaining the same glyph again does not account for it twice.
+        cache.retain(makeGlyphKey(2), makeGlyph(2, 50), true);
+        CHECK(cache.bitmapBytes == 150);
+    }
+
+    SECTION("budget exceeded") {
+        auto constexpr Half = GlyphCache::MaxBitmapBytes / 2;
+        cache.retain(makeGlyphKey(1), makeGlyph(1, Half), true);
+        cache.retain(makeGlyphKey(2), makeGlyph(2, Half), true);
+        CHECK(cache.glyphs.size() == 2);
+        CHECK(cache.bitmapBytes == GlyphCache::MaxBitmapBytes);
+
+        cache.retain(makeGlyphKey(3), makeGlyph(3, 1), true);
+        CHECK(cache.glyphs.size() == 1);
+        CHECK(cache.glyphs.count(makeGlyphKey(3)) == 1);
+        CHECK(cache.bitmapBytes == 1);
+    }
+}
@@ -0,0 +1,56 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/Color.h>
+#include <terminal/Grid.h>
+#include <terminal/Hyperlink.h>
+
+#include <crispy/span.h>
+
+#include <optional>
+
+namespace terminal::renderer {
+
+/// Inclusive range of columns (1-based) within a row.
+struct ColumnRange {
+    int from;
+    int to;
+
+    constexpr bool contains(int _column) const noexcept { return from <= _column && _column <= to; }
+};
+
+/// A single row of the screen as handed to the sub-renderers.
+///
+/// Colors are already resolved for every cell (with reverse video and selection applied),
+/// so that each sub-renderer can process the whole row in a tight loop over contiguous memory.
+struct RenderRow {
+    int row;                                    // viewport-relative row number (1-based)
+    crispy::span<Cell const> cells;             // all cells of this row, from left to right
+    crispy::span<RGBColor const> foreground;    // resolved foreground color, one per cell
+    crispy::span<RGBColor const> background;    // resolved background color, one per cell
+    std::optional<ColumnRange> selection;       // selected columns of this row, if any
+    HyperlinkId hoveredHyperlink;               // hyperlink under the mouse cursor if to be highlighted, or 0
+
+    int columnCount() const noexcept { return static_cast<int>(cells.size()); }
+
+    Cell const& at(int _column) const noexcept { return cells[static_cast<size_t>(_column - 1)]; }
+
+    bool isHyperlinkHovered(Cell const& _cell) const noexcept
+    {
+        return hoveredHyperlink != 0 && _cell.hyperlink() == hoveredHyperlink;
+    }
+};
+
+} // end namespace
@@ -14,22 +14,30 @@
 #include <terminal_renderer/Renderer.h>
 #include <terminal_renderer/TextRenderer.h>
 
-#include <text_shaper/open_shaper.h>
 
 #include <crispy/debuglog.h>
+#include <crispy/metrics.h>
+#include <crispy/trace.h>
 
+#include <algorithm>
 #include <array>
 #include <functional>
 #include <memory>
+#include <string>
 
 using std::array;
+using std::max;
+using std::min;
+using std::nullopt;
+using std::string;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
 using std::scoped_lock;
 using std::chrono::steady_clock;
-using std::make_unique;
 using std::move;
 using std::optional;
-using std::tuple;
 using std::unique_ptr;
+using std::vector;
 
 namespace terminal::renderer {
 
@@ -79,10 +87,10 @@ Renderer::Renderer(Size const& _screenSize,
                    Decorator _hyperlinkNormal,
                    Decorator _hyperlinkHover,
                    unique_ptr<RenderTarget> _renderTarget) :
-    textShaper_{ make_unique<text::open_shaper>(text::vec2{_logicalDpiX, _logicalDpiY}) },
+    fontCache_{ FontCache::get(text::vec2{_logicalDpiX, _logicalDpiY}) },
     fontDescriptions_{ _fontDescriptions },
-    fonts_{ loadFontKeys(fontDescriptions_, *textShaper_) },
-    gridMetrics_{ loadGridMetrics(fonts_.regular, _screenSize, *textShaper_) },
+    fonts_{ loadFontKeys(fontDescriptions_, fontCache_->shaper()) },
+    gridMetrics_{ loadGridMetrics(fonts_.regular, _screenSize, fontCache_->shaper()) },
     colorProfile_{ _colorProfile },
     backgroundOpacity_{ _backgroundOpacity },
     renderTarget_{ move(_renderTarget) },
@@ -102,7 +110,7 @@ Renderer::Renderer(Size const& _screenSize,
         renderTarget_->coloredAtlasAllocator(),
         renderTarget_->lcdAtlasAllocator(),
         gridMetrics_,
-        *textShaper_,
+        *fontCache_,
         fontDescriptions_,
         fonts_
     },
@@ -157,14 +165,14 @@ void Renderer::clearCache()
 void Renderer::setFonts(FontDescriptions _fontDescriptions)
 {
     fontDescriptions_ = move(_fontDescriptions);
-    fonts_ = loadFontKeys(fontDescriptions_, *textShaper_);
+    fonts_ = loadFontKeys(fontDescriptions_, fontCache_->shaper());
     updateFontMetrics();
 }
 
 bool Renderer::setFontSize(text::font_size _fontSize)
 {
     fontDescriptions_.size = _fontSize;
-    fonts_ = loadFontKeys(fontDescriptions_, *textShaper_);
+    fonts_ = loadFontKeys(fontDescriptions_, fontCache_->shaper());
     updateFontMetrics();
 
     return true;
@@ -172,7 +180,7 @@ bool Renderer::setFontSize(text::font_size _fontSize)
 
 void Renderer::updateFontMetrics()
 {
-    gridMetrics_ = loadGridMetrics(fonts_.regular, gridMetrics_.pageSize, *textShaper_);
+    gridMetrics_ = loadGridMetrics(fonts_.regular, gridMetrics_.pageSize, fontCache_->shaper());
 
     textRenderer_.updateFontMetrics();
     imageRenderer_.setCellSize(cellSize());
@@ -201,119 +209,169 @@ void Renderer::setColorProfile(terminal::ColorProfile const& _colors)
 
 uint64_t Renderer::render(Terminal& _terminal,
                           steady_clock::time_point _now,
-                          terminal::Coordinate const& _currentMousePosition,
                           bool _pressure)
 {
-    gridMetrics_.pageSize = _terminal.screenSize();
+    CRISPY_METRICS_TIME_SCOPE("render.frame");
+    CRISPY_TRACE_SPAN("render.frame");
 
-    executeImageDiscards();
+    auto const changes = [&]() {
+        CRISPY_METRICS_TIME_SCOPE("render.snapshot");
+        CRISPY_TRACE_SPAN("render.snapshot");
+        return _terminal.takeSnapshot(snapshot_, _now);
+    }();
 
-    uint64_t const changes = renderInternalNoFlush(_terminal, _now, _currentMousePosition, _pressure);
+    metrics_.frameCount++;
+    if (changes)
+        metrics_.cellCopies++;
+    metrics_.lastLockHoldTime = snapshot_.lockHoldTime;
+    metrics_.maxLockHoldTime = std::max(metrics_.maxLockHoldTime, snapshot_.lockHoldTime);
+    metrics_.totalLockHoldTime += snapshot_.lockHoldTime;
 
-    backgroundRenderer_.renderPendingCells();
-    backgroundRenderer_.finish();
+    gridMetrics_.pageSize = snapshot_.pageSize;
 
-    textRenderer_.flushPendingSegments();
-    textRenderer_.finish();
+    {
+        CRISPY_TRACE_SPAN("render.image_discards");
+        executeImageDiscards();
+    }
+
+    {
+        CRISPY_METRICS_TIME_SCOPE("render.cells");
+        CRISPY_TRACE_SPAN("render.cells");
+        renderInternalNoFlush(_pressure);
+
+        backgroundRenderer_.renderPendingCells();
+        backgroundRenderer_.finish();
+    }
+
+    {
+        CRISPY_METRICS_TIME_SCOPE("render.text");
+        CRISPY_TRACE_SPAN("render.text");
+        textRenderer_.flushPendingSegments();
+        textRenderer_.finish();
+    }
 
     renderTarget_->execute();
 
     return changes;
 }
 
-uint64_t Renderer::renderInternalNoFlush(Terminal& _terminal,
-                                         steady_clock::time_point _now,
-                                         terminal::Coordinate const& _currentMousePosition,
-                                         bool _pressure)
+void Renderer::renderInternalNoFlush(bool _pressure)
 {
-    auto const pressure = _pressure && _terminal.screen().isPrimaryScreen();
+    auto const pressure = _pressure && snapshot_.primaryScreen;
     textRenderer_.setPressure(pressure);
 
-    auto _l = scoped_lock{_terminal};
-    auto const reverseVideo = _terminal.screen().isModeEnabled(terminal::DECMode::ReverseVideo);
-    auto const baseLine = _terminal.viewport().absoluteScrollOffset().value_or(_terminal.screen().historyLineCount());
+    renderCursor();
 
-    renderCursor(_terminal);
+    auto const hoveredHyperlink = !pressure ? snapshot_.hoveredHyperlink : HyperlinkId{0}; // TODO: Left-Ctrl pressed?
+    auto const columnCount = static_cast<size_t>(snapshot_.pageSize.width);
+    auto selection = snapshot_.selection.begin();
+    auto searchMatch = snapshot_.searchMatches.begin();
 
-    auto const renderHyperlinks = !pressure && _terminal.screen().contains(_currentMousePosition);
+    foregroundColors_.resize(columnCount);
+    backgroundColors_.resize(columnCount);
 
-    if (renderHyperlinks)
+    for (int row = 1; row <= snapshot_.pageSize.height; ++row)
     {
-        auto& cellAtMouse = _terminal.screen().at(_currentMousePosition);
-        if (cellAtMouse.hyperlink())
-            cellAtMouse.hyperlink()->state = HyperlinkState::Hover; // TODO: Left-Ctrl pressed?
+        while (selection != snapshot_.selection.end() && selection->line < row)
+            ++selection;
+
+        auto const selectedColumns = selection != snapshot_.selection.end() && selection->line == row
+                                   ? optional{ColumnRange{selection->fromColumn, selection->toColumn}}
+                                   : nullopt;
+
+        searchMatchColumns_.clear();
+        for (; searchMatch != snapshot_.searchMatches.end() && searchMatch->line <= row; ++searchMatch)
+            if (searchMatch->line == row)
+                searchMatchColumns_.emplace_back(ColumnRange{searchMatch->fromColumn, searchMatch->toColumn});
+
+        auto const cells = snapshot_.row(row);
+        resolveColors(cells, selectedColumns, searchMatchColumns_);
+
+        auto const line = RenderRow{
+            row,
+            cells,
+            crispy::span<RGBColor const>(foregroundColors_.data(), columnCount),
+            crispy::span<RGBColor const>(backgroundColors_.data(), columnCount),
+            selectedColumns,
+            hoveredHyperlink
+        };
+
+        backgroundRenderer_.renderRow(line);
+        decorationRenderer_.renderRow(line);
+        textRenderer_.renderRow(line);
+        renderImages(line);
     }
+}
 
-    auto const changes = _terminal.preRender(_now);
+void Renderer::resolveColors(crispy::span<Cell const> _cells,
+                             optional<ColumnRange> _selection,
+                             vector<ColumnRange> const& _searchMatches)
+{
+    auto const reverseVideo = snapshot_.reverseVideo;
+    auto const cellCount = static_cast<int>(_cells.size());
 
-    _terminal.screen().render(
-        [&](Coordinate const& _pos, Cell const& _cell) {
-            auto const absolutePos = Coordinate{baseLine + (_pos.row - 1), _pos.column};
-            auto const selected = _terminal.isSelectedAbsolute(absolutePos);
-            renderCell(_pos, _cell, reverseVideo, selected);
-        },
-        _terminal.viewport().absoluteScrollOffset()
-    );
+    for (size_t i = 0; i < _cells.size(); ++i)
+    {
+        auto const [fg, bg] = _cells[i].attributes().makeColors(colorProfile_, reverseVideo);
+        foregroundColors_[i] = fg;
+        backgroundColors_[i] = bg;
+    }
 
-    if (renderHyperlinks)
+    for (auto const& match : _searchMatches)
     {
-        auto& cellAtMouse = _terminal.screen().at(_currentMousePosition);
-        if (cellAtMouse.hyperlink())
-            cellAtMouse.hyperlink()->state = HyperlinkState::Inactive;
+        for (auto column = max(match.from, 1); column <= min(match.to, cellCount); ++column)
+        {
+            auto const i = static_cast<size_t>(column - 1);
+            foregroundColors_[i] = colorProfile_.searchMatchForeground;
+            backgroundColors_[i] = colorProfile_.searchMatchBackground;
+        }
     }
 
-    return changes;
+    if (_selection.has_value())
+    {
+        for (auto column = max(_selection->from, 1); column <= min(_selection->to, cellCount); ++column)
+        {
+            auto const i = static_cast<size_t>(column - 1);
+            auto const fg = foregroundColors_[i];
+            auto const bg = backgroundColors_[i];
+            foregroundColors_[i] = colorProfile_.selectionForeground.value_or(bg);
+            backgroundColors_[i] = colorProfile_.selectionBackground.value_or(fg);
+        }
+    }
 }
 
-void Renderer::renderCursor(Terminal const& _terminal)
+void Renderer::renderImages(RenderRow const& _row)
 {
-    bool const shouldDisplayCursor = _terminal.screen().cursor().visible
-        && (_terminal.cursorDisplay() == CursorDisplay::Steady || _terminal.cursorBlinkActive());
-
-    // TODO: check if CursorStyle has changed, and update render context accordingly.
-    if (shouldDisplayCursor && _terminal.viewport().isLineVisible(_terminal.screen().cursor().position.row))
-    {
-        Cell const& cursorCell = _terminal.screen().at(_terminal.screen().cursor().position);
-
-        auto const cursorShape = _terminal.screen().focused() ? _terminal.cursorShape()
-                                                              : CursorShape::Rectangle;
-
-        cursorRenderer_.setShape(cursorShape);
-
-        cursorRenderer_.render(
-            gridMetrics_.map(
-                _terminal.screen().cursor().position.column,
-                _terminal.screen().cursor().position.row + _terminal.viewport().relativeScrollOffset()
-            ),
-            cursorCell.width()
-        );
-    }
+    for (int column = 1; column <= _row.columnCount(); ++column)
+        if (optional<ImageFragment> const& fragment = _row.at(column).imageFragment(); fragment.has_value())
+            imageRenderer_.renderImage(gridMetrics_.map(column, _row.row), fragment.value());
 }
 
-tuple<RGBColor, RGBColor> makeColors(ColorProfile const& _colorProfile, Cell const& _cell, bool _reverseVideo, bool _selected)
+void Renderer::renderCursor()
 {
-    auto const [fg, bg] = _cell.attributes().makeColors(_colorProfile, _reverseVideo);
-    if (!_selected)
-        return tuple{fg, bg};
+    // TODO: check if CursorStyle has changed, and update render context accordingly.
+    if (!snapshot_.cursor.visible)
+        return;
 
-    auto const a = _colorProfile.selectionForeground.value_or(bg);
-    auto const b = _colorProfile.selectionBackground.value_or(fg);
-    return tuple{a, b};
+    cursorRenderer_.setShape(snapshot_.cursor.shape);
+    cursorRenderer_.render(gridMetrics_.map(snapshot_.cursor.position), snapshot_.cursor.width);
 }
 
-void Renderer::renderCell(Coordinate const& _pos, Cell const& _cell, bool _reverseVideo, bool _selected)
+string RenderMetrics::to_string() const
 {
-    auto const [fg, bg] = makeColors(colorProfile_, _cell, _reverseVideo, _selected);
-
-    backgroundRenderer_.renderCell(_pos, bg);
-    decorationRenderer_.renderCell(_pos, _cell);
-    textRenderer_.schedule(_pos, _cell, fg);
-    if (optional<ImageFragment> const& fragment = _cell.imageFragment(); fragment.has_value())
-        imageRenderer_.renderImage(gridMetrics_.map(_pos), fragment.value());
+    return fmt::format(
+        "{} frames ({} with cell copies), screen lock held: last {} us, max {} us, avg {} us",
+        frameCount,
+        cellCopies,
+        duration_cast<microseconds>(lastLockHoldTime).count(),
+        duration_cast<microseconds>(maxLockHoldTime).count(),
+        frameCount ? duration_cast<microseconds>(totalLockHoldTime).count() / static_cast<int64_t>(frameCount) : 0
+    );
 }
 
 void Renderer::dumpState(std::ostream& _textOutput) const
 {
+    _textOutput << "Render metrics: " << metrics_.to_string() << '\n';
     textRenderer_.debugCache(_textOutput);
 }
 
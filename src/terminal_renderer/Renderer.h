@@ -20,19 +20,34 @@
 #include <terminal_renderer/CursorRenderer.h>
 #include <terminal_renderer/DecorationRenderer.h>
 #include <terminal_renderer/ImageRenderer.h>
+#include <terminal_renderer/RenderRow.h>
 #include <terminal_renderer/TextRenderer.h>
 
+#include <terminal/RenderSnapshot.h>
 #include <terminal/Terminal.h>
 
 #include <fmt/format.h>
 
 #include <chrono>
 #include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 #include <utility>
 
 namespace terminal::renderer {
 
+/// Frame related counters of a Renderer.
+struct RenderMetrics {
+    uint64_t frameCount = 0;                            // number of frames rendered
+    uint64_t cellCopies = 0;                            // number of frames that had to copy the screen's cells
+    std::chrono::nanoseconds lastLockHoldTime{};        // time the screen lock was held for the last frame
+    std::chrono::nanoseconds maxLockHoldTime{};         // maximum of lastLockHoldTime so far
+    std::chrono::nanoseconds totalLockHoldTime{};       // accumulated time the screen lock was held
+
+    std::string to_string() const;
+};
+
 /**
  * Renders a terminal's screen to the current OpenGL context.
  */
@@ -87,13 +102,17 @@ class Renderer {
     /**
      * Renders the given @p _terminal to the current OpenGL context.
      *
+     * The terminal's screen lock is only held while taking a snapshot of the screen,
+     * all the text shaping and rasterization happens without blocking the terminal.
+     *
      * @p _now The time hint to use when rendering the eventually blinking cursor.
      */
     uint64_t render(Terminal& _terminal,
                     std::chrono::steady_clock::time_point _now,
-                    terminal::Coordinate const& _currentMousePosition,
                     bool _pressure);
 
+    RenderMetrics const& metrics() const noexcept { return metrics_; }
+
     // Converts given RGBColor with its given opacity to a 4D-vector of values between 0.0 and 1.0
     static constexpr std::array<float, 4> canonicalColor(RGBColor const& _rgb, Opacity _opacity = Opacity::Opaque)
     {
@@ -113,17 +132,20 @@ class Renderer {
 
   private:
     /// Invoked internally by render() function.
-    uint64_t renderInternalNoFlush(Terminal& _terminal,
-                                   std::chrono::steady_clock::time_point _now,
-                                   terminal::Coordinate const& _currentMousePosition,
-                                   bool _pressure);
+    void renderInternalNoFlush(bool _pressure);
+
+    /// Resolves the foreground and background colors of the given cells into foregroundColors_
+    /// and backgroundColors_, with reverse video, search matches and the selected columns applied.
+    void resolveColors(crispy::span<Cell const> _cells,
+                       std::optional<ColumnRange> _selection,
+                       std::vector<ColumnRange> const& _searchMatches);
 
-    void renderCell(Coordinate const& _pos, Cell const& _cell, bool _reverseVideo, bool _selected);
-    void renderCursor(Terminal const& _terminal);
+    void renderImages(RenderRow const& _row);
+    void renderCursor();
 
     void executeImageDiscards();
 
-    std::unique_ptr<text::shaper> textShaper_;
+    std::shared_ptr<FontCache> fontCache_;      //!< Font loader and glyph caches shared with other renderers.
 
     FontDescriptions fontDescriptions_;
     FontKeys fonts_;
@@ -138,6 +160,12 @@ class Renderer {
 
     std::unique_ptr<RenderTarget> renderTarget_;
 
+    RenderSnapshot snapshot_;                   //!< Screen state of the frame currently being rendered.
+    std::vector<RGBColor> foregroundColors_;    //!< Resolved foreground colors of the row being rendered.
+    std::vector<RGBColor> backgroundColors_;    //!< Resolved background colors of the row being rendered.
+    std::vector<ColumnRange> searchMatchColumns_; //!< Search matches of the row being rendered.
+    RenderMetrics metrics_;
+
     BackgroundRenderer backgroundRenderer_;
     ImageRenderer imageRenderer_;
     TextRenderer textRenderer_;
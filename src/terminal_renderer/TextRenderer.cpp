@@ -17,6 +17,8 @@
 
 #include <crispy/algorithm.h>
 #include <crispy/debuglog.h>
+#include <crispy/metrics.h>
+#include <crispy/trace.h>
 #include <crispy/times.h>
 #include <crispy/range.h>
 
@@ -52,13 +54,14 @@ TextRenderer::TextRenderer(atlas::CommandListener& _commandListener,
                            atlas::TextureAtlasAllocator& _colorAtlasAllocator,
                            atlas::TextureAtlasAllocator& _lcdAtlasAllocator,
                            GridMetrics const& _gridMetrics,
-                           text::shaper& _textShaper,
+                           FontCache& _fontCache,
                            FontDescriptions& _fontDescriptions,
                            FontKeys const& _fonts) :
     gridMetrics_{ _gridMetrics },
     fontDescriptions_{ _fontDescriptions },
     fonts_{ _fonts },
-    textShaper_{ _textShaper },
+    fontCache_{ _fontCache },
+    textShaper_{ _fontCache.shaper() },
     commandListener_{ _commandListener },
     monochromeAtlas_{ _monochromeAtlasAllocator },
     colorAtlas_{ _colorAtlasAllocator },
@@ -72,12 +75,17 @@ void TextRenderer::clearCache()
     colorAtlas_.clear();
     lcdAtlas_.clear();
 
-    cacheKeyStorage_.clear();
-    cache_.clear();
+    // Only our reference is dropped, as other renderers might still use it.
+    // The glyph cache of the (possibly changed) fonts is acquired again on demand.
+    glyphCache_.reset();
+}
 
-#if !defined(NDEBUG)
-    cacheHits_.clear();
-#endif
+GlyphCache& TextRenderer::glyphCache()
+{
+    if (!glyphCache_)
+        glyphCache_ = fontCache_.glyphCache(fonts_, fontDescriptions_.renderMode);
+
+    return *glyphCache_;
 }
 
 void TextRenderer::updateFontMetrics()
@@ -106,49 +114,55 @@ void TextRenderer::extend(Cell const& _cell, [[maybe_unused]] int _column)
     ++clusterOffset_;
 }
 
-void TextRenderer::schedule(Coordinate const& _pos, Cell const& _cell, RGBColor const& _color)
+void TextRenderer::renderRow(RenderRow const& _row)
 {
     constexpr char32_t SP = 0x20;
 
-    bool const emptyCell = _cell.empty() || _cell.codepoint(0) == SP;
+    // Text runs never span multiple rows.
+    if (state_ == State::Filling)
+    {
+        flushPendingSegments();
+        state_ = State::Empty;
+    }
 
-    switch (state_)
+    for (int column = 1; column <= _row.columnCount(); ++column)
     {
-        case State::Empty:
+        Cell const& cell = _row.at(column);
+        bool const emptyCell = cell.empty() || cell.codepoint(0) == SP;
+
+        if (state_ == State::Empty)
+        {
             if (!emptyCell)
             {
                 state_ = State::Filling;
-                reset(_pos, _cell.attributes().styles, _color);
-                extend(_cell, _pos.column);
+                reset(Coordinate{_row.row, column}, cell.attributes().styles, _row.foreground[column - 1]);
+                extend(cell, column);
             }
-            break;
-        case State::Filling:
+            continue;
+        }
+
+        // Do not perform multi-column text shaping when under rendering pressure.
+        // This usually only happens in bandwidth heavy commands (such as cat), where
+        // ligature rendering isn't that important anyways?
+        // Performing multi-column text shaping under pressure would cause the cache to be
+        // filled up needlessly with half printed words. We mitigate that by shaping cell-wise
+        // in such cases.
+
+        auto const& color = _row.foreground[column - 1];
+        bool const sameSGR = cell.attributes().styles == characterStyleMask_ && color == color_;
+
+        if (!pressure_ && !emptyCell && sameSGR)
+            extend(cell, column);
+        else
         {
-            //if (!_cell.empty() && row_ == _pos.row && attributes_ == _cell.attributes() && _cell.codepoint(0) != SP)
-            bool const sameLine = _pos.row == row_;
-            bool const sameSGR = _cell.attributes().styles == characterStyleMask_ && _color == color_;
-
-            // Do not perform multi-column text shaping when under rendering pressure.
-            // This usually only happens in bandwidth heavy commands (such as cat), where
-            // ligature rendering isn't that important anyways?
-            // Performing multi-column text shaping under pressure would cause the cache to be
-            // filled up needlessly with half printed words. We mitigate that by shaping cell-wise
-            // in such cases.
-
-            if (!pressure_ && !emptyCell && sameLine && sameSGR)
-                extend(_cell, _pos.column);
-            else
+            flushPendingSegments();
+            if (emptyCell)
+                state_ = State::Empty;
+            else // i.o.w.: cell attributes changed
             {
-                flushPendingSegments();
-                if (emptyCell)
-                    state_ = State::Empty;
-                else // i.o.w.: cell attributes OR row number changed
-                {
-                    reset(_pos, _cell.attributes().styles, _color);
-                    extend(_cell, _pos.column);
-                }
+                reset(Coordinate{_row.row, column}, cell.attributes().styles, color);
+                extend(cell, column);
             }
-            break;
         }
     }
 }
@@ -158,36 +172,48 @@ void TextRenderer::flushPendingSegments()
     if (codepoints_.empty())
         return;
 
+    CRISPY_TRACE_SPAN("text.flush");
     render(
         gridMetrics_.map(startColumn_, row_),
         cachedGlyphPositions(),
         color_
     );
+
+    // Flushed runs must not be rendered again when flushing at the end of the frame.
+    codepoints_.clear();
+    clusters_.clear();
+    clusterOffset_ = 0;
 }
 
 text::shape_result const& TextRenderer::cachedGlyphPositions()
 {
+    auto& cache = glyphCache();
     auto const codepoints = u32string_view(codepoints_.data(), codepoints_.size());
-    if (auto const cached = cache_.find(CacheKey{codepoints, characterStyleMask_}); cached != cache_.end())
+    if (auto const cached = cache.shapes.find(CacheKey{codepoints, characterStyleMask_}); cached != cache.shapes.end())
     {
+        CRISPY_METRICS_COUNT("text.shape_cache_hits", 1);
 #if !defined(NDEBUG)
-        cacheHits_[cached->first]++;
+        cache.hits[cached->first]++;
 #endif
         return cached->second;
     }
 
-    cacheKeyStorage_.emplace_back(u32string{codepoints});
-    auto const cacheKeyFromStorage = CacheKey{ cacheKeyStorage_.back(), characterStyleMask_ };
+    CRISPY_METRICS_COUNT("text.shape_cache_misses", 1);
+    cache.keyStorage.emplace_back(u32string{codepoints});
+    auto const cacheKeyFromStorage = CacheKey{ cache.keyStorage.back(), characterStyleMask_ };
 
 #if !defined(NDEBUG)
-    cacheHits_[cacheKeyFromStorage] = 0;
+    cache.hits[cacheKeyFromStorage] = 0;
 #endif
 
-    return cache_[cacheKeyFromStorage] = requestGlyphPositions();
+    return cache.shapes[cacheKeyFromStorage] = requestGlyphPositions();
 }
 
 text::shape_result TextRenderer::requestGlyphPositions()
 {
+    CRISPY_METRICS_TIME_SCOPE("text.shape");
+    CRISPY_TRACE_SPAN("text.shape");
+
     text::shape_result glyphPositions;
     unicode::run_segmenter::range run;
     auto rs = unicode::run_segmenter(codepoints_.data(), codepoints_.size());
@@ -245,7 +271,7 @@ text::shape_result TextRenderer::shapeRun(unicode::run_segmenter::range const& _
         gpos
     );
 
-    if (crispy::logging_sink::for_debug().enabled() && !gpos.empty())
+    if (crispy::debugtag::enabled(TextRendererTag) && !gpos.empty())
     {
         auto msg = debuglog(TextRendererTag);
         msg.write("Shaped codepoints: {}", unicode::convert_to<char>(codepoints));
@@ -333,11 +359,23 @@ optional<TextRenderer::DataRef> TextRenderer::getTextureInfo(text::glyph_key con
     if (optional<DataRef> const dataRef = lookupAtlas.get(_id); dataRef.has_value())
         return dataRef;
 
-    auto theGlyphOpt = textShaper_.rasterize(_id, fontDescriptions_.renderMode);
-    if (!theGlyphOpt.has_value())
+    // Glyphs rasterized for one renderer are uploaded into the atlases of the others
+    // using the same glyph cache without rasterizing them again.
+    auto& cache = glyphCache();
+    optional<text::rasterized_glyph> rasterized;
+    if (auto const cachedGlyph = cache.glyphs.find(_id); cachedGlyph != cache.glyphs.end())
+        rasterized = cachedGlyph->second;
+    else
+    {
+        CRISPY_TRACE_SPAN("text.rasterize");
+        rasterized = textShaper_.rasterize(_id, fontDescriptions_.renderMode);
+        cache.retain(_id, rasterized, glyphCache_.use_count() > 1);
+    }
+
+    if (!rasterized.has_value())
         return nullopt;
 
-    text::rasterized_glyph& glyph = theGlyphOpt.value();
+    text::rasterized_glyph glyph = move(*rasterized);
     auto const numCells = colored ? 2 : 1; // is this the only case - with colored := Emoji presentation?
     // FIXME: this `2` is a hack of my bad knowledge. FIXME.
     // As I only know of emojis being colored fonts, and those take up 2 cell with units.
@@ -412,7 +450,7 @@ optional<TextRenderer::DataRef> TextRenderer::getTextureInfo(text::glyph_key con
                            float(gridMetrics_.cellSize.height) / float(glyph.height));
 
     auto const yOverflow = gridMetrics_.cellSize.height - yMax;
-    if (crispy::logging_sink::for_debug().enabled())
+    if (crispy::debugtag::enabled(TextRendererTag))
         debuglog(TextRendererTag).write("insert glyph {}: {}; ratio:{}; yOverflow({}, {}); {}",
                                         _id.index,
                                         colored ? "emoji" : "text",
@@ -510,7 +548,7 @@ void TextRenderer::renderTexture(crispy::Point const& _pos,
     }
 
 #if 0
-    if (crispy::logging_sink::for_debug().enabled())
+    if (crispy::debugtag::enabled(TextRendererTag))
         debuglog(TextRendererTag).write("xy={}:{} pos=({}:{}) tex={}x{}, gpos=({}:{}), baseline={}, descender={}",
                                         x, y,
                                         _pos.x(), _pos.y(),
@@ -542,10 +580,13 @@ void TextRenderer::debugCache(std::ostream& _textOutput) const
 {
     std::map<u32string, CacheKey> orderedKeys;
 
-    for (auto && [key, val] : cache_)
+    if (glyphCache_)
     {
-        (void) val;
-        orderedKeys[u32string(key.text)] = key;
+        for (auto && [key, val] : glyphCache_->shapes)
+        {
+            (void) val;
+            orderedKeys[u32string(key.text)] = key;
+        }
     }
 
     _textOutput << fmt::format("TextRenderer: {} cache entries:\n", orderedKeys.size());
@@ -554,7 +595,7 @@ void TextRenderer::debugCache(std::ostream& _textOutput) const
         auto const vword = u32string_view(word);
 #if !defined(NDEBUG)
         auto hits = int64_t{};
-        if (auto i = cacheHits_.find(key); i != cacheHits_.end())
+        if (auto i = glyphCache_->hits.find(key); i != glyphCache_->hits.end())
             hits = i->second;
         _textOutput << fmt::format("{:>5} : {}\n", hits, unicode::convert_to<char>(vword));
 #else
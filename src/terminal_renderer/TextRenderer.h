@@ -14,6 +14,8 @@
 #pragma once
 
 #include <terminal_renderer/Atlas.h>
+#include <terminal_renderer/FontCache.h>
+#include <terminal_renderer/RenderRow.h>
 
 #include <terminal/Color.h>
 #include <terminal/Screen.h>
@@ -21,7 +23,6 @@
 #include <text_shaper/font.h>
 #include <text_shaper/shaper.h>
 
-#include <crispy/FNV.h>
 #include <crispy/point.h>
 
 #include <unicode/run_segmenter.h>
@@ -32,49 +33,6 @@
 #include <unordered_map>
 #include <vector>
 
-namespace terminal::renderer
-{
-    using GlyphId = text::glyph_key;
-
-    struct CacheKey {
-        std::u32string_view text;
-        CharacterStyleMask styles;
-
-        bool operator==(CacheKey const& _rhs) const noexcept
-        {
-            return text == _rhs.text && styles == _rhs.styles;
-        }
-
-        bool operator!=(CacheKey const& _rhs) const noexcept
-        {
-            return !(*this == _rhs);
-        }
-
-        bool operator<(CacheKey const& _rhs) const noexcept
-        {
-            if (text < _rhs.text)
-                return true;
-
-            if (static_cast<unsigned>(styles) < static_cast<unsigned>(_rhs.styles))
-                return true;
-
-            return false;
-        }
-    };
-}
-
-namespace std
-{
-    template <>
-    struct hash<terminal::renderer::CacheKey> {
-        size_t operator()(terminal::renderer::CacheKey const& _key) const noexcept
-        {
-            auto fnv = crispy::FNV<char32_t>{};
-            return static_cast<size_t>(fnv(fnv(_key.text.data(), _key.text.size()), static_cast<char32_t>(_key.styles)));
-        }
-    };
-}
-
 namespace terminal::renderer {
 
 struct GridMetrics;
@@ -105,14 +63,6 @@ inline bool operator!=(FontDescriptions const& a, FontDescriptions const& b) noe
     return !(a == b);
 }
 
-struct FontKeys {
-    text::font_key regular;
-    text::font_key bold;
-    text::font_key italic;
-    text::font_key boldItalic;
-    text::font_key emoji;
-};
-
 /// Text Rendering Pipeline
 class TextRenderer {
   public:
@@ -121,7 +71,7 @@ class TextRenderer {
                  atlas::TextureAtlasAllocator& _colorAtlasAllocator,
                  atlas::TextureAtlasAllocator& _lcdAtlasAllocator,
                  GridMetrics const& _gridMetrics,
-                 text::shaper& _textShaper,
+                 FontCache& _fontCache,
                  FontDescriptions& _fontDescriptions,
                  FontKeys const& _fontKeys);
 
@@ -129,7 +79,8 @@ class TextRenderer {
 
     void setPressure(bool _pressure) noexcept { pressure_ = _pressure; }
 
-    void schedule(Coordinate const& _pos, Cell const& _cell, RGBColor const& _color);
+    /// Schedules all text of the given row for rendering, segmented into runs of equal style and color.
+    void renderRow(RenderRow const& _row);
     void flushPendingSegments();
     void finish();
 
@@ -174,6 +125,9 @@ class TextRenderer {
 
     TextureAtlas& atlasForFont(text::font_key _font);
 
+    /// @returns the glyph cache of the current fonts, shared with all other renderers using them.
+    GlyphCache& glyphCache();
+
     // general properties
     //
     GridMetrics const& gridMetrics_;
@@ -196,13 +150,10 @@ class TextRenderer {
     //
     bool pressure_ = false;
 
-    // text shaping cache
+    // text shaping and glyph rasterization cache
     //
-    std::list<std::u32string> cacheKeyStorage_;
-    std::unordered_map<CacheKey, text::shape_result> cache_;
-#if !defined(NDEBUG)
-    std::unordered_map<CacheKey, int64_t> cacheHits_;
-#endif
+    FontCache& fontCache_;
+    std::shared_ptr<GlyphCache> glyphCache_;
 
     // target surface rendering
     //
@@ -16,6 +16,8 @@
 #include <terminal_renderer/Atlas.h>
 
 #include <crispy/algorithm.h>
+#include <crispy/metrics.h>
+#include <crispy/trace.h>
 
 #include <algorithm>
 
@@ -453,6 +455,9 @@ void OpenGLRenderer::uploadTexture(atlas::UploadTexture const& _param)
 
     glTexSubImage3D(target, levelOfDetail, x0, y0, z0, texture.width, texture.height, depth,
                     glFormat(_param.format), type, _param.data.data());
+
+    CRISPY_METRICS_COUNT("gl.atlas_uploads", 1);
+    CRISPY_METRICS_COUNT("gl.atlas_upload_bytes", _param.data.size());
 }
 
 void OpenGLRenderer::renderTexture(atlas::RenderTexture const& _param)
@@ -529,6 +534,9 @@ void OpenGLRenderer::renderRectangle(unsigned _x, unsigned _y, unsigned _width,
 
 void OpenGLRenderer::execute()
 {
+    CRISPY_METRICS_TIME_SCOPE("render.execute");
+    CRISPY_TRACE_SPAN("render.execute");
+
     //FIXME
     //glEnable(GL_BLEND);
     //glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE);
@@ -539,6 +547,7 @@ void OpenGLRenderer::execute()
     //
     if (!rectBuffer_.empty())
     {
+        CRISPY_TRACE_SPAN("gl.rects");
         rectShader_->bind();
         rectShader_->setUniformValue(rectProjectionLocation_, projectionMatrix_);
 
@@ -572,21 +581,29 @@ void OpenGLRenderer::executeRenderTextures()
     //     textureScheduler_->renderTextures.size()
     // );
 
-    // potentially create new atlases
-    for (auto const& params : textureScheduler_->createAtlases)
-        createAtlas(params);
+    {
+        CRISPY_TRACE_SPAN("gl.atlas_upload");
+
+        // potentially create new atlases
+        for (auto const& params : textureScheduler_->createAtlases)
+            createAtlas(params);
+
+        // potentially upload any new textures
+        for (auto const& params : textureScheduler_->uploadTextures)
+            uploadTexture(params);
+    }
 
-    // potentially upload any new textures
-    for (auto const& params : textureScheduler_->uploadTextures)
-        uploadTexture(params);
+    {
+        CRISPY_TRACE_SPAN("gl.vertices");
 
-    // order and prepare texture geometry
-    sort(textureScheduler_->renderTextures.begin(),
-         textureScheduler_->renderTextures.end(),
-         [](auto const& a, auto const& b) { return a.texture.get().atlas < b.texture.get().atlas; });
+        // order and prepare texture geometry
+        sort(textureScheduler_->renderTextures.begin(),
+             textureScheduler_->renderTextures.end(),
+             [](auto const& a, auto const& b) { return a.texture.get().atlas < b.texture.get().atlas; });
 
-    for (auto const& params : textureScheduler_->renderTextures)
-        renderTexture(params);
+        for (auto const& params : textureScheduler_->renderTextures)
+            renderTexture(params);
+    }
 
     // upload vertices and render (iff there is anything to render)
     if (!textureScheduler_->renderTextures.empty())
@@ -594,13 +611,19 @@ void OpenGLRenderer::executeRenderTextures()
         glBindVertexArray(vao_);
 
         // upload buffer
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_);
-        glBufferData(GL_ARRAY_BUFFER,
-                     textureScheduler_->buffer.size() * sizeof(GLfloat),
-                     textureScheduler_->buffer.data(),
-                     GL_STREAM_DRAW);
+        {
+            CRISPY_TRACE_SPAN("gl.buffer_data");
+            glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+            glBufferData(GL_ARRAY_BUFFER,
+                         textureScheduler_->buffer.size() * sizeof(GLfloat),
+                         textureScheduler_->buffer.data(),
+                         GL_STREAM_DRAW);
+        }
 
-        glDrawArrays(GL_TRIANGLES, 0, textureScheduler_->vertexCount);
+        {
+            CRISPY_TRACE_SPAN("gl.draw");
+            glDrawArrays(GL_TRIANGLES, 0, textureScheduler_->vertexCount);
+        }
 
         // TODO: Instead of on glDrawArrays (and many if's in the shader for each GL_TEXTUREi),
         //       make a loop over each GL_TEXTUREi and draw a sub range of the vertices and a
@@ -0,0 +1,264 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal_renderer/software/Png.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+using namespace std;
+
+namespace terminal::renderer::software {
+
+namespace // {{{ helper
+{
+    constexpr string_view Signature = "\x89PNG\r\n\x1A\n";
+
+    uint32_t crc32(uint32_t _crc, string_view _data)
+    {
+        static auto const table = []() {
+            auto t = array<uint32_t, 256>{};
+            for (uint32_t n = 0; n < 256; ++n)
+            {
+                auto c = n;
+                for (int k = 0; k < 8; ++k)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[n] = c;
+            }
+            return t;
+        }();
+
+        auto c = _crc ^ 0xFFFFFFFFu;
+        for (char const ch : _data)
+            c = table[(c ^ static_cast<uint8_t>(ch)) & 0xFF] ^ (c >> 8);
+        return c ^ 0xFFFFFFFFu;
+    }
+
+    uint32_t adler32(string_view _data)
+    {
+        uint32_t a = 1;
+        uint32_t b = 0;
+        for (char const ch : _data)
+        {
+            a = (a + static_cast<uint8_t>(ch)) % 65521;
+            b = (b + a) % 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    void appendU32(string& _out, uint32_t _value)
+    {
+        _out.push_back(static_cast<char>((_value >> 24) & 0xFF));
+        _out.push_back(static_cast<char>((_value >> 16) & 0xFF));
+        _out.push_back(static_cast<char>((_value >> 8) & 0xFF));
+        _out.push_back(static_cast<char>(_value & 0xFF));
+    }
+
+    uint32_t readU32(string_view _data, size_t _offset)
+    {
+        return (static_cast<uint32_t>(static_cast<uint8_t>(_data[_offset])) << 24)
+             | (static_cast<uint32_t>(static_cast<uint8_t>(_data[_offset + 1])) << 16)
+             | (static_cast<uint32_t>(static_cast<uint8_t>(_data[_offset + 2])) << 8)
+             | static_cast<uint32_t>(static_cast<uint8_t>(_data[_offset + 3]));
+    }
+
+    void appendChunk(string& _out, string_view _type, string_view _data)
+    {
+        appendU32(_out, static_cast<uint32_t>(_data.size()));
+        auto const start = _out.size();
+        _out.append(_type);
+        _out.append(_data);
+        appendU32(_out, crc32(0, string_view(_out).substr(start)));
+    }
+
+    /// Wraps the data into a zlib stream of uncompressed deflate blocks.
+    string zlibStore(string_view _data)
+    {
+        auto out = string{"\x78\x01", 2};
+        do
+        {
+            auto const n = min(_data.size(), size_t{65535});
+            auto const last = n == _data.size();
+            out.push_back(last ? 1 : 0);
+            out.push_back(static_cast<char>(n & 0xFF));
+            out.push_back(static_cast<char>(n >> 8));
+            out.push_back(static_cast<char>(~n & 0xFF));
+            out.push_back(static_cast<char>((~n >> 8) & 0xFF));
+            out.append(_data.substr(0, n));
+            _data.remove_prefix(n);
+        }
+        while (!_data.empty());
+        return out;
+    }
+
+    [[noreturn]] void fail(string const& _message)
+    {
+        throw runtime_error{"Invalid PNG. " + _message};
+    }
+
+    /// Unwraps a zlib stream of uncompressed deflate blocks, as written by zlibStore().
+    string zlibUnstore(string_view _zlib)
+    {
+        if (_zlib.size() < 6 || (static_cast<uint8_t>(_zlib[0]) & 0x0F) != 8
+                || ((static_cast<uint8_t>(_zlib[0]) << 8) | static_cast<uint8_t>(_zlib[1])) % 31 != 0)
+            fail("Invalid zlib header.");
+
+        auto in = _zlib.substr(2, _zlib.size() - 6);
+        auto out = string{};
+
+        for (bool last = false; !last; )
+        {
+            if (in.size() < 5)
+                fail("Unexpected end of image data.");
+            auto const header = static_cast<uint8_t>(in[0]);
+            if ((header & 0x06) != 0)
+                throw runtime_error{"Unsupported PNG format. Only uncompressed image data is supported."};
+            last = header & 0x01;
+
+            auto const length = static_cast<size_t>(static_cast<uint8_t>(in[1]) | (static_cast<uint8_t>(in[2]) << 8));
+            auto const complement = static_cast<size_t>(static_cast<uint8_t>(in[3]) | (static_cast<uint8_t>(in[4]) << 8));
+            if ((length ^ complement) != 0xFFFF || length > in.size() - 5)
+                fail("Invalid uncompressed block.");
+
+            out.append(in.substr(5, length));
+            in.remove_prefix(5 + length);
+        }
+
+        if (!in.empty() || adler32(out) != readU32(_zlib, _zlib.size() - 4))
+            fail("Image data checksum mismatch.");
+
+        return out;
+    }
+} // }}}
+
+string encodePng(RGBAImage const& _image)
+{
+    auto header = string{};
+    appendU32(header, static_cast<uint32_t>(_image.width));
+    appendU32(header, static_cast<uint32_t>(_image.height));
+    header.append("\x08\x06\x00\x00\x00", 5); // 8 bit RGBA, deflate, no filtering, no interlacing
+
+    auto const stride = static_cast<size_t>(_image.width) * 4;
+    auto scanlines = string{};
+    scanlines.reserve((stride + 1) * static_cast<size_t>(_image.height));
+    for (int y = 0; y < _image.height; ++y)
+    {
+        scanlines.push_back(0); // filter type: none
+        scanlines.append(reinterpret_cast<char const*>(_image.pixel(0, y)), stride);
+    }
+
+    auto png = string{Signature};
+    appendChunk(png, "IHDR", header);
+    auto idat = zlibStore(scanlines);
+    appendU32(idat, adler32(scanlines));
+    appendChunk(png, "IDAT", idat);
+    appendChunk(png, "IEND", {});
+    return png;
+}
+
+RGBAImage decodePng(string_view _data)
+{
+    if (_data.substr(0, Signature.size()) != Signature)
+        fail("Missing signature.");
+
+    auto image = RGBAImage{};
+    auto channels = 0;
+    auto zlib = string{};
+
+    for (size_t pos = Signature.size(); ; )
+    {
+        if (_data.size() - pos < 12)
+            fail("Truncated chunk.");
+        auto const length = readU32(_data, pos);
+        if (length > _data.size() - pos - 12)
+            fail("Truncated chunk.");
+        auto const type = _data.substr(pos + 4, 4);
+        auto const chunk = _data.substr(pos + 8, length);
+        if (crc32(0, _data.substr(pos + 4, length + 4)) != readU32(_data, pos + 8 + length))
+            fail("Chunk checksum mismatch.");
+        pos += 12 + length;
+
+        if (type == "IHDR")
+        {
+            if (chunk.size() != 13)
+                fail("Invalid header.");
+            image.width = static_cast<int>(readU32(chunk, 0));
+            image.height = static_cast<int>(readU32(chunk, 4));
+            auto const depth = static_cast<uint8_t>(chunk[8]);
+            auto const colorType = static_cast<uint8_t>(chunk[9]);
+            auto const interlace = static_cast<uint8_t>(chunk[12]);
+            if (depth != 8 || (colorType != 2 && colorType != 6) || interlace != 0)
+                throw runtime_error{"Unsupported PNG format. Only 8 bit RGB(A) without interlacing is supported."};
+            channels = colorType == 6 ? 4 : 3;
+        }
+        else if (type == "IDAT")
+            zlib.append(chunk);
+        else if (type == "IEND")
+            break;
+    }
+
+    if (!channels || image.width <= 0 || image.height <= 0)
+        fail("Missing header.");
+
+    auto const stride = static_cast<size_t>(image.width) * static_cast<size_t>(channels);
+    auto const scanlines = zlibUnstore(zlib);
+    if (scanlines.size() < (stride + 1) * static_cast<size_t>(image.height))
+        fail("Not enough image data.");
+
+    image.pixels.resize(static_cast<size_t>(image.width) * static_cast<size_t>(image.height) * 4);
+    for (int y = 0; y < image.height; ++y)
+    {
+        auto const* line = reinterpret_cast<uint8_t const*>(scanlines.data()) + static_cast<size_t>(y) * (stride + 1);
+        if (line[0] != 0)
+            throw runtime_error{"Unsupported PNG format. Only unfiltered scanlines are supported."};
+
+        for (int x = 0; x < image.width; ++x)
+        {
+            auto* target = image.pixel(x, y);
+            auto const* source = line + 1 + static_cast<size_t>(x) * static_cast<size_t>(channels);
+            target[0] = source[0];
+            target[1] = source[1];
+            target[2] = source[2];
+            target[3] = channels == 4 ? source[3] : 0xFF;
+        }
+    }
+
+    return image;
+}
+
+void savePng(string const& _path, RGBAImage const& _image)
+{
+    auto file = ofstream{_path, ios::binary | ios::trunc};
+    if (!file.good())
+        throw runtime_error{"Could not create PNG file "s + _path + ": " + strerror(errno)};
+
+    auto const png = encodePng(_image);
+    file.write(png.data(), static_cast<streamsize>(png.size()));
+}
+
+RGBAImage loadPng(string const& _path)
+{
+    auto file = ifstream{_path, ios::binary};
+    if (!file.good())
+        throw runtime_error{"Could not open PNG file "s + _path + ": " + strerror(errno)};
+
+    auto const data = string{istreambuf_iterator<char>(file), istreambuf_iterator<char>()};
+    return decodePng(data);
+}
+
+} // end namespace
@@ -0,0 +1,64 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace terminal::renderer::software {
+
+/// 8-bit RGBA pixels, stored row by row from the top left.
+struct RGBAImage {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+
+    uint8_t const* pixel(int _x, int _y) const noexcept { return pixels.data() + (static_cast<size_t>(_y) * width + _x) * 4; }
+    uint8_t* pixel(int _x, int _y) noexcept { return pixels.data() + (static_cast<size_t>(_y) * width + _x) * 4; }
+};
+
+inline bool operator==(RGBAImage const& a, RGBAImage const& b) noexcept
+{
+    return a.width == b.width && a.height == b.height && a.pixels == b.pixels;
+}
+
+inline bool operator!=(RGBAImage const& a, RGBAImage const& b) noexcept
+{
+    return !(a == b);
+}
+
+/// Encodes the image as PNG file contents.
+///
+/// This is a minimal encoder without compression, meant for test and debug output.
+std::string encodePng(RGBAImage const& _image);
+
+/// Decodes 8-bit RGB or RGBA PNG file contents without compression, filtering or interlacing,
+/// i.e. as written by encodePng().
+///
+/// @throws std::runtime_error on invalid or unsupported data.
+RGBAImage decodePng(std::string_view _data);
+
+/// Writes the image into a PNG file.
+///
+/// @throws std::runtime_error if the file could not be written.
+void savePng(std::string const& _path, RGBAImage const& _image);
+
+/// Reads the image from a PNG file.
+///
+/// @throws std::runtime_error if the file could not be read or decoded.
+RGBAImage loadPng(std::string const& _path);
+
+} // end namespace
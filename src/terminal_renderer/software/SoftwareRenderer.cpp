@@ -0,0 +1,437 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal_renderer/software/SoftwareRenderer.h>
+
+#include <crispy/metrics.h>
+#include <crispy/trace.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+using std::clamp;
+using std::max;
+using std::min;
+
+namespace terminal::renderer::software {
+
+namespace // {{{ helper
+{
+    constexpr unsigned MaxInstanceCount = 1;
+    constexpr unsigned MaxTextureDepth = 16; // layers are allocated on demand only
+    constexpr unsigned MaxMonochromeTextureSize = 1024;
+    constexpr unsigned MaxColorTextureSize = 2048;
+
+    // Texture selectors as passed via TextureInfo::user (see text.frag).
+    constexpr unsigned MonochromeTexture = 0;
+    constexpr unsigned ColoredTexture = 1;
+    constexpr unsigned LcdTexture = 2;
+
+    constexpr uint8_t toByte(float _value) noexcept
+    {
+        return static_cast<uint8_t>(clamp(_value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    /// Exact integer approximation of (_value / 255), for _value in [0, 255 * 255].
+    constexpr unsigned div255(unsigned _value) noexcept
+    {
+        _value += 128;
+        return (_value + (_value >> 8)) >> 8;
+    }
+
+    // The blend functions below mirror
+    //     glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE)
+    // on 8-bit RGBA pixels. They are kept branch free over contiguous spans,
+    // so that the compiler can auto-vectorize them.
+
+    void blendSpan(uint8_t* _dst, uint8_t const* _src, size_t _count) noexcept
+    {
+        for (size_t i = 0; i < _count * 4; i += 4)
+        {
+            unsigned const sa = _src[i + 3];
+            unsigned const da = 255 - sa;
+            _dst[i + 0] = static_cast<uint8_t>(div255(_src[i + 0] * sa + _dst[i + 0] * da));
+            _dst[i + 1] = static_cast<uint8_t>(div255(_src[i + 1] * sa + _dst[i + 1] * da));
+            _dst[i + 2] = static_cast<uint8_t>(div255(_src[i + 2] * sa + _dst[i + 2] * da));
+            _dst[i + 3] = static_cast<uint8_t>(min(255u, sa + _dst[i + 3]));
+        }
+    }
+
+    /// Blends a single color, with per pixel coverage given by @p _mask.
+    void blendMask(uint8_t* _dst, uint8_t const* _mask, std::array<uint8_t, 4> _color, size_t _count) noexcept
+    {
+        unsigned const r = _color[0];
+        unsigned const g = _color[1];
+        unsigned const b = _color[2];
+        unsigned const a = _color[3];
+        for (size_t i = 0; i < _count; ++i)
+        {
+            unsigned const sa = div255(_mask[i] * a);
+            unsigned const da = 255 - sa;
+            uint8_t* p = _dst + i * 4;
+            p[0] = static_cast<uint8_t>(div255(r * sa + p[0] * da));
+            p[1] = static_cast<uint8_t>(div255(g * sa + p[1] * da));
+            p[2] = static_cast<uint8_t>(div255(b * sa + p[2] * da));
+            p[3] = static_cast<uint8_t>(min(255u, sa + p[3]));
+        }
+    }
+
+    void blendSolid(uint8_t* _dst, std::array<uint8_t, 4> _color, size_t _count) noexcept
+    {
+        unsigned const sa = _color[3];
+        unsigned const da = 255 - sa;
+        unsigned const r = _color[0] * sa;
+        unsigned const g = _color[1] * sa;
+        unsigned const b = _color[2] * sa;
+        for (size_t i = 0; i < _count * 4; i += 4)
+        {
+            _dst[i + 0] = static_cast<uint8_t>(div255(r + _dst[i + 0] * da));
+            _dst[i + 1] = static_cast<uint8_t>(div255(g + _dst[i + 1] * da));
+            _dst[i + 2] = static_cast<uint8_t>(div255(b + _dst[i + 2] * da));
+            _dst[i + 3] = static_cast<uint8_t>(min(255u, sa + _dst[i + 3]));
+        }
+    }
+
+    /// Fills a span with an opaque color, the fast path of blendSolid().
+    void fillSpan(uint8_t* _dst, std::array<uint8_t, 4> _color, size_t _count) noexcept
+    {
+        for (size_t i = 0; i < _count * 4; i += 4)
+            std::memcpy(_dst + i, _color.data(), 4);
+    }
+
+    /// Converts an LCD subpixel texel into RGBA, as done by renderLcdGlyph() in text.frag
+    /// (with no subpixel shift, as glyphs are always rendered at full pixels).
+    std::array<uint8_t, 4> lcdPixel(uint8_t const* _texel, std::array<float, 4> const& _color) noexcept
+    {
+        auto const r = static_cast<float>(_texel[0]) / 255.0f;
+        auto const g = static_cast<float>(_texel[1]) / 255.0f;
+        auto const b = static_cast<float>(_texel[2]) / 255.0f;
+
+        auto const rgbAvg = (r + g + b) / 3.0f;
+        auto const rgbMin = min(min(r, g), b);
+        auto const rgbMax = max(max(r, g), b);
+        auto const rgbMaxNormComplement = 1.0f - rgbMax;
+
+        return {
+            toByte(_color[0] * rgbMax + r * rgbMaxNormComplement),
+            toByte(_color[1] * rgbMax + g * rgbMaxNormComplement),
+            toByte(_color[2] * rgbMax + b * rgbMaxNormComplement),
+            toByte((rgbAvg * rgbMax + rgbMin * rgbMaxNormComplement) * _color[3])
+        };
+    }
+} // }}}
+
+struct SoftwareRenderer::Scheduler : public atlas::CommandListener
+{
+    explicit Scheduler(SoftwareRenderer& _renderer) : renderer{ _renderer } {}
+
+    SoftwareRenderer& renderer;
+    std::vector<atlas::RenderTexture> renderTextures;
+    std::vector<atlas::DestroyAtlas> destroyAtlases;
+
+    // Atlas creation and uploads take effect immediately, as there is no GPU to wait for,
+    // whereas rendering and destruction is deferred to execute(), as with OpenGL.
+
+    void createAtlas(atlas::CreateAtlas const& _atlas) override
+    {
+        renderer.createAtlas(_atlas);
+    }
+
+    void uploadTexture(atlas::UploadTexture const& _texture) override
+    {
+        renderer.uploadTexture(_texture);
+    }
+
+    void renderTexture(atlas::RenderTexture const& _render) override
+    {
+        renderTextures.emplace_back(_render);
+    }
+
+    void destroyAtlas(atlas::DestroyAtlas const& _atlas) override
+    {
+        destroyAtlases.push_back(_atlas);
+    }
+
+    void reset()
+    {
+        renderTextures.clear();
+        destroyAtlases.clear();
+    }
+};
+
+std::vector<uint8_t>& SoftwareRenderer::AtlasStorage::layer(unsigned _z)
+{
+    if (_z >= layers.size())
+        layers.resize(_z + 1);
+
+    auto& data = layers[_z];
+    if (data.empty())
+        data.resize(static_cast<size_t>(width) * height * static_cast<size_t>(atlas::element_count(format)));
+
+    return data;
+}
+
+SoftwareRenderer::SoftwareRenderer(int _width, int _height, int _leftMargin, int _bottomMargin) :
+    leftMargin_{ _leftMargin },
+    bottomMargin_{ _bottomMargin },
+    scheduler_{std::make_unique<Scheduler>(*this)},
+    monochromeAtlasAllocator_{
+        0,
+        MaxInstanceCount,
+        MaxTextureDepth,
+        MaxMonochromeTextureSize,
+        MaxMonochromeTextureSize,
+        atlas::Format::Red,
+        *scheduler_,
+        "monochromeAtlas"
+    },
+    coloredAtlasAllocator_{
+        1,
+        MaxInstanceCount,
+        MaxTextureDepth,
+        MaxColorTextureSize,
+        MaxColorTextureSize,
+        atlas::Format::RGBA,
+        *scheduler_,
+        "colorAtlas"
+    },
+    lcdAtlasAllocator_{
+        2,
+        MaxInstanceCount,
+        MaxTextureDepth,
+        MaxColorTextureSize,
+        MaxColorTextureSize,
+        atlas::Format::RGB,
+        *scheduler_,
+        "lcdAtlas"
+    }
+{
+    setRenderSize(_width, _height);
+}
+
+SoftwareRenderer::~SoftwareRenderer() = default;
+
+void SoftwareRenderer::setRenderSize(int _width, int _height)
+{
+    framebuffer_.width = max(_width, 0);
+    framebuffer_.height = max(_height, 0);
+    framebuffer_.pixels.assign(static_cast<size_t>(framebuffer_.width) * static_cast<size_t>(framebuffer_.height) * 4, 0);
+}
+
+void SoftwareRenderer::setMargin(int _left, int _bottom) noexcept
+{
+    leftMargin_ = _left;
+    bottomMargin_ = _bottom;
+}
+
+atlas::TextureAtlasAllocator& SoftwareRenderer::monochromeAtlasAllocator() noexcept
+{
+    return monochromeAtlasAllocator_;
+}
+
+atlas::TextureAtlasAllocator& SoftwareRenderer::coloredAtlasAllocator() noexcept
+{
+    return coloredAtlasAllocator_;
+}
+
+atlas::TextureAtlasAllocator& SoftwareRenderer::lcdAtlasAllocator() noexcept
+{
+    return lcdAtlasAllocator_;
+}
+
+atlas::CommandListener& SoftwareRenderer::textureScheduler()
+{
+    return *scheduler_;
+}
+
+void SoftwareRenderer::clearCache()
+{
+    monochromeAtlasAllocator_.clear();
+    coloredAtlasAllocator_.clear();
+    lcdAtlasAllocator_.clear();
+}
+
+void SoftwareRenderer::clear(RGBAColor _color) noexcept
+{
+    fillSpan(framebuffer_.pixels.data(),
+             {_color.red(), _color.green(), _color.blue(), _color.alpha()},
+             framebuffer_.pixels.size() / 4);
+}
+
+void SoftwareRenderer::createAtlas(atlas::CreateAtlas const& _param)
+{
+    atlases_[AtlasKey{_param.atlasName.get(), _param.atlas}] = AtlasStorage{
+        _param.width,
+        _param.height,
+        _param.format,
+        {}
+    };
+}
+
+void SoftwareRenderer::uploadTexture(atlas::UploadTexture const& _param)
+{
+    auto const& texture = _param.texture.get();
+    auto const i = atlases_.find(AtlasKey{texture.atlasName.get(), texture.atlas});
+    assert(i != atlases_.end() && "Texture ID not found in atlas map!");
+    if (i == atlases_.end())
+        return;
+
+    auto& storage = i->second;
+    auto const elementCount = static_cast<size_t>(atlas::element_count(storage.format));
+    auto const rowLength = texture.width * elementCount;
+    if (atlas::element_count(_param.format) != atlas::element_count(storage.format)
+            || _param.data.size() < rowLength * texture.height)
+        return;
+
+    auto& layer = storage.layer(texture.z);
+    for (unsigned y = 0; y < texture.height; ++y)
+        std::memcpy(layer.data() + ((texture.y + y) * storage.width + texture.x) * elementCount,
+                    _param.data.data() + y * rowLength,
+                    rowLength);
+
+    CRISPY_METRICS_COUNT("software.atlas_uploads", 1);
+    CRISPY_METRICS_COUNT("software.atlas_upload_bytes", _param.data.size());
+}
+
+void SoftwareRenderer::destroyAtlas(atlas::DestroyAtlas const& _param)
+{
+    atlases_.erase(AtlasKey{_param.atlasName.get(), _param.atlas});
+}
+
+void SoftwareRenderer::renderRectangle(unsigned _x, unsigned _y, unsigned _width, unsigned _height,
+                                       float _r, float _g, float _b, float _a)
+{
+    rectangles_.emplace_back(Rectangle{
+        static_cast<int>(_x),
+        static_cast<int>(_y),
+        static_cast<int>(_width),
+        static_cast<int>(_height),
+        {toByte(_r), toByte(_g), toByte(_b), toByte(_a)}
+    });
+}
+
+void SoftwareRenderer::executeRenderRectangle(Rectangle const& _rect)
+{
+    auto const x0 = clamp(_rect.x, 0, framebuffer_.width);
+    auto const x1 = clamp(_rect.x + _rect.width, 0, framebuffer_.width);
+    auto const y0 = clamp(_rect.y, 0, framebuffer_.height);
+    auto const y1 = clamp(_rect.y + _rect.height, 0, framebuffer_.height);
+    auto const count = static_cast<size_t>(max(x1 - x0, 0));
+    if (!count || _rect.color[3] == 0)
+        return;
+
+    for (int y = y0; y < y1; ++y)
+    {
+        auto* dst = framebuffer_.pixel(x0, framebuffer_.height - 1 - y);
+        if (_rect.color[3] == 255)
+            fillSpan(dst, _rect.color, count);
+        else
+            blendSolid(dst, _rect.color, count);
+    }
+}
+
+void SoftwareRenderer::renderTexture(atlas::RenderTexture const& _param)
+{
+    auto const& texture = _param.texture.get();
+    auto const i = atlases_.find(AtlasKey{texture.atlasName.get(), texture.atlas});
+    if (i == atlases_.end() || !texture.width || !texture.height)
+        return;
+
+    auto& storage = i->second;
+    auto const& layer = storage.layer(texture.z);
+    auto const elementCount = static_cast<size_t>(atlas::element_count(storage.format));
+
+    auto const targetWidth = static_cast<int>(texture.targetWidth);
+    auto const targetHeight = static_cast<int>(texture.targetHeight);
+    auto const x0 = clamp(_param.x, 0, framebuffer_.width);
+    auto const x1 = clamp(_param.x + targetWidth, 0, framebuffer_.width);
+    auto const y0 = clamp(_param.y, 0, framebuffer_.height);
+    auto const y1 = clamp(_param.y + targetHeight, 0, framebuffer_.height);
+    auto const count = static_cast<size_t>(max(x1 - x0, 0));
+    if (!count)
+        return;
+
+    // Nearest neighbour sampling at the pixel centers (GL_NEAREST), mapping the first texel row
+    // to the bottom of the target rectangle, as with the texture coordinates in OpenGLRenderer.
+    auto const sourceX = [&](int _x) -> size_t {
+        auto const u = static_cast<unsigned>(_x - _param.x);
+        return texture.x + (2 * u + 1) * texture.width / (2 * texture.targetWidth);
+    };
+    auto const sourceRow = [&](int _y) -> uint8_t const* {
+        auto const v = static_cast<unsigned>(_y - _param.y);
+        auto const row = texture.y + (2 * v + 1) * texture.height / (2 * texture.targetHeight);
+        return layer.data() + static_cast<size_t>(row) * storage.width * elementCount;
+    };
+
+    auto const color = std::array<uint8_t, 4>{
+        toByte(_param.color[0]), toByte(_param.color[1]), toByte(_param.color[2]), toByte(_param.color[3])
+    };
+
+    span_.resize(count * 4);
+    for (int y = y0; y < y1; ++y)
+    {
+        auto const* row = sourceRow(y);
+        auto* dst = framebuffer_.pixel(x0, framebuffer_.height - 1 - y);
+
+        switch (texture.user)
+        {
+            case ColoredTexture:
+                for (size_t k = 0; k < count; ++k)
+                    std::memcpy(&span_[k * 4], row + sourceX(x0 + static_cast<int>(k)) * elementCount, 4);
+                blendSpan(dst, span_.data(), count);
+                break;
+            case LcdTexture:
+                for (size_t k = 0; k < count; ++k)
+                {
+                    auto const pixel = lcdPixel(row + sourceX(x0 + static_cast<int>(k)) * elementCount, _param.color);
+                    std::memcpy(&span_[k * 4], pixel.data(), 4);
+                }
+                blendSpan(dst, span_.data(), count);
+                break;
+            case MonochromeTexture:
+            default:
+                for (size_t k = 0; k < count; ++k)
+                    span_[k] = row[sourceX(x0 + static_cast<int>(k)) * elementCount];
+                blendMask(dst, span_.data(), color, count);
+                break;
+        }
+    }
+}
+
+void SoftwareRenderer::execute()
+{
+    CRISPY_METRICS_TIME_SCOPE("render.execute");
+    CRISPY_TRACE_SPAN("render.execute");
+
+    // Same order as the OpenGLRenderer: filled rects first, then all textures in submission order.
+    {
+        CRISPY_TRACE_SPAN("software.rects");
+        for (auto const& rect : rectangles_)
+            executeRenderRectangle(rect);
+        rectangles_.clear();
+    }
+
+    {
+        CRISPY_TRACE_SPAN("software.textures");
+        for (auto const& params : scheduler_->renderTextures)
+            renderTexture(params);
+    }
+
+    for (auto const& params : scheduler_->destroyAtlases)
+        destroyAtlas(params);
+
+    scheduler_->reset();
+}
+
+} // end namespace
@@ -0,0 +1,118 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal_renderer/RenderTarget.h>
+#include <terminal_renderer/Atlas.h>
+#include <terminal_renderer/software/Png.h>
+
+#include <terminal/Color.h>
+
+#include <array>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace terminal::renderer::software {
+
+/**
+ * CPU rasterizing render target, compositing into an in-memory RGBA framebuffer.
+ *
+ * It implements the same coordinate system (origin at the bottom left), draw order
+ * and blending as the OpenGLRenderer, so that the Renderer can be run and verified
+ * without a GPU, e.g. for golden image tests or frame time benchmarks.
+ *
+ * @see OpenGLRenderer
+ */
+class SoftwareRenderer : public RenderTarget
+{
+  private:
+    struct Scheduler;
+
+  public:
+    SoftwareRenderer(int _width, int _height, int _leftMargin = 0, int _bottomMargin = 0);
+    ~SoftwareRenderer() override;
+
+    void setRenderSize(int _width, int _height) override;
+    void setMargin(int _left, int _bottom) noexcept override;
+
+    atlas::TextureAtlasAllocator& monochromeAtlasAllocator() noexcept override;
+    atlas::TextureAtlasAllocator& coloredAtlasAllocator() noexcept override;
+    atlas::TextureAtlasAllocator& lcdAtlasAllocator() noexcept override;
+
+    atlas::CommandListener& textureScheduler() override;
+
+    void renderRectangle(unsigned _x, unsigned _y, unsigned _width, unsigned _height,
+                         float _r, float _g, float _b, float _a) override;
+
+    void execute() override;
+
+    void clearCache() override;
+
+    /// Fills the whole framebuffer with the given color (the equivalent of glClear()).
+    void clear(RGBAColor _color) noexcept;
+
+    /// @returns the framebuffer contents, as of the last call to execute().
+    RGBAImage const& image() const noexcept { return framebuffer_; }
+
+    int leftMargin() const noexcept { return leftMargin_; }
+    int bottomMargin() const noexcept { return bottomMargin_; }
+
+  private:
+    struct Rectangle {
+        int x;
+        int y;
+        int width;
+        int height;
+        std::array<uint8_t, 4> color;
+    };
+
+    /// Texture storage of a single (3D) atlas, with its 2D layers allocated on first use.
+    struct AtlasStorage {
+        unsigned width;
+        unsigned height;
+        atlas::Format format;
+        std::vector<std::vector<uint8_t>> layers;
+
+        std::vector<uint8_t>& layer(unsigned _z);
+    };
+
+    using AtlasKey = std::pair<std::string, unsigned>;
+
+    void createAtlas(atlas::CreateAtlas const& _param);
+    void uploadTexture(atlas::UploadTexture const& _param);
+    void renderTexture(atlas::RenderTexture const& _param);
+    void destroyAtlas(atlas::DestroyAtlas const& _param);
+    void executeRenderRectangle(Rectangle const& _rect);
+
+    // -------------------------------------------------------------------------------------------
+    // private data members
+    //
+    RGBAImage framebuffer_;
+    int leftMargin_;
+    int bottomMargin_;
+
+    std::vector<Rectangle> rectangles_;
+    std::map<AtlasKey, AtlasStorage> atlases_;
+    std::vector<uint8_t> span_; // scratch buffer of one row of source pixels (RGBA)
+
+    std::unique_ptr<Scheduler> scheduler_;
+    atlas::TextureAtlasAllocator monochromeAtlasAllocator_;
+    atlas::TextureAtlasAllocator coloredAtlasAllocator_;
+    atlas::TextureAtlasAllocator lcdAtlasAllocator_;
+};
+
+} // end namespace
@@ -0,0 +1,207 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal_renderer/software/SoftwareRenderer.h>
+#include <terminal_renderer/software/Png.h>
+
+#include <crispy/stdfs.h>
+
+#include <catch2/catch.hpp>
+
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+using namespace std;
+using namespace terminal;
+using namespace terminal::renderer;
+using namespace terminal::renderer::software;
+
+namespace {
+    /// Compares the image against the golden image of the given name.
+    ///
+    /// Run the tests with UPDATE_GOLDEN_IMAGES=1 in the environment to (re)create the golden images.
+    /// On mismatch, the actual image is written into the temp directory for inspection.
+    void checkGoldenImage(string const& _name, RGBAImage const& _actual)
+    {
+        auto const goldenPath = (FileSystem::path(GOLDEN_IMAGE_DIR) / (_name + ".png")).string();
+
+        if (getenv("UPDATE_GOLDEN_IMAGES"))
+        {
+            savePng(goldenPath, _actual);
+            WARN("Updated golden image " << goldenPath);
+            return;
+        }
+
+        auto const expected = loadPng(goldenPath);
+        if (expected != _actual)
+        {
+            auto const actualPath = (FileSystem::temp_directory_path() / (_name + ".actual.png")).string();
+            savePng(actualPath, _actual);
+            FAIL("Rendered image differs from " << goldenPath << ", see " << actualPath);
+        }
+    }
+
+    /// @returns the RGBA value of the pixel at the given window coordinates (origin bottom left).
+    array<uint8_t, 4> pixelAt(SoftwareRenderer const& _renderer, int _x, int _y)
+    {
+        auto const* p = _renderer.image().pixel(_x, _renderer.image().height - 1 - _y);
+        return {p[0], p[1], p[2], p[3]};
+    }
+
+    /// Monochrome 8x8 glyph of a diamond shape with anti-aliased edges.
+    atlas::Buffer diamondGlyph()
+    {
+        auto glyph = atlas::Buffer(8 * 8);
+        for (int y = 0; y < 8; ++y)
+            for (int x = 0; x < 8; ++x)
+            {
+                auto const d = abs(2 * x - 7) + abs(2 * y - 7);
+                glyph[y * 8 + x] = static_cast<uint8_t>(d <= 6 ? 0xFF : d == 8 ? 0x80 : 0x00);
+            }
+        return glyph;
+    }
+
+    /// 4x4 RGBA image of four differently colored quadrants, with the upper ones being translucent.
+    atlas::Buffer quadrantImage()
+    {
+        auto image = atlas::Buffer{};
+        for (int y = 0; y < 4; ++y)
+            for (int x = 0; x < 4; ++x)
+            {
+                auto const left = x < 2;
+                auto const bottom = y < 2;
+                image.push_back(left ? 0xFF : 0x00);
+                image.push_back(bottom ? 0xFF : 0x00);
+                image.push_back(left && bottom ? 0x00 : 0xFF);
+                image.push_back(bottom ? 0xFF : 0x80);
+            }
+        return image;
+    }
+}
+
+TEST_CASE("Png.roundtrip", "[png]")
+{
+    auto image = RGBAImage{5, 3, {}};
+    for (int i = 0; i < 5 * 3 * 4; ++i)
+        image.pixels.push_back(static_cast<uint8_t>(i * 17));
+
+    auto const decoded = decodePng(encodePng(image));
+    CHECK(decoded == image);
+}
+
+TEST_CASE("Png.decode_compressed", "[png]")
+{
+    // 3x2 RGBA image, deflate compressed, with sub and paeth filtered scanlines.
+    static constexpr char data[] =
+        "\x89\x50\x4E\x47\x0D\x0A\x1A\x0A\x00\x00\x00\x0D\x49\x48\x44\x52"
+        "\x00\x00\x00\x03\x00\x00\x00\x02\x08\x06\x00\x00\x00\x9D\x74\x66"
+        "\x1A\x00\x00\x00\x22\x49\x44\x41\x54\x78\xDA\x63\xFC\xCF\xC0\xF0"
+        "\x9F\xF1\x3F\x43\x23\x03\xE3\xFF\x06\x16\x6E\x11\x39\x06\x0D\x63"
+        "\xB9\x7A\xB9\x80\xE8\x7A\x00\x6D\x4A\x07\x82\x82\x60\xED\x03\x00"
+        "\x00\x00\x00\x49\x45\x4E\x44\xAE\x42\x60\x82";
+
+    // Golden images are only ever written by encodePng(), so compressed ones are rejected.
+    CHECK_THROWS_AS(decodePng(string_view(data, sizeof(data) - 1)), runtime_error);
+}
+
+TEST_CASE("Png.decode_invalid", "[png]")
+{
+    CHECK_THROWS_AS(decodePng("not a PNG file"), runtime_error);
+    CHECK_THROWS_AS(decodePng(encodePng(RGBAImage{1, 1, {1, 2, 3, 4}}).substr(0, 40)), runtime_error);
+}
+
+TEST_CASE("SoftwareRenderer.coordinates", "[renderer]")
+{
+    auto renderer = SoftwareRenderer{4, 3};
+    renderer.clear(RGBAColor{0x000000FF});
+    renderer.renderRectangle(0, 0, 1, 1, 1.0f, 0.0f, 0.0f, 1.0f);
+    renderer.renderRectangle(3, 2, 1, 1, 0.0f, 0.0f, 1.0f, 1.0f);
+    renderer.execute();
+
+    // origin is at the bottom left, as with OpenGL
+    CHECK(renderer.image().pixel(0, 2)[0] == 0xFF);
+    CHECK(pixelAt(renderer, 0, 0) == array<uint8_t, 4>{0xFF, 0x00, 0x00, 0xFF});
+    CHECK(pixelAt(renderer, 3, 2) == array<uint8_t, 4>{0x00, 0x00, 0xFF, 0xFF});
+    CHECK(pixelAt(renderer, 1, 1) == array<uint8_t, 4>{0x00, 0x00, 0x00, 0xFF});
+}
+
+TEST_CASE("SoftwareRenderer.blending", "[renderer]")
+{
+    auto renderer = SoftwareRenderer{2, 1};
+    renderer.clear(RGBAColor{0xFFFFFF00});
+    renderer.renderRectangle(0, 0, 2, 1, 0.0f, 0.0f, 1.0f, 1.0f);
+    renderer.renderRectangle(1, 0, 1, 1, 1.0f, 0.0f, 0.0f, 0.5f);
+    renderer.execute();
+
+    CHECK(pixelAt(renderer, 0, 0) == array<uint8_t, 4>{0x00, 0x00, 0xFF, 0xFF});
+    CHECK(pixelAt(renderer, 1, 0) == array<uint8_t, 4>{0x80, 0x00, 0x7F, 0xFF});
+}
+
+TEST_CASE("SoftwareRenderer.clipping", "[renderer]")
+{
+    auto renderer = SoftwareRenderer{4, 4};
+    renderer.clear(RGBAColor{0x000000FF});
+    renderer.renderRectangle(2, 2, 100, 100, 0.0f, 1.0f, 0.0f, 1.0f);
+
+    auto const* glyph = renderer.monochromeAtlasAllocator().insert(8, 8, 8, 8, atlas::Format::Red, diamondGlyph());
+    REQUIRE(glyph != nullptr);
+    renderer.textureScheduler().renderTexture({*glyph, -4, -4, 0, {1.0f, 1.0f, 1.0f, 1.0f}});
+    renderer.execute();
+
+    CHECK(pixelAt(renderer, 3, 3) == array<uint8_t, 4>{0x00, 0xFF, 0x00, 0xFF});
+    CHECK(pixelAt(renderer, 0, 0) == array<uint8_t, 4>{0xFF, 0xFF, 0xFF, 0xFF});
+    CHECK(pixelAt(renderer, 3, 1) == array<uint8_t, 4>{0x00, 0x00, 0x00, 0xFF});
+}
+
+TEST_CASE("SoftwareRenderer.golden_rectangles", "[renderer][golden]")
+{
+    auto renderer = SoftwareRenderer{48, 32};
+    renderer.clear(RGBAColor{0x202020FF});
+    renderer.renderRectangle(2, 2, 20, 12, 0.8f, 0.1f, 0.1f, 1.0f);
+    renderer.renderRectangle(26, 2, 20, 12, 0.1f, 0.8f, 0.1f, 1.0f);
+    renderer.renderRectangle(2, 18, 44, 12, 0.1f, 0.1f, 0.8f, 1.0f);
+    renderer.renderRectangle(12, 8, 24, 16, 1.0f, 1.0f, 0.0f, 0.5f);
+    renderer.renderRectangle(0, 15, 48, 2, 1.0f, 1.0f, 1.0f, 0.25f);
+    renderer.execute();
+
+    checkGoldenImage("rectangles", renderer.image());
+}
+
+TEST_CASE("SoftwareRenderer.golden_textures", "[renderer][golden]")
+{
+    auto renderer = SoftwareRenderer{48, 32};
+    renderer.clear(RGBAColor{0x101030FF});
+    renderer.renderRectangle(0, 0, 24, 32, 0.9f, 0.9f, 0.9f, 1.0f);
+
+    auto& scheduler = renderer.textureScheduler();
+
+    // monochrome glyphs, tinted with their text color
+    auto const* glyph = renderer.monochromeAtlasAllocator().insert(8, 8, 8, 8, atlas::Format::Red, diamondGlyph());
+    REQUIRE(glyph != nullptr);
+    scheduler.renderTexture({*glyph, 2, 2, 0, {0.0f, 0.0f, 0.0f, 1.0f}});
+    scheduler.renderTexture({*glyph, 26, 2, 0, {1.0f, 0.5f, 0.0f, 1.0f}});
+    scheduler.renderTexture({*glyph, 36, 2, 0, {1.0f, 1.0f, 1.0f, 0.5f}});
+
+    // colored image, at its natural size and scaled up (nearest neighbour)
+    auto const* image = renderer.coloredAtlasAllocator().insert(4, 4, 4, 4, atlas::Format::RGBA, quadrantImage(), 1);
+    auto const* scaled = renderer.coloredAtlasAllocator().insert(4, 4, 16, 12, atlas::Format::RGBA, quadrantImage(), 1);
+    REQUIRE(image != nullptr);
+    REQUIRE(scaled != nullptr);
+    scheduler.renderTexture({*image, 14, 4, 0, {}});
+    scheduler.renderTexture({*scaled, 16, 16, 0, {}});
+
+    renderer.execute();
+
+    checkGoldenImage("textures", renderer.image());
+}
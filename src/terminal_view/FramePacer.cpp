@@ -0,0 +1,115 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal_view/FramePacer.h>
+
+#include <algorithm>
+#include <cmath>
+
+using std::chrono::duration;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+
+namespace terminal::view {
+
+namespace {
+    /// Weight of the latest sample in the frame cost's exponentially weighted moving average.
+    constexpr double SmoothingFactor = 0.25;
+
+    /// Time after which the throughput estimate has decayed to 1/e, if no output has been processed meanwhile.
+    ///
+    /// Samples are weighted by the time they span, so that the estimate does not depend on the frame rate.
+    constexpr auto ThroughputTimeConstant = std::chrono::milliseconds(250);
+
+    /// @returns the weight of an estimate that is @p _age old, relative to a fresh sample.
+    double decay(nanoseconds _age) noexcept
+    {
+        return std::exp(-duration<double>(_age).count() / duration<double>(ThroughputTimeConstant).count());
+    }
+
+    /// Fraction of the frame interval that rendering may take at most under pressure,
+    /// leaving the rest for processing the application's output.
+    constexpr double MaxRenderShare = 0.5;
+
+    /// Samples taken over shorter periods are too noisy to estimate throughput from.
+    constexpr auto MinSamplePeriod = std::chrono::milliseconds(1);
+}
+
+void FramePacer::onFrameRendered(clock::time_point _start, nanoseconds _cost, uint64_t _bytesProcessed) noexcept
+{
+    stats_.frames++;
+    if (pressure_)
+        stats_.pressureFrames++;
+    if (inputActive(_start))
+        stats_.inputFrames++;
+
+    stats_.frameCost = stats_.frameCost.count() == 0
+        ? _cost
+        : duration_cast<nanoseconds>(SmoothingFactor * _cost + (1.0 - SmoothingFactor) * stats_.frameCost);
+
+    auto const period = _start - lastFrame_;
+    if (lastFrame_ != clock::time_point{} && period >= MinSamplePeriod)
+    {
+        auto const bytes = _bytesProcessed - lastBytesProcessed_;
+        auto const rate = static_cast<double>(bytes) / duration<double>(period).count();
+        auto const weight = decay(period);
+        stats_.throughput = (1.0 - weight) * rate + weight * stats_.throughput;
+    }
+
+    lastFrame_ = _start;
+    lastBytesProcessed_ = _bytesProcessed;
+}
+
+nanoseconds FramePacer::nextFrameDelay(clock::time_point _now, bool _keyPressPending) noexcept
+{
+    pressure_ = policy_.adaptive
+             && !_keyPressPending
+             && !inputActive(_now)
+             && throughput(_now) >= static_cast<double>(policy_.pressureThroughput);
+
+    if (!pressure_)
+        return nanoseconds::zero();
+
+    auto const nextFrame = lastFrame_ + minFrameInterval();
+    if (nextFrame <= _now)
+        return nanoseconds::zero();
+
+    if (nextFrame != throttledFrame_)
+    {
+        throttledFrame_ = nextFrame;
+        stats_.throttledFrames++;
+    }
+    return nextFrame - _now;
+}
+
+double FramePacer::throughput(clock::time_point _now) const noexcept
+{
+    if (lastFrame_ == clock::time_point{} || _now <= lastFrame_)
+        return stats_.throughput;
+
+    return stats_.throughput * decay(_now - lastFrame_);
+}
+
+bool FramePacer::inputActive(clock::time_point _now) const noexcept
+{
+    return lastInput_ != clock::time_point{} && _now - lastInput_ < policy_.inputLatencyWindow;
+}
+
+nanoseconds FramePacer::minFrameInterval() const noexcept
+{
+    auto const cap = nanoseconds(std::chrono::seconds(1)) / std::max(policy_.maxFramesPerSecondUnderPressure, 1);
+    auto const costBound = duration_cast<nanoseconds>(stats_.frameCost / MaxRenderShare);
+    return std::max(cap, costBound);
+}
+
+} // end namespace
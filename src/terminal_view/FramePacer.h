@@ -0,0 +1,128 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdint>
+
+namespace terminal::view {
+
+/// Configures how frames are scheduled and when rendering is put under pressure.
+struct FramePacingPolicy {
+    /// Whether or not to throttle frames and enable render pressure under bulk output at all.
+    bool adaptive = true;
+
+    /// Frame rate cap while the application is producing bulk output.
+    int maxFramesPerSecondUnderPressure = 30;
+
+    /// Output processing rate (in bytes per second) from which on output is considered bulk output.
+    uint64_t pressureThroughput = 2 * 1024 * 1024;
+
+    /// Time window after keyboard input, in which frames are always rendered immediately.
+    std::chrono::milliseconds inputLatencyWindow{100};
+};
+
+/// Counters and current estimates of a FramePacer.
+struct FramePacerStats {
+    uint64_t frames = 0;                        // number of rendered frames
+    uint64_t pressureFrames = 0;                // frames rendered under pressure
+    uint64_t inputFrames = 0;                   // frames rendered within the input latency window
+    uint64_t throttledFrames = 0;               // frames that have been delayed to keep the frame rate cap
+    double throughput = 0;                      // output processing rate in bytes per second, as of the last frame
+    std::chrono::nanoseconds frameCost{};       // estimated time it takes to render a frame
+};
+
+/// Decides when the next frame is to be rendered and whether it should be rendered under pressure.
+///
+/// Frames are rendered right away after keyboard input or when the application's output is light.
+/// Under sustained bulk output, the frame rate gets capped (and further reduced, if frames become
+/// expensive), so that more time is left for processing the output, and the text renderer is
+/// put under pressure to avoid expensive text shaping.
+///
+/// This class is not thread-safe, it is meant to be used by the GUI thread only.
+class FramePacer {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    explicit FramePacer(FramePacingPolicy _policy = {}) : policy_{ _policy } {}
+
+    FramePacingPolicy const& policy() const noexcept { return policy_; }
+    void setPolicy(FramePacingPolicy _policy) noexcept { policy_ = _policy; }
+
+    /// Informs about keyboard input, which disables throttling for the input latency window.
+    void onInput(clock::time_point _now) noexcept { lastInput_ = _now; }
+
+    /// Informs about a rendered frame.
+    ///
+    /// @param _start          time the frame's rendering began.
+    /// @param _cost           time it took to render the frame.
+    /// @param _bytesProcessed total number of output bytes processed so far (monotonically increasing).
+    void onFrameRendered(clock::time_point _start, std::chrono::nanoseconds _cost, uint64_t _bytesProcessed) noexcept;
+
+    /// @returns the time to wait from @p _now on before rendering the next frame (zero for right away).
+    ///
+    /// Asking again before that frame has been rendered yields the remaining time, without counting
+    /// the frame as throttled once more.
+    ///
+    /// @param _keyPressPending whether the application's response to a key press is yet to be presented,
+    ///                         in which case the frame is never delayed, regardless of the input latency window.
+    std::chrono::nanoseconds nextFrameDelay(clock::time_point _now, bool _keyPressPending = false) noexcept;
+
+    /// Tests whether or not the next frame should be rendered under pressure.
+    bool pressure() const noexcept { return pressure_; }
+
+    /// @returns the estimated output processing rate in bytes per second, which decays while no frames are rendered.
+    double throughput(clock::time_point _now) const noexcept;
+
+    FramePacerStats const& stats() const noexcept { return stats_; }
+
+  private:
+    bool inputActive(clock::time_point _now) const noexcept;
+    std::chrono::nanoseconds minFrameInterval() const noexcept;
+
+    FramePacingPolicy policy_;
+    FramePacerStats stats_;
+    bool pressure_ = false;
+    clock::time_point lastInput_{};
+    clock::time_point lastFrame_{};
+    clock::time_point throttledFrame_{};    // time the last throttled frame has been delayed to
+    uint64_t lastBytesProcessed_ = 0;
+};
+
+} // end namespace
+
+namespace fmt // {{{
+{
+    template <>
+    struct formatter<terminal::view::FramePacerStats> {
+        template <typename ParseContext>
+        constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+        template <typename FormatContext>
+        auto format(terminal::view::FramePacerStats const& _stats, FormatContext& ctx)
+        {
+            return format_to(
+                ctx.out(),
+                "frames: {} (pressure {}, input {}, throttled {}), throughput: {:.2f} MB/s, frame cost: {} us",
+                _stats.frames,
+                _stats.pressureFrames,
+                _stats.inputFrames,
+                _stats.throttledFrames,
+                _stats.throughput / (1024.0 * 1024.0),
+                std::chrono::duration_cast<std::chrono::microseconds>(_stats.frameCost).count()
+            );
+        }
+    };
+} // }}}
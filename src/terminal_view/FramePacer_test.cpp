@@ -0,0 +1,99 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2020 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal_view/FramePacer.h>
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+
+using namespace terminal::view;
+using namespace std::chrono;
+
+namespace
+{
+    constexpr uint64_t MB = 1024 * 1024;
+
+    /// Renders frames 10 ms apart, each after 1 MB of output (100 MB/s), and returns the time of the last one.
+    ///
+    /// @param _bytes total number of output bytes processed before the first frame.
+    FramePacer::clock::time_point renderBulkOutput(FramePacer& _pacer,
+                                                   FramePacer::clock::time_point _start,
+                                                   uint64_t _bytes,
+                                                   int _frames)
+    {
+        auto now = _start;
+        for (int i = 0; i < _frames; ++i)
+        {
+            now = _start + milliseconds{10 * i};
+            _pacer.onFrameRendered(now, milliseconds{1}, _bytes + static_cast<uint64_t>(i) * MB);
+        }
+        return now;
+    }
+}
+
+TEST_CASE("FramePacer.light_output", "[view]")
+{
+    auto pacer = FramePacer{};
+    auto const start = FramePacer::clock::now();
+    pacer.onFrameRendered(start, milliseconds{1}, 0);
+    pacer.onFrameRendered(start + milliseconds{10}, milliseconds{1}, 1024);
+
+    CHECK(pacer.nextFrameDelay(start + milliseconds{11}) == nanoseconds::zero());
+    CHECK_FALSE(pacer.pressure());
+}
+
+TEST_CASE("FramePacer.throttled_frames", "[view]")
+{
+    auto pacer = FramePacer{};
+    auto const lastFrame = renderBulkOutput(pacer, FramePacer::clock::now(), 0, 20);
+    REQUIRE(pacer.throughput(lastFrame) > 50.0 * MB);
+
+    // The frame is delayed until the frame rate cap permits it, and counted as throttled only once.
+    auto const delay = pacer.nextFrameDelay(lastFrame + milliseconds{1});
+    CHECK(pacer.pressure());
+    CHECK(delay > milliseconds{25});
+    CHECK(pacer.nextFrameDelay(lastFrame + milliseconds{2}) == delay - milliseconds{1});
+    CHECK(pacer.nextFrameDelay(lastFrame + milliseconds{3}) == delay - milliseconds{2});
+    CHECK(pacer.stats().throttledFrames == 1);
+
+    // The next delayed frame is counted again.
+    auto const nextFrame = lastFrame + milliseconds{1} + delay;
+    pacer.onFrameRendered(nextFrame, milliseconds{1}, 25 * MB);
+    CHECK(pacer.nextFrameDelay(nextFrame + milliseconds{1}) > nanoseconds::zero());
+    CHECK(pacer.stats().throttledFrames == 2);
+
+    // Keyboard input is never throttled.
+    pacer.onInput(nextFrame + milliseconds{2});
+    CHECK(pacer.nextFrameDelay(nextFrame + milliseconds{2}) == nanoseconds::zero());
+    CHECK_FALSE(pacer.pressure());
+    CHECK(pacer.stats().throttledFrames == 2);
+}
+
+TEST_CASE("FramePacer.throughput_decays_while_idle", "[view]")
+{
+    auto pacer = FramePacer{};
+    auto const lastFrame = renderBulkOutput(pacer, FramePacer::clock::now(), 0, 20);
+    REQUIRE(pacer.nextFrameDelay(lastFrame + milliseconds{1}) > nanoseconds::zero());
+
+    // Output after a pause is not throttled because of the bulk output before it.
+    auto const later = lastFrame + seconds{3};
+    CHECK(pacer.throughput(later) < static_cast<double>(pacer.policy().pressureThroughput));
+    CHECK(pacer.nextFrameDelay(later) == nanoseconds::zero());
+    CHECK_FALSE(pacer.pressure());
+
+    // The estimate only decays from the last frame on, and recovers as soon as bulk output resumes.
+    CHECK(pacer.throughput(lastFrame) == pacer.stats().throughput);
+    renderBulkOutput(pacer, later, 20 * MB, 5);
+    CHECK(pacer.throughput(later + milliseconds{40}) > static_cast<double>(pacer.policy().pressureThroughput));
+}
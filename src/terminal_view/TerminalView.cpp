@@ -82,7 +82,7 @@ TerminalView::TerminalView(steady_clock::time_point _now,
     process_{ _shell, terminal_.device() },
     processExitWatcher_{ [this]() {
         (void) process_.wait();
-        terminal_.device().close();
+        terminal_.closeDevice();
     } },
     colorProfile_{_colorProfile},
     defaultColorProfile_{_colorProfile}
@@ -227,7 +227,7 @@ bool TerminalView::setTerminalSize(Size _cells)
 
 uint64_t TerminalView::render(steady_clock::time_point const& _now, bool _pressure)
 {
-    return renderer_.render(terminal_, _now, terminal().currentMousePosition(), _pressure);
+    return renderer_.render(terminal_, _now, _pressure);
 }
 
 Process::ExitStatus TerminalView::waitForProcessExit()